@@ -29,6 +29,19 @@ macro(_photon_add_unit_test test target file)
     )
 endmacro()
 
+# unit test for onboard code that does not depend on generated device sources
+macro(_photon_add_onboard_unit_test test file)
+    bmcl_add_unit_test(${test} ${_PHOTON_DIR}/tests/${file})
+    target_sources(${test} PRIVATE ${ARGN})
+    add_dependencies(${test} photon-gen-src)
+
+    target_include_directories(${test}
+        PRIVATE
+        ${PHOTON_GEN_SRC_ONBOARD_DIR}
+        ${_PHOTON_DIR}/modules
+    )
+endmacro()
+
 function(_photon_add_library target)
     bmcl_add_library(${target} ${ARGN})
     _photon_setup_target(${target})
@@ -93,10 +106,19 @@ macro(photon_init dir)
     set(PHOTON_GROUNDCONTROL_SRC
         ${_PHOTON_DIR}/src/photon/groundcontrol/AllowUnsafeMessageType.h
         ${_PHOTON_DIR}/src/photon/groundcontrol/Atoms.h
+        ${_PHOTON_DIR}/src/photon/groundcontrol/BlogParser.h
+        ${_PHOTON_DIR}/src/photon/groundcontrol/BlogReplay.cpp
+        ${_PHOTON_DIR}/src/photon/groundcontrol/BlogReplay.h
         ${_PHOTON_DIR}/src/photon/groundcontrol/CmdState.cpp
         ${_PHOTON_DIR}/src/photon/groundcontrol/CmdState.h
+        ${_PHOTON_DIR}/src/photon/groundcontrol/CompressedPackage.cpp
+        ${_PHOTON_DIR}/src/photon/groundcontrol/CompressedPackage.h
         ${_PHOTON_DIR}/src/photon/groundcontrol/Crc.cpp
         ${_PHOTON_DIR}/src/photon/groundcontrol/Crc.h
+        ${_PHOTON_DIR}/src/photon/groundcontrol/DeviceRouter.cpp
+        ${_PHOTON_DIR}/src/photon/groundcontrol/DeviceRouter.h
+        ${_PHOTON_DIR}/src/photon/groundcontrol/DfuPatch.cpp
+        ${_PHOTON_DIR}/src/photon/groundcontrol/DfuPatch.h
         ${_PHOTON_DIR}/src/photon/groundcontrol/DfuState.cpp
         ${_PHOTON_DIR}/src/photon/groundcontrol/DfuState.h
         ${_PHOTON_DIR}/src/photon/groundcontrol/Exchange.cpp
@@ -108,11 +130,21 @@ macro(photon_init dir)
         ${_PHOTON_DIR}/src/photon/groundcontrol/GcStructs.h
         ${_PHOTON_DIR}/src/photon/groundcontrol/GroundControl.cpp
         ${_PHOTON_DIR}/src/photon/groundcontrol/GroundControl.h
+        ${_PHOTON_DIR}/src/photon/groundcontrol/LinkBond.cpp
+        ${_PHOTON_DIR}/src/photon/groundcontrol/LinkBond.h
+        ${_PHOTON_DIR}/src/photon/groundcontrol/LogRecord.cpp
+        ${_PHOTON_DIR}/src/photon/groundcontrol/LogRecord.h
+        ${_PHOTON_DIR}/src/photon/groundcontrol/Lz4.cpp
+        ${_PHOTON_DIR}/src/photon/groundcontrol/Lz4.h
         ${_PHOTON_DIR}/src/photon/groundcontrol/MemIntervalSet.cpp
         ${_PHOTON_DIR}/src/photon/groundcontrol/MemIntervalSet.h
+        ${_PHOTON_DIR}/src/photon/groundcontrol/ProjectCache.cpp
+        ${_PHOTON_DIR}/src/photon/groundcontrol/ProjectCache.h
         ${_PHOTON_DIR}/src/photon/groundcontrol/ProjectUpdate.cpp
         ${_PHOTON_DIR}/src/photon/groundcontrol/ProjectUpdate.h
         ${_PHOTON_DIR}/src/photon/groundcontrol/TmParamUpdate.h
+        ${_PHOTON_DIR}/src/photon/groundcontrol/TmProcessor.cpp
+        ${_PHOTON_DIR}/src/photon/groundcontrol/TmProcessor.h
         ${_PHOTON_DIR}/src/photon/groundcontrol/TmState.cpp
         ${_PHOTON_DIR}/src/photon/groundcontrol/TmState.h
     )
@@ -143,6 +175,8 @@ macro(photon_init dir)
         ${_PHOTON_DIR}/src/photon/model/NodeViewUpdater.h
         ${_PHOTON_DIR}/src/photon/model/OnboardTime.cpp
         ${_PHOTON_DIR}/src/photon/model/OnboardTime.h
+        ${_PHOTON_DIR}/src/photon/model/TmDelta.cpp
+        ${_PHOTON_DIR}/src/photon/model/TmDelta.h
         ${_PHOTON_DIR}/src/photon/model/TmMsgDecoder.cpp
         ${_PHOTON_DIR}/src/photon/model/TmMsgDecoder.h
         ${_PHOTON_DIR}/src/photon/model/TmModel.cpp
@@ -186,6 +220,7 @@ macro(photon_init dir)
         ${PHOTON_GROUNDCONTROL_SRC}
         ${PHOTON_MODEL_SRC}
         ${PHOTON_GEN_SRC_GROUNDCONTROL_DIR}/Photon.cpp
+        ${_PHOTON_DIR}/modules/photon/blog/Lz4.c
     )
 
     add_dependencies(photon photon-gen-src)
@@ -205,6 +240,11 @@ macro(photon_init dir)
         ${_PHOTON_DIR}/thirdparty
         ${PHOTON_GEN_SRC_GROUNDCONTROL_DIR}
     )
+    # onboard lz4 decoder is shared with ground code
+    target_include_directories(photon
+        PRIVATE
+        ${_PHOTON_DIR}/modules
+    )
 
     qt5_wrap_cpp(PHOTON_UI_TEST_MOC
         ${_PHOTON_DIR}/tests/UiTest.h
@@ -231,6 +271,61 @@ macro(photon_init dir)
     _photon_add_ui_test(photon-client
     ${_PHOTON_DIR}/tests/Client.cpp
     )
+
+    _photon_add_onboard_unit_test(photon-test-tm-sched TmSchedTest.cpp
+        ${_PHOTON_DIR}/modules/photon/tm/Sched.c
+    )
+    _photon_add_onboard_unit_test(photon-test-ringbuf RingBufTest.cpp
+        ${_PHOTON_DIR}/modules/photon/core/RingBuf.c
+    )
+    _photon_add_onboard_unit_test(photon-test-spsc-ringbuf SpscRingBufTest.cpp
+        ${_PHOTON_DIR}/modules/photon/core/SpscRingBuf.c
+    )
+    _photon_add_onboard_unit_test(photon-test-deferred-logging LoggingTest.cpp
+        ${_PHOTON_DIR}/modules/photon/core/Logging.c
+        ${_PHOTON_DIR}/modules/photon/core/RingBuf.c
+    )
+    target_compile_definitions(photon-test-deferred-logging PRIVATE PHOTON_LOG_LEVEL=5 PHOTON_CFG_LOG_DEFERRED)
+    _photon_add_onboard_unit_test(photon-test-log-record LogRecordTest.cpp
+        ${_PHOTON_DIR}/modules/photon/core/Logging.c
+        ${_PHOTON_DIR}/modules/photon/core/RingBuf.c
+        ${_PHOTON_DIR}/src/photon/groundcontrol/LogRecord.cpp
+    )
+    target_compile_definitions(photon-test-log-record PRIVATE PHOTON_LOG_LEVEL=5 PHOTON_CFG_LOG_DEFERRED)
+    target_include_directories(photon-test-log-record PRIVATE ${_PHOTON_DIR}/src)
+    target_link_libraries(photon-test-log-record bmcl)
+    _photon_add_onboard_unit_test(photon-test-lz4 Lz4Test.cpp
+        ${_PHOTON_DIR}/modules/photon/blog/Lz4.c
+    )
+    _photon_add_onboard_unit_test(photon-test-fl-chunk-map FlChunkMapTest.cpp
+        ${_PHOTON_DIR}/modules/photon/fl/ChunkMap.c
+    )
+    _photon_add_onboard_unit_test(photon-test-dfu-patch DfuPatchTest.cpp
+        ${_PHOTON_DIR}/modules/photon/dfu/Patch.c
+        ${_PHOTON_DIR}/src/photon/groundcontrol/DfuPatch.cpp
+    )
+    target_include_directories(photon-test-dfu-patch PRIVATE ${_PHOTON_DIR}/src)
+    target_link_libraries(photon-test-dfu-patch bmcl)
+
+    bmcl_add_unit_test(photon-test-mem-interval-set ${_PHOTON_DIR}/tests/MemIntervalSet.cpp)
+    target_link_libraries(photon-test-mem-interval-set
+        decode
+        photon
+    )
+
+    bmcl_add_unit_test(photon-test-project-cache ${_PHOTON_DIR}/tests/ProjectCacheTest.cpp)
+    target_link_libraries(photon-test-project-cache
+        decode
+        photon
+    )
+
+    _photon_add_executable(photon-bench-crc ${_PHOTON_DIR}/tests/CrcBench.cpp)
+    add_dependencies(photon-bench-crc photon-gen-src)
+    target_include_directories(photon-bench-crc
+        PRIVATE
+        ${PHOTON_GEN_SRC_ONBOARD_DIR}
+        ${_PHOTON_DIR}/modules
+    )
 endmacro()
 
 macro(photon_generate_sources proj)
@@ -251,9 +346,64 @@ macro(photon_generate_sources proj)
         DEPENDS decode-gen ${proj} ${_PHOTON_MOD_SOURCES}
     )
     add_custom_target(photon-gen-src DEPENDS ${_PHOTON_DEPENDS})
+
+    # table of log format and file name strings, used to format deferred log records outside the image
+    set(_PHOTON_LOG_STRINGS ${CMAKE_CURRENT_BINARY_DIR}/photon-log-strings.txt)
+    add_executable(photon-log-strings
+        ${_PHOTON_DIR}/tools/LogStrings.cpp
+        ${_PHOTON_DIR}/src/photon/groundcontrol/LogRecord.cpp
+    )
+    target_include_directories(photon-log-strings PRIVATE ${_PHOTON_DIR}/src)
+    target_link_libraries(photon-log-strings bmcl tclap)
+    add_custom_command(
+        OUTPUT ${_PHOTON_LOG_STRINGS}
+        COMMAND ${CMAKE_CROSSCOMPILING_EMULATOR} $<TARGET_FILE:photon-log-strings> -o ${_PHOTON_LOG_STRINGS} ${_PHOTON_MOD_SOURCES}
+        DEPENDS photon-log-strings ${_PHOTON_MOD_SOURCES}
+    )
+    add_custom_target(photon-log-strings-table ALL DEPENDS ${_PHOTON_LOG_STRINGS})
     install(DIRECTORY ${PHOTON_GEN_SRC_ONBOARD_DIR}/photon DESTINATION gen)
     install(DIRECTORY ${PHOTON_GEN_SRC_GROUNDCONTROL_DIR}/photon DESTINATION gen)
     install(FILES ${_PHOTON_DEPENDS} ${_PHOTON_DEPENDS_H} DESTINATION gen)
+    install(FILES ${_PHOTON_LOG_STRINGS} DESTINATION gen)
+endmacro()
+
+# host tool compressing generated package of a device, served by fwt module instead of raw package
+macro(_photon_add_package_lz4 target upper)
+    set(_PACKAGE_FILE PackageLz4-${target}.h)
+    set(_PACKAGE_PATH ${CMAKE_CURRENT_BINARY_DIR}/_photon_package/${_PACKAGE_FILE})
+
+    add_executable(photon-package-compress-${target}
+        ${_PHOTON_DIR}/tools/PackageCompress.c
+        ${_PHOTON_DIR}/modules/photon/blog/Lz4.c
+    )
+    add_dependencies(photon-package-compress-${target} photon-gen-src)
+    target_compile_definitions(photon-package-compress-${target} PRIVATE
+        PHOTON_DEVICE_${upper}
+        PHOTON_CFG_LZ4_HASH_BITS=14
+    )
+    target_include_directories(photon-package-compress-${target}
+        PRIVATE
+        ${PHOTON_GEN_SRC_ONBOARD_DIR}
+        ${_PHOTON_DIR}/modules
+    )
+
+    add_custom_command(
+        OUTPUT ${_PACKAGE_PATH}
+        COMMAND ${CMAKE_COMMAND} -E make_directory ${CMAKE_CURRENT_BINARY_DIR}/_photon_package
+        COMMAND ${CMAKE_CROSSCOMPILING_EMULATOR} $<TARGET_FILE:photon-package-compress-${target}> ${_PACKAGE_PATH}
+        DEPENDS photon-package-compress-${target}
+    )
+    add_custom_target(photon-package-lz4-${target} DEPENDS ${_PACKAGE_PATH})
+    add_dependencies(photon-target-${target} photon-package-lz4-${target})
+
+    target_compile_definitions(photon-target-${target} PUBLIC
+        PHOTON_CFG_FWT_PACKAGE_LZ4=1
+        "PHOTON_FWT_PACKAGE_LZ4_FILE=\"${_PACKAGE_FILE}\""
+    )
+    target_include_directories(photon-target-${target}
+        PRIVATE
+        ${CMAKE_CURRENT_BINARY_DIR}/_photon_package
+    )
 endmacro()
 
 macro(photon_add_device target)
@@ -295,10 +445,23 @@ macro(photon_add_device target)
         )
     endif()
 
+    if (PHOTON_FWT_PACKAGE_LZ4)
+        _photon_add_package_lz4(${target} ${_TARGET_UPPER})
+    endif()
+
     _photon_add_model_ui_test(photon-model-inproc ${target} ${_PHOTON_DIR}/tests/InprocTest.cpp)
     _photon_add_model_ui_test(photon-model-udpserver ${target} ${_PHOTON_DIR}/tests/Model.cpp)
-
-    #_photon_add_unit_test(photon-test-fwt ${target} FwtTest.cpp)
+    _photon_add_model_ui_test(photon-bench-pipeline ${target} ${_PHOTON_DIR}/tests/PipelineBench.cpp)
+    _photon_add_model_ui_test(photon-bench-project-load ${target} ${_PHOTON_DIR}/tests/ProjectLoadBench.cpp)
+
+    _photon_add_unit_test(photon-test-fwt ${target} FwtTest.cpp)
+    _photon_add_unit_test(photon-test-exc-queue ${target} ExcQueueTest.cpp)
+    _photon_add_unit_test(photon-test-exc-rate ${target} ExcRateTest.cpp)
+    _photon_add_unit_test(photon-test-tm-delta ${target} TmDeltaTest.cpp)
+    _photon_add_unit_test(photon-test-dfu ${target} DfuTest.cpp)
+    _photon_add_unit_test(photon-test-duplicate-filter ${target} DuplicateFilterTest.cpp)
+    _photon_add_unit_test(photon-test-link-bond ${target} LinkBondTest.cpp)
+    _photon_add_unit_test(photon-test-device-router ${target} DeviceRouterTest.cpp)
 endmacro()
 
 macro(photon_init_project)
@@ -318,7 +481,9 @@ macro(photon_init_project)
         foreach (lib ${_PHOTON_${dev}_LINK_LIBRARIES})
             target_link_libraries(photon-model-inproc-${dev} ${lib})
             target_link_libraries(photon-model-udpserver-${dev} ${lib})
-            #target_link_libraries(photon-test-fwt-${dev} ${lib})
+            target_link_libraries(photon-bench-pipeline-${dev} ${lib})
+            target_link_libraries(photon-bench-project-load-${dev} ${lib})
+            target_link_libraries(photon-test-fwt-${dev} ${lib})
         endforeach()
     endforeach()
     photon_generate_sources(${_ARGS_PROJECT})
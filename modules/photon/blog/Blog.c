@@ -1,6 +1,10 @@
 #include "photongen/onboard/blog/Blog.Component.h"
 #include "photongen/onboard/clk/Clk.Component.h"
 #include "photon/core/Logging.h"
+#include "photon/core/Crc.h"
+#include "photon/core/Endian.h"
+#include "photon/core/Util.h"
+#include "photon/blog/Lz4.h"
 
 #ifdef PHOTON_HAS_MODULE_FWT
 # include "photongen/onboard/fwt/Fwt.Component.h"
@@ -11,15 +15,145 @@
 
 #define _PHOTON_FNAME "blog/Blog.c"
 
+// log stream is split into blocks of this size, each block is compressed separately
+#ifndef PHOTON_CFG_BLOG_BLOCK_SIZE
+# define PHOTON_CFG_BLOG_BLOCK_SIZE 2048
+#endif
+
+// size of PhotonBlog_HandleLogData calls, should be a multiple of storage sector size
+#ifndef PHOTON_CFG_BLOG_WRITE_SIZE
+# define PHOTON_CFG_BLOG_WRITE_SIZE 4096
+#endif
+
+#ifndef PHOTON_CFG_BLOG_COMPRESSION
+# define PHOTON_CFG_BLOG_COMPRESSION 1
+#endif
+
+// deferred log records are moved to binary log in parts of this size, should fit at least one record
+#ifndef PHOTON_CFG_BLOG_LOG_RECORDS_SIZE
+# define PHOTON_CFG_BLOG_LOG_RECORDS_SIZE 512
+#endif
+
+// partially filled block is flushed from tick if it is older than this (ms), 0 disables timed flush
+#ifndef PHOTON_CFG_BLOG_FLUSH_INTERVAL
+# define PHOTON_CFG_BLOG_FLUSH_INTERVAL 1000
+#endif
+
+// file: ["pblk"][u8 version][blocks]
+// block: [u16be sync][u8 flags][u16le rawSize][u16le storedSize][u16le crc][stored data]
+// crc covers flags, sizes and stored data, blocks decompressed in order form the log stream:
+// ["blog"][varuint nameSize][name][varuint projectSize][project][records]
+#define BLOCK_SYNC 0xb10c
+#define BLOCK_FLAG_LZ4 1
+#define BLOCK_HEADER_SIZE 9
+#define FILE_VERSION 1
+
 static const char magicPrefix[4] = "blog";
+static const char fileMagicPrefix[4] = "pblk";
+
+static uint8_t rawBlock[PHOTON_CFG_BLOG_BLOCK_SIZE];
+static size_t rawBlockSize;
+#if PHOTON_CFG_BLOG_COMPRESSION
+static uint8_t packedBlock[PHOTON_CFG_BLOG_BLOCK_SIZE];
+static uint16_t lz4Table[PHOTON_LZ4_HASH_TABLE_SIZE];
+#endif
+// HandleLogData has to finish with data before returning, buffer is reused right after
+static uint8_t outBuffer[PHOTON_CFG_BLOG_WRITE_SIZE];
+static size_t outBufferSize;
+// time of oldest data not passed to HandleLogData
+static PhotonClkTimePoint pendingSince;
+
+static void flushOut()
+{
+    if (outBufferSize == 0) {
+        return;
+    }
+    PhotonBlog_HandleLogData(outBuffer, outBufferSize);
+    outBufferSize = 0;
+}
+
+static void writeOut(const void* data, size_t size)
+{
+    const uint8_t* src = (const uint8_t*)data;
+    while (size != 0) {
+        size_t chunkSize = PHOTON_MIN(size, PHOTON_CFG_BLOG_WRITE_SIZE - outBufferSize);
+        memcpy(outBuffer + outBufferSize, src, chunkSize);
+        outBufferSize += chunkSize;
+        src += chunkSize;
+        size -= chunkSize;
+        if (outBufferSize == PHOTON_CFG_BLOG_WRITE_SIZE) {
+            flushOut();
+        }
+    }
+}
+
+static void flushBlock()
+{
+    if (rawBlockSize == 0) {
+        return;
+    }
+    const uint8_t* data = rawBlock;
+    size_t storedSize = rawBlockSize;
+    uint8_t flags = 0;
+#if PHOTON_CFG_BLOG_COMPRESSION
+    // stored uncompressed if compression doesn't save anything
+    size_t packedSize = PhotonLz4_Compress(rawBlock, rawBlockSize, packedBlock, rawBlockSize - 1, lz4Table);
+    if (packedSize != 0) {
+        data = packedBlock;
+        storedSize = packedSize;
+        flags |= BLOCK_FLAG_LZ4;
+    }
+#endif
+    uint8_t header[BLOCK_HEADER_SIZE];
+    Photon_Be16Enc(header, BLOCK_SYNC);
+    header[2] = flags;
+    Photon_Le16Enc(header + 3, (uint16_t)rawBlockSize);
+    Photon_Le16Enc(header + 5, (uint16_t)storedSize);
+    uint16_t crc = Photon_Crc16Update(Photon_Crc16(header + 2, 5), data, storedSize);
+    Photon_Le16Enc(header + 7, crc);
+    writeOut(header, sizeof(header));
+    writeOut(data, storedSize);
+    rawBlockSize = 0;
+}
+
+static void appendData(const void* data, size_t size)
+{
+    if (rawBlockSize == 0 && outBufferSize == 0) {
+        pendingSince = PhotonClk_GetTickTime();
+    }
+    const uint8_t* src = (const uint8_t*)data;
+    while (size != 0) {
+        size_t chunkSize = PHOTON_MIN(size, PHOTON_CFG_BLOG_BLOCK_SIZE - rawBlockSize);
+        memcpy(rawBlock + rawBlockSize, src, chunkSize);
+        rawBlockSize += chunkSize;
+        src += chunkSize;
+        size -= chunkSize;
+        if (rawBlockSize == PHOTON_CFG_BLOG_BLOCK_SIZE) {
+            flushBlock();
+        }
+    }
+}
+
+void PhotonBlog_Flush()
+{
+    flushBlock();
+    flushOut();
+}
 
 void PhotonBlog_Init()
 {
     _photonBlog.pvuCmdLogEnabled = true;
     _photonBlog.tmMsgLogEnabled = true;
     _photonBlog.fwtCmdLogEnabled = true;
+    _photonBlog.logRecordsEnabled = true;
+    rawBlockSize = 0;
+    outBufferSize = 0;
+    pendingSince = PhotonClk_GetTickTime();
     PhotonBlog_HandleBeginLog();
-    PhotonBlog_HandleLogData(magicPrefix, sizeof(magicPrefix));
+    uint8_t version = FILE_VERSION;
+    writeOut(fileMagicPrefix, sizeof(fileMagicPrefix));
+    writeOut(&version, 1);
+    appendData(magicPrefix, sizeof(magicPrefix));
 
     uint8_t buf[8];
     PhotonWriter dest;
@@ -27,22 +161,43 @@ void PhotonBlog_Init()
 
     size_t nameSize = strlen(PHOTON_DEVICE_NAME);
     assert(PhotonWriter_WriteVaruint(&dest, nameSize) == PhotonError_Ok);
-    PhotonBlog_HandleLogData(dest.start, dest.current - dest.start);
-    PhotonBlog_HandleLogData(PHOTON_DEVICE_NAME, nameSize);
+    appendData(dest.start, dest.current - dest.start);
+    appendData(PHOTON_DEVICE_NAME, nameSize);
 
     dest.current = dest.start;
 #ifdef PHOTON_HAS_MODULE_FWT
     assert(PhotonWriter_WriteVaruint(&dest, PhotonFwt_GetFirmwareSize()) == PhotonError_Ok);
-    PhotonBlog_HandleLogData(dest.start, dest.current - dest.start);
-    PhotonBlog_HandleLogData(PhotonFwt_GetFirmwareData(), PhotonFwt_GetFirmwareSize());
+    appendData(dest.start, dest.current - dest.start);
+    appendData(PhotonFwt_GetFirmwareData(), PhotonFwt_GetFirmwareSize());
 #else
     assert(PhotonWriter_WriteVaruint(&dest, 0) == PhotonError_Ok);
-    PhotonBlog_HandleLogData(dest.start, dest.current - dest.start);
+    appendData(dest.start, dest.current - dest.start);
 #endif
 }
 
+static void logMsg(PhotonBlogMsgKind kind, const void* data, size_t size);
+
 void PhotonBlog_Tick()
 {
+#if defined(PHOTON_CFG_LOG_DEFERRED) && PHOTON_LOG_LEVEL != PHOTON_LOG_LEVEL_NONE
+    if (_photonBlog.logRecordsEnabled) {
+        uint8_t records[PHOTON_CFG_BLOG_LOG_RECORDS_SIZE];
+        size_t size;
+        while ((size = Photon_ReadLogRecords(records, sizeof(records))) != 0) {
+            logMsg(PhotonBlogMsgKind_LogRecords, records, size);
+        }
+    }
+#endif
+#if PHOTON_CFG_BLOG_FLUSH_INTERVAL != 0
+    if (rawBlockSize == 0 && outBufferSize == 0) {
+        return;
+    }
+    PhotonClkTimePoint now = PhotonClk_GetTickTime();
+    // time correction can move clock backwards
+    if (now < pendingSince || (now - pendingSince) >= PHOTON_CFG_BLOG_FLUSH_INTERVAL) {
+        PhotonBlog_Flush();
+    }
+#endif
 }
 
 static bool isLogEnabled(PhotonBlogMsgKind kind)
@@ -54,6 +209,8 @@ static bool isLogEnabled(PhotonBlogMsgKind kind)
         return _photonBlog.tmMsgLogEnabled;
     case PhotonBlogMsgKind_FwtCmd:
         return _photonBlog.fwtCmdLogEnabled;
+    case PhotonBlogMsgKind_LogRecords:
+        return _photonBlog.logRecordsEnabled;
     }
     return false;
 }
@@ -70,6 +227,9 @@ void PhotonBlog_EnableLog(PhotonBlogMsgKind kind, bool isEnabled)
     case PhotonBlogMsgKind_FwtCmd:
         _photonBlog.fwtCmdLogEnabled = isEnabled;
         break;
+    case PhotonBlogMsgKind_LogRecords:
+        _photonBlog.logRecordsEnabled = isEnabled;
+        break;
     }
 }
 
@@ -97,8 +257,8 @@ static void logMsg(PhotonBlogMsgKind kind, const void* data, size_t size)
         return;
     }
 
-    PhotonBlog_HandleLogData(dest.start, dest.current - dest.start);
-    PhotonBlog_HandleLogData(data, size);
+    appendData(dest.start, dest.current - dest.start);
+    appendData(data, size);
 }
 
 void PhotonBlog_LogTmMsg(const void* data, size_t size)
@@ -125,6 +285,7 @@ PhotonError PhotonBlog_ExecCmd_EnableLog(PhotonBlogMsgKind kind, bool isEnabled)
 #ifdef PHOTON_STUB
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <time.h>
 #include <assert.h>
 
@@ -132,6 +293,13 @@ static const char* blogPathFormat = "photon-model-" PHOTON_DEVICE_NAME "-blog_%s
 
 FILE* logFile = NULL;
 
+static void closeLog()
+{
+    PhotonBlog_Flush();
+    fclose(logFile);
+    logFile = NULL;
+}
+
 void PhotonBlog_HandleBeginLog()
 {
     time_t t = time(NULL);
@@ -144,6 +312,11 @@ void PhotonBlog_HandleBeginLog()
 
     PHOTON_DEBUG("%s", pathStr);
 
+    if (logFile) {
+        fclose(logFile);
+    } else {
+        atexit(closeLog);
+    }
     logFile = fopen(pathStr, "w");
     assert(logFile);
     fflush(logFile);
@@ -152,6 +325,7 @@ void PhotonBlog_HandleBeginLog()
 void PhotonBlog_HandleLogData(const void* data, size_t size)
 {
     fwrite(data, 1, size, logFile);
+    fflush(logFile);
 }
 
 #endif
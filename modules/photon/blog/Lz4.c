@@ -0,0 +1,183 @@
+#include "photon/blog/Lz4.h"
+
+#include <string.h>
+
+#define MIN_MATCH 4
+// last match must start at least 12 bytes before end, last 5 bytes are always literals
+#define MF_LIMIT 12
+#define LAST_LITERALS 5
+#define MAX_OFFSET 65535
+
+static inline uint32_t read32(const uint8_t* src)
+{
+    uint32_t value;
+    memcpy(&value, src, 4);
+    return value;
+}
+
+static inline uint32_t hash32(uint32_t value)
+{
+    return (value * 2654435761u) >> (32 - PHOTON_CFG_LZ4_HASH_BITS);
+}
+
+static uint8_t* writeLength(uint8_t* dest, const uint8_t* destEnd, size_t length)
+{
+    while (length >= 255) {
+        if (dest == destEnd) {
+            return 0;
+        }
+        *dest++ = 255;
+        length -= 255;
+    }
+    if (dest == destEnd) {
+        return 0;
+    }
+    *dest++ = (uint8_t)length;
+    return dest;
+}
+
+// match is omitted if matchLength is 0
+static uint8_t* writeSequence(uint8_t* dest, const uint8_t* destEnd, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength)
+{
+    if (dest == destEnd) {
+        return 0;
+    }
+    uint8_t* token = dest++;
+    *token = (uint8_t)((literalLength >= 15 ? 15 : literalLength) << 4);
+    if (literalLength >= 15) {
+        dest = writeLength(dest, destEnd, literalLength - 15);
+        if (!dest) {
+            return 0;
+        }
+    }
+    if ((size_t)(destEnd - dest) < literalLength) {
+        return 0;
+    }
+    memcpy(dest, literals, literalLength);
+    dest += literalLength;
+    if (matchLength == 0) {
+        return dest;
+    }
+
+    if (destEnd - dest < 2) {
+        return 0;
+    }
+    *dest++ = (uint8_t)offset;
+    *dest++ = (uint8_t)(offset >> 8);
+    size_t length = matchLength - MIN_MATCH;
+    *token |= (uint8_t)(length >= 15 ? 15 : length);
+    if (length >= 15) {
+        dest = writeLength(dest, destEnd, length - 15);
+    }
+    return dest;
+}
+
+size_t PhotonLz4_Compress(const void* src, size_t srcSize, void* dest, size_t destSize, uint16_t* table)
+{
+    const uint8_t* in = (const uint8_t*)src;
+    uint8_t* out = (uint8_t*)dest;
+    const uint8_t* outEnd = out + destSize;
+    if (srcSize > 65536) {
+        return 0;
+    }
+
+    size_t anchor = 0;
+    if (srcSize > MF_LIMIT) {
+        memset(table, 0, PHOTON_LZ4_HASH_TABLE_SIZE * sizeof(uint16_t));
+        size_t matchLimit = srcSize - LAST_LITERALS;
+        size_t i = 0;
+        while (i < srcSize - MF_LIMIT) {
+            uint32_t value = read32(in + i);
+            uint32_t h = hash32(value);
+            size_t candidate = table[h];
+            table[h] = (uint16_t)i;
+            if (candidate >= i || i - candidate > MAX_OFFSET || read32(in + candidate) != value) {
+                i++;
+                continue;
+            }
+            size_t length = MIN_MATCH;
+            while (i + length < matchLimit && in[candidate + length] == in[i + length]) {
+                length++;
+            }
+            out = writeSequence(out, outEnd, in + anchor, i - anchor, i - candidate, length);
+            if (!out) {
+                return 0;
+            }
+            i += length;
+            anchor = i;
+        }
+    }
+    out = writeSequence(out, outEnd, in + anchor, srcSize - anchor, 0, 0);
+    if (!out) {
+        return 0;
+    }
+    return out - (uint8_t*)dest;
+}
+
+static const uint8_t* readLength(const uint8_t* src, const uint8_t* srcEnd, size_t* length)
+{
+    uint8_t b;
+    do {
+        if (src == srcEnd) {
+            return 0;
+        }
+        b = *src++;
+        *length += b;
+    } while (b == 255);
+    return src;
+}
+
+size_t PhotonLz4_Decompress(const void* src, size_t srcSize, void* dest, size_t destSize)
+{
+    const uint8_t* in = (const uint8_t*)src;
+    const uint8_t* inEnd = in + srcSize;
+    uint8_t* out = (uint8_t*)dest;
+    uint8_t* outEnd = out + destSize;
+
+    while (in < inEnd) {
+        uint8_t token = *in++;
+        size_t literalLength = token >> 4;
+        if (literalLength == 15) {
+            in = readLength(in, inEnd, &literalLength);
+            if (!in) {
+                return 0;
+            }
+        }
+        if ((size_t)(inEnd - in) < literalLength || (size_t)(outEnd - out) < literalLength) {
+            return 0;
+        }
+        memcpy(out, in, literalLength);
+        in += literalLength;
+        out += literalLength;
+        if (in == inEnd) {
+            break;
+        }
+
+        if (inEnd - in < 2) {
+            return 0;
+        }
+        size_t offset = in[0] | ((size_t)in[1] << 8);
+        in += 2;
+        if (offset == 0 || offset > (size_t)(out - (uint8_t*)dest)) {
+            return 0;
+        }
+        size_t matchLength = token & 15;
+        if (matchLength == 15) {
+            in = readLength(in, inEnd, &matchLength);
+            if (!in) {
+                return 0;
+            }
+        }
+        matchLength += MIN_MATCH;
+        if ((size_t)(outEnd - out) < matchLength) {
+            return 0;
+        }
+        // byte by byte, match can overlap output
+        const uint8_t* match = out - offset;
+        for (size_t i = 0; i < matchLength; i++) {
+            out[i] = match[i];
+        }
+        out += matchLength;
+    }
+    return out - (uint8_t*)dest;
+}
@@ -0,0 +1,32 @@
+#ifndef __PHOTON_BLOG_LZ4_H__
+#define __PHOTON_BLOG_LZ4_H__
+
+#include "photongen/onboard/Config.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// LZ4 block format (no frame), compatible with LZ4_decompress_safe.
+// Compressor is a single pass greedy matcher with a hash table of 1 << PHOTON_CFG_LZ4_HASH_BITS
+// 16 bit entries provided by caller, so input is limited to 64 KiB.
+
+#ifndef PHOTON_CFG_LZ4_HASH_BITS
+# define PHOTON_CFG_LZ4_HASH_BITS 10
+#endif
+
+#define PHOTON_LZ4_HASH_TABLE_SIZE (1 << PHOTON_CFG_LZ4_HASH_BITS)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// returns compressed size or 0 if result doesn't fit into dest
+size_t PhotonLz4_Compress(const void* src, size_t srcSize, void* dest, size_t destSize, uint16_t* table);
+// returns decompressed size or 0 if src is malformed or result doesn't fit into dest
+size_t PhotonLz4_Decompress(const void* src, size_t srcSize, void* dest, size_t destSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,7 +1,7 @@
 #include "photon/core/Crc.h"
 
 /*
- * Code generated by universal_crc by Danjel McGougan
+ * Tables generated by universal_crc by Danjel McGougan and extended for slicing
  *
  * CRC parameters used:
  *   bits:       16
@@ -11,12 +11,22 @@
  *   reverse:    true
  *   non-direct: false
  *
- * CRC of the string "123456789" is 0x42d6
+ * CRC of the string "123456789" is 0xf66d
  */
 
 #include <stddef.h>
 #include <stdint.h>
 
+#ifndef PHOTON_CFG_CRC16_IMPL
+# define PHOTON_CFG_CRC16_IMPL PHOTON_CRC16_IMPL_NIBBLE
+#endif
+
+#ifndef PHOTON_CFG_CRC16_HW_MIN_SIZE
+# define PHOTON_CFG_CRC16_HW_MIN_SIZE 16
+#endif
+
+#if PHOTON_CFG_CRC16_IMPL == PHOTON_CRC16_IMPL_NIBBLE || PHOTON_CFG_CRC16_IMPL == PHOTON_CRC16_IMPL_HW
+
 static const uint16_t _crcTable[32] = {
         0x0000, 0x90f8, 0x7ce7, 0xec1f, 0xf9ce, 0x6936, 0x8529, 0x15d1,
         0xae8b, 0x3e73, 0xd26c, 0x4294, 0x5745, 0xc7bd, 0x2ba2, 0xbb5a,
@@ -33,16 +43,351 @@ static inline uint16_t crcNext(uint16_t crc, uint8_t data)
     return crc;
 }
 
-PHOTON_WEAK uint16_t Photon_Crc16(const void* src, size_t len)
+#else
+
+# if PHOTON_CFG_CRC16_IMPL == PHOTON_CRC16_IMPL_BYTE
+#  define _PHOTON_CRC16_TABLES 1
+# elif PHOTON_CFG_CRC16_IMPL == PHOTON_CRC16_IMPL_SLICE4
+#  define _PHOTON_CRC16_TABLES 4
+# elif PHOTON_CFG_CRC16_IMPL == PHOTON_CRC16_IMPL_SLICE8
+#  define _PHOTON_CRC16_TABLES 8
+# else
+#  error "invalid PHOTON_CFG_CRC16_IMPL"
+# endif
+
+/* _crcTable[k][i] is crc of byte i followed by k zero bytes */
+static const uint16_t _crcTable[_PHOTON_CRC16_TABLES][256] = {
+    {
+        0x0000, 0xa784, 0x121f, 0xb59b, 0x243e, 0x83ba, 0x3621, 0x91a5,
+        0x487c, 0xeff8, 0x5a63, 0xfde7, 0x6c42, 0xcbc6, 0x7e5d, 0xd9d9,
+        0x90f8, 0x377c, 0x82e7, 0x2563, 0xb4c6, 0x1342, 0xa6d9, 0x015d,
+        0xd884, 0x7f00, 0xca9b, 0x6d1f, 0xfcba, 0x5b3e, 0xeea5, 0x4921,
+        0x7ce7, 0xdb63, 0x6ef8, 0xc97c, 0x58d9, 0xff5d, 0x4ac6, 0xed42,
+        0x349b, 0x931f, 0x2684, 0x8100, 0x10a5, 0xb721, 0x02ba, 0xa53e,
+        0xec1f, 0x4b9b, 0xfe00, 0x5984, 0xc821, 0x6fa5, 0xda3e, 0x7dba,
+        0xa463, 0x03e7, 0xb67c, 0x11f8, 0x805d, 0x27d9, 0x9242, 0x35c6,
+        0xf9ce, 0x5e4a, 0xebd1, 0x4c55, 0xddf0, 0x7a74, 0xcfef, 0x686b,
+        0xb1b2, 0x1636, 0xa3ad, 0x0429, 0x958c, 0x3208, 0x8793, 0x2017,
+        0x6936, 0xceb2, 0x7b29, 0xdcad, 0x4d08, 0xea8c, 0x5f17, 0xf893,
+        0x214a, 0x86ce, 0x3355, 0x94d1, 0x0574, 0xa2f0, 0x176b, 0xb0ef,
+        0x8529, 0x22ad, 0x9736, 0x30b2, 0xa117, 0x0693, 0xb308, 0x148c,
+        0xcd55, 0x6ad1, 0xdf4a, 0x78ce, 0xe96b, 0x4eef, 0xfb74, 0x5cf0,
+        0x15d1, 0xb255, 0x07ce, 0xa04a, 0x31ef, 0x966b, 0x23f0, 0x8474,
+        0x5dad, 0xfa29, 0x4fb2, 0xe836, 0x7993, 0xde17, 0x6b8c, 0xcc08,
+        0xae8b, 0x090f, 0xbc94, 0x1b10, 0x8ab5, 0x2d31, 0x98aa, 0x3f2e,
+        0xe6f7, 0x4173, 0xf4e8, 0x536c, 0xc2c9, 0x654d, 0xd0d6, 0x7752,
+        0x3e73, 0x99f7, 0x2c6c, 0x8be8, 0x1a4d, 0xbdc9, 0x0852, 0xafd6,
+        0x760f, 0xd18b, 0x6410, 0xc394, 0x5231, 0xf5b5, 0x402e, 0xe7aa,
+        0xd26c, 0x75e8, 0xc073, 0x67f7, 0xf652, 0x51d6, 0xe44d, 0x43c9,
+        0x9a10, 0x3d94, 0x880f, 0x2f8b, 0xbe2e, 0x19aa, 0xac31, 0x0bb5,
+        0x4294, 0xe510, 0x508b, 0xf70f, 0x66aa, 0xc12e, 0x74b5, 0xd331,
+        0x0ae8, 0xad6c, 0x18f7, 0xbf73, 0x2ed6, 0x8952, 0x3cc9, 0x9b4d,
+        0x5745, 0xf0c1, 0x455a, 0xe2de, 0x737b, 0xd4ff, 0x6164, 0xc6e0,
+        0x1f39, 0xb8bd, 0x0d26, 0xaaa2, 0x3b07, 0x9c83, 0x2918, 0x8e9c,
+        0xc7bd, 0x6039, 0xd5a2, 0x7226, 0xe383, 0x4407, 0xf19c, 0x5618,
+        0x8fc1, 0x2845, 0x9dde, 0x3a5a, 0xabff, 0x0c7b, 0xb9e0, 0x1e64,
+        0x2ba2, 0x8c26, 0x39bd, 0x9e39, 0x0f9c, 0xa818, 0x1d83, 0xba07,
+        0x63de, 0xc45a, 0x71c1, 0xd645, 0x47e0, 0xe064, 0x55ff, 0xf27b,
+        0xbb5a, 0x1cde, 0xa945, 0x0ec1, 0x9f64, 0x38e0, 0x8d7b, 0x2aff,
+        0xf326, 0x54a2, 0xe139, 0x46bd, 0xd718, 0x709c, 0xc507, 0x6283
+    },
+# if _PHOTON_CRC16_TABLES >= 4
+    {
+        0x0000, 0x8a12, 0x4933, 0xc321, 0x9266, 0x1874, 0xdb55, 0x5147,
+        0x79db, 0xf3c9, 0x30e8, 0xbafa, 0xebbd, 0x61af, 0xa28e, 0x289c,
+        0xf3b6, 0x79a4, 0xba85, 0x3097, 0x61d0, 0xebc2, 0x28e3, 0xa2f1,
+        0x8a6d, 0x007f, 0xc35e, 0x494c, 0x180b, 0x9219, 0x5138, 0xdb2a,
+        0xba7b, 0x3069, 0xf348, 0x795a, 0x281d, 0xa20f, 0x612e, 0xeb3c,
+        0xc3a0, 0x49b2, 0x8a93, 0x0081, 0x51c6, 0xdbd4, 0x18f5, 0x92e7,
+        0x49cd, 0xc3df, 0x00fe, 0x8aec, 0xdbab, 0x51b9, 0x9298, 0x188a,
+        0x3016, 0xba04, 0x7925, 0xf337, 0xa270, 0x2862, 0xeb43, 0x6151,
+        0x29e1, 0xa3f3, 0x60d2, 0xeac0, 0xbb87, 0x3195, 0xf2b4, 0x78a6,
+        0x503a, 0xda28, 0x1909, 0x931b, 0xc25c, 0x484e, 0x8b6f, 0x017d,
+        0xda57, 0x5045, 0x9364, 0x1976, 0x4831, 0xc223, 0x0102, 0x8b10,
+        0xa38c, 0x299e, 0xeabf, 0x60ad, 0x31ea, 0xbbf8, 0x78d9, 0xf2cb,
+        0x939a, 0x1988, 0xdaa9, 0x50bb, 0x01fc, 0x8bee, 0x48cf, 0xc2dd,
+        0xea41, 0x6053, 0xa372, 0x2960, 0x7827, 0xf235, 0x3114, 0xbb06,
+        0x602c, 0xea3e, 0x291f, 0xa30d, 0xf24a, 0x7858, 0xbb79, 0x316b,
+        0x19f7, 0x93e5, 0x50c4, 0xdad6, 0x8b91, 0x0183, 0xc2a2, 0x48b0,
+        0x53c2, 0xd9d0, 0x1af1, 0x90e3, 0xc1a4, 0x4bb6, 0x8897, 0x0285,
+        0x2a19, 0xa00b, 0x632a, 0xe938, 0xb87f, 0x326d, 0xf14c, 0x7b5e,
+        0xa074, 0x2a66, 0xe947, 0x6355, 0x3212, 0xb800, 0x7b21, 0xf133,
+        0xd9af, 0x53bd, 0x909c, 0x1a8e, 0x4bc9, 0xc1db, 0x02fa, 0x88e8,
+        0xe9b9, 0x63ab, 0xa08a, 0x2a98, 0x7bdf, 0xf1cd, 0x32ec, 0xb8fe,
+        0x9062, 0x1a70, 0xd951, 0x5343, 0x0204, 0x8816, 0x4b37, 0xc125,
+        0x1a0f, 0x901d, 0x533c, 0xd92e, 0x8869, 0x027b, 0xc15a, 0x4b48,
+        0x63d4, 0xe9c6, 0x2ae7, 0xa0f5, 0xf1b2, 0x7ba0, 0xb881, 0x3293,
+        0x7a23, 0xf031, 0x3310, 0xb902, 0xe845, 0x6257, 0xa176, 0x2b64,
+        0x03f8, 0x89ea, 0x4acb, 0xc0d9, 0x919e, 0x1b8c, 0xd8ad, 0x52bf,
+        0x8995, 0x0387, 0xc0a6, 0x4ab4, 0x1bf3, 0x91e1, 0x52c0, 0xd8d2,
+        0xf04e, 0x7a5c, 0xb97d, 0x336f, 0x6228, 0xe83a, 0x2b1b, 0xa109,
+        0xc058, 0x4a4a, 0x896b, 0x0379, 0x523e, 0xd82c, 0x1b0d, 0x911f,
+        0xb983, 0x3391, 0xf0b0, 0x7aa2, 0x2be5, 0xa1f7, 0x62d6, 0xe8c4,
+        0x33ee, 0xb9fc, 0x7add, 0xf0cf, 0xa188, 0x2b9a, 0xe8bb, 0x62a9,
+        0x4a35, 0xc027, 0x0306, 0x8914, 0xd853, 0x5241, 0x9160, 0x1b72
+    },
+    {
+        0x0000, 0x826d, 0x59cd, 0xdba0, 0xb39a, 0x31f7, 0xea57, 0x683a,
+        0x3a23, 0xb84e, 0x63ee, 0xe183, 0x89b9, 0x0bd4, 0xd074, 0x5219,
+        0x7446, 0xf62b, 0x2d8b, 0xafe6, 0xc7dc, 0x45b1, 0x9e11, 0x1c7c,
+        0x4e65, 0xcc08, 0x17a8, 0x95c5, 0xfdff, 0x7f92, 0xa432, 0x265f,
+        0xe88c, 0x6ae1, 0xb141, 0x332c, 0x5b16, 0xd97b, 0x02db, 0x80b6,
+        0xd2af, 0x50c2, 0x8b62, 0x090f, 0x6135, 0xe358, 0x38f8, 0xba95,
+        0x9cca, 0x1ea7, 0xc507, 0x476a, 0x2f50, 0xad3d, 0x769d, 0xf4f0,
+        0xa6e9, 0x2484, 0xff24, 0x7d49, 0x1573, 0x971e, 0x4cbe, 0xced3,
+        0x8c0f, 0x0e62, 0xd5c2, 0x57af, 0x3f95, 0xbdf8, 0x6658, 0xe435,
+        0xb62c, 0x3441, 0xefe1, 0x6d8c, 0x05b6, 0x87db, 0x5c7b, 0xde16,
+        0xf849, 0x7a24, 0xa184, 0x23e9, 0x4bd3, 0xc9be, 0x121e, 0x9073,
+        0xc26a, 0x4007, 0x9ba7, 0x19ca, 0x71f0, 0xf39d, 0x283d, 0xaa50,
+        0x6483, 0xe6ee, 0x3d4e, 0xbf23, 0xd719, 0x5574, 0x8ed4, 0x0cb9,
+        0x5ea0, 0xdccd, 0x076d, 0x8500, 0xed3a, 0x6f57, 0xb4f7, 0x369a,
+        0x10c5, 0x92a8, 0x4908, 0xcb65, 0xa35f, 0x2132, 0xfa92, 0x78ff,
+        0x2ae6, 0xa88b, 0x732b, 0xf146, 0x997c, 0x1b11, 0xc0b1, 0x42dc,
+        0x4509, 0xc764, 0x1cc4, 0x9ea9, 0xf693, 0x74fe, 0xaf5e, 0x2d33,
+        0x7f2a, 0xfd47, 0x26e7, 0xa48a, 0xccb0, 0x4edd, 0x957d, 0x1710,
+        0x314f, 0xb322, 0x6882, 0xeaef, 0x82d5, 0x00b8, 0xdb18, 0x5975,
+        0x0b6c, 0x8901, 0x52a1, 0xd0cc, 0xb8f6, 0x3a9b, 0xe13b, 0x6356,
+        0xad85, 0x2fe8, 0xf448, 0x7625, 0x1e1f, 0x9c72, 0x47d2, 0xc5bf,
+        0x97a6, 0x15cb, 0xce6b, 0x4c06, 0x243c, 0xa651, 0x7df1, 0xff9c,
+        0xd9c3, 0x5bae, 0x800e, 0x0263, 0x6a59, 0xe834, 0x3394, 0xb1f9,
+        0xe3e0, 0x618d, 0xba2d, 0x3840, 0x507a, 0xd217, 0x09b7, 0x8bda,
+        0xc906, 0x4b6b, 0x90cb, 0x12a6, 0x7a9c, 0xf8f1, 0x2351, 0xa13c,
+        0xf325, 0x7148, 0xaae8, 0x2885, 0x40bf, 0xc2d2, 0x1972, 0x9b1f,
+        0xbd40, 0x3f2d, 0xe48d, 0x66e0, 0x0eda, 0x8cb7, 0x5717, 0xd57a,
+        0x8763, 0x050e, 0xdeae, 0x5cc3, 0x34f9, 0xb694, 0x6d34, 0xef59,
+        0x218a, 0xa3e7, 0x7847, 0xfa2a, 0x9210, 0x107d, 0xcbdd, 0x49b0,
+        0x1ba9, 0x99c4, 0x4264, 0xc009, 0xa833, 0x2a5e, 0xf1fe, 0x7393,
+        0x55cc, 0xd7a1, 0x0c01, 0x8e6c, 0xe656, 0x643b, 0xbf9b, 0x3df6,
+        0x6fef, 0xed82, 0x3622, 0xb44f, 0xdc75, 0x5e18, 0x85b8, 0x07d5
+    },
+    {
+        0x0000, 0x4e6d, 0x9cda, 0xd2b7, 0x64a3, 0x2ace, 0xf879, 0xb614,
+        0xc946, 0x872b, 0x559c, 0x1bf1, 0xade5, 0xe388, 0x313f, 0x7f52,
+        0xcf9b, 0x81f6, 0x5341, 0x1d2c, 0xab38, 0xe555, 0x37e2, 0x798f,
+        0x06dd, 0x48b0, 0x9a07, 0xd46a, 0x627e, 0x2c13, 0xfea4, 0xb0c9,
+        0xc221, 0x8c4c, 0x5efb, 0x1096, 0xa682, 0xe8ef, 0x3a58, 0x7435,
+        0x0b67, 0x450a, 0x97bd, 0xd9d0, 0x6fc4, 0x21a9, 0xf31e, 0xbd73,
+        0x0dba, 0x43d7, 0x9160, 0xdf0d, 0x6919, 0x2774, 0xf5c3, 0xbbae,
+        0xc4fc, 0x8a91, 0x5826, 0x164b, 0xa05f, 0xee32, 0x3c85, 0x72e8,
+        0xd955, 0x9738, 0x458f, 0x0be2, 0xbdf6, 0xf39b, 0x212c, 0x6f41,
+        0x1013, 0x5e7e, 0x8cc9, 0xc2a4, 0x74b0, 0x3add, 0xe86a, 0xa607,
+        0x16ce, 0x58a3, 0x8a14, 0xc479, 0x726d, 0x3c00, 0xeeb7, 0xa0da,
+        0xdf88, 0x91e5, 0x4352, 0x0d3f, 0xbb2b, 0xf546, 0x27f1, 0x699c,
+        0x1b74, 0x5519, 0x87ae, 0xc9c3, 0x7fd7, 0x31ba, 0xe30d, 0xad60,
+        0xd232, 0x9c5f, 0x4ee8, 0x0085, 0xb691, 0xf8fc, 0x2a4b, 0x6426,
+        0xd4ef, 0x9a82, 0x4835, 0x0658, 0xb04c, 0xfe21, 0x2c96, 0x62fb,
+        0x1da9, 0x53c4, 0x8173, 0xcf1e, 0x790a, 0x3767, 0xe5d0, 0xabbd,
+        0xefbd, 0xa1d0, 0x7367, 0x3d0a, 0x8b1e, 0xc573, 0x17c4, 0x59a9,
+        0x26fb, 0x6896, 0xba21, 0xf44c, 0x4258, 0x0c35, 0xde82, 0x90ef,
+        0x2026, 0x6e4b, 0xbcfc, 0xf291, 0x4485, 0x0ae8, 0xd85f, 0x9632,
+        0xe960, 0xa70d, 0x75ba, 0x3bd7, 0x8dc3, 0xc3ae, 0x1119, 0x5f74,
+        0x2d9c, 0x63f1, 0xb146, 0xff2b, 0x493f, 0x0752, 0xd5e5, 0x9b88,
+        0xe4da, 0xaab7, 0x7800, 0x366d, 0x8079, 0xce14, 0x1ca3, 0x52ce,
+        0xe207, 0xac6a, 0x7edd, 0x30b0, 0x86a4, 0xc8c9, 0x1a7e, 0x5413,
+        0x2b41, 0x652c, 0xb79b, 0xf9f6, 0x4fe2, 0x018f, 0xd338, 0x9d55,
+        0x36e8, 0x7885, 0xaa32, 0xe45f, 0x524b, 0x1c26, 0xce91, 0x80fc,
+        0xffae, 0xb1c3, 0x6374, 0x2d19, 0x9b0d, 0xd560, 0x07d7, 0x49ba,
+        0xf973, 0xb71e, 0x65a9, 0x2bc4, 0x9dd0, 0xd3bd, 0x010a, 0x4f67,
+        0x3035, 0x7e58, 0xacef, 0xe282, 0x5496, 0x1afb, 0xc84c, 0x8621,
+        0xf4c9, 0xbaa4, 0x6813, 0x267e, 0x906a, 0xde07, 0x0cb0, 0x42dd,
+        0x3d8f, 0x73e2, 0xa155, 0xef38, 0x592c, 0x1741, 0xc5f6, 0x8b9b,
+        0x3b52, 0x753f, 0xa788, 0xe9e5, 0x5ff1, 0x119c, 0xc32b, 0x8d46,
+        0xf214, 0xbc79, 0x6ece, 0x20a3, 0x96b7, 0xd8da, 0x0a6d, 0x4400
+    },
+# endif
+# if _PHOTON_CRC16_TABLES >= 8
+    {
+        0x0000, 0x4ea1, 0x9d42, 0xd3e3, 0x6793, 0x2932, 0xfad1, 0xb470,
+        0xcf26, 0x8187, 0x5264, 0x1cc5, 0xa8b5, 0xe614, 0x35f7, 0x7b56,
+        0xc35b, 0x8dfa, 0x5e19, 0x10b8, 0xa4c8, 0xea69, 0x398a, 0x772b,
+        0x0c7d, 0x42dc, 0x913f, 0xdf9e, 0x6bee, 0x254f, 0xf6ac, 0xb80d,
+        0xdba1, 0x9500, 0x46e3, 0x0842, 0xbc32, 0xf293, 0x2170, 0x6fd1,
+        0x1487, 0x5a26, 0x89c5, 0xc764, 0x7314, 0x3db5, 0xee56, 0xa0f7,
+        0x18fa, 0x565b, 0x85b8, 0xcb19, 0x7f69, 0x31c8, 0xe22b, 0xac8a,
+        0xd7dc, 0x997d, 0x4a9e, 0x043f, 0xb04f, 0xfeee, 0x2d0d, 0x63ac,
+        0xea55, 0xa4f4, 0x7717, 0x39b6, 0x8dc6, 0xc367, 0x1084, 0x5e25,
+        0x2573, 0x6bd2, 0xb831, 0xf690, 0x42e0, 0x0c41, 0xdfa2, 0x9103,
+        0x290e, 0x67af, 0xb44c, 0xfaed, 0x4e9d, 0x003c, 0xd3df, 0x9d7e,
+        0xe628, 0xa889, 0x7b6a, 0x35cb, 0x81bb, 0xcf1a, 0x1cf9, 0x5258,
+        0x31f4, 0x7f55, 0xacb6, 0xe217, 0x5667, 0x18c6, 0xcb25, 0x8584,
+        0xfed2, 0xb073, 0x6390, 0x2d31, 0x9941, 0xd7e0, 0x0403, 0x4aa2,
+        0xf2af, 0xbc0e, 0x6fed, 0x214c, 0x953c, 0xdb9d, 0x087e, 0x46df,
+        0x3d89, 0x7328, 0xa0cb, 0xee6a, 0x5a1a, 0x14bb, 0xc758, 0x89f9,
+        0x89bd, 0xc71c, 0x14ff, 0x5a5e, 0xee2e, 0xa08f, 0x736c, 0x3dcd,
+        0x469b, 0x083a, 0xdbd9, 0x9578, 0x2108, 0x6fa9, 0xbc4a, 0xf2eb,
+        0x4ae6, 0x0447, 0xd7a4, 0x9905, 0x2d75, 0x63d4, 0xb037, 0xfe96,
+        0x85c0, 0xcb61, 0x1882, 0x5623, 0xe253, 0xacf2, 0x7f11, 0x31b0,
+        0x521c, 0x1cbd, 0xcf5e, 0x81ff, 0x358f, 0x7b2e, 0xa8cd, 0xe66c,
+        0x9d3a, 0xd39b, 0x0078, 0x4ed9, 0xfaa9, 0xb408, 0x67eb, 0x294a,
+        0x9147, 0xdfe6, 0x0c05, 0x42a4, 0xf6d4, 0xb875, 0x6b96, 0x2537,
+        0x5e61, 0x10c0, 0xc323, 0x8d82, 0x39f2, 0x7753, 0xa4b0, 0xea11,
+        0x63e8, 0x2d49, 0xfeaa, 0xb00b, 0x047b, 0x4ada, 0x9939, 0xd798,
+        0xacce, 0xe26f, 0x318c, 0x7f2d, 0xcb5d, 0x85fc, 0x561f, 0x18be,
+        0xa0b3, 0xee12, 0x3df1, 0x7350, 0xc720, 0x8981, 0x5a62, 0x14c3,
+        0x6f95, 0x2134, 0xf2d7, 0xbc76, 0x0806, 0x46a7, 0x9544, 0xdbe5,
+        0xb849, 0xf6e8, 0x250b, 0x6baa, 0xdfda, 0x917b, 0x4298, 0x0c39,
+        0x776f, 0x39ce, 0xea2d, 0xa48c, 0x10fc, 0x5e5d, 0x8dbe, 0xc31f,
+        0x7b12, 0x35b3, 0xe650, 0xa8f1, 0x1c81, 0x5220, 0x81c3, 0xcf62,
+        0xb434, 0xfa95, 0x2976, 0x67d7, 0xd3a7, 0x9d06, 0x4ee5, 0x0044
+    },
+    {
+        0x0000, 0x75a6, 0xeb4c, 0x9eea, 0x8b8f, 0xfe29, 0x60c3, 0x1565,
+        0x4a09, 0x3faf, 0xa145, 0xd4e3, 0xc186, 0xb420, 0x2aca, 0x5f6c,
+        0x9412, 0xe1b4, 0x7f5e, 0x0af8, 0x1f9d, 0x6a3b, 0xf4d1, 0x8177,
+        0xde1b, 0xabbd, 0x3557, 0x40f1, 0x5594, 0x2032, 0xbed8, 0xcb7e,
+        0x7533, 0x0095, 0x9e7f, 0xebd9, 0xfebc, 0x8b1a, 0x15f0, 0x6056,
+        0x3f3a, 0x4a9c, 0xd476, 0xa1d0, 0xb4b5, 0xc113, 0x5ff9, 0x2a5f,
+        0xe121, 0x9487, 0x0a6d, 0x7fcb, 0x6aae, 0x1f08, 0x81e2, 0xf444,
+        0xab28, 0xde8e, 0x4064, 0x35c2, 0x20a7, 0x5501, 0xcbeb, 0xbe4d,
+        0xea66, 0x9fc0, 0x012a, 0x748c, 0x61e9, 0x144f, 0x8aa5, 0xff03,
+        0xa06f, 0xd5c9, 0x4b23, 0x3e85, 0x2be0, 0x5e46, 0xc0ac, 0xb50a,
+        0x7e74, 0x0bd2, 0x9538, 0xe09e, 0xf5fb, 0x805d, 0x1eb7, 0x6b11,
+        0x347d, 0x41db, 0xdf31, 0xaa97, 0xbff2, 0xca54, 0x54be, 0x2118,
+        0x9f55, 0xeaf3, 0x7419, 0x01bf, 0x14da, 0x617c, 0xff96, 0x8a30,
+        0xd55c, 0xa0fa, 0x3e10, 0x4bb6, 0x5ed3, 0x2b75, 0xb59f, 0xc039,
+        0x0b47, 0x7ee1, 0xe00b, 0x95ad, 0x80c8, 0xf56e, 0x6b84, 0x1e22,
+        0x414e, 0x34e8, 0xaa02, 0xdfa4, 0xcac1, 0xbf67, 0x218d, 0x542b,
+        0x89db, 0xfc7d, 0x6297, 0x1731, 0x0254, 0x77f2, 0xe918, 0x9cbe,
+        0xc3d2, 0xb674, 0x289e, 0x5d38, 0x485d, 0x3dfb, 0xa311, 0xd6b7,
+        0x1dc9, 0x686f, 0xf685, 0x8323, 0x9646, 0xe3e0, 0x7d0a, 0x08ac,
+        0x57c0, 0x2266, 0xbc8c, 0xc92a, 0xdc4f, 0xa9e9, 0x3703, 0x42a5,
+        0xfce8, 0x894e, 0x17a4, 0x6202, 0x7767, 0x02c1, 0x9c2b, 0xe98d,
+        0xb6e1, 0xc347, 0x5dad, 0x280b, 0x3d6e, 0x48c8, 0xd622, 0xa384,
+        0x68fa, 0x1d5c, 0x83b6, 0xf610, 0xe375, 0x96d3, 0x0839, 0x7d9f,
+        0x22f3, 0x5755, 0xc9bf, 0xbc19, 0xa97c, 0xdcda, 0x4230, 0x3796,
+        0x63bd, 0x161b, 0x88f1, 0xfd57, 0xe832, 0x9d94, 0x037e, 0x76d8,
+        0x29b4, 0x5c12, 0xc2f8, 0xb75e, 0xa23b, 0xd79d, 0x4977, 0x3cd1,
+        0xf7af, 0x8209, 0x1ce3, 0x6945, 0x7c20, 0x0986, 0x976c, 0xe2ca,
+        0xbda6, 0xc800, 0x56ea, 0x234c, 0x3629, 0x438f, 0xdd65, 0xa8c3,
+        0x168e, 0x6328, 0xfdc2, 0x8864, 0x9d01, 0xe8a7, 0x764d, 0x03eb,
+        0x5c87, 0x2921, 0xb7cb, 0xc26d, 0xd708, 0xa2ae, 0x3c44, 0x49e2,
+        0x829c, 0xf73a, 0x69d0, 0x1c76, 0x0913, 0x7cb5, 0xe25f, 0x97f9,
+        0xc895, 0xbd33, 0x23d9, 0x567f, 0x431a, 0x36bc, 0xa856, 0xddf0
+    },
+    {
+        0x0000, 0xe438, 0x9567, 0x715f, 0x77d9, 0x93e1, 0xe2be, 0x0686,
+        0xefb2, 0x0b8a, 0x7ad5, 0x9eed, 0x986b, 0x7c53, 0x0d0c, 0xe934,
+        0x8273, 0x664b, 0x1714, 0xf32c, 0xf5aa, 0x1192, 0x60cd, 0x84f5,
+        0x6dc1, 0x89f9, 0xf8a6, 0x1c9e, 0x1a18, 0xfe20, 0x8f7f, 0x6b47,
+        0x59f1, 0xbdc9, 0xcc96, 0x28ae, 0x2e28, 0xca10, 0xbb4f, 0x5f77,
+        0xb643, 0x527b, 0x2324, 0xc71c, 0xc19a, 0x25a2, 0x54fd, 0xb0c5,
+        0xdb82, 0x3fba, 0x4ee5, 0xaadd, 0xac5b, 0x4863, 0x393c, 0xdd04,
+        0x3430, 0xd008, 0xa157, 0x456f, 0x43e9, 0xa7d1, 0xd68e, 0x32b6,
+        0xb3e2, 0x57da, 0x2685, 0xc2bd, 0xc43b, 0x2003, 0x515c, 0xb564,
+        0x5c50, 0xb868, 0xc937, 0x2d0f, 0x2b89, 0xcfb1, 0xbeee, 0x5ad6,
+        0x3191, 0xd5a9, 0xa4f6, 0x40ce, 0x4648, 0xa270, 0xd32f, 0x3717,
+        0xde23, 0x3a1b, 0x4b44, 0xaf7c, 0xa9fa, 0x4dc2, 0x3c9d, 0xd8a5,
+        0xea13, 0x0e2b, 0x7f74, 0x9b4c, 0x9dca, 0x79f2, 0x08ad, 0xec95,
+        0x05a1, 0xe199, 0x90c6, 0x74fe, 0x7278, 0x9640, 0xe71f, 0x0327,
+        0x6860, 0x8c58, 0xfd07, 0x193f, 0x1fb9, 0xfb81, 0x8ade, 0x6ee6,
+        0x87d2, 0x63ea, 0x12b5, 0xf68d, 0xf00b, 0x1433, 0x656c, 0x8154,
+        0x3ad3, 0xdeeb, 0xafb4, 0x4b8c, 0x4d0a, 0xa932, 0xd86d, 0x3c55,
+        0xd561, 0x3159, 0x4006, 0xa43e, 0xa2b8, 0x4680, 0x37df, 0xd3e7,
+        0xb8a0, 0x5c98, 0x2dc7, 0xc9ff, 0xcf79, 0x2b41, 0x5a1e, 0xbe26,
+        0x5712, 0xb32a, 0xc275, 0x264d, 0x20cb, 0xc4f3, 0xb5ac, 0x5194,
+        0x6322, 0x871a, 0xf645, 0x127d, 0x14fb, 0xf0c3, 0x819c, 0x65a4,
+        0x8c90, 0x68a8, 0x19f7, 0xfdcf, 0xfb49, 0x1f71, 0x6e2e, 0x8a16,
+        0xe151, 0x0569, 0x7436, 0x900e, 0x9688, 0x72b0, 0x03ef, 0xe7d7,
+        0x0ee3, 0xeadb, 0x9b84, 0x7fbc, 0x793a, 0x9d02, 0xec5d, 0x0865,
+        0x8931, 0x6d09, 0x1c56, 0xf86e, 0xfee8, 0x1ad0, 0x6b8f, 0x8fb7,
+        0x6683, 0x82bb, 0xf3e4, 0x17dc, 0x115a, 0xf562, 0x843d, 0x6005,
+        0x0b42, 0xef7a, 0x9e25, 0x7a1d, 0x7c9b, 0x98a3, 0xe9fc, 0x0dc4,
+        0xe4f0, 0x00c8, 0x7197, 0x95af, 0x9329, 0x7711, 0x064e, 0xe276,
+        0xd0c0, 0x34f8, 0x45a7, 0xa19f, 0xa719, 0x4321, 0x327e, 0xd646,
+        0x3f72, 0xdb4a, 0xaa15, 0x4e2d, 0x48ab, 0xac93, 0xddcc, 0x39f4,
+        0x52b3, 0xb68b, 0xc7d4, 0x23ec, 0x256a, 0xc152, 0xb00d, 0x5435,
+        0xbd01, 0x5939, 0x2866, 0xcc5e, 0xcad8, 0x2ee0, 0x5fbf, 0xbb87
+    },
+    {
+        0x0000, 0xa487, 0x1419, 0xb09e, 0x2832, 0x8cb5, 0x3c2b, 0x98ac,
+        0x5064, 0xf4e3, 0x447d, 0xe0fa, 0x7856, 0xdcd1, 0x6c4f, 0xc8c8,
+        0xa0c8, 0x044f, 0xb4d1, 0x1056, 0x88fa, 0x2c7d, 0x9ce3, 0x3864,
+        0xf0ac, 0x542b, 0xe4b5, 0x4032, 0xd89e, 0x7c19, 0xcc87, 0x6800,
+        0x1c87, 0xb800, 0x089e, 0xac19, 0x34b5, 0x9032, 0x20ac, 0x842b,
+        0x4ce3, 0xe864, 0x58fa, 0xfc7d, 0x64d1, 0xc056, 0x70c8, 0xd44f,
+        0xbc4f, 0x18c8, 0xa856, 0x0cd1, 0x947d, 0x30fa, 0x8064, 0x24e3,
+        0xec2b, 0x48ac, 0xf832, 0x5cb5, 0xc419, 0x609e, 0xd000, 0x7487,
+        0x390e, 0x9d89, 0x2d17, 0x8990, 0x113c, 0xb5bb, 0x0525, 0xa1a2,
+        0x696a, 0xcded, 0x7d73, 0xd9f4, 0x4158, 0xe5df, 0x5541, 0xf1c6,
+        0x99c6, 0x3d41, 0x8ddf, 0x2958, 0xb1f4, 0x1573, 0xa5ed, 0x016a,
+        0xc9a2, 0x6d25, 0xddbb, 0x793c, 0xe190, 0x4517, 0xf589, 0x510e,
+        0x2589, 0x810e, 0x3190, 0x9517, 0x0dbb, 0xa93c, 0x19a2, 0xbd25,
+        0x75ed, 0xd16a, 0x61f4, 0xc573, 0x5ddf, 0xf958, 0x49c6, 0xed41,
+        0x8541, 0x21c6, 0x9158, 0x35df, 0xad73, 0x09f4, 0xb96a, 0x1ded,
+        0xd525, 0x71a2, 0xc13c, 0x65bb, 0xfd17, 0x5990, 0xe90e, 0x4d89,
+        0x721c, 0xd69b, 0x6605, 0xc282, 0x5a2e, 0xfea9, 0x4e37, 0xeab0,
+        0x2278, 0x86ff, 0x3661, 0x92e6, 0x0a4a, 0xaecd, 0x1e53, 0xbad4,
+        0xd2d4, 0x7653, 0xc6cd, 0x624a, 0xfae6, 0x5e61, 0xeeff, 0x4a78,
+        0x82b0, 0x2637, 0x96a9, 0x322e, 0xaa82, 0x0e05, 0xbe9b, 0x1a1c,
+        0x6e9b, 0xca1c, 0x7a82, 0xde05, 0x46a9, 0xe22e, 0x52b0, 0xf637,
+        0x3eff, 0x9a78, 0x2ae6, 0x8e61, 0x16cd, 0xb24a, 0x02d4, 0xa653,
+        0xce53, 0x6ad4, 0xda4a, 0x7ecd, 0xe661, 0x42e6, 0xf278, 0x56ff,
+        0x9e37, 0x3ab0, 0x8a2e, 0x2ea9, 0xb605, 0x1282, 0xa21c, 0x069b,
+        0x4b12, 0xef95, 0x5f0b, 0xfb8c, 0x6320, 0xc7a7, 0x7739, 0xd3be,
+        0x1b76, 0xbff1, 0x0f6f, 0xabe8, 0x3344, 0x97c3, 0x275d, 0x83da,
+        0xebda, 0x4f5d, 0xffc3, 0x5b44, 0xc3e8, 0x676f, 0xd7f1, 0x7376,
+        0xbbbe, 0x1f39, 0xafa7, 0x0b20, 0x938c, 0x370b, 0x8795, 0x2312,
+        0x5795, 0xf312, 0x438c, 0xe70b, 0x7fa7, 0xdb20, 0x6bbe, 0xcf39,
+        0x07f1, 0xa376, 0x13e8, 0xb76f, 0x2fc3, 0x8b44, 0x3bda, 0x9f5d,
+        0xf75d, 0x53da, 0xe344, 0x47c3, 0xdf6f, 0x7be8, 0xcb76, 0x6ff1,
+        0xa739, 0x03be, 0xb320, 0x17a7, 0x8f0b, 0x2b8c, 0x9b12, 0x3f95
+    },
+# endif
+};
+
+static inline uint16_t crcNext(uint16_t crc, uint8_t data)
 {
-    uint16_t crc = 0xffff;
-    const uint8_t* data = (const uint8_t*)src;
+    return (crc >> 8) ^ _crcTable[0][(crc ^ data) & 0xff];
+}
 
-    if (len) {
-        do {
-            crc = crcNext(crc, *data++);
-        } while (--len);
-    }
+#endif
 
+static uint16_t crcUpdate(uint16_t crc, const uint8_t* data, size_t len)
+{
+#if PHOTON_CFG_CRC16_IMPL == PHOTON_CRC16_IMPL_SLICE8
+    while (len >= 8) {
+        crc ^= data[0] | (data[1] << 8);
+        crc = _crcTable[7][crc & 0xff] ^
+              _crcTable[6][crc >> 8] ^
+              _crcTable[5][data[2]] ^
+              _crcTable[4][data[3]] ^
+              _crcTable[3][data[4]] ^
+              _crcTable[2][data[5]] ^
+              _crcTable[1][data[6]] ^
+              _crcTable[0][data[7]];
+        data += 8;
+        len -= 8;
+    }
+#endif
+#if PHOTON_CFG_CRC16_IMPL == PHOTON_CRC16_IMPL_SLICE4 || PHOTON_CFG_CRC16_IMPL == PHOTON_CRC16_IMPL_SLICE8
+    while (len >= 4) {
+        crc ^= data[0] | (data[1] << 8);
+        crc = _crcTable[3][crc & 0xff] ^
+              _crcTable[2][crc >> 8] ^
+              _crcTable[1][data[2]] ^
+              _crcTable[0][data[3]];
+        data += 4;
+        len -= 4;
+    }
+#endif
+    while (len) {
+        crc = crcNext(crc, *data++);
+        len--;
+    }
     return crc;
 }
+
+PHOTON_WEAK uint16_t Photon_Crc16Update(uint16_t crc, const void* src, size_t len)
+{
+#if PHOTON_CFG_CRC16_IMPL == PHOTON_CRC16_IMPL_HW
+    if (len >= PHOTON_CFG_CRC16_HW_MIN_SIZE) {
+        return Photon_Crc16HwUpdate(crc, src, len);
+    }
+#endif
+    return crcUpdate(crc, (const uint8_t*)src, len);
+}
+
+PHOTON_WEAK uint16_t Photon_Crc16(const void* src, size_t len)
+{
+    return Photon_Crc16Update(0xffff, src, len);
+}
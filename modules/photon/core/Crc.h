@@ -6,6 +6,26 @@
 #include <stddef.h>
 #include <stdint.h>
 
+// Implementation is selected with PHOTON_CFG_CRC16_IMPL:
+//   NIBBLE - two 16 entry tables, 64 bytes of flash (default)
+//   BYTE   - 256 entry table, 512 bytes
+//   SLICE4 - 4 tables, 2 KiB, processes 4 bytes per step
+//   SLICE8 - 8 tables, 4 KiB, processes 8 bytes per step
+//   HW     - Photon_Crc16HwUpdate is called for buffers of at least PHOTON_CFG_CRC16_HW_MIN_SIZE bytes,
+//            smaller ones use NIBBLE to avoid peripheral setup overhead
+#define PHOTON_CRC16_IMPL_NIBBLE 0
+#define PHOTON_CRC16_IMPL_BYTE 1
+#define PHOTON_CRC16_IMPL_SLICE4 2
+#define PHOTON_CRC16_IMPL_SLICE8 3
+#define PHOTON_CRC16_IMPL_HW 4
+
 uint16_t Photon_Crc16(const void* src, size_t len);
+// continues crc calculation, Photon_Crc16(src, len) == Photon_Crc16Update(0xffff, src, len)
+uint16_t Photon_Crc16Update(uint16_t crc, const void* src, size_t len);
+
+#if defined(PHOTON_CFG_CRC16_IMPL) && PHOTON_CFG_CRC16_IMPL == PHOTON_CRC16_IMPL_HW
+// provided by integrator, must continue from crc with poly 0xd175 (reversed), no final xor
+uint16_t Photon_Crc16HwUpdate(uint16_t crc, const void* src, size_t len);
+#endif
 
 #endif
@@ -1,5 +1,6 @@
 #include "photon/core/Logging.h"
 #include "photon/core/Util.h"
+#include "photon/core/Assert.h"
 
 #ifdef PHOTON_LOG_LEVEL
 # if PHOTON_LOG_LEVEL >= 1
@@ -45,53 +46,62 @@ void Photon_SetLogDeviceName(const char* name)
     }
 }
 
-//TODO: refact
-
-void Photon_Log(int level, const char* fname, unsigned lineNum, const char* fmt, ...)
+static bool levelInfo(int level, const char** levelStr, const char** levelPrefix, const char** levelAlign)
 {
-    const char* levelStr;
-    const char* levelPrefix;
-    const char* levelPostfix;
-    const char* levelAlign;
     switch (level) {
     case PHOTON_LOG_LEVEL_FATAL:
-        levelStr = "FATAL";
-        levelPrefix = "\x1b[1;5;31m";
-        levelPostfix = "\x1b[0m:";
-        levelAlign = "   ";
-        break;
+        *levelStr = "FATAL";
+        *levelPrefix = "\x1b[1;5;31m";
+        *levelAlign = "   ";
+        return true;
     case PHOTON_LOG_LEVEL_CRITICAL:
-        levelStr = "CRITICAL";
-        levelPrefix = "\x1b[31m";
-        levelPostfix = "\x1b[0m:";
-        levelAlign = "";
-        break;
+        *levelStr = "CRITICAL";
+        *levelPrefix = "\x1b[31m";
+        *levelAlign = "";
+        return true;
     case PHOTON_LOG_LEVEL_WARNING:
-        levelStr = "WARNING";
-        levelPrefix = "\x1b[1;33m";
-        levelPostfix = "\x1b[0m:";
-        levelAlign = " ";
-        break;
+        *levelStr = "WARNING";
+        *levelPrefix = "\x1b[1;33m";
+        *levelAlign = " ";
+        return true;
     case PHOTON_LOG_LEVEL_INFO:
-        levelStr = "INFO";
-        levelPrefix = "\x1b[1;36m";
-        levelPostfix = "\x1b[0m:";
-        levelAlign = "    ";
-        break;
+        *levelStr = "INFO";
+        *levelPrefix = "\x1b[1;36m";
+        *levelAlign = "    ";
+        return true;
     case PHOTON_LOG_LEVEL_DEBUG:
-        levelStr = "DEBUG";
-        levelPrefix = "\x1b[1;30m";
-        levelPostfix = "\x1b[0m:";
-        levelAlign = "   ";
-        break;
-    default:
+        *levelStr = "DEBUG";
+        *levelPrefix = "\x1b[1;30m";
+        *levelAlign = "   ";
+        return true;
+    }
+    return false;
+}
+
+// strftime and localtime are only called once per second
+static const char* formatTime(time_t t)
+{
+    static char timeStr[20];
+    static time_t lastTime = (time_t)-1;
+    if (t != lastTime) {
+        timeStr[19] = '\0';
+        strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", localtime(&t));
+        lastTime = t;
+    }
+    return timeStr;
+}
+
+static void printPrefix(int level, const char* fname, unsigned lineNum, time_t t)
+{
+    const char* levelStr;
+    const char* levelPrefix;
+    const char* levelPostfix = "\x1b[0m:";
+    const char* levelAlign;
+    if (!levelInfo(level, &levelStr, &levelPrefix, &levelAlign)) {
         return;
     }
 
-    char timeStr[20];
-    timeStr[19] = '\0';
-    time_t t = time(NULL);
-    strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", localtime(&t));
+    const char* timeStr = formatTime(t);
 
     size_t alignSize = 40;
     size_t fnameLen = strlen(fname);
@@ -122,6 +132,19 @@ void Photon_Log(int level, const char* fname, unsigned lineNum, const char* fmt,
     } else {
         printf("%s [%s] %s:%s ", timeStr, modStr, levelStr, levelAlign);
     }
+}
+
+#ifndef PHOTON_CFG_LOG_DEFERRED
+
+void Photon_Log(int level, const char* fname, unsigned lineNum, const char* fmt, ...)
+{
+    const char* levelStr;
+    const char* levelPrefix;
+    const char* levelAlign;
+    if (!levelInfo(level, &levelStr, &levelPrefix, &levelAlign)) {
+        return;
+    }
+    printPrefix(level, fname, lineNum, time(NULL));
 
     va_list args;
     va_start(args, fmt);
@@ -131,5 +154,639 @@ void Photon_Log(int level, const char* fname, unsigned lineNum, const char* fmt,
     printf("\n");
 }
 
+#else
+
+#include "photongen/onboard/core/RingBuf.h"
+#include "photon/core/Endian.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef PHOTON_CFG_LOG_BUFFER_SIZE
+# define PHOTON_CFG_LOG_BUFFER_SIZE 4096
+#endif
+
+#ifndef PHOTON_CFG_LOG_MAX_RECORD_SIZE
+# define PHOTON_CFG_LOG_MAX_RECORD_SIZE 128
+#endif
+
+#ifndef PHOTON_CFG_LOG_MAX_STRING_SIZE
+# define PHOTON_CFG_LOG_MAX_STRING_SIZE 32
+#endif
+
+// number of distinct format and file name strings that can be resolved back from ids, power of 2
+#ifndef PHOTON_CFG_LOG_STRING_TABLE_SIZE
+# define PHOTON_CFG_LOG_STRING_TABLE_SIZE 128
+#endif
+
+// [u16 size][u8 level][u32 lineNum][i64 time][u32 fname id][u32 fmt id][args]
+// all fields are little endian, args are stored in order of format specifiers (star widths included)
+// as [u8 tag][value] and do not depend on target abi:
+// signed integers are stored as i64, unsigned integers and pointers as u64,
+// floating point values as f64 and strings as [u8 size][chars]
+#define RECORD_LEVEL_OFFSET 2
+#define RECORD_LINE_OFFSET 3
+#define RECORD_TIME_OFFSET 7
+#define RECORD_FNAME_OFFSET 15
+#define RECORD_FMT_OFFSET 19
+#define RECORD_HEADER_SIZE 23
+
+#define PRECISION_NONE -1
+#define PRECISION_STAR -2
+
+// values are stored as arg tags
+typedef enum {
+    ArgKind_None = 0,
+    ArgKind_Int = 1,
+    ArgKind_Uint = 2,
+    ArgKind_Double = 3,
+    ArgKind_String = 4,
+    ArgKind_Ptr = 5,
+} ArgKind;
+
+typedef enum {
+    LengthMod_None,
+    LengthMod_Char,
+    LengthMod_Short,
+    LengthMod_Long,
+    LengthMod_LongLong,
+    LengthMod_Size,
+    LengthMod_IntMax,
+    LengthMod_PtrDiff,
+    LengthMod_LongDouble,
+} LengthMod;
+
+typedef struct {
+    const char* begin;
+    // first char of length modifier or conversion
+    const char* lengthBegin;
+    const char* end;
+    unsigned starCount;
+    int precision;
+    LengthMod length;
+    ArgKind kind;
+    char conversion;
+} FormatSpec;
+
+typedef struct {
+    const char* str;
+    uint32_t id;
+} StringEntry;
+
+static uint8_t logData[PHOTON_CFG_LOG_BUFFER_SIZE];
+static PhotonRingBuf logRingBuf;
+static bool isLogInitialized = false;
+static size_t droppedCount = 0;
+// keyed by string address, ids are only hashed once per string
+static StringEntry stringTable[PHOTON_CFG_LOG_STRING_TABLE_SIZE];
+
+// FNV-1a
+uint32_t Photon_LogStringId(const char* str)
+{
+    uint32_t hash = 2166136261u;
+    while (*str) {
+        hash ^= (uint8_t)*str;
+        hash *= 16777619u;
+        str++;
+    }
+    return hash;
+}
+
+static uint32_t stringId(const char* str)
+{
+    size_t mask = PHOTON_CFG_LOG_STRING_TABLE_SIZE - 1;
+    size_t index = ((uintptr_t)str >> 2) & mask;
+    for (size_t i = 0; i < PHOTON_CFG_LOG_STRING_TABLE_SIZE; i++) {
+        StringEntry* entry = &stringTable[(index + i) & mask];
+        if (entry->str == str) {
+            return entry->id;
+        }
+        if (!entry->str) {
+            entry->str = str;
+            entry->id = Photon_LogStringId(str);
+            return entry->id;
+        }
+    }
+    // table is full, record can only be formatted outside the image
+    return Photon_LogStringId(str);
+}
+
+static const char* findString(uint32_t id)
+{
+    for (size_t i = 0; i < PHOTON_CFG_LOG_STRING_TABLE_SIZE; i++) {
+        if (stringTable[i].str && stringTable[i].id == id) {
+            return stringTable[i].str;
+        }
+    }
+    return 0;
+}
+
+static size_t boundedStrlen(const char* str, size_t maxSize)
+{
+    size_t size = 0;
+    while (size < maxSize && str[size] != '\0') {
+        size++;
+    }
+    return size;
+}
+
+// returns pointer to next specifier or end of string, %% is skipped
+static const char* nextSpec(const char* fmt, FormatSpec* spec)
+{
+    while (true) {
+        fmt = strchr(fmt, '%');
+        if (!fmt) {
+            return 0;
+        }
+        if (fmt[1] != '%') {
+            break;
+        }
+        fmt += 2;
+    }
+    spec->begin = fmt;
+    spec->starCount = 0;
+    spec->precision = PRECISION_NONE;
+    const char* p = fmt + 1;
+    bool isPrecision = false;
+    while (*p && strchr("-+ #0123456789.*", *p)) {
+        if (*p == '*') {
+            spec->starCount++;
+            if (isPrecision) {
+                spec->precision = PRECISION_STAR;
+            }
+        } else if (*p == '.') {
+            isPrecision = true;
+            spec->precision = 0;
+        } else if (isPrecision && *p >= '0' && *p <= '9' && spec->precision >= 0) {
+            spec->precision = PHOTON_MIN(spec->precision * 10 + (*p - '0'), 0xffff);
+        }
+        p++;
+    }
+    spec->lengthBegin = p;
+    spec->length = LengthMod_None;
+    switch (*p) {
+    case 'h':
+        p++;
+        spec->length = LengthMod_Short;
+        if (*p == 'h') {
+            p++;
+            spec->length = LengthMod_Char;
+        }
+        break;
+    case 'l':
+        p++;
+        spec->length = LengthMod_Long;
+        if (*p == 'l') {
+            p++;
+            spec->length = LengthMod_LongLong;
+        }
+        break;
+    case 'z':
+        p++;
+        spec->length = LengthMod_Size;
+        break;
+    case 'j':
+        p++;
+        spec->length = LengthMod_IntMax;
+        break;
+    case 't':
+        p++;
+        spec->length = LengthMod_PtrDiff;
+        break;
+    case 'L':
+        p++;
+        spec->length = LengthMod_LongDouble;
+        break;
+    }
+    spec->conversion = *p;
+    switch (*p) {
+    case 'd':
+    case 'i':
+    case 'c':
+        spec->kind = ArgKind_Int;
+        break;
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+        spec->kind = ArgKind_Uint;
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        spec->kind = ArgKind_Double;
+        break;
+    case 's':
+        spec->kind = ArgKind_String;
+        break;
+    case 'p':
+        spec->kind = ArgKind_Ptr;
+        break;
+    default:
+        // %n and invalid specifiers are not supported
+        spec->kind = ArgKind_None;
+        break;
+    }
+    if (*p) {
+        p++;
+    }
+    spec->end = p;
+    return fmt;
+}
+
+// integers are read with their promoted type and truncated to the type given by length modifier
+static int64_t readSigned(va_list* args, LengthMod length)
+{
+    switch (length) {
+    case LengthMod_Char:
+        return (signed char)va_arg(*args, int);
+    case LengthMod_Short:
+        return (short)va_arg(*args, int);
+    case LengthMod_Long:
+        return va_arg(*args, long);
+    case LengthMod_LongLong:
+        return va_arg(*args, long long);
+    case LengthMod_Size:
+        return (ptrdiff_t)va_arg(*args, size_t);
+    case LengthMod_IntMax:
+        return va_arg(*args, intmax_t);
+    case LengthMod_PtrDiff:
+        return va_arg(*args, ptrdiff_t);
+    default:
+        return va_arg(*args, int);
+    }
+}
+
+static uint64_t readUnsigned(va_list* args, LengthMod length)
+{
+    switch (length) {
+    case LengthMod_Char:
+        return (unsigned char)va_arg(*args, unsigned);
+    case LengthMod_Short:
+        return (unsigned short)va_arg(*args, unsigned);
+    case LengthMod_Long:
+        return va_arg(*args, unsigned long);
+    case LengthMod_LongLong:
+        return va_arg(*args, unsigned long long);
+    case LengthMod_Size:
+        return va_arg(*args, size_t);
+    case LengthMod_IntMax:
+        return va_arg(*args, uintmax_t);
+    case LengthMod_PtrDiff:
+        return (size_t)va_arg(*args, ptrdiff_t);
+    default:
+        return va_arg(*args, unsigned);
+    }
+}
+
+static uint64_t doubleBits(double value)
+{
+    union {
+        double f;
+        uint64_t v;
+    } u;
+    u.f = value;
+    return u.v;
+}
+
+static double doubleFromBits(uint64_t bits)
+{
+    union {
+        double f;
+        uint64_t v;
+    } u;
+    u.v = bits;
+    return u.f;
+}
+
+#define CAPTURE_ARG(argKind, value)                     \
+    do {                                                \
+        uint64_t encoded = (uint64_t)(value);           \
+        if ((size_t)(end - current) < 9) {              \
+            goto done;                                  \
+        }                                               \
+        current[0] = (uint8_t)(argKind);                \
+        Photon_Le64Enc(current + 1, encoded);           \
+        current += 9;                                   \
+    } while (0)
+
+void Photon_Log(int level, const char* fname, unsigned lineNum, const char* fmt, ...)
+{
+    if (!isLogInitialized) {
+        PhotonRingBuf_Init(&logRingBuf, logData, sizeof(logData));
+        isLogInitialized = true;
+    }
+
+    if (level < PHOTON_LOG_LEVEL_FATAL || level > PHOTON_LOG_LEVEL_DEBUG) {
+        return;
+    }
+
+    uint8_t record[PHOTON_CFG_LOG_MAX_RECORD_SIZE];
+    uint8_t* current = record + RECORD_HEADER_SIZE;
+    uint8_t* end = record + sizeof(record);
+
+    record[RECORD_LEVEL_OFFSET] = (uint8_t)level;
+    Photon_Le32Enc(record + RECORD_LINE_OFFSET, lineNum);
+    Photon_Le64Enc(record + RECORD_TIME_OFFSET, (uint64_t)(int64_t)time(NULL));
+    Photon_Le32Enc(record + RECORD_FNAME_OFFSET, stringId(fname));
+    Photon_Le32Enc(record + RECORD_FMT_OFFSET, stringId(fmt));
+
+    va_list args;
+    va_start(args, fmt);
+    FormatSpec spec;
+    const char* it = fmt;
+    // last star argument, precision if it is given as .*
+    int lastStar = 0;
+    // args that don't fit are dropped, formatting stops at first missing arg
+    while ((it = nextSpec(it, &spec)) != 0) {
+        for (unsigned i = 0; i < spec.starCount; i++) {
+            lastStar = va_arg(args, int);
+            CAPTURE_ARG(ArgKind_Int, (int64_t)lastStar);
+        }
+        switch (spec.kind) {
+        case ArgKind_None:
+            goto done;
+        case ArgKind_Int:
+            CAPTURE_ARG(ArgKind_Int, readSigned(&args, spec.length));
+            break;
+        case ArgKind_Uint:
+            CAPTURE_ARG(ArgKind_Uint, readUnsigned(&args, spec.length));
+            break;
+        case ArgKind_Double:
+            if (spec.length == LengthMod_LongDouble) {
+                CAPTURE_ARG(ArgKind_Double, doubleBits((double)va_arg(args, long double)));
+            } else {
+                CAPTURE_ARG(ArgKind_Double, doubleBits(va_arg(args, double)));
+            }
+            break;
+        case ArgKind_Ptr:
+            CAPTURE_ARG(ArgKind_Ptr, (uintptr_t)va_arg(args, void*));
+            break;
+        case ArgKind_String: {
+            // string contents are copied, pointer may be a temporary buffer
+            // string with precision does not have to be null terminated
+            const char* str = va_arg(args, const char*);
+            if (!str) {
+                str = "(null)";
+            }
+            size_t maxSize = PHOTON_CFG_LOG_MAX_STRING_SIZE;
+            if (spec.precision == PRECISION_STAR && lastStar >= 0) {
+                maxSize = PHOTON_MIN(maxSize, (size_t)lastStar);
+            } else if (spec.precision >= 0) {
+                maxSize = PHOTON_MIN(maxSize, (size_t)spec.precision);
+            }
+            size_t size = boundedStrlen(str, maxSize);
+            if ((size_t)(end - current) < size + 2) {
+                goto done;
+            }
+            current[0] = (uint8_t)ArgKind_String;
+            current[1] = (uint8_t)size;
+            memcpy(current + 2, str, size);
+            current += size + 2;
+            break;
+        }
+        }
+        it = spec.end;
+    }
+done:
+    va_end(args);
+
+    uint16_t size = (uint16_t)(current - record);
+    Photon_Le16Enc(record, size);
+    if (PhotonRingBuf_WritableSize(&logRingBuf) < size) {
+        droppedCount++;
+        return;
+    }
+    PhotonRingBuf_Write(&logRingBuf, record, size);
+}
+
+#undef CAPTURE_ARG
+
+static void appendStr(char* dest, size_t destSize, size_t* pos, const char* src, size_t size)
+{
+    size = PHOTON_MIN(size, destSize - 1 - *pos);
+    memcpy(dest + *pos, src, size);
+    *pos += size;
+}
+
+// reads [u8 tag][u64 value], returns false if record is truncated or arg type does not match specifier
+static bool readArg(const uint8_t** current, const uint8_t* end, ArgKind kind, uint64_t* value)
+{
+    if ((size_t)(end - *current) < 9 || **current != (uint8_t)kind) {
+        return false;
+    }
+    *value = Photon_Le64Dec(*current + 1);
+    *current += 9;
+    return true;
+}
+
+#define FORMAT_ARG(value)                                                                           \
+    do {                                                                                            \
+        switch (spec.starCount) {                                                                   \
+        case 0:                                                                                     \
+            rv = snprintf(dest + pos, destSize - pos, specStr, value);                              \
+            break;                                                                                  \
+        case 1:                                                                                     \
+            rv = snprintf(dest + pos, destSize - pos, specStr, stars[0], value);                    \
+            break;                                                                                  \
+        default:                                                                                    \
+            rv = snprintf(dest + pos, destSize - pos, specStr, stars[0], stars[1], value);          \
+            break;                                                                                  \
+        }                                                                                           \
+    } while (0)
+
+size_t Photon_FormatLogRecord(const void* record, size_t size, char* dest, size_t destSize)
+{
+    if (destSize == 0) {
+        return 0;
+    }
+    dest[0] = '\0';
+    if (size < RECORD_HEADER_SIZE) {
+        return 0;
+    }
+    const uint8_t* current = (const uint8_t*)record + RECORD_HEADER_SIZE;
+    const uint8_t* end = (const uint8_t*)record + size;
+    uint32_t fmtId = Photon_Le32Dec((const uint8_t*)record + RECORD_FMT_OFFSET);
+    const char* fmt = findString(fmtId);
+    if (!fmt) {
+        int rv = snprintf(dest, destSize, "<unknown format %08x>", (unsigned)fmtId);
+        return rv > 0 ? PHOTON_MIN((size_t)rv, destSize - 1) : 0;
+    }
+
+    size_t pos = 0;
+    const char* it = fmt;
+    FormatSpec spec;
+    const char* next;
+    while ((next = nextSpec(it, &spec)) != 0) {
+        // literal text, %% is printed as single %
+        while (it < next) {
+            const char* percent = strstr(it, "%%");
+            if (!percent || percent >= next) {
+                appendStr(dest, destSize, &pos, it, next - it);
+                break;
+            }
+            appendStr(dest, destSize, &pos, it, percent - it + 1);
+            it = percent + 2;
+        }
+        // flags, width and precision are kept, length modifier is replaced to match stored value
+        char specStr[20];
+        size_t specSize = spec.lengthBegin - spec.begin;
+        if (spec.kind == ArgKind_None || spec.starCount > 2 || specSize + 4 > sizeof(specStr)) {
+            goto truncated;
+        }
+        memcpy(specStr, spec.begin, specSize);
+        if ((spec.kind == ArgKind_Int && spec.conversion != 'c') || spec.kind == ArgKind_Uint) {
+            specStr[specSize++] = 'l';
+            specStr[specSize++] = 'l';
+        }
+        specStr[specSize++] = spec.conversion;
+        specStr[specSize] = '\0';
+        int stars[2];
+        for (unsigned i = 0; i < spec.starCount; i++) {
+            uint64_t star;
+            if (!readArg(&current, end, ArgKind_Int, &star)) {
+                goto truncated;
+            }
+            stars[i] = (int)(int64_t)star;
+        }
+        int rv = 0;
+        uint64_t value;
+        switch (spec.kind) {
+        case ArgKind_None:
+            break;
+        case ArgKind_Int:
+            if (!readArg(&current, end, ArgKind_Int, &value)) {
+                goto truncated;
+            }
+            if (spec.conversion == 'c') {
+                FORMAT_ARG((int)(int64_t)value);
+            } else {
+                FORMAT_ARG((long long)(int64_t)value);
+            }
+            break;
+        case ArgKind_Uint:
+            if (!readArg(&current, end, ArgKind_Uint, &value)) {
+                goto truncated;
+            }
+            FORMAT_ARG((unsigned long long)value);
+            break;
+        case ArgKind_Double:
+            if (!readArg(&current, end, ArgKind_Double, &value)) {
+                goto truncated;
+            }
+            FORMAT_ARG(doubleFromBits(value));
+            break;
+        case ArgKind_Ptr:
+            if (!readArg(&current, end, ArgKind_Ptr, &value)) {
+                goto truncated;
+            }
+            FORMAT_ARG((void*)(uintptr_t)value);
+            break;
+        case ArgKind_String: {
+            if ((size_t)(end - current) < 2 || current[0] != (uint8_t)ArgKind_String
+                || (size_t)(end - current) < 2u + current[1]) {
+                goto truncated;
+            }
+            char str[PHOTON_CFG_LOG_MAX_STRING_SIZE + 1];
+            size_t strSize = PHOTON_MIN((size_t)current[1], (size_t)PHOTON_CFG_LOG_MAX_STRING_SIZE);
+            memcpy(str, current + 2, strSize);
+            str[strSize] = '\0';
+            current += current[1] + 2;
+            FORMAT_ARG(str);
+            break;
+        }
+        }
+        if (rv > 0) {
+            pos = PHOTON_MIN(pos + (size_t)rv, destSize - 1);
+        }
+        it = spec.end;
+    }
+    while (*it) {
+        const char* percent = strstr(it, "%%");
+        if (!percent) {
+            appendStr(dest, destSize, &pos, it, strlen(it));
+            break;
+        }
+        appendStr(dest, destSize, &pos, it, percent - it + 1);
+        it = percent + 2;
+    }
+    dest[pos] = '\0';
+    return pos;
+
+truncated:
+    appendStr(dest, destSize, &pos, "...", 3);
+    dest[pos] = '\0';
+    return pos;
+}
+
+#undef FORMAT_ARG
+
+static uint16_t peekRecordSize(void)
+{
+    uint8_t sizeData[2];
+    PhotonRingBuf_Peek(&logRingBuf, sizeData, 2, 0);
+    return Photon_Le16Dec(sizeData);
+}
+
+static bool readRecord(uint8_t* record, size_t* size)
+{
+    if (!isLogInitialized || PhotonRingBuf_ReadableSize(&logRingBuf) < 2) {
+        return false;
+    }
+    uint16_t recordSize = peekRecordSize();
+    PHOTON_ASSERT(recordSize <= PHOTON_CFG_LOG_MAX_RECORD_SIZE);
+    PhotonRingBuf_Read(&logRingBuf, record, recordSize);
+    *size = recordSize;
+    return true;
+}
+
+size_t Photon_FlushLog(size_t maxRecords)
+{
+    size_t count = 0;
+    uint8_t record[PHOTON_CFG_LOG_MAX_RECORD_SIZE];
+    char line[256];
+    size_t size;
+    while (count < maxRecords && readRecord(record, &size)) {
+        uint32_t lineNum = Photon_Le32Dec(record + RECORD_LINE_OFFSET);
+        int64_t t = (int64_t)Photon_Le64Dec(record + RECORD_TIME_OFFSET);
+        const char* fname = findString(Photon_Le32Dec(record + RECORD_FNAME_OFFSET));
+        if (!fname) {
+            fname = "?";
+        }
+        Photon_FormatLogRecord(record, size, line, sizeof(line));
+        printPrefix(record[RECORD_LEVEL_OFFSET], fname, lineNum, (time_t)t);
+        printf("%s\n", line);
+        count++;
+    }
+    return count;
+}
+
+size_t Photon_ReadLogRecords(void* dest, size_t size)
+{
+    size_t total = 0;
+    uint8_t* d = (uint8_t*)dest;
+    while (isLogInitialized && PhotonRingBuf_ReadableSize(&logRingBuf) >= 2) {
+        uint16_t recordSize = peekRecordSize();
+        if (recordSize > size - total) {
+            break;
+        }
+        PhotonRingBuf_Read(&logRingBuf, d + total, recordSize);
+        total += recordSize;
+    }
+    return total;
+}
+
+size_t Photon_LogDroppedCount(void)
+{
+    return droppedCount;
+}
+
+#endif
+
 # endif
 #endif
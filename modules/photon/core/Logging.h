@@ -3,6 +3,9 @@
 
 #include "photongen/onboard/Config.h"
 
+#include <stddef.h>
+#include <stdint.h>
+
 //TODO: find a better way to set _PHOTON_FNAME
 
 #ifdef _PHOTON_FNAME
@@ -29,6 +32,22 @@ extern "C" {
 void Photon_SetLogDeviceName(const char* name);
 void Photon_Log(int level, const char* fname, unsigned lineNum, const char* fmt, ...);
 
+# ifdef PHOTON_CFG_LOG_DEFERRED
+// log calls only copy format string id and tagged fixed width arguments to a ring buffer,
+// formatting is done later by Photon_FlushLog or Photon_FormatLogRecord.
+// Format and file name ids are Photon_LogStringId hashes of the strings, so records
+// sent outside the image can be decoded with a table of hashed source strings
+
+/// formats and prints up to maxRecords stored records, returns number of printed records
+size_t Photon_FlushLog(size_t maxRecords);
+/// moves whole records to dest (to be sent as telemetry), returns number of copied bytes
+size_t Photon_ReadLogRecords(void* dest, size_t size);
+/// formats record returned by Photon_ReadLogRecords, format is looked up among strings logged by this image
+size_t Photon_FormatLogRecord(const void* record, size_t size, char* dest, size_t destSize);
+size_t Photon_LogDroppedCount(void);
+uint32_t Photon_LogStringId(const char* str);
+# endif
+
 # ifdef __cplusplus
 }
 # endif
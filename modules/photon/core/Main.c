@@ -35,6 +35,8 @@
 # include "photongen/onboard/blog/Blog.Component.h"
 #endif
 
+#include "photon/core/Logging.h"
+
 void Photon_Init()
 {
 #if defined(PHOTON_HAS_MODULE_BLOG)
@@ -75,6 +77,11 @@ void Photon_Init()
 #endif
 }
 
+// deferred log records printed per tick if there is no binary log to store them
+#ifndef PHOTON_CFG_LOG_FLUSH_RECORDS
+# define PHOTON_CFG_LOG_FLUSH_RECORDS 16
+#endif
+
 void Photon_Tick()
 {
 #if defined(PHOTON_HAS_MODULE_CLK)
@@ -113,5 +120,8 @@ void Photon_Tick()
 #if defined(PHOTON_HAS_MODULE_ZCVM)
     PhotonZcvm_Tick();
 #endif
+#if defined(PHOTON_CFG_LOG_DEFERRED) && PHOTON_LOG_LEVEL != PHOTON_LOG_LEVEL_NONE && !defined(PHOTON_HAS_MODULE_BLOG)
+    Photon_FlushLog(PHOTON_CFG_LOG_FLUSH_RECORDS);
+#endif
 }
 
@@ -151,7 +151,8 @@ void PhotonRingBuf_AdvanceWritePtr(PhotonRingBuf* self, size_t size)
 
 void PhotonRingBuf_AdvanceReadPtr(PhotonRingBuf* self, size_t size)
 {
-    self->freeSpace -= size;
+    PHOTON_ASSERT(self->size - self->freeSpace >= size);
+    self->freeSpace += size;
     self->readOffset += size;
     if (self->readOffset >= self->size) {
         self->readOffset -= self->size;
@@ -189,3 +190,75 @@ PhotonMemChunks PhotonRingBuf_ReadableChunks(const PhotonRingBuf* self)
 
     return chunks;
 }
+
+uint8_t* PhotonRingBuf_Reserve(PhotonRingBuf* self, size_t size)
+{
+    if (self->freeSpace == self->size) {
+        /* empty, move offsets to the beginning to get the longest linear region */
+        self->readOffset = 0;
+        self->writeOffset = 0;
+    }
+    if (PhotonRingBuf_LinearWritableSize(self) < size) {
+        return NULL;
+    }
+    return self->data + self->writeOffset;
+}
+
+void PhotonRingBuf_Commit(PhotonRingBuf* self, size_t size)
+{
+    PHOTON_ASSERT(size <= PhotonRingBuf_LinearWritableSize(self));
+    extend(self, size);
+}
+
+PhotonMemChunks PhotonRingBuf_PeekChunks(const PhotonRingBuf* self, size_t size, size_t offset)
+{
+    PHOTON_ASSERT(size + offset <= self->size - self->freeSpace);
+    size_t readOffset = self->readOffset + offset;
+    if (readOffset >= self->size) {
+        readOffset -= self->size;
+    }
+    PhotonMemChunks chunks;
+    size_t rightData = self->size - readOffset;
+    chunks.first.data = self->data + readOffset;
+    chunks.first.size = min(size, rightData);
+    chunks.second.data = self->data;
+    chunks.second.size = size - chunks.first.size;
+    return chunks;
+}
+
+void PhotonRingBuf_Consume(PhotonRingBuf* self, size_t size)
+{
+    PhotonRingBuf_Erase(self, size);
+}
+
+static void reverse(uint8_t* begin, uint8_t* end)
+{
+    while (begin < end) {
+        end--;
+        uint8_t tmp = *begin;
+        *begin = *end;
+        *end = tmp;
+        begin++;
+    }
+}
+
+void PhotonRingBuf_Linearize(PhotonRingBuf* self)
+{
+    if (self->readOffset == 0) {
+        return;
+    }
+    size_t readableSize = self->size - self->freeSpace;
+    if (self->readOffset < self->writeOffset || readableSize == 0) {
+        memmove(self->data, self->data + self->readOffset, readableSize);
+    } else {
+        /* rotate in place, no extra memory */
+        reverse(self->data, self->data + self->readOffset);
+        reverse(self->data + self->readOffset, self->data + self->size);
+        reverse(self->data, self->data + self->size);
+    }
+    self->readOffset = 0;
+    self->writeOffset = readableSize;
+    if (self->writeOffset == self->size) {
+        self->writeOffset = 0;
+    }
+}
@@ -0,0 +1,73 @@
+#include "photon/core/SpscRingBuf.h"
+#include "photon/core/Assert.h"
+#include "photon/core/Util.h"
+
+#include <string.h>
+
+void PhotonSpscRingBuf_Init(PhotonSpscRingBuf* self, void* data, size_t size)
+{
+    PHOTON_ASSERT(size > 0);
+    PHOTON_ASSERT((size & (size - 1)) == 0);
+    self->data = (uint8_t*)data;
+    self->mask = size - 1;
+    self->head = 0;
+    self->tail = 0;
+}
+
+size_t PhotonSpscRingBuf_WritableSize(const PhotonSpscRingBuf* self)
+{
+    size_t tail = PHOTON_SPSC_LOAD_ACQUIRE(&self->tail);
+    return self->mask + 1 - (self->head - tail);
+}
+
+size_t PhotonSpscRingBuf_Write(PhotonSpscRingBuf* self, const void* src, size_t size)
+{
+    size_t head = self->head;
+    size_t tail = PHOTON_SPSC_LOAD_ACQUIRE(&self->tail);
+    size = PHOTON_MIN(size, self->mask + 1 - (head - tail));
+    if (size == 0) {
+        return 0;
+    }
+    size_t offset = head & self->mask;
+    size_t firstChunkSize = PHOTON_MIN(size, self->mask + 1 - offset);
+    memcpy(self->data + offset, src, firstChunkSize);
+    memcpy(self->data, (const uint8_t*)src + firstChunkSize, size - firstChunkSize);
+    PHOTON_SPSC_STORE_RELEASE(&self->head, head + size);
+    return size;
+}
+
+size_t PhotonSpscRingBuf_ReadableSize(const PhotonSpscRingBuf* self)
+{
+    size_t head = PHOTON_SPSC_LOAD_ACQUIRE(&self->head);
+    return head - self->tail;
+}
+
+PhotonMemChunks PhotonSpscRingBuf_ReadableChunks(const PhotonSpscRingBuf* self)
+{
+    size_t head = PHOTON_SPSC_LOAD_ACQUIRE(&self->head);
+    size_t size = head - self->tail;
+    size_t offset = self->tail & self->mask;
+    PhotonMemChunks chunks;
+    chunks.first.data = self->data + offset;
+    chunks.first.size = PHOTON_MIN(size, self->mask + 1 - offset);
+    chunks.second.data = self->data;
+    chunks.second.size = size - chunks.first.size;
+    return chunks;
+}
+
+size_t PhotonSpscRingBuf_Read(PhotonSpscRingBuf* self, void* dest, size_t size)
+{
+    PhotonMemChunks chunks = PhotonSpscRingBuf_ReadableChunks(self);
+    size = PHOTON_MIN(size, chunks.first.size + chunks.second.size);
+    size_t firstChunkSize = PHOTON_MIN(size, chunks.first.size);
+    memcpy(dest, chunks.first.data, firstChunkSize);
+    memcpy((uint8_t*)dest + firstChunkSize, chunks.second.data, size - firstChunkSize);
+    PhotonSpscRingBuf_Consume(self, size);
+    return size;
+}
+
+void PhotonSpscRingBuf_Consume(PhotonSpscRingBuf* self, size_t size)
+{
+    PHOTON_ASSERT(size <= PhotonSpscRingBuf_ReadableSize(self));
+    PHOTON_SPSC_STORE_RELEASE(&self->tail, self->tail + size);
+}
@@ -0,0 +1,80 @@
+#ifndef __PHOTON_CORE_SPSCRINGBUF_H__
+#define __PHOTON_CORE_SPSCRINGBUF_H__
+
+#include "photongen/onboard/Config.h"
+
+#include "photongen/onboard/core/MemChunks.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Single producer, single consumer byte queue that needs no critical sections.
+// Producer (usually uart rx interrupt) only calls Write/WritableSize, consumer (main loop) only calls
+// ReadableSize/ReadableChunks/Read/Consume:
+//
+//     void UART_IRQHandler() { PhotonSpscRingBuf_Write(&rx, &byte, 1); }
+//     ...
+//     PhotonMemChunks chunks = PhotonSpscRingBuf_ReadableChunks(&rx);
+//     PhotonExc_AcceptInput(chunks.first.data, chunks.first.size);
+//     PhotonExc_AcceptInput(chunks.second.data, chunks.second.size);
+//     PhotonSpscRingBuf_Consume(&rx, chunks.first.size + chunks.second.size);
+//
+// Indexes are free running and published with release/acquire ordering. GCC and clang use
+// __atomic builtins, other compilers must define PHOTON_MEMORY_BARRIER().
+// Buffer size must be a power of two.
+
+#if defined(PHOTON_SPSC_LOAD_ACQUIRE) && defined(PHOTON_SPSC_STORE_RELEASE)
+#elif defined(__GNUC__) || defined(__clang__)
+# define PHOTON_SPSC_LOAD_ACQUIRE(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+# define PHOTON_SPSC_STORE_RELEASE(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#elif defined(PHOTON_MEMORY_BARRIER)
+# define PHOTON_SPSC_LOAD_ACQUIRE(ptr) Photon_SpscLoadAcquire(ptr)
+# define PHOTON_SPSC_STORE_RELEASE(ptr, value) Photon_SpscStoreRelease((ptr), (value))
+#else
+# error "PHOTON_MEMORY_BARRIER() is required for this compiler"
+#endif
+
+typedef struct {
+    uint8_t* data;
+    size_t mask;
+    size_t head; // written only by producer
+    size_t tail; // written only by consumer
+} PhotonSpscRingBuf;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if !defined(__GNUC__) && !defined(__clang__) && defined(PHOTON_MEMORY_BARRIER)
+static PHOTON_INLINE size_t Photon_SpscLoadAcquire(const size_t* ptr)
+{
+    size_t value = *(const volatile size_t*)ptr;
+    PHOTON_MEMORY_BARRIER();
+    return value;
+}
+
+static PHOTON_INLINE void Photon_SpscStoreRelease(size_t* ptr, size_t value)
+{
+    PHOTON_MEMORY_BARRIER();
+    *(volatile size_t*)ptr = value;
+}
+#endif
+
+void PhotonSpscRingBuf_Init(PhotonSpscRingBuf* self, void* data, size_t size);
+
+// producer side, returns number of bytes written, bytes that don't fit are dropped
+size_t PhotonSpscRingBuf_Write(PhotonSpscRingBuf* self, const void* src, size_t size);
+size_t PhotonSpscRingBuf_WritableSize(const PhotonSpscRingBuf* self);
+
+// consumer side
+size_t PhotonSpscRingBuf_ReadableSize(const PhotonSpscRingBuf* self);
+PhotonMemChunks PhotonSpscRingBuf_ReadableChunks(const PhotonSpscRingBuf* self);
+size_t PhotonSpscRingBuf_Read(PhotonSpscRingBuf* self, void* dest, size_t size);
+void PhotonSpscRingBuf_Consume(PhotonSpscRingBuf* self, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5,9 +5,30 @@
 
 #include "photon/core/Assert.h"
 #include "photon/core/Logging.h"
+#include "photon/core/Util.h"
+#include "photon/core/Crc.h"
+#include "photon/dfu/Patch.h"
+
+#include <string.h>
 
 #define _PHOTON_FNAME "fwt/Dfu.c"
 
+// max size of written block, chunk with header has to fit into max exc packet
+#ifndef PHOTON_CFG_DFU_MAX_BLOCK_SIZE
+# define PHOTON_CFG_DFU_MAX_BLOCK_SIZE 512
+#endif
+
+// size of written blocks bitmap in bytes, block size is increased if transfer has more blocks than bitmap bits
+#ifndef PHOTON_CFG_DFU_BITMAP_SIZE
+# define PHOTON_CFG_DFU_BITMAP_SIZE 256
+#endif
+
+// used if ground does not negotiate block size
+#define DEFAULT_BLOCK_SIZE 256
+#define MAX_BLOCKS ((uint64_t)PHOTON_CFG_DFU_BITMAP_SIZE * 8)
+
+static uint8_t writtenBlocks[PHOTON_CFG_DFU_BITMAP_SIZE];
+
 static void setError(const char* err)
 {
     _photonDfu.response = PhotonDfuResponse_Error;
@@ -49,31 +70,61 @@ PhotonError PhotonDfu_HandleInitSectorDesc(PhotonDfuAllSectorsDesc* data)
     return PhotonError_Ok;
 }
 
-static uint8_t* stubFirmware = 0;
+PhotonError PhotonDfu_HandleInitImageDesc(PhotonDfuAllImagesDesc* data)
+{
+    data->size = 4;
+    memset(data->data, 0, sizeof(data->data));
+    return PhotonError_Ok;
+}
+
+PhotonError PhotonDfu_HandleStoreImageDesc(uint64_t sectorId, const PhotonDfuImageDesc* desc)
+{
+    (void)sectorId;
+    (void)desc;
+    return PhotonError_Ok;
+}
+
+// sectors are kept in memory after update so that they can be used as delta update base
+static uint8_t* stubSectors[8];
+static size_t stubCurrentSector = 0;
+
+static size_t stubSectorIndex(const PhotonDfuSectorDesc* sector)
+{
+    return sector - _photonDfu.allSectorsDesc.data;
+}
 
 PhotonError PhotonDfu_HandleBeginUpdate(const PhotonDfuSectorDesc* sector)
 {
-    if (stubFirmware) {
-        free(stubFirmware);
-        stubFirmware = 0;
+    stubCurrentSector = stubSectorIndex(sector);
+    free(stubSectors[stubCurrentSector]);
+    stubSectors[stubCurrentSector] = (uint8_t*)malloc(sector->size);
+    if (!stubSectors[stubCurrentSector]) {
+        return PhotonError_NotEnoughSpace;
     }
-    stubFirmware = (uint8_t*)malloc(sector->size);
+    memset(stubSectors[stubCurrentSector], 0xff, sector->size);
     return PhotonError_Ok;
 }
 
 PhotonError PhotonDfu_HandleWriteChunk(const void* data, uint64_t offset, uint64_t size)
 {
-    memcpy(&stubFirmware[offset], data, size);
+    memcpy(&stubSectors[stubCurrentSector][offset], data, size);
     return PhotonError_Ok;
 }
 
+PhotonError PhotonDfu_HandleReadSector(const PhotonDfuSectorDesc* sector, uint64_t offset, void* dest, uint64_t size)
+{
+    uint8_t* data = stubSectors[stubSectorIndex(sector)];
+    if (data) {
+        memcpy(dest, &data[offset], size);
+    } else {
+        memset(dest, 0xff, size);
+    }
+    return PhotonError_Ok;
+}
 
 PhotonError PhotonDfu_HandleEndUpdate(const PhotonDfuSectorDesc* sector)
 {
-    if (stubFirmware) {
-        free(stubFirmware);
-        stubFirmware = 0;
-    }
+    (void)sector;
     return PhotonError_Ok;
 }
 
@@ -89,13 +140,25 @@ void PhotonDfu_Init()
     _photonDfu.state = PhotonDfuState_Idle;
     _photonDfu.response = PhotonDfuResponse_None;
     _photonDfu.currentWriteOffset = 0;
+    _photonDfu.lastWriteOffset = 0;
+    _photonDfu.isWriteAckPending = false;
     _photonDfu.lastError = "";
     _photonDfu.currentSector = 0;
+    _photonDfu.transferSize = 0;
+    _photonDfu.blockSize = DEFAULT_BLOCK_SIZE;
+    _photonDfu.transferId = 0;
+    memset(writtenBlocks, 0, sizeof(writtenBlocks));
     PhotonDfu_HandleInitSectorData(&_photonDfu.sectorData);
     PhotonDfu_HandleInitSectorDesc(&_photonDfu.allSectorsDesc);
+    PhotonDfu_HandleInitImageDesc(&_photonDfu.allImagesDesc);
+    _photonDfu.isPatching = false;
+    _photonDfu.patchBaseSector = 0;
+    _photonDfu.patchTarget.id = 0;
+    _photonDfu.patchTarget.size = 0;
+    _photonDfu.patchTargetCrc = 0;
 #ifdef PHOTON_STUB
-    stubFirmware = 0;
-
+    memset(stubSectors, 0, sizeof(stubSectors));
+    stubCurrentSector = 0;
 #endif
 }
 
@@ -117,13 +180,33 @@ static PhotonError reportInfo(PhotonReader* src)
     return PhotonError_Ok;
 }
 
-static PhotonError beginUpdate(PhotonReader* src)
+static uint64_t blockCount()
 {
-    uint64_t sectorId;
-    uint64_t totalSize;
-    PHOTON_TRY(PhotonReader_ReadVaruint(src, &sectorId));
-    PHOTON_TRY(PhotonReader_ReadVaruint(src, &totalSize));
+    return (_photonDfu.transferSize + _photonDfu.blockSize - 1) / _photonDfu.blockSize;
+}
 
+static uint64_t bitmapSize()
+{
+    return (blockCount() + 7) / 8;
+}
+
+static PhotonError reportProgress(PhotonReader* src)
+{
+    (void)src;
+    _photonDfu.response = PhotonDfuResponse_Progress;
+    return PhotonError_Ok;
+}
+
+static PhotonError invalidateImage(uint64_t sectorId)
+{
+    PhotonDfuImageDesc* image = &_photonDfu.allImagesDesc.data[sectorId];
+    image->id = 0;
+    image->size = 0;
+    return PhotonDfu_HandleStoreImageDesc(sectorId, image);
+}
+
+static PhotonError startTransfer(uint64_t sectorId, uint64_t totalSize, uint64_t blockSize, uint64_t transferId)
+{
     if (sectorId == PHOTON_DFU_CURRENT_SECTOR) {
         setError("Cannot flash sector currently booted into");
         return PhotonError_InvalidValue;
@@ -145,9 +228,30 @@ static PhotonError beginUpdate(PhotonReader* src)
         return PhotonError_InvalidValue;
     }
 
+    if (blockSize == 0) {
+        setError("Invalid block size");
+        return PhotonError_InvalidValue;
+    }
+    blockSize = PHOTON_MIN(blockSize, PHOTON_CFG_DFU_MAX_BLOCK_SIZE);
+    uint64_t minBlockSize = (totalSize + MAX_BLOCKS - 1) / MAX_BLOCKS;
+    if (blockSize < minBlockSize) {
+        if (minBlockSize > PHOTON_CFG_DFU_MAX_BLOCK_SIZE) {
+            setError("Transfer size overflows written blocks bitmap");
+            return PhotonError_InvalidValue;
+        }
+        blockSize = minBlockSize;
+    }
+
     _photonDfu.currentWriteOffset = 0;
+    _photonDfu.lastWriteOffset = 0;
+    _photonDfu.isWriteAckPending = false;
     _photonDfu.transferSize = totalSize;
     _photonDfu.currentSector = sectorId;
+    _photonDfu.blockSize = blockSize;
+    _photonDfu.transferId = transferId;
+    _photonDfu.isPatching = false;
+    memset(writtenBlocks, 0, sizeof(writtenBlocks));
+    PHOTON_TRY(invalidateImage(sectorId));
     PHOTON_TRY(PhotonDfu_HandleBeginUpdate(sector));
 
     _photonDfu.state = PhotonDfuState_Writing;
@@ -155,6 +259,132 @@ static PhotonError beginUpdate(PhotonReader* src)
     return PhotonError_Ok;
 }
 
+static PhotonError beginUpdate(PhotonReader* src)
+{
+    uint64_t sectorId;
+    uint64_t totalSize;
+    uint64_t blockSize = DEFAULT_BLOCK_SIZE;
+    uint64_t transferId = 0;
+    PHOTON_TRY(PhotonReader_ReadVaruint(src, &sectorId));
+    PHOTON_TRY(PhotonReader_ReadVaruint(src, &totalSize));
+    // block size and transfer id are optional for compatibility with sequential ground
+    if (PhotonReader_ReadableSize(src) != 0) {
+        PHOTON_TRY(PhotonReader_ReadVaruint(src, &blockSize));
+        if (PhotonReader_ReadableSize(src) < 8) {
+            setError("Invalid transfer id");
+            return PhotonError_NotEnoughData;
+        }
+        transferId = PhotonReader_ReadU64Le(src);
+    }
+    return startTransfer(sectorId, totalSize, blockSize, transferId);
+}
+
+static bool readPatchBase(void* ctx, uint64_t offset, void* dest, size_t size)
+{
+    (void)ctx;
+    const PhotonDfuSectorDesc* base = &_photonDfu.allSectorsDesc.data[_photonDfu.patchBaseSector];
+    return PhotonDfu_HandleReadSector(base, offset, dest, size) == PhotonError_Ok;
+}
+
+static bool writePatchTarget(void* ctx, uint64_t offset, const void* src, size_t size)
+{
+    (void)ctx;
+    return PhotonDfu_HandleWriteChunk(src, offset, size) == PhotonError_Ok;
+}
+
+static PhotonDfuPatch patch;
+
+// failed patch can't be resumed, ground has to begin new transfer
+static void abortPatch(const char* err)
+{
+    setError(err);
+    _photonDfu.state = PhotonDfuState_Idle;
+    _photonDfu.transferId = 0;
+    _photonDfu.isPatching = false;
+    _photonDfu.isWriteAckPending = false;
+}
+
+// [target sector][patch size][block size][transfer id][base sector][base id][target size][target id][target crc]
+static PhotonError beginPatch(PhotonReader* src)
+{
+    uint64_t sectorId;
+    uint64_t patchSize;
+    uint64_t blockSize;
+    uint64_t transferId;
+    uint64_t baseSectorId;
+    uint64_t baseId;
+    uint64_t targetSize;
+    uint64_t targetId;
+    uint16_t targetCrc;
+    PHOTON_TRY(PhotonReader_ReadVaruint(src, &sectorId));
+    PHOTON_TRY(PhotonReader_ReadVaruint(src, &patchSize));
+    PHOTON_TRY(PhotonReader_ReadVaruint(src, &blockSize));
+    if (PhotonReader_ReadableSize(src) < 8) {
+        return PhotonError_NotEnoughData;
+    }
+    transferId = PhotonReader_ReadU64Le(src);
+    PHOTON_TRY(PhotonReader_ReadVaruint(src, &baseSectorId));
+    if (PhotonReader_ReadableSize(src) < 8) {
+        return PhotonError_NotEnoughData;
+    }
+    baseId = PhotonReader_ReadU64Le(src);
+    PHOTON_TRY(PhotonReader_ReadVaruint(src, &targetSize));
+    if (PhotonReader_ReadableSize(src) < 10) {
+        return PhotonError_NotEnoughData;
+    }
+    targetId = PhotonReader_ReadU64Le(src);
+    targetCrc = PhotonReader_ReadU16Le(src);
+
+    if (baseSectorId >= _photonDfu.allSectorsDesc.size || baseSectorId == sectorId) {
+        setError("Invalid base sector id");
+        return PhotonError_InvalidValue;
+    }
+
+    const PhotonDfuImageDesc* base = &_photonDfu.allImagesDesc.data[baseSectorId];
+    if (base->id == 0 || base->id != baseId) {
+        setError("Base image does not match");
+        return PhotonError_InvalidValue;
+    }
+
+    if (sectorId < _photonDfu.allSectorsDesc.size && targetSize > _photonDfu.allSectorsDesc.data[sectorId].size) {
+        setError("Sector size overflow");
+        return PhotonError_InvalidValue;
+    }
+
+    PHOTON_TRY(startTransfer(sectorId, patchSize, blockSize, transferId));
+    _photonDfu.isPatching = true;
+    _photonDfu.patchBaseSector = baseSectorId;
+    _photonDfu.patchTarget.id = targetId;
+    _photonDfu.patchTarget.size = targetSize;
+    _photonDfu.patchTargetCrc = targetCrc;
+    PhotonDfuPatch_Init(&patch, base->size, targetSize, readPatchBase, writePatchTarget, 0);
+    return PhotonError_Ok;
+}
+
+// whole patched image is read back, so errors in base or flash writes are also detected
+static PhotonError verifyPatchedImage()
+{
+    if (!PhotonDfuPatch_IsFinished(&patch)) {
+        abortPatch("Patch is incomplete");
+        return PhotonError_InvalidValue;
+    }
+
+    const PhotonDfuSectorDesc* sector = &_photonDfu.allSectorsDesc.data[_photonDfu.currentSector];
+    uint16_t crc = 0xffff;
+    uint64_t offset = 0;
+    while (offset < _photonDfu.patchTarget.size) {
+        size_t size = PHOTON_MIN(sizeof(patch.sector), _photonDfu.patchTarget.size - offset);
+        PHOTON_TRY(PhotonDfu_HandleReadSector(sector, offset, patch.sector, size));
+        crc = Photon_Crc16Update(crc, patch.sector, size);
+        offset += size;
+    }
+    if (crc != _photonDfu.patchTargetCrc) {
+        abortPatch("Patched image crc mismatch");
+        return PhotonError_InvalidValue;
+    }
+    return PhotonError_Ok;
+}
+
 static PhotonError endUpdate(PhotonReader* src)
 {
     uint64_t sectorId;
@@ -166,14 +396,29 @@ static PhotonError endUpdate(PhotonReader* src)
 
     uint64_t totalSize;
     PHOTON_TRY(PhotonReader_ReadVaruint(src, &totalSize));
-    //TODO: check sector id
     if (totalSize != _photonDfu.transferSize) {
         setError("Invalid total size");
         return PhotonError_InvalidValue;
     }
 
+    if (_photonDfu.currentWriteOffset != _photonDfu.transferSize) {
+        setError("Not all blocks written");
+        return PhotonError_InvalidValue;
+    }
+
+    PhotonDfuImageDesc image;
+    if (_photonDfu.isPatching) {
+        PHOTON_TRY(verifyPatchedImage());
+        image = _photonDfu.patchTarget;
+    } else {
+        image.id = _photonDfu.transferId;
+        image.size = _photonDfu.transferSize;
+    }
+
     PhotonDfuSectorDesc* sector = &_photonDfu.allSectorsDesc.data[_photonDfu.currentSector];
     PHOTON_TRY(PhotonDfu_HandleEndUpdate(sector));
+    _photonDfu.allImagesDesc.data[_photonDfu.currentSector] = image;
+    PHOTON_TRY(PhotonDfu_HandleStoreImageDesc(_photonDfu.currentSector, &image));
     _photonDfu.response = PhotonDfuResponse_EndOk;
 
     return PhotonError_Ok;
@@ -196,25 +441,45 @@ static PhotonError writeChunk(PhotonReader* src)
         return PhotonError_InvalidValue;
     }
 
-    if (offset != _photonDfu.currentWriteOffset) {
-        setError("offset != current offset");
-        return PhotonError_InvalidValue;
-    }
-
     if (offset >= _photonDfu.transferSize) {
         setError("offset > total size");
         return PhotonError_InvalidValue;
     }
 
-    if (offset > (_photonDfu.transferSize - size)) {
-        setError("write overflow");
+    if ((offset % _photonDfu.blockSize) != 0) {
+        setError("offset is not block aligned");
         return PhotonError_InvalidValue;
     }
 
-    PHOTON_TRY(PhotonDfu_HandleWriteChunk(PhotonReader_CurrentPtr(src), offset, size));
+    if (size != PHOTON_MIN(_photonDfu.blockSize, _photonDfu.transferSize - offset)) {
+        setError("chunk size != block size");
+        return PhotonError_InvalidValue;
+    }
 
-    _photonDfu.currentWriteOffset += size;
-    _photonDfu.response = PhotonDfuResponse_WriteOk;
+    // all chunks accepted since last answer are acknowledged by one answer with written blocks bitmap,
+    // ignored or failed blocks are absent from bitmap and resent by ground
+    _photonDfu.lastWriteOffset = offset;
+    _photonDfu.isWriteAckPending = true;
+
+    uint64_t block = offset / _photonDfu.blockSize;
+    uint8_t mask = 1 << (block % 8);
+    // retransmitted block is only acknowledged, ground could have lost previous answer
+    if ((writtenBlocks[block / 8] & mask) == 0) {
+        if (_photonDfu.isPatching) {
+            // patch is applied sequentially, blocks after lost one are ignored
+            if (offset != _photonDfu.currentWriteOffset) {
+                return PhotonError_Ok;
+            }
+            if (!PhotonDfuPatch_Feed(&patch, PhotonReader_CurrentPtr(src), size)) {
+                abortPatch("Failed to apply patch");
+                return PhotonError_InvalidValue;
+            }
+        } else {
+            PHOTON_TRY(PhotonDfu_HandleWriteChunk(PhotonReader_CurrentPtr(src), offset, size));
+        }
+        writtenBlocks[block / 8] |= mask;
+        _photonDfu.currentWriteOffset += size;
+    }
     return PhotonError_Ok;
 }
 
@@ -231,10 +496,10 @@ static PhotonError reboot(PhotonReader* src)
     return PhotonDfu_HandleReboot(sectorId);
 }
 
-static DfuHandler handlers[2][5] = {
-//      getinfo, beginupdate,         writechunk, endupdate  reboot
-    {reportInfo, beginUpdate, reportInvalidState, endUpdate, reboot}, //idle
-    {reportInfo, beginUpdate, writeChunk,         endUpdate, reportInvalidState}, //writing
+static DfuHandler handlers[2][7] = {
+//      getinfo, beginupdate,         writechunk, endupdate  reboot,             getprogress,    beginpatch
+    {reportInfo, beginUpdate, reportInvalidState, endUpdate, reboot,             reportProgress, beginPatch}, //idle
+    {reportInfo, beginUpdate, writeChunk,         endUpdate, reportInvalidState, reportProgress, beginPatch}, //writing
 };
 
 PhotonError PhotonDfu_AcceptCmd(const PhotonExcDataHeader* header, PhotonReader* src, PhotonWriter* dest)
@@ -252,6 +517,7 @@ static PhotonError writeInfo(PhotonWriter* dest)
     PHOTON_TRY(PhotonDfuResponse_Serialize(PhotonDfuResponse_GetInfo, dest));
     PHOTON_TRY(PhotonDfuSectorData_Serialize(&_photonDfu.sectorData, dest));
     PHOTON_TRY(PhotonDynArrayOfDfuSectorDescMaxSize8_Serialize(&_photonDfu.allSectorsDesc, dest));
+    PHOTON_TRY(PhotonDynArrayOfDfuImageDescMaxSize8_Serialize(&_photonDfu.allImagesDesc, dest));
     _photonDfu.response = PhotonDfuResponse_None;
     return PhotonError_Ok;
 }
@@ -261,14 +527,45 @@ static PhotonError writeBeginOk(PhotonWriter* dest)
     PHOTON_TRY(PhotonDfuResponse_Serialize(PhotonDfuResponse_BeginOk, dest));
     PHOTON_TRY(PhotonWriter_WriteVaruint(dest, _photonDfu.currentSector));
     PHOTON_TRY(PhotonWriter_WriteVaruint(dest, _photonDfu.transferSize));
+    PHOTON_TRY(PhotonWriter_WriteVaruint(dest, _photonDfu.blockSize));
     _photonDfu.response = PhotonDfuResponse_None;
     return PhotonError_Ok;
 }
 
+static PhotonError writeBitmap(PhotonWriter* dest)
+{
+    uint64_t size = _photonDfu.state == PhotonDfuState_Writing ? bitmapSize() : 0;
+    PHOTON_TRY(PhotonWriter_WriteVaruint(dest, size));
+    if (size > PhotonWriter_WritableSize(dest)) {
+        return PhotonError_NotEnoughSpace;
+    }
+    PhotonWriter_Write(dest, writtenBlocks, size);
+    return PhotonError_Ok;
+}
+
+// [last chunk offset][written bytes][bitmap of written blocks]
 static PhotonError writeWriteOk(PhotonWriter* dest)
 {
     PHOTON_TRY(PhotonDfuResponse_Serialize(PhotonDfuResponse_WriteOk, dest));
+    PHOTON_TRY(PhotonWriter_WriteVaruint(dest, _photonDfu.lastWriteOffset));
     PHOTON_TRY(PhotonWriter_WriteVaruint(dest, _photonDfu.currentWriteOffset));
+    PHOTON_TRY(writeBitmap(dest));
+    _photonDfu.isWriteAckPending = false;
+    return PhotonError_Ok;
+}
+
+static PhotonError writeProgress(PhotonWriter* dest)
+{
+    PHOTON_TRY(PhotonDfuResponse_Serialize(PhotonDfuResponse_Progress, dest));
+    PHOTON_TRY(PhotonDfuState_Serialize(_photonDfu.state, dest));
+    PHOTON_TRY(PhotonWriter_WriteVaruint(dest, _photonDfu.currentSector));
+    PHOTON_TRY(PhotonWriter_WriteVaruint(dest, _photonDfu.transferSize));
+    PHOTON_TRY(PhotonWriter_WriteVaruint(dest, _photonDfu.blockSize));
+    if (PhotonWriter_WritableSize(dest) < 8) {
+        return PhotonError_NotEnoughSpace;
+    }
+    PhotonWriter_WriteU64Le(dest, _photonDfu.transferId);
+    PHOTON_TRY(writeBitmap(dest));
     _photonDfu.response = PhotonDfuResponse_None;
     return PhotonError_Ok;
 }
@@ -297,20 +594,25 @@ static PhotonError writeError(PhotonWriter* dest)
     return PhotonError_Ok;
 }
 
+// write acknowledgement does not use response slot, so it is not lost if other answer is pending
 PhotonError PhotonDfu_GenAnswer(PhotonWriter* dest)
 {
     PhotonDfuResponse resp = _photonDfu.response;
+    if (resp == PhotonDfuResponse_None && _photonDfu.isWriteAckPending) {
+        return writeWriteOk(dest);
+    }
     switch (resp) {
     case PhotonDfuResponse_GetInfo:
         return writeInfo(dest);
     case PhotonDfuResponse_BeginOk:
         return writeBeginOk(dest);
-    case PhotonDfuResponse_WriteOk:
-        return writeWriteOk(dest);
     case PhotonDfuResponse_EndOk:
         return writeEndOk(dest);
     case PhotonDfuResponse_Error:
         return writeError(dest);
+    case PhotonDfuResponse_Progress:
+        return writeProgress(dest);
+    case PhotonDfuResponse_WriteOk:
     case PhotonDfuResponse_None:
         break;
     }
@@ -319,7 +621,7 @@ PhotonError PhotonDfu_GenAnswer(PhotonWriter* dest)
 
 bool PhotonDfu_HasAnswers()
 {
-    return _photonDfu.response != PhotonDfuResponse_None;
+    return _photonDfu.response != PhotonDfuResponse_None || _photonDfu.isWriteAckPending;
 }
 
 #undef _PHOTON_FNAME
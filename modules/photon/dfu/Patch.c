@@ -0,0 +1,171 @@
+#include "photon/dfu/Patch.h"
+
+#include <string.h>
+
+enum {
+    STATE_OP,
+    STATE_COPY_OFFSET,
+    STATE_COPY_SIZE,
+    STATE_INSERT_SIZE,
+    STATE_INSERT_DATA,
+    STATE_ERROR,
+};
+
+void PhotonDfuPatch_Init(PhotonDfuPatch* self, uint64_t baseSize, uint64_t targetSize,
+                         PhotonDfuPatchReadBase readBase, PhotonDfuPatchWriteTarget writeTarget, void* ctx)
+{
+    self->readBase = readBase;
+    self->writeTarget = writeTarget;
+    self->ctx = ctx;
+    self->baseSize = baseSize;
+    self->targetSize = targetSize;
+    self->targetOffset = 0;
+    self->copyOffset = 0;
+    self->number = 0;
+    self->numberShift = 0;
+    self->sectorFill = 0;
+    self->state = STATE_OP;
+}
+
+// returns true if number is complete
+static bool readNumber(PhotonDfuPatch* self, uint8_t byte, bool* isValid)
+{
+    if (self->numberShift > 63) {
+        *isValid = false;
+        return false;
+    }
+    self->number |= (uint64_t)(byte & 0x7f) << self->numberShift;
+    self->numberShift += 7;
+    if (byte & 0x80) {
+        return false;
+    }
+    self->numberShift = 0;
+    return true;
+}
+
+static size_t sectorSpace(const PhotonDfuPatch* self)
+{
+    return sizeof(self->sector) - self->sectorFill;
+}
+
+// size bytes were placed into sector buffer, sector is written when full or when target is complete
+static bool advanceTarget(PhotonDfuPatch* self, size_t size)
+{
+    self->sectorFill += size;
+    self->targetOffset += size;
+    if (self->sectorFill != sizeof(self->sector) && self->targetOffset != self->targetSize) {
+        return true;
+    }
+    uint64_t sectorOffset = self->targetOffset - self->sectorFill;
+    if (!self->writeTarget(self->ctx, sectorOffset, self->sector, self->sectorFill)) {
+        return false;
+    }
+    self->sectorFill = 0;
+    return true;
+}
+
+static bool copyFromBase(PhotonDfuPatch* self, uint64_t size)
+{
+    if (self->copyOffset > self->baseSize || size > (self->baseSize - self->copyOffset)) {
+        return false;
+    }
+    if (size > (self->targetSize - self->targetOffset)) {
+        return false;
+    }
+    while (size != 0) {
+        size_t space = sectorSpace(self);
+        size_t chunkSize = size < space ? (size_t)size : space;
+        if (!self->readBase(self->ctx, self->copyOffset, &self->sector[self->sectorFill], chunkSize)) {
+            return false;
+        }
+        self->copyOffset += chunkSize;
+        size -= chunkSize;
+        if (!advanceTarget(self, chunkSize)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PhotonDfuPatch_Feed(PhotonDfuPatch* self, const void* src, size_t size)
+{
+    const uint8_t* current = (const uint8_t*)src;
+    const uint8_t* end = current + size;
+
+    while (current < end) {
+        bool isValid = true;
+        switch (self->state) {
+        case STATE_OP:
+            self->number = 0;
+            self->numberShift = 0;
+            if (*current == PHOTON_DFU_PATCH_OP_COPY) {
+                self->state = STATE_COPY_OFFSET;
+            } else if (*current == PHOTON_DFU_PATCH_OP_INSERT) {
+                self->state = STATE_INSERT_SIZE;
+            } else {
+                self->state = STATE_ERROR;
+                return false;
+            }
+            current++;
+            break;
+        case STATE_COPY_OFFSET:
+            if (readNumber(self, *current, &isValid)) {
+                self->copyOffset = self->number;
+                self->number = 0;
+                self->state = STATE_COPY_SIZE;
+            }
+            current++;
+            break;
+        case STATE_COPY_SIZE:
+            if (readNumber(self, *current, &isValid)) {
+                if (!copyFromBase(self, self->number)) {
+                    self->state = STATE_ERROR;
+                    return false;
+                }
+                self->state = STATE_OP;
+            }
+            current++;
+            break;
+        case STATE_INSERT_SIZE:
+            if (readNumber(self, *current, &isValid)) {
+                if (self->number > (self->targetSize - self->targetOffset)) {
+                    self->state = STATE_ERROR;
+                    return false;
+                }
+                self->state = self->number == 0 ? STATE_OP : STATE_INSERT_DATA;
+            }
+            current++;
+            break;
+        case STATE_INSERT_DATA: {
+            // number holds remaining literal size
+            size_t available = end - current;
+            size_t space = sectorSpace(self);
+            size_t chunkSize = self->number < available ? (size_t)self->number : available;
+            chunkSize = chunkSize < space ? chunkSize : space;
+            memcpy(&self->sector[self->sectorFill], current, chunkSize);
+            self->number -= chunkSize;
+            current += chunkSize;
+            if (!advanceTarget(self, chunkSize)) {
+                self->state = STATE_ERROR;
+                return false;
+            }
+            if (self->number == 0) {
+                self->state = STATE_OP;
+            }
+            break;
+        }
+        default:
+            return false;
+        }
+        if (!isValid) {
+            self->state = STATE_ERROR;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PhotonDfuPatch_IsFinished(const PhotonDfuPatch* self)
+{
+    return self->state == STATE_OP && self->targetOffset == self->targetSize;
+}
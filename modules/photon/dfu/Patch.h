@@ -0,0 +1,58 @@
+#ifndef __PHOTON_DFU_PATCH_H__
+#define __PHOTON_DFU_PATCH_H__
+
+#include "photongen/onboard/Config.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming applier of binary patches used for delta firmware updates. Patch is a sequence of operations
+// building target image front to back from base image and literal data, all numbers are LEB128 encoded:
+//   [0][base offset][size]          - copy size bytes from base image
+//   [1][size][size bytes of data]   - insert literal data
+// Patch can be fed in chunks of any size, target is written sequentially in whole aligned sectors,
+// only the last sector of target may be shorter.
+
+// size of flash write sector, target is staged in buffer of this size
+#ifndef PHOTON_CFG_DFU_PATCH_SECTOR_SIZE
+# define PHOTON_CFG_DFU_PATCH_SECTOR_SIZE 256
+#endif
+
+#define PHOTON_DFU_PATCH_OP_COPY 0
+#define PHOTON_DFU_PATCH_OP_INSERT 1
+
+typedef bool (*PhotonDfuPatchReadBase)(void* ctx, uint64_t offset, void* dest, size_t size);
+typedef bool (*PhotonDfuPatchWriteTarget)(void* ctx, uint64_t offset, const void* src, size_t size);
+
+typedef struct {
+    PhotonDfuPatchReadBase readBase;
+    PhotonDfuPatchWriteTarget writeTarget;
+    void* ctx;
+    uint64_t baseSize;
+    uint64_t targetSize;
+    uint64_t targetOffset;
+    uint64_t copyOffset;
+    uint64_t number;
+    unsigned numberShift;
+    size_t sectorFill;
+    uint8_t state;
+    uint8_t sector[PHOTON_CFG_DFU_PATCH_SECTOR_SIZE];
+} PhotonDfuPatch;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void PhotonDfuPatch_Init(PhotonDfuPatch* self, uint64_t baseSize, uint64_t targetSize,
+                         PhotonDfuPatchReadBase readBase, PhotonDfuPatchWriteTarget writeTarget, void* ctx);
+// returns false if patch is malformed or base/target access failed
+bool PhotonDfuPatch_Feed(PhotonDfuPatch* self, const void* src, size_t size);
+// whole target is written and patch ends on operation boundary
+bool PhotonDfuPatch_IsFinished(const PhotonDfuPatch* self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
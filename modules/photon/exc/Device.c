@@ -5,11 +5,14 @@
 #include "photon/core/Logging.h"
 #include "photongen/onboard/core/Generator.h"
 #include "photon/core/Try.h"
+#include "photon/core/Util.h"
 #include "photongen/onboard/exc/DataHeader.h"
 #include "photongen/onboard/exc/StreamDirection.h"
 #include "photongen/onboard/exc/StreamState.h"
 #include "photongen/onboard/exc/StreamHandler.h"
 #include "photongen/onboard/exc/ReceiptType.h"
+#include "photongen/onboard/exc/QueuedPacket.h"
+#include "photongen/onboard/exc/QueuedPacketKind.h"
 #include "photon/exc/Utils.h"
 #ifdef PHOTON_HAS_MODULE_PVU
 #include "photongen/onboard/pvu/Pvu.Component.h"
@@ -36,9 +39,50 @@
 
 #define _PHOTON_FNAME "exc/Device.c"
 
-#define PHOTON_CFG_EXC_INPUT_RINGBUF_SIZE 2048
+// capacity is limited by Device::outQueue size in exc.decode
+#ifndef PHOTON_CFG_EXC_OUT_QUEUE_SIZE
+# define PHOTON_CFG_EXC_OUT_QUEUE_SIZE (sizeof(((PhotonExcDevice*)0)->outQueue) / sizeof(PhotonExcQueuedPacket))
+#endif
+
+// 0 means unlimited, packets are generated until writer is full
+#ifndef PHOTON_CFG_EXC_BITRATE
+# define PHOTON_CFG_EXC_BITRATE 0
+#endif
+
+#ifndef PHOTON_CFG_EXC_BURST_SIZE
+# define PHOTON_CFG_EXC_BURST_SIZE 2048
+#endif
+
+#ifndef PHOTON_CFG_EXC_MAX_PACKET_SIZE
+# define PHOTON_CFG_EXC_MAX_PACKET_SIZE 1024
+#endif
+
+// separator, size, data header, receipt type and crc of ok receipt packet
+#define MAX_RECEIPT_OVERHEAD 64
+
+#ifndef PHOTON_CFG_EXC_DFU_WEIGHT
+# define PHOTON_CFG_EXC_DFU_WEIGHT 4
+#endif
 
-static uint8_t inTemp[PHOTON_CFG_EXC_INPUT_RINGBUF_SIZE];
+#ifndef PHOTON_CFG_EXC_FWT_WEIGHT
+# define PHOTON_CFG_EXC_FWT_WEIGHT 4
+#endif
+
+#ifndef PHOTON_CFG_EXC_TM_WEIGHT
+# define PHOTON_CFG_EXC_TM_WEIGHT 1
+#endif
+
+// indexes in Device::streamWeights
+#define STREAM_DFU 0
+#define STREAM_FWT 1
+#define STREAM_TM 2
+#define STREAM_COUNT 3
+
+// token bucket is kept in bit * ms units to avoid rounding on short ticks
+#define TOKENS_PER_BYTE 8000
+
+#define SEP_FIRST_PART 0x9c
+#define SEP_SECOND_PART 0x3e
 
 static void initStream(PhotonExcStreamState* self)
 {
@@ -51,15 +95,29 @@ static void initStream(PhotonExcStreamState* self)
 
 static void init(PhotonExcDevice* self, uint64_t address)
 {
+    PHOTON_ASSERT(PHOTON_CFG_EXC_OUT_QUEUE_SIZE <= (sizeof(self->outQueue) / sizeof(PhotonExcQueuedPacket)));
     self->skippedBytes = 0;
+    self->droppedPackets = 0;
     self->address = address;
-    self->hasDataQueued = false;
+    self->outQueueSize = 0;
     initStream(&self->cmdStream);
     initStream(&self->telemStream);
     initStream(&self->fwtStream);
     initStream(&self->dfuStream);
     initStream(&self->userStream);
     PhotonRingBuf_Init(&self->inRingBuf, self->inRingBufData, sizeof(self->inRingBufData));
+    PhotonRingBuf_Init(&self->resultsRingBuf, self->resultsRingBufData, sizeof(self->resultsRingBufData));
+    self->bitrate = PHOTON_CFG_EXC_BITRATE;
+    self->burstSize = PHOTON_CFG_EXC_BURST_SIZE;
+    self->tokens = 0;
+    self->lastRefillTime = 0;
+    self->streamWeights[STREAM_DFU] = PHOTON_CFG_EXC_DFU_WEIGHT;
+    self->streamWeights[STREAM_FWT] = PHOTON_CFG_EXC_FWT_WEIGHT;
+    self->streamWeights[STREAM_TM] = PHOTON_CFG_EXC_TM_WEIGHT;
+    for (size_t i = 0; i < STREAM_COUNT; i++) {
+        self->streamVirtualTimes[i] = 0;
+    }
+    self->virtualTime = 0;
 }
 
 void PhotonExcDevice_InitGroundControl(PhotonExcDevice* self, uint64_t address)
@@ -94,9 +152,8 @@ void PhotonExcDevice_InitSlave(PhotonExcDevice* self, uint64_t address, PhotonEx
         self->skippedBytes++;                                 \
     } while(0);
 
-static void handleJunk(PhotonExcDevice* self, const uint8_t* data, size_t size)
+static void handleJunk(PhotonExcDevice* self, size_t size)
 {
-    (void)data;
     (void)self;
     if (size == 0) {
         return;
@@ -104,24 +161,72 @@ static void handleJunk(PhotonExcDevice* self, const uint8_t* data, size_t size)
     PHOTON_DEBUG("Recieved junk %zu bytes", size);
 }
 
-static inline uint8_t* findByte(uint8_t* begin, uint8_t* end, uint8_t value)
+// sets high bit in every zero byte of value
+static inline uint32_t zeroBytes(uint32_t value)
 {
-    while (begin < end) {
-        if (*begin == value) { return begin; } begin++;
-        //if (*begin == value) return begin; begin++;
-        //if (*begin == value) return begin; begin++;
-        //if (*begin == value) return begin; begin++;
+    return ~(((value & 0x7f7f7f7f) + 0x7f7f7f7f) | value | 0x7f7f7f7f);
+}
+
+// returns offset of first separator or size if span doesn't contain one, checks 4 positions at a time
+static size_t findSepInSpan(const uint8_t* data, size_t size)
+{
+    size_t i = 0;
+    if (size >= 5) {
+        while (i <= size - 5) {
+            uint32_t first;
+            uint32_t second;
+            memcpy(&first, data + i, 4);
+            memcpy(&second, data + i + 1, 4);
+            if (zeroBytes(first ^ 0x9c9c9c9c) & zeroBytes(second ^ 0x3e3e3e3e)) {
+                break;
+            }
+            i += 4;
+        }
     }
-    return end;
+    for (; (i + 1) < size; i++) {
+        if (data[i] == SEP_FIRST_PART && data[i + 1] == SEP_SECOND_PART) {
+            return i;
+        }
+    }
+    return size;
+}
+
+static void skipChunks(PhotonMemChunks* chunks, size_t size)
+{
+    if (size <= chunks->first.size) {
+        chunks->first.data += size;
+        chunks->first.size -= size;
+        return;
+    }
+    size -= chunks->first.size;
+    chunks->first.data += chunks->first.size;
+    chunks->first.size = 0;
+    PHOTON_ASSERT(size <= chunks->second.size);
+    chunks->second.data += size;
+    chunks->second.size -= size;
+}
+
+static uint8_t chunksAt(const PhotonMemChunks* chunks, size_t offset)
+{
+    if (offset < chunks->first.size) {
+        return chunks->first.data[offset];
+    }
+    return chunks->second.data[offset - chunks->first.size];
+}
+
+static uint16_t crcChunks(const PhotonMemChunks* chunks, size_t size)
+{
+    if (size <= chunks->first.size) {
+        return Photon_Crc16(chunks->first.data, size);
+    }
+    uint16_t crc = Photon_Crc16(chunks->first.data, chunks->first.size);
+    return Photon_Crc16Update(crc, chunks->second.data, size - chunks->first.size);
 }
 
 static bool findSep(PhotonExcDevice* self);
 static bool findPacket(PhotonExcDevice* self, PhotonMemChunks* chunks);
-static bool handlePacket(PhotonExcDevice* self, size_t size);
-static PhotonError queueReceipt(PhotonExcDevice* self, const PhotonExcDataHeader* incomingHeader, void* data, PhotonGenerator gen);
-static PhotonError genPayloadErrorReceiptPayload(void* data, PhotonWriter* dest);
-static PhotonError genOkReceiptPayload(void* data, PhotonWriter* dest);
-static PhotonError genCounterCorrectionReceiptPayload(void* data, PhotonWriter* dest);
+static bool handlePacket(PhotonExcDevice* self, const uint8_t* packet, size_t size);
+static PhotonExcQueuedPacket* queueReceipt(PhotonExcDevice* self, const PhotonExcDataHeader* incomingHeader, PhotonExcQueuedPacketKind kind);
 
 void PhotonExcDevice_AcceptInput(PhotonExcDevice* self, const void* src, size_t size)
 {
@@ -154,71 +259,37 @@ void PhotonExcDevice_AcceptInput(PhotonExcDevice* self, const void* src, size_t
 
 static bool findSep(PhotonExcDevice* self)
 {
-    const uint16_t separator = 0x9c3e;
-    const uint8_t firstSepPart = (separator & 0xff00) >> 8;
-    const uint8_t secondSepPart = separator & 0x00ff;
     PhotonMemChunks chunks = PhotonRingBuf_ReadableChunks(&self->inRingBuf);
-
-    uint8_t* it = chunks.first.data;
-    uint8_t* next;
-    uint8_t* end = it + chunks.first.size;
-    while (true) {
-        it = findByte(it, end, firstSepPart);
-        if (it == end) {
-            break;
-        }
-        next = it + 1;
-        if (next == end) {
-            if (chunks.second.size != 0 && chunks.second.data[0] == secondSepPart) {
-                size_t skippedSize = it - chunks.first.data;
-                handleJunk(self, chunks.first.data, skippedSize);
-                PhotonRingBuf_Erase(&self->inRingBuf, skippedSize);
-                self->skippedBytes += skippedSize;
-                chunks.first.size = 0;
-                chunks.second.data += 1;
-                chunks.second.size -= 1;
-                return findPacket(self, &chunks);
-            }
-            return false;
-        }
-        if (*next == secondSepPart) {
-            size_t skippedSize = it - chunks.first.data;
-            handleJunk(self, chunks.first.data, skippedSize);
-            PhotonRingBuf_Erase(&self->inRingBuf, skippedSize);
-            self->skippedBytes += skippedSize;
-            PHOTON_ASSERT(chunks.first.size >= (skippedSize + 2));
-            chunks.first.data += skippedSize + 2;
-            chunks.first.size -= skippedSize + 2;
-            return findPacket(self, &chunks);
+    size_t totalSize = chunks.first.size + chunks.second.size;
+
+    size_t offset = findSepInSpan(chunks.first.data, chunks.first.size);
+    if (offset == chunks.first.size) {
+        if (chunks.first.size != 0 && chunks.second.size != 0
+            && chunks.first.data[chunks.first.size - 1] == SEP_FIRST_PART
+            && chunks.second.data[0] == SEP_SECOND_PART) {
+            offset = chunks.first.size - 1;
+        } else {
+            offset = chunks.first.size + findSepInSpan(chunks.second.data, chunks.second.size);
         }
-        it++;
     }
 
-    it = chunks.second.data;
-    end = it + chunks.second.size;
-    while (true) {
-        it = findByte(it, end, firstSepPart);
-        next = it + 1;
-        if (next >= end) {
-            handleJunk(self, chunks.first.data, chunks.first.size);
-            handleJunk(self, chunks.second.data, chunks.second.size);
-            PhotonRingBuf_Clear(&self->inRingBuf);
-            return false;
-        }
-        if (*next == secondSepPart) {
-            size_t skippedSize = it - chunks.second.data;
-            handleJunk(self, chunks.first.data, chunks.first.size);
-            handleJunk(self, chunks.second.data, skippedSize);
-            PhotonRingBuf_Erase(&self->inRingBuf, chunks.first.size + skippedSize);
-            self->skippedBytes += chunks.first.size + skippedSize;
-            chunks.first.size = 0;
-            PHOTON_ASSERT(chunks.second.size >= (skippedSize + 2));
-            chunks.second.data += skippedSize + 2;
-            chunks.second.size -= skippedSize + 2;
-            return findPacket(self, &chunks);
+    if (offset == totalSize) {
+        // keep last byte, it may be the first part of separator
+        size_t junkSize = totalSize;
+        if (totalSize != 0 && chunksAt(&chunks, totalSize - 1) == SEP_FIRST_PART) {
+            junkSize--;
         }
-        it++;
+        handleJunk(self, junkSize);
+        PhotonRingBuf_Erase(&self->inRingBuf, junkSize);
+        self->skippedBytes += junkSize;
+        return false;
     }
+
+    handleJunk(self, offset);
+    PhotonRingBuf_Erase(&self->inRingBuf, offset);
+    self->skippedBytes += offset;
+    skipChunks(&chunks, offset + 2);
+    return findPacket(self, &chunks);
 }
 
 static bool findPacket(PhotonExcDevice* self, PhotonMemChunks* chunks)
@@ -228,20 +299,8 @@ static bool findPacket(PhotonExcDevice* self, PhotonMemChunks* chunks)
         PHOTON_DEBUG("Packet size part not yet recieved");
         return false;
     }
-    uint8_t firstSizePart;
-    uint8_t secondSizePart;
-    if (chunks->first.size >= 2) {
-        firstSizePart = chunks->first.data[0];
-        secondSizePart = chunks->first.data[1];
-    } else if (chunks->first.size == 1) {
-        firstSizePart = chunks->first.data[0];
-        secondSizePart = chunks->second.data[0];
-    } else {
-        firstSizePart = chunks->second.data[0];
-        secondSizePart = chunks->second.data[1];
-    }
 
-    size_t expectedSize = 2 + (firstSizePart | (secondSizePart << 8));
+    size_t expectedSize = 2 + (chunksAt(chunks, 0) | (chunksAt(chunks, 1) << 8));
 
     size_t maxPacketSize = 1024; //TODO: define
     if (expectedSize > maxPacketSize) {
@@ -254,14 +313,31 @@ static bool findPacket(PhotonExcDevice* self, PhotonMemChunks* chunks)
         return false;
     }
 
+    if (expectedSize < 4) {
+        HANDLE_INVALID_PACKET(self, "Recieved packet with size < 4");
+        return true;
+    }
+
+    // crc is checked before linearizing so that junk doesn't cause data movement
+    uint16_t crc16 = crcChunks(chunks, expectedSize - 2);
+    uint16_t expectedCrc16 = chunksAt(chunks, expectedSize - 2) | (chunksAt(chunks, expectedSize - 1) << 8);
+    if (crc16 != expectedCrc16) {
+        HANDLE_INVALID_PACKET(self, "Recieved packet with invalid crc");
+        return true;
+    }
+
+    const uint8_t* packet;
     if (expectedSize <= chunks->first.size) {
-        memcpy(inTemp, chunks->first.data, expectedSize);
+        packet = chunks->first.data;
+    } else if (chunks->first.size == 0) {
+        packet = chunks->second.data;
     } else {
-        memcpy(inTemp, chunks->first.data, chunks->first.size);
-        memcpy(inTemp + chunks->first.size, chunks->second.data, expectedSize - chunks->first.size);
+        // packet wraps around buffer end
+        PhotonRingBuf_Linearize(&self->inRingBuf);
+        packet = PhotonRingBuf_CurrentReadPtr(&self->inRingBuf) + 2;
     }
 
-    return handlePacket(self, expectedSize);
+    return handlePacket(self, packet, expectedSize);
 }
 
 #ifdef PHOTON_HAS_MODULE_PVU
@@ -298,26 +374,10 @@ static PhotonError handleTmPacket(const PhotonExcDataHeader* header, PhotonReade
 }
 #endif
 
-typedef struct {
-    PhotonExcStreamState* state;
-    PhotonExcDataHeader header;
-} CounterCorrectionData;
-
-static CounterCorrectionData ccData;
-
-static bool handlePacket(PhotonExcDevice* self, size_t size)
+static bool handlePacket(PhotonExcDevice* self, const uint8_t* packet, size_t size)
 {
-    if (size < 4) {
-        HANDLE_INVALID_PACKET(self, "Recieved packet with size < 4");
-        return true;
-    }
-    uint16_t crc16 = Photon_Crc16(inTemp, size - 2);
-    if (crc16 != Photon_Le16Dec(inTemp + size - 2)) {
-        HANDLE_INVALID_PACKET(self, "Recieved packet with invalid crc");
-        return true;
-    }
     PhotonReader payload;
-    PhotonReader_Init(&payload, inTemp + 2, size - 4);
+    PhotonReader_Init(&payload, packet + 2, size - 4);
     if(PhotonExcDataHeader_Deserialize(&self->incomingHeader, &payload) != PhotonError_Ok) {
         HANDLE_INVALID_PACKET(self, "Recieved packet with invalid header");
         return true;
@@ -432,22 +492,30 @@ static bool handlePacket(PhotonExcDevice* self, size_t size)
         break;
     case PhotonExcPacketType_Reliable:
         if (self->incomingHeader.counter != state->expectedReliableUplinkCounter) {
-            ccData.state = state;
-            ccData.header = self->incomingHeader;
-            queueReceipt(self, &self->incomingHeader, 0, genCounterCorrectionReceiptPayload);
+            PhotonExcQueuedPacket* receipt = queueReceipt(self, &self->incomingHeader, PhotonExcQueuedPacketKind_CounterCorrectionReceipt);
+            if (receipt) {
+                receipt->incomingHeader = self->incomingHeader;
+                receipt->expectedCounter = state->expectedReliableUplinkCounter;
+            }
             HANDLE_INVALID_PACKET(self, "Invalid expected reliable counter: expected(%" PRIu16 "), got(%" PRIu16 ")", state->expectedReliableUplinkCounter, self->incomingHeader.counter);
             return true;
         }
+        if (self->outQueueSize >= PHOTON_CFG_EXC_OUT_QUEUE_SIZE || PhotonRingBuf_WritableSize(&self->resultsRingBuf) < sizeof(self->outData)) {
+            // no space for receipt, packet is not executed and will be resent
+            PHOTON_WARNING("Outgoing queue is full, dropping reliable packet");
+            self->droppedPackets++;
+            PhotonRingBuf_Erase(&self->inRingBuf, size + 2);
+            return true;
+        }
         if (handler(&self->incomingHeader, &payload, &results, userData) != PhotonError_Ok) {
-            queueReceipt(self, &self->incomingHeader, 0, genPayloadErrorReceiptPayload);
+            queueReceipt(self, &self->incomingHeader, PhotonExcQueuedPacketKind_ErrorReceipt);
             HANDLE_INVALID_PACKET(self, "Invalid payload");
             return true;
         }
-        self->dataSize = results.current - results.start;
-        PhotonError err = queueReceipt(self, &self->incomingHeader, self, genOkReceiptPayload);
-        if (err != PhotonError_Ok) {
-            PHOTON_CRITICAL("could not gen OK receipt");
-        }
+        PhotonExcQueuedPacket* receipt = queueReceipt(self, &self->incomingHeader, PhotonExcQueuedPacketKind_OkReceipt);
+        PHOTON_ASSERT(receipt);
+        receipt->resultsSize = results.current - results.start;
+        PhotonRingBuf_Write(&self->resultsRingBuf, results.start, receipt->resultsSize);
         state->expectedReliableUplinkCounter++;
         PhotonRingBuf_Erase(&self->inRingBuf, size + 2);
         return true;
@@ -459,48 +527,104 @@ static bool handlePacket(PhotonExcDevice* self, size_t size)
     return true;
 }
 
-static PhotonError genPayloadErrorReceiptPayload(void* data, PhotonWriter* dest)
+static unsigned queuedPacketPriority(PhotonExcQueuedPacketKind kind)
 {
-    (void)data;
-    PHOTON_TRY(PhotonExcReceiptType_Serialize(PhotonExcReceiptType_PayloadError, dest));
-    return PhotonError_Ok;
+    switch (kind) {
+    case PhotonExcQueuedPacketKind_ErrorReceipt:
+    case PhotonExcQueuedPacketKind_CounterCorrectionReceipt:
+        return 0;
+    case PhotonExcQueuedPacketKind_OkReceipt:
+    case PhotonExcQueuedPacketKind_Custom:
+        return 1;
+    }
+    return 1;
 }
 
-static PhotonError genOkReceiptPayload(void* data, PhotonWriter* dest)
+// inserted after all packets with the same or higher priority, returns NULL if queue is full
+static PhotonExcQueuedPacket* pushPacket(PhotonExcDevice* self, PhotonExcQueuedPacketKind kind)
+{
+    if (self->outQueueSize >= PHOTON_CFG_EXC_OUT_QUEUE_SIZE) {
+        PHOTON_WARNING("Outgoing queue is full");
+        self->droppedPackets++;
+        return 0;
+    }
+    unsigned priority = queuedPacketPriority(kind);
+    size_t i = self->outQueueSize;
+    while (i > 0 && queuedPacketPriority(self->outQueue[i - 1].kind) > priority) {
+        self->outQueue[i] = self->outQueue[i - 1];
+        i--;
+    }
+    self->outQueueSize++;
+    PhotonExcQueuedPacket* packet = &self->outQueue[i];
+    packet->kind = kind;
+    packet->resultsSize = 0;
+    return packet;
+}
+
+static void popPacket(PhotonExcDevice* self)
+{
+    PHOTON_ASSERT(self->outQueueSize > 0);
+    // ok receipts keep their order, so results are always at the front of results buffer
+    PhotonRingBuf_Erase(&self->resultsRingBuf, self->outQueue[0].resultsSize);
+    for (size_t i = 1; i < self->outQueueSize; i++) {
+        self->outQueue[i - 1] = self->outQueue[i];
+    }
+    self->outQueueSize--;
+}
+
+static PhotonError genOkReceiptPayload(PhotonExcDevice* self, const PhotonExcQueuedPacket* packet, PhotonWriter* dest)
 {
-    PhotonExcDevice* self = (PhotonExcDevice*)data;
     PHOTON_TRY(PhotonExcReceiptType_Serialize(PhotonExcReceiptType_Ok, dest));
-    size_t resultSize = self->dataSize;
-    if (PhotonWriter_WritableSize(dest) < resultSize) {
+    if (PhotonWriter_WritableSize(dest) < packet->resultsSize) {
         return PhotonError_NotEnoughSpace;
     }
-    PhotonWriter_Write(dest, self->outData, self->dataSize);
+    PhotonMemChunks chunks = PhotonRingBuf_PeekChunks(&self->resultsRingBuf, packet->resultsSize, 0);
+    PhotonWriter_Write(dest, chunks.first.data, chunks.first.size);
+    PhotonWriter_Write(dest, chunks.second.data, chunks.second.size);
     return PhotonError_Ok;
 }
 
-static PhotonError genCounterCorrectionReceiptPayload(void* data, PhotonWriter* dest)
+static PhotonError genCounterCorrectionReceiptPayload(const PhotonExcQueuedPacket* packet, PhotonWriter* dest)
 {
     PHOTON_TRY(PhotonExcReceiptType_Serialize(PhotonExcReceiptType_CounterCorrection, dest));
     if (PhotonWriter_WritableSize(dest) < 2) {
         return PhotonError_NotEnoughSpace;
     }
-    PhotonWriter_WriteU16Le(dest, ccData.state->expectedReliableUplinkCounter);
-    return PhotonExcDataHeader_Serialize(&ccData.header, dest);
+    PhotonWriter_WriteU16Le(dest, packet->expectedCounter);
+    return PhotonExcDataHeader_Serialize(&packet->incomingHeader, dest);
 }
 
-static PhotonError queueReceipt(PhotonExcDevice* self, const PhotonExcDataHeader* incomingHeader, void* data, PhotonGenerator gen)
+static PhotonExcQueuedPacket* queueReceipt(PhotonExcDevice* self, const PhotonExcDataHeader* incomingHeader, PhotonExcQueuedPacketKind kind)
 {
-    self->request.data = data;
-    self->request.gen = gen;
-    self->request.header.streamDirection = PhotonExcStreamDirection_Downlink;
-    self->request.header.packetType = PhotonExcPacketType_Receipt;
-    self->request.header.streamType = incomingHeader->streamType;
-    self->request.header.counter = incomingHeader->counter;
-    self->request.header.srcAddress = incomingHeader->destAddress;
-    self->request.header.destAddress = incomingHeader->srcAddress;
+    PhotonExcQueuedPacket* packet = pushPacket(self, kind);
+    if (!packet) {
+        return 0;
+    }
+    packet->request.data = 0;
+    packet->request.gen = 0;
+    packet->request.header.streamDirection = PhotonExcStreamDirection_Downlink;
+    packet->request.header.packetType = PhotonExcPacketType_Receipt;
+    packet->request.header.streamType = incomingHeader->streamType;
+    packet->request.header.counter = incomingHeader->counter;
+    packet->request.header.srcAddress = incomingHeader->destAddress;
+    packet->request.header.destAddress = incomingHeader->srcAddress;
+    return packet;
+}
 
-    self->hasDataQueued = true;
-    return PhotonError_Ok;
+static void initAnswer(PhotonExcDevice* self, PhotonExcQueuedPacket* packet, PhotonExcStreamType type, PhotonExcStreamState* state, PhotonGenerator gen)
+{
+    packet->kind = PhotonExcQueuedPacketKind_Custom;
+    packet->resultsSize = 0;
+    packet->request.data = 0;
+    packet->request.gen = gen;
+    packet->request.header.streamDirection = PhotonExcStreamDirection_Downlink;
+    packet->request.header.packetType = PhotonExcPacketType_Unreliable;
+    packet->request.header.streamType = type;
+    packet->request.header.counter = state->currentUnreliableDownlinkCounter;
+    packet->request.header.srcAddress = PhotonExc_SelfAddress();
+    packet->request.header.destAddress = self->address;
+
+    state->currentUnreliableDownlinkCounter++;
 }
 
 #ifdef PHOTON_HAS_MODULE_TM
@@ -509,22 +633,6 @@ static PhotonError genTm(void* data, PhotonWriter* dest)
     (void)data;
     return PhotonTm_CollectMessages(dest);
 }
-
-static PhotonError queueTmPacket(PhotonExcDevice* self)
-{
-    self->request.data = 0;
-    self->request.gen = genTm;
-    self->request.header.streamDirection = PhotonExcStreamDirection_Downlink;
-    self->request.header.packetType = PhotonExcPacketType_Unreliable;
-    self->request.header.streamType = PhotonExcStreamType_Telem;
-    self->request.header.counter = self->telemStream.currentUnreliableDownlinkCounter;
-    self->request.header.srcAddress = PhotonExc_SelfAddress();
-    self->request.header.destAddress = self->address;
-
-    self->telemStream.currentUnreliableDownlinkCounter++;
-    self->hasDataQueued = true;
-    return PhotonError_Ok;
-}
 #endif
 
 #ifdef PHOTON_HAS_MODULE_FWT
@@ -533,23 +641,6 @@ static PhotonError genFwt(void* data, PhotonWriter* dest)
     (void)data;
     return PhotonFwt_GenAnswer(dest);
 }
-
-
-static PhotonError queueFwtPacket(PhotonExcDevice* self)
-{
-    self->request.data = 0;
-    self->request.gen = genFwt;
-    self->request.header.streamDirection = PhotonExcStreamDirection_Downlink;
-    self->request.header.packetType = PhotonExcPacketType_Unreliable;
-    self->request.header.streamType = PhotonExcStreamType_Firmware;
-    self->request.header.counter = self->fwtStream.currentUnreliableDownlinkCounter;
-    self->request.header.srcAddress = PhotonExc_SelfAddress();
-    self->request.header.destAddress = self->address;
-
-    self->fwtStream.currentUnreliableDownlinkCounter++;
-    self->hasDataQueued = true;
-    return PhotonError_Ok;
-}
 #endif
 
 #ifdef PHOTON_HAS_MODULE_DFU
@@ -558,96 +649,252 @@ static PhotonError genDfu(void* data, PhotonWriter* dest)
     (void)data;
     return PhotonDfu_GenAnswer(dest);
 }
-
-
-static PhotonError queueDfuPacket(PhotonExcDevice* self)
-{
-    self->request.data = 0;
-    self->request.gen = genDfu;
-    self->request.header.streamDirection = PhotonExcStreamDirection_Downlink;
-    self->request.header.packetType = PhotonExcPacketType_Unreliable;
-    self->request.header.streamType = PhotonExcStreamType_Dfu;
-    self->request.header.counter = self->dfuStream.currentUnreliableDownlinkCounter;
-    self->request.header.srcAddress = PhotonExc_SelfAddress();
-    self->request.header.destAddress = self->address;
-
-    self->dfuStream.currentUnreliableDownlinkCounter++;
-    self->hasDataQueued = true;
-    return PhotonError_Ok;
-}
 #endif
 
 PhotonError PhotonExcDevice_QueueCustomCmdPacket(PhotonExcDevice* self, void* data, PhotonGenerator gen)
 {
-    self->request.data = data;
-    self->request.gen = gen;
-    self->request.header.streamDirection = PhotonExcStreamDirection_Uplink;
-    self->request.header.packetType = PhotonExcPacketType_Unreliable; //TODO: make reliable
-    self->request.header.streamType = PhotonExcStreamType_Cmd;
-    self->request.header.counter = self->cmdStream.currentReliableUplinkCounter;
+    PhotonExcQueuedPacket* packet = pushPacket(self, PhotonExcQueuedPacketKind_Custom);
+    if (!packet) {
+        return PhotonError_NotEnoughSpace;
+    }
+    packet->request.data = data;
+    packet->request.gen = gen;
+    packet->request.header.streamDirection = PhotonExcStreamDirection_Uplink;
+    packet->request.header.packetType = PhotonExcPacketType_Unreliable; //TODO: make reliable
+    packet->request.header.streamType = PhotonExcStreamType_Cmd;
+    packet->request.header.counter = self->cmdStream.currentReliableUplinkCounter;
     switch (self->deviceKind) {
     case PhotonExcDeviceKind_GroundControl:
     case PhotonExcDeviceKind_Uav:
-        self->request.header.srcAddress = PhotonExc_SelfAddress();
+        packet->request.header.srcAddress = PhotonExc_SelfAddress();
         break;
     case PhotonExcDeviceKind_Slave:
-        self->request.header.srcAddress = PhotonExc_SelfSlaveAddress();
+        packet->request.header.srcAddress = PhotonExc_SelfSlaveAddress();
         break;
     }
-    self->request.header.destAddress = self->address;
+    packet->request.header.destAddress = self->address;
 
     self->fwtStream.currentReliableUplinkCounter++;
-    self->hasDataQueued = true;
     return PhotonError_Ok;
 }
 
-static PhotonError genPacket(PhotonExcDevice* self, PhotonWriter* dest)
+static PhotonError genPayload(PhotonExcDevice* self, const PhotonExcQueuedPacket* packet, PhotonWriter* dest)
+{
+    switch (packet->kind) {
+    case PhotonExcQueuedPacketKind_ErrorReceipt:
+        return PhotonExcReceiptType_Serialize(PhotonExcReceiptType_PayloadError, dest);
+    case PhotonExcQueuedPacketKind_CounterCorrectionReceipt:
+        return genCounterCorrectionReceiptPayload(packet, dest);
+    case PhotonExcQueuedPacketKind_OkReceipt:
+        return genOkReceiptPayload(self, packet, dest);
+    case PhotonExcQueuedPacketKind_Custom:
+        return packet->request.gen(packet->request.data, dest);
+    }
+    return PhotonError_InvalidValue;
+}
+
+static PhotonError genPacket(PhotonExcDevice* self, PhotonExcQueuedPacket* packet, PhotonWriter* dest)
 {
     PhotonWriter_WriteU16Be(dest, PHOTON_EXC_STREAM_SEPARATOR);
 
     PHOTON_EXC_ENCODE_PACKET_HEADER(dest, reserved);
 
-    self->request.header.time = PhotonClk_GetTime();
+    packet->request.header.time = PhotonClk_GetTime();
 
-    PHOTON_TRY(PhotonExcDataHeader_Serialize(&self->request.header, &reserved));
-    PHOTON_TRY(self->request.gen(self->request.data, &reserved));
+    PHOTON_TRY(PhotonExcDataHeader_Serialize(&packet->request.header, &reserved));
+    PHOTON_TRY(genPayload(self, packet, &reserved));
 
     PHOTON_EXC_ENCODE_PACKET_FOOTER(dest, reserved);
-    self->hasDataQueued = false;
     return PhotonError_Ok;
 }
 
-PhotonError PhotonExcDevice_GenNextPacket(PhotonExcDevice* self, PhotonWriter* dest)
+static bool streamHasData(const PhotonExcDevice* self, size_t stream)
 {
-    if (self->hasDataQueued) {
-        PhotonError e = genPacket(self, dest);
-        if (e == PhotonError_NoDataAvailable)
-            self->hasDataQueued = false;
-        return e;
+    if (self->streamWeights[stream] == 0) {
+        return false;
     }
-    if (self->deviceKind == PhotonExcDeviceKind_GroundControl) {
+    switch (stream) {
 #ifdef PHOTON_HAS_MODULE_DFU
-        if (PhotonDfu_HasAnswers()) {
-            queueDfuPacket(self);
-            return genPacket(self, dest);
-        } else
+    case STREAM_DFU:
+        return PhotonDfu_HasAnswers();
 #endif
 #ifdef PHOTON_HAS_MODULE_FWT
-        if (PhotonFwt_HasAnswers()) {
-            queueFwtPacket(self);
-            return genPacket(self, dest);
-        } else
+    case STREAM_FWT:
+        return PhotonFwt_HasAnswers();
 #endif
 #ifdef PHOTON_HAS_MODULE_TM
-        {
-            queueTmPacket(self);
-            return genPacket(self, dest);
+    case STREAM_TM:
+        return PhotonTm_HasMessages();
+#endif
+    default:
+        return false;
+    }
+}
+
+static size_t selectStream(const PhotonExcDevice* self, const bool* isSkipped)
+{
+    size_t stream = STREAM_COUNT;
+    for (size_t i = 0; i < STREAM_COUNT; i++) {
+        if (isSkipped[i] || !streamHasData(self, i)) {
+            continue;
+        }
+        if (stream == STREAM_COUNT || self->streamVirtualTimes[i] < self->streamVirtualTimes[stream]) {
+            stream = i;
         }
+    }
+    return stream;
+}
+
+// stream with data and lowest virtual time is selected, virtual time grows by sent bytes / weight
+static PhotonError genStreamPacket(PhotonExcDevice* self, PhotonWriter* dest)
+{
+    bool isSkipped[STREAM_COUNT] = {0};
+    while (true) {
+        size_t stream = selectStream(self, isSkipped);
+        if (stream == STREAM_COUNT) {
+            return PhotonError_NoDataAvailable;
+        }
+        // stream that was idle does not get accumulated share
+        if (self->streamVirtualTimes[stream] < self->virtualTime) {
+            self->streamVirtualTimes[stream] = self->virtualTime;
+        }
+        self->virtualTime = self->streamVirtualTimes[stream];
+
+        PhotonExcQueuedPacket answer;
+        PhotonExcStreamState* state;
+        switch (stream) {
+#ifdef PHOTON_HAS_MODULE_DFU
+        case STREAM_DFU:
+            state = &self->dfuStream;
+            initAnswer(self, &answer, PhotonExcStreamType_Dfu, state, genDfu);
+            break;
+#endif
+#ifdef PHOTON_HAS_MODULE_FWT
+        case STREAM_FWT:
+            state = &self->fwtStream;
+            initAnswer(self, &answer, PhotonExcStreamType_Firmware, state, genFwt);
+            break;
+#endif
+#ifdef PHOTON_HAS_MODULE_TM
+        case STREAM_TM:
+            state = &self->telemStream;
+            initAnswer(self, &answer, PhotonExcStreamType_Telem, state, genTm);
+            break;
 #endif
-    {}
+        default:
+            return PhotonError_NoDataAvailable;
+        }
+
+        PhotonWriter packet;
+        PhotonWriter_Init(&packet, PhotonWriter_CurrentPtr(dest), PhotonWriter_WritableSize(dest));
+        PhotonError err = genPacket(self, &answer, &packet);
+        if (err == PhotonError_NoDataAvailable) {
+            // stream had nothing to send (e.g. no status is due), its virtual time is not advanced
+            // so it is skipped and other streams are tried
+            state->currentUnreliableDownlinkCounter--;
+            isSkipped[stream] = true;
+            continue;
+        }
+        PHOTON_TRY(err);
+        size_t size = PhotonWriter_CurrentPtr(&packet) - PhotonWriter_CurrentPtr(dest);
+        PhotonWriter_Skip(dest, size);
+        self->streamVirtualTimes[stream] += ((uint64_t)size << 8) / self->streamWeights[stream];
+        return PhotonError_Ok;
+    }
+}
+
+PhotonError PhotonExcDevice_GenNextPacket(PhotonExcDevice* self, PhotonWriter* dest)
+{
+    if (self->outQueueSize != 0) {
+        PhotonError e = genPacket(self, &self->outQueue[0], dest);
+        if (e != PhotonError_NotEnoughSpace) {
+            // not enough space is retried with next buffer
+            popPacket(self);
+        }
+        return e;
+    }
+    if (self->deviceKind == PhotonExcDeviceKind_GroundControl) {
+        return genStreamPacket(self, dest);
     }
     return PhotonError_NoDataAvailable;
 }
 
+// ok receipt results can not be split, packet limit is extended to fit them
+static size_t maxPacketSize(const PhotonExcDevice* self)
+{
+    size_t maxSize = PHOTON_CFG_EXC_MAX_PACKET_SIZE;
+    if (self->outQueueSize != 0) {
+        maxSize = PHOTON_MAX(maxSize, self->outQueue[0].resultsSize + MAX_RECEIPT_OVERHEAD);
+    }
+    return maxSize;
+}
+
+static void refillTokens(PhotonExcDevice* self, uint64_t now)
+{
+    if (now < self->lastRefillTime) {
+        // clock was corrected backwards
+        self->lastRefillTime = now;
+        return;
+    }
+    uint64_t delta = PHOTON_MIN(now - self->lastRefillTime, (uint64_t)1000000);
+    self->lastRefillTime = now;
+    int64_t maxTokens = (int64_t)self->burstSize * TOKENS_PER_BYTE;
+    self->tokens += (int64_t)(delta * self->bitrate);
+    if (self->tokens > maxTokens) {
+        self->tokens = maxTokens;
+    }
+}
+
+PhotonError PhotonExcDevice_GenPackets(PhotonExcDevice* self, PhotonWriter* dest, uint64_t now)
+{
+    refillTokens(self, now);
+    size_t count = 0;
+    PhotonError err = PhotonError_NoDataAvailable;
+    // last packet can overdraw the bucket, debt is repaid on next calls
+    while (self->bitrate == 0 || self->tokens > 0) {
+        size_t maxSize = PHOTON_MIN(PhotonWriter_WritableSize(dest), maxPacketSize(self));
+        PhotonWriter packet;
+        PhotonWriter_Init(&packet, PhotonWriter_CurrentPtr(dest), maxSize);
+        err = PhotonExcDevice_GenNextPacket(self, &packet);
+        if (err != PhotonError_Ok) {
+            break;
+        }
+        size_t size = PhotonWriter_CurrentPtr(&packet) - PhotonWriter_CurrentPtr(dest);
+        PhotonWriter_Skip(dest, size);
+        self->tokens -= (int64_t)size * TOKENS_PER_BYTE;
+        count++;
+    }
+    if (count != 0) {
+        return PhotonError_Ok;
+    }
+    return err;
+}
+
+void PhotonExcDevice_SetBitrate(PhotonExcDevice* self, uint32_t bitrate, size_t burstSize)
+{
+    self->bitrate = bitrate;
+    self->burstSize = burstSize;
+    if (self->tokens > (int64_t)burstSize * TOKENS_PER_BYTE) {
+        self->tokens = (int64_t)burstSize * TOKENS_PER_BYTE;
+    }
+}
+
+PhotonError PhotonExcDevice_SetStreamWeight(PhotonExcDevice* self, PhotonExcStreamType streamType, uint8_t weight)
+{
+    switch (streamType) {
+    case PhotonExcStreamType_Dfu:
+        self->streamWeights[STREAM_DFU] = weight;
+        return PhotonError_Ok;
+    case PhotonExcStreamType_Firmware:
+        self->streamWeights[STREAM_FWT] = weight;
+        return PhotonError_Ok;
+    case PhotonExcStreamType_Telem:
+        self->streamWeights[STREAM_TM] = weight;
+        return PhotonError_Ok;
+    default:
+        return PhotonError_InvalidValue;
+    }
+}
+
 
 #undef _PHOTON_FNAME
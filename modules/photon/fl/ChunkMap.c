@@ -0,0 +1,105 @@
+#include "photon/fl/ChunkMap.h"
+
+#include <string.h>
+
+void PhotonFlChunkMap_Init(PhotonFlChunkMap* self, uint8_t* bitmap, size_t bitmapSize)
+{
+    self->bitmap = bitmap;
+    self->bitmapSize = bitmapSize;
+    self->size = 0;
+    self->chunkSize = 0;
+    self->chunkNum = 0;
+    self->firstMissing = 0;
+}
+
+static uint64_t windowSize(const PhotonFlChunkMap* self)
+{
+    return (uint64_t)self->bitmapSize * 8;
+}
+
+// bitmap is used as ring buffer, chunk n is stored at bit n % windowSize
+static bool getBit(const PhotonFlChunkMap* self, uint64_t chunk)
+{
+    uint64_t i = chunk % windowSize(self);
+    return (self->bitmap[i / 8] & (1 << (i % 8))) != 0;
+}
+
+static void setBit(PhotonFlChunkMap* self, uint64_t chunk, bool isSet)
+{
+    uint64_t i = chunk % windowSize(self);
+    uint8_t mask = 1 << (i % 8);
+    if (isSet) {
+        self->bitmap[i / 8] |= mask;
+    } else {
+        self->bitmap[i / 8] &= ~mask;
+    }
+}
+
+bool PhotonFlChunkMap_Reset(PhotonFlChunkMap* self, uint64_t size, uint64_t chunkSize)
+{
+    if (chunkSize == 0 || self->bitmapSize == 0) {
+        return false;
+    }
+    self->size = size;
+    self->chunkSize = chunkSize;
+    self->chunkNum = size / chunkSize + ((size % chunkSize) != 0);
+    self->firstMissing = 0;
+    memset(self->bitmap, 0, self->bitmapSize);
+    return true;
+}
+
+bool PhotonFlChunkMap_IsValidChunk(const PhotonFlChunkMap* self, uint64_t offset, uint64_t size)
+{
+    if (self->chunkSize == 0 || offset >= self->size || (offset % self->chunkSize) != 0) {
+        return false;
+    }
+    if ((offset / self->chunkSize) >= self->firstMissing + windowSize(self)) {
+        return false;
+    }
+    uint64_t left = self->size - offset;
+    return size == (left < self->chunkSize ? left : self->chunkSize);
+}
+
+bool PhotonFlChunkMap_HasChunk(const PhotonFlChunkMap* self, uint64_t offset)
+{
+    uint64_t chunk = offset / self->chunkSize;
+    return chunk < self->firstMissing || getBit(self, chunk);
+}
+
+void PhotonFlChunkMap_SetChunk(PhotonFlChunkMap* self, uint64_t offset)
+{
+    uint64_t chunk = offset / self->chunkSize;
+    if (chunk < self->firstMissing) {
+        return;
+    }
+    setBit(self, chunk, true);
+    // window slides over received chunks, freed bits are reused by chunks at window end
+    while (self->firstMissing < self->chunkNum && getBit(self, self->firstMissing)) {
+        setBit(self, self->firstMissing, false);
+        self->firstMissing++;
+    }
+}
+
+bool PhotonFlChunkMap_IsComplete(const PhotonFlChunkMap* self)
+{
+    return self->firstMissing == self->chunkNum;
+}
+
+size_t PhotonFlChunkMap_CopyWindow(const PhotonFlChunkMap* self, uint8_t* dest, size_t destSize)
+{
+    uint64_t num = self->chunkNum - self->firstMissing;
+    if (num > windowSize(self)) {
+        num = windowSize(self);
+    }
+    if (num > (uint64_t)destSize * 8) {
+        num = (uint64_t)destSize * 8;
+    }
+    size_t size = (size_t)((num + 7) / 8);
+    memset(dest, 0, size);
+    for (uint64_t i = 0; i < num; i++) {
+        if (getBit(self, self->firstMissing + i)) {
+            dest[i / 8] |= 1 << (i % 8);
+        }
+    }
+    return size;
+}
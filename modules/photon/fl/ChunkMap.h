@@ -0,0 +1,44 @@
+#ifndef __PHOTON_FL_CHUNK_MAP_H__
+#define __PHOTON_FL_CHUNK_MAP_H__
+
+#include "photongen/onboard/Config.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Tracks received chunks of uploaded file. All chunks except the last one are of chunkSize, chunks can be received
+// in any order and more than once. All chunks before firstMissing are received, bitmap is a sliding window of
+// bitmapSize * 8 chunks starting from firstMissing, so file size is not limited by bitmap size.
+
+typedef struct {
+    uint8_t* bitmap;
+    size_t bitmapSize;
+    uint64_t size;
+    uint64_t chunkSize;
+    uint64_t chunkNum;
+    uint64_t firstMissing;
+} PhotonFlChunkMap;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void PhotonFlChunkMap_Init(PhotonFlChunkMap* self, uint8_t* bitmap, size_t bitmapSize);
+// clears bitmap, returns false if chunk size is 0
+bool PhotonFlChunkMap_Reset(PhotonFlChunkMap* self, uint64_t size, uint64_t chunkSize);
+// chunk is aligned, has expected size and is inside window
+bool PhotonFlChunkMap_IsValidChunk(const PhotonFlChunkMap* self, uint64_t offset, uint64_t size);
+// offset must be valid
+bool PhotonFlChunkMap_HasChunk(const PhotonFlChunkMap* self, uint64_t offset);
+// offset must be valid
+void PhotonFlChunkMap_SetChunk(PhotonFlChunkMap* self, uint64_t offset);
+bool PhotonFlChunkMap_IsComplete(const PhotonFlChunkMap* self);
+// copies window as bit per chunk starting from firstMissing, returns number of written bytes
+size_t PhotonFlChunkMap_CopyWindow(const PhotonFlChunkMap* self, uint8_t* dest, size_t destSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
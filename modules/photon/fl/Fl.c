@@ -1,25 +1,122 @@
 #include "photongen/onboard/fl/Fl.Component.h"
+#include "photon/fl/ChunkMap.h"
 #include "photon/core/Logging.h"
+#include "photon/core/Try.h"
 
 #define _PHOTON_FNAME "fl/Fl.c"
 
+#define MAX_CHUNK_SIZE (sizeof(((PhotonFlFileChunk*)0)->data))
+#define BITMAP_SIZE (sizeof(((PhotonFlChunkBitmap*)0)->data))
+
+static PhotonFlFileProgress progress;
+static PhotonFlChunkMap chunkMap;
+static uint8_t chunkBitmap[BITMAP_SIZE];
+
+void PhotonFl_Init()
+{
+    progress.isWriting = false;
+    progress.id = 0;
+    progress.size = 0;
+    progress.chunkSize = 0;
+    progress.firstChunk = 0;
+    progress.received.size = 0;
+    PhotonFlChunkMap_Init(&chunkMap, chunkBitmap, sizeof(chunkBitmap));
+}
+
+PhotonError PhotonFl_ExecCmd_BeginFile(uint64_t id, uint64_t size, uint64_t chunkSize, uint64_t* rv)
+{
+    progress.isWriting = false;
+    if (chunkSize > MAX_CHUNK_SIZE) {
+        chunkSize = MAX_CHUNK_SIZE;
+    }
+    if (!PhotonFlChunkMap_Reset(&chunkMap, size, chunkSize)) {
+        PHOTON_CRITICAL("Invalid chunk size");
+        return PhotonError_InvalidValue;
+    }
+    PHOTON_TRY(PhotonFl_HandleBeginFile(id, size));
+
+    progress.isWriting = true;
+    progress.id = id;
+    progress.size = size;
+    progress.chunkSize = chunkSize;
+    *rv = chunkSize;
+    return PhotonError_Ok;
+}
+
+PhotonError PhotonFl_ExecCmd_WriteFile(uint64_t id, uint64_t offset, const PhotonDynArrayOfU8MaxSize768* chunk)
+{
+    if (!progress.isWriting || id != progress.id) {
+        PHOTON_CRITICAL("Invalid file id");
+        return PhotonError_InvalidValue;
+    }
+    if (!PhotonFlChunkMap_IsValidChunk(&chunkMap, offset, chunk->size)) {
+        PHOTON_CRITICAL("Invalid chunk");
+        return PhotonError_InvalidValue;
+    }
+    if (PhotonFlChunkMap_HasChunk(&chunkMap, offset)) {
+        // resent after lost receipt
+        return PhotonError_Ok;
+    }
+    PHOTON_TRY(PhotonFl_HandleWriteFile(id, offset, chunk->data, chunk->size));
+    PhotonFlChunkMap_SetChunk(&chunkMap, offset);
+    return PhotonError_Ok;
+}
+
+PhotonError PhotonFl_ExecCmd_EndFile(uint64_t id, uint64_t size, PhotonFlChecksum* rv)
+{
+    if (!progress.isWriting || id != progress.id || size != progress.size) {
+        PHOTON_CRITICAL("Invalid file id");
+        return PhotonError_InvalidValue;
+    }
+    if (!PhotonFlChunkMap_IsComplete(&chunkMap)) {
+        PHOTON_CRITICAL("File is incomplete");
+        return PhotonError_InvalidValue;
+    }
+    PHOTON_TRY(PhotonFl_HandleEndFile(id, size, rv));
+    progress.isWriting = false;
+    return PhotonError_Ok;
+}
+
+PhotonError PhotonFl_ExecCmd_GetFileProgress(PhotonFlFileProgress* rv)
+{
+    *rv = progress;
+    if (progress.isWriting) {
+        rv->firstChunk = chunkMap.firstMissing;
+        rv->received.size = PhotonFlChunkMap_CopyWindow(&chunkMap, rv->received.data, sizeof(rv->received.data));
+    }
+    return PhotonError_Ok;
+}
+
 #ifdef PHOTON_STUB
 
-PhotonError PhotonFl_ExecCmd_BeginFile(uint64_t id, uint64_t size)
+#include "photon/core/Crc.h"
+
+#include <string.h>
+
+#define STUB_FILE_SIZE (64 * 1024)
+
+static uint8_t stubFile[STUB_FILE_SIZE];
+
+PhotonError PhotonFl_HandleBeginFile(uint64_t id, uint64_t size)
 {
     PHOTON_INFO("Begin file id(%" PRIu64 "), size(%" PRIu64 ")", id, size);
+    if (size > STUB_FILE_SIZE) {
+        return PhotonError_InvalidValue;
+    }
     return PhotonError_Ok;
 }
 
-PhotonError PhotonFl_ExecCmd_WriteFile(uint64_t id, uint64_t offset, const PhotonDynArrayOfU8MaxSize128* chunk)
+PhotonError PhotonFl_HandleWriteFile(uint64_t id, uint64_t offset, const void* data, uint64_t size)
 {
-    PHOTON_INFO("Begin file id(%" PRIu64 "), offset(%" PRIu64 "), size(%" PRIu64 ")", id, offset, chunk->size);
+    PHOTON_INFO("Write file id(%" PRIu64 "), offset(%" PRIu64 "), size(%" PRIu64 ")", id, offset, size);
+    memcpy(stubFile + offset, data, size);
     return PhotonError_Ok;
 }
 
-PhotonError PhotonFl_ExecCmd_EndFile(uint64_t id, uint64_t size, PhotonFlChecksum* rv)
+PhotonError PhotonFl_HandleEndFile(uint64_t id, uint64_t size, PhotonFlChecksum* checksum)
 {
     PHOTON_INFO("End file id(%" PRIu64 "), size(%" PRIu64 ")", id, size);
+    *checksum = Photon_Crc16(stubFile, size);
     return PhotonError_Ok;
 }
 
@@ -6,6 +6,7 @@
 #include "photon/core/Logging.h"
 #include "photongen/onboard/fwt/AnswerType.h"
 #include "photongen/onboard/fwt/CmdType.h"
+#include "photongen/onboard/fwt/PackageEncoding.h"
 #include "photongen/onboard/Package.inc.c"
 
 #ifdef PHOTON_HAS_MODULE_BLOG
@@ -13,11 +14,28 @@
 #endif
 
 #include <inttypes.h>
+#include <string.h>
 
 #define _PHOTON_FNAME "fwt/Fwt.c"
 
-#define FW_START &_package[0]
-#define FW_END &_package[_PHOTON_PACKAGE_SIZE]
+// serve compressed package generated by tools/PackageCompress.c at build time, hash is always of raw package
+#ifndef PHOTON_CFG_FWT_PACKAGE_LZ4
+# define PHOTON_CFG_FWT_PACKAGE_LZ4 0
+#endif
+
+#if PHOTON_CFG_FWT_PACKAGE_LZ4
+# include PHOTON_FWT_PACKAGE_LZ4_FILE
+# define FW_DATA _packageLz4
+# define FW_SIZE _PHOTON_PACKAGE_LZ4_SIZE
+# define FW_ENCODING PhotonFwtPackageEncoding_Lz4
+#else
+# define FW_DATA _package
+# define FW_SIZE _PHOTON_PACKAGE_SIZE
+# define FW_ENCODING PhotonFwtPackageEncoding_Raw
+#endif
+
+#define FW_START &FW_DATA[0]
+#define FW_END &FW_DATA[FW_SIZE]
 
 #define EXPECT_NO_PARAMS_LEFT(src)              \
     if (PhotonReader_ReadableSize(src) != 0) {  \
@@ -25,7 +43,12 @@
         return PhotonError_InvalidValue;        \
     }
 
-#define MAX_SIZE 128
+// max firmware bytes in one chunk answer, answer is also limited by packet size
+#ifndef PHOTON_CFG_FWT_MAX_CHUNK_SIZE
+# define PHOTON_CFG_FWT_MAX_CHUNK_SIZE 1024
+#endif
+
+#define MAX_CHUNKS (sizeof(_photonFwt.chunks) / sizeof(_photonFwt.chunks[0]))
 
 void PhotonFwt_Init()
 {
@@ -33,9 +56,7 @@ void PhotonFwt_Init()
     _photonFwt.firmware.end = FW_END;
     _photonFwt.firmware.isTransfering = false;
     _photonFwt.hashRequested = false;
-    _photonFwt.chunk.isTransfering = false;
-    _photonFwt.chunk.current = FW_END;
-    _photonFwt.chunk.end = FW_END;
+    _photonFwt.chunksSize = 0;
     _photonFwt.startId = 0;
 }
 
@@ -51,44 +72,40 @@ static PhotonError requestHash(PhotonReader* src)
     return PhotonError_Ok;
 }
 
-//TODO: resend only sent parts
-static PhotonError requestChunk(PhotonReader* src)
+static PhotonError readRange(PhotonReader* src, uint64_t* chunkBegin, uint64_t* chunkEnd)
 {
-    if (_photonFwt.chunk.isTransfering) {
-        return PhotonError_Ok;
-    }
-
-    uint64_t chunkBegin;
-    uint64_t chunkEnd;
-    PHOTON_TRY(PhotonReader_ReadVaruint(src, &chunkBegin));
-    PHOTON_TRY(PhotonReader_ReadVaruint(src, &chunkEnd));
-    EXPECT_NO_PARAMS_LEFT(src);
+    PHOTON_TRY(PhotonReader_ReadVaruint(src, chunkBegin));
+    PHOTON_TRY(PhotonReader_ReadVaruint(src, chunkEnd));
 
-    if (chunkBegin >= _PHOTON_PACKAGE_SIZE) {
+    if (*chunkBegin >= FW_SIZE) {
         PHOTON_CRITICAL("Ignoring chunk with begin > fwsize");
         return PhotonError_InvalidValue;
     }
 
-    if (chunkEnd > _PHOTON_PACKAGE_SIZE) {
+    if (*chunkEnd > FW_SIZE) {
         PHOTON_CRITICAL("Ignoring chunk with end > fwsize");
         return PhotonError_InvalidValue;
     }
 
-    if (chunkBegin > chunkEnd) {
+    if (*chunkBegin > *chunkEnd) {
         PHOTON_CRITICAL("Ignoring chunk with begin > end");
         return PhotonError_InvalidValue;
     }
+    return PhotonError_Ok;
+}
 
+static void queueChunk(uint64_t chunkBegin, uint64_t chunkEnd)
+{
     if (chunkBegin == chunkEnd) {
         PHOTON_DEBUG("Ignoring zero size chunk");
-        return PhotonError_Ok;
+        return;
     }
 
-    // avoid sending twice
+    // avoid sending twice, data after current position is sent by sequential transfer
     const uint8_t* start = FW_START + chunkBegin;
     if (start >= _photonFwt.firmware.current) {
         PHOTON_DEBUG("Ignoring duplicating chunk");
-        return PhotonError_Ok;
+        return;
     }
 
     // avoid intersecting part twice
@@ -97,11 +114,57 @@ static PhotonError requestChunk(PhotonReader* src)
         end = _photonFwt.firmware.current;
     }
 
-    _photonFwt.chunk.current = start;
-    _photonFwt.chunk.end = end;
-    _photonFwt.chunk.isTransfering = true;
+    for (size_t i = 0; i < _photonFwt.chunksSize; i++) {
+        const PhotonFwtChunk* chunk = &_photonFwt.chunks[i];
+        if (start >= chunk->current && end <= chunk->end) {
+            PHOTON_DEBUG("Ignoring already queued chunk");
+            return;
+        }
+    }
+
+    if (_photonFwt.chunksSize == MAX_CHUNKS) {
+        PHOTON_WARNING("Chunk queue is full, ignoring chunk %u, %u", (unsigned)chunkBegin, (unsigned)chunkEnd);
+        return;
+    }
+
+    PhotonFwtChunk* chunk = &_photonFwt.chunks[_photonFwt.chunksSize];
+    chunk->current = start;
+    chunk->end = end;
+    chunk->isTransfering = true;
+    _photonFwt.chunksSize++;
 
     PHOTON_DEBUG("ChunkRequested %u, %u", (unsigned)chunkBegin, (unsigned)chunkEnd);
+}
+
+static PhotonError requestChunk(PhotonReader* src)
+{
+    uint64_t chunkBegin;
+    uint64_t chunkEnd;
+    PHOTON_TRY(readRange(src, &chunkBegin, &chunkEnd));
+    EXPECT_NO_PARAMS_LEFT(src);
+
+    queueChunk(chunkBegin, chunkEnd);
+    return PhotonError_Ok;
+}
+
+static PhotonError requestChunks(PhotonReader* src)
+{
+    uint64_t count;
+    PHOTON_TRY(PhotonReader_ReadVaruint(src, &count));
+    if (count > MAX_CHUNKS) {
+        PHOTON_CRITICAL("Too many chunks requested");
+        return PhotonError_InvalidValue;
+    }
+
+    uint64_t ranges[MAX_CHUNKS][2];
+    for (uint64_t i = 0; i < count; i++) {
+        PHOTON_TRY(readRange(src, &ranges[i][0], &ranges[i][1]));
+    }
+    EXPECT_NO_PARAMS_LEFT(src);
+
+    for (uint64_t i = 0; i < count; i++) {
+        queueChunk(ranges[i][0], ranges[i][1]);
+    }
     return PhotonError_Ok;
 }
 
@@ -132,8 +195,7 @@ static PhotonError stop(PhotonReader* src)
     PHOTON_DEBUG("StopRequested requested");
     _photonFwt.firmware.isTransfering = false;
     _photonFwt.firmware.current = FW_END;
-    _photonFwt.chunk.isTransfering = false;
-    _photonFwt.chunk.current = FW_END;
+    _photonFwt.chunksSize = 0;
     return PhotonError_Ok;
 }
 
@@ -156,6 +218,9 @@ PhotonError PhotonFwt_AcceptCmd(const PhotonExcDataHeader* header, PhotonReader*
     case PhotonFwtCmdType_RequestChunk:
         rv = requestChunk(src);
         break;
+    case PhotonFwtCmdType_RequestChunks:
+        rv = requestChunks(src);
+        break;
     case PhotonFwtCmdType_Start:
         rv = start(src);
         break;
@@ -179,7 +244,7 @@ PhotonError PhotonFwt_AcceptCmd(const PhotonExcDataHeader* header, PhotonReader*
 static PhotonError genHash(PhotonWriter* dest)
 {
     PHOTON_TRY(PhotonFwtAnswerType_Serialize(PhotonFwtAnswerType_Hash, dest));
-    PHOTON_TRY(PhotonWriter_WriteVaruint(dest, _PHOTON_PACKAGE_SIZE));
+    PHOTON_TRY(PhotonWriter_WriteVaruint(dest, FW_SIZE));
     PHOTON_TRY(PhotonWriter_WriteVaruint(dest, _PHOTON_DEVICE_NAME_SIZE));
     if (PhotonWriter_WritableSize(dest) < (_PHOTON_PACKAGE_HASH_SIZE + _PHOTON_DEVICE_NAME_SIZE)) {
         PHOTON_CRITICAL("Not enough space to generate fwt cmd");
@@ -187,6 +252,7 @@ static PhotonError genHash(PhotonWriter* dest)
     }
     PhotonWriter_Write(dest, _deviceName, _PHOTON_DEVICE_NAME_SIZE);
     PhotonWriter_Write(dest, _packageHash, _PHOTON_PACKAGE_HASH_SIZE);
+    PHOTON_TRY(PhotonFwtPackageEncoding_Serialize(FW_ENCODING, dest));
     _photonFwt.hashRequested = false;
     PHOTON_DEBUG("Generated hash response");
     return PhotonError_Ok;
@@ -208,7 +274,7 @@ static PhotonError genNext(PhotonFwtChunk* chunk, PhotonWriter* dest)
     PHOTON_TRY(PhotonWriter_WriteVaruint(dest, chunk->current - FW_START));
 
     size_t size = chunk->end - chunk->current;
-    size = PHOTON_MIN(size, MAX_SIZE);
+    size = PHOTON_MIN(size, PHOTON_CFG_FWT_MAX_CHUNK_SIZE);
     size = PHOTON_MIN(size, PhotonWriter_WritableSize(dest));
 
     if (size == 0) {
@@ -241,8 +307,14 @@ PhotonError PhotonFwt_GenAnswer(PhotonWriter* dest)
         return genStart(dest);
     }
 
-    if (_photonFwt.chunk.isTransfering) {
-        return genNext(&_photonFwt.chunk, dest);
+    if (_photonFwt.chunksSize != 0) {
+        PhotonFwtChunk* chunk = &_photonFwt.chunks[0];
+        PHOTON_TRY(genNext(chunk, dest));
+        if (!chunk->isTransfering) {
+            _photonFwt.chunksSize--;
+            memmove(&_photonFwt.chunks[0], &_photonFwt.chunks[1], _photonFwt.chunksSize * sizeof(PhotonFwtChunk));
+        }
+        return PhotonError_Ok;
     }
 
     if (_photonFwt.firmware.isTransfering) {
@@ -254,7 +326,7 @@ PhotonError PhotonFwt_GenAnswer(PhotonWriter* dest)
 
 bool PhotonFwt_HasAnswers()
 {
-    return _photonFwt.hashRequested | _photonFwt.startRequested | _photonFwt.chunk.isTransfering | _photonFwt.firmware.isTransfering;
+    return _photonFwt.hashRequested | _photonFwt.startRequested | (_photonFwt.chunksSize != 0) | _photonFwt.firmware.isTransfering;
 }
 
 const uint8_t* PhotonFwt_GetFirmwareData()
@@ -264,7 +336,7 @@ const uint8_t* PhotonFwt_GetFirmwareData()
 
 size_t PhotonFwt_GetFirmwareSize()
 {
-    return _PHOTON_PACKAGE_SIZE;
+    return FW_SIZE;
 }
 
 #undef _PHOTON_FNAME
@@ -1,5 +1,6 @@
 #include "photongen/onboard/nav/Nav.Component.h"
 #include "photon/core/Logging.h"
+#include "photon/core/Crc.h"
 
 #define _PHOTON_FNAME "nav/Nav.c"
 
@@ -223,6 +224,25 @@ PhotonError PhotonNav_ExecCmd_GetRoutePoint(PhotonNavRouteId routeId, uint64_t p
     return PhotonError_Ok;
 }
 
+PhotonError PhotonNav_ExecCmd_GetRouteChecksum(PhotonNavRouteId routeId, uint16_t* rv)
+{
+    if (routeId != 0) {
+        PHOTON_CRITICAL("Invalid route id");
+        return PhotonError_InvalidValue;
+    }
+    PHOTON_INFO("Getting route checksum");
+    uint16_t crc = 0xffff;
+    for (uint64_t i = 0; i < info.size; i++) {
+        uint8_t buf[sizeof(PhotonNavWaypoint) * 2];
+        PhotonWriter dest;
+        PhotonWriter_Init(&dest, buf, sizeof(buf));
+        PHOTON_TRY(PhotonNavWaypoint_Serialize(&tmpRoute[i], &dest));
+        crc = Photon_Crc16Update(crc, dest.start, dest.current - dest.start);
+    }
+    *rv = crc;
+    return PhotonError_Ok;
+}
+
 #endif
 
 #undef _PHOTON_FNAME
@@ -0,0 +1,115 @@
+#include "photon/tm/Delta.h"
+#include "photon/core/Try.h"
+#include "photon/core/Util.h"
+
+#include <string.h>
+
+// sequence number always takes one varuint byte
+#define SEQ_MASK 0x7f
+
+static uint8_t _deltaTmp[PHOTON_CFG_TM_DELTA_MAX_MSG_SIZE];
+
+void PhotonTmDelta_Init(PhotonTmDelta* self)
+{
+    self->base = NULL;
+    self->capacity = 0;
+    self->size = 0;
+    self->seq = 0;
+    self->count = 0;
+}
+
+void PhotonTmDelta_SetStorage(PhotonTmDelta* self, uint8_t* base, uint16_t capacity)
+{
+    self->base = base;
+    self->capacity = capacity;
+    self->size = 0;
+}
+
+void PhotonTmDelta_Reset(PhotonTmDelta* self)
+{
+    self->size = 0;
+    self->count = 0;
+}
+
+PhotonError PhotonTmDelta_BeginMsg(PhotonTmDelta* self, PhotonWriter* dest)
+{
+    PHOTON_TRY(PhotonWriter_WriteVaruint(dest, PHOTON_TM_DELTA_BASE_MARKER));
+    return PhotonWriter_WriteVaruint(dest, (self->seq + 1) & SEQ_MASK);
+}
+
+static PhotonError encodeRuns(const uint8_t* base, const uint8_t* image, size_t size, PhotonWriter* dest)
+{
+    size_t last = 0;
+    size_t i = 0;
+    while (i < size) {
+        if (base[i] == image[i]) {
+            i++;
+            continue;
+        }
+        size_t runStart = i;
+        size_t runEnd = i + 1;
+        // merge runs separated by less than 3 equal bytes, cheaper than a new run header
+        while (runEnd < size) {
+            if (base[runEnd] != image[runEnd]) {
+                runEnd++;
+                continue;
+            }
+            size_t next = runEnd;
+            while (next < size && next < runEnd + 3 && base[next] == image[next]) {
+                next++;
+            }
+            if (next < size && next < runEnd + 3) {
+                runEnd = next;
+                continue;
+            }
+            break;
+        }
+        PHOTON_TRY(PhotonWriter_WriteVaruint(dest, runStart - last));
+        PHOTON_TRY(PhotonWriter_WriteVaruint(dest, runEnd - runStart));
+        if (PhotonWriter_WritableSize(dest) < (runEnd - runStart)) {
+            return PhotonError_NotEnoughSpace;
+        }
+        PhotonWriter_Write(dest, image + runStart, runEnd - runStart);
+        last = runEnd;
+        i = runEnd;
+    }
+    PHOTON_TRY(PhotonWriter_WriteVaruint(dest, 0));
+    return PhotonWriter_WriteVaruint(dest, 0);
+}
+
+static PhotonError encodeDelta(const PhotonTmDelta* self, uint8_t compNum, uint8_t msgNum, const uint8_t* image, size_t size, PhotonWriter* dest)
+{
+    PHOTON_TRY(PhotonWriter_WriteVaruint(dest, PHOTON_TM_DELTA_MARKER));
+    PHOTON_TRY(PhotonWriter_WriteVaruint(dest, compNum));
+    PHOTON_TRY(PhotonWriter_WriteVaruint(dest, msgNum));
+    PHOTON_TRY(PhotonWriter_WriteVaruint(dest, self->seq));
+    return encodeRuns(self->base, image, size, dest);
+}
+
+void PhotonTmDelta_EndMsg(PhotonTmDelta* self, uint8_t compNum, uint8_t msgNum, uint8_t* begin, uint8_t* image, PhotonWriter* dest)
+{
+    size_t size = PhotonWriter_CurrentPtr(dest) - image;
+    if (!self->base || size > self->capacity) {
+        memmove(begin, image, size);
+        PhotonWriter_SetCurrentPtr(dest, begin + size);
+        return;
+    }
+
+    if (self->size == size && self->count < PHOTON_CFG_TM_DELTA_BASE_INTERVAL) {
+        PhotonWriter tmp;
+        PhotonWriter_Init(&tmp, _deltaTmp, PHOTON_MIN(sizeof(_deltaTmp), size));
+        if (encodeDelta(self, compNum, msgNum, image, size, &tmp) == PhotonError_Ok) {
+            size_t deltaSize = tmp.current - tmp.start;
+            memcpy(begin, _deltaTmp, deltaSize);
+            PhotonWriter_SetCurrentPtr(dest, begin + deltaSize);
+            self->count++;
+            return;
+        }
+    }
+
+    // header written by BeginMsg already has next sequence number
+    memcpy(self->base, image, size);
+    self->size = size;
+    self->seq = (self->seq + 1) & SEQ_MASK;
+    self->count = 0;
+}
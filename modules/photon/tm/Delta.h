@@ -0,0 +1,60 @@
+#ifndef __PHOTON_TM_DELTA_H__
+#define __PHOTON_TM_DELTA_H__
+
+#include "photongen/onboard/Config.h"
+#include "photongen/onboard/core/Error.h"
+#include "photongen/onboard/core/Writer.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Delta encoding of status messages. Message is sent either as base or as changed byte runs against
+// the last base, never against previous delta, so a lost packet only loses that packet. Base sequence
+// number lets ground reject deltas to a base it has not received.
+// Component numbers are u8, values above are used as markers:
+//   base:  [varuint(257), varuint(baseSeq), status msg]
+//   delta: [varuint(256), varuint(compNum), varuint(msgNum), varuint(baseSeq),
+//           {varuint(gap), varuint(size), data[size]}..., varuint(0), varuint(0)]
+
+#define PHOTON_TM_DELTA_MARKER 256
+#define PHOTON_TM_DELTA_BASE_MARKER 257
+
+#ifndef PHOTON_CFG_TM_DELTA_MAX_MSG_SIZE
+# define PHOTON_CFG_TM_DELTA_MAX_MSG_SIZE 256
+#endif
+
+// full message is sent after this number of deltas, lets ground recover after lost base
+#ifndef PHOTON_CFG_TM_DELTA_BASE_INTERVAL
+# define PHOTON_CFG_TM_DELTA_BASE_INTERVAL 10
+#endif
+
+typedef struct {
+    // copy of last base, NULL if storage is not assigned
+    uint8_t* base;
+    uint16_t capacity;
+    // size of last base, 0 if base was not sent yet
+    uint16_t size;
+    uint8_t seq;
+    uint8_t count;
+} PhotonTmDelta;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void PhotonTmDelta_Init(PhotonTmDelta* self);
+void PhotonTmDelta_SetStorage(PhotonTmDelta* self, uint8_t* base, uint16_t capacity);
+// next message is sent as base
+void PhotonTmDelta_Reset(PhotonTmDelta* self);
+// writes base header, status msg is serialized after it
+PhotonError PhotonTmDelta_BeginMsg(PhotonTmDelta* self, PhotonWriter* dest);
+// status msg was written to image after header at begin, replaces it with delta if it is smaller;
+// without storage the header is removed and plain status msg is left
+void PhotonTmDelta_EndMsg(PhotonTmDelta* self, uint8_t compNum, uint8_t msgNum, uint8_t* begin, uint8_t* image, PhotonWriter* dest);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
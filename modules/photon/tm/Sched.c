@@ -0,0 +1,95 @@
+#include "photon/tm/Sched.h"
+
+#include "photon/core/Assert.h"
+
+void PhotonTmSched_Init(PhotonTmSched* self, PhotonTmSchedEntry* entries, size_t size)
+{
+    self->entries = entries;
+    self->size = size;
+    self->current = 0;
+    self->collectId = 0;
+    for (size_t i = 0; i < size; i++) {
+        entries[i].nextDeadline = 0;
+        entries[i].period = 0;
+        entries[i].priority = 0;
+        entries[i].collectId = 0;
+        entries[i].isEnabled = false;
+    }
+}
+
+void PhotonTmSched_SetPeriod(PhotonTmSched* self, size_t index, uint32_t period, uint64_t now)
+{
+    PHOTON_ASSERT(index < self->size);
+    PhotonTmSchedEntry* entry = &self->entries[index];
+    entry->period = period;
+    entry->nextDeadline = now;
+}
+
+void PhotonTmSched_BeginCollect(PhotonTmSched* self)
+{
+    self->collectId++;
+    if (self->collectId == 0) {
+        self->collectId = 1;
+    }
+}
+
+static inline bool isAvailable(const PhotonTmSched* self, const PhotonTmSchedEntry* entry)
+{
+    return entry->isEnabled && entry->collectId != self->collectId;
+}
+
+size_t PhotonTmSched_NextDue(PhotonTmSched* self, uint64_t now)
+{
+    size_t best = self->size;
+    int64_t bestPriority = 0;
+    for (size_t i = 0; i < self->size; i++) {
+        const PhotonTmSchedEntry* entry = &self->entries[i];
+        if (entry->period == 0 || !isAvailable(self, entry) || entry->nextDeadline > now) {
+            continue;
+        }
+        int64_t priority = entry->priority + (int64_t)((now - entry->nextDeadline) / entry->period);
+        if (best == self->size || priority > bestPriority ||
+            (priority == bestPriority && entry->nextDeadline < self->entries[best].nextDeadline)) {
+            best = i;
+            bestPriority = priority;
+        }
+    }
+    return best;
+}
+
+size_t PhotonTmSched_NextBestEffort(PhotonTmSched* self)
+{
+    for (size_t n = 0; n < self->size; n++) {
+        size_t i = self->current;
+        self->current++;
+        if (self->current >= self->size) {
+            self->current = 0;
+        }
+        const PhotonTmSchedEntry* entry = &self->entries[i];
+        if (entry->period == 0 && isAvailable(self, entry)) {
+            return i;
+        }
+    }
+    return self->size;
+}
+
+void PhotonTmSched_MarkSent(PhotonTmSched* self, size_t index, uint64_t now)
+{
+    PHOTON_ASSERT(index < self->size);
+    PhotonTmSchedEntry* entry = &self->entries[index];
+    entry->collectId = self->collectId;
+    if (entry->period == 0) {
+        return;
+    }
+    entry->nextDeadline += entry->period;
+    if (entry->nextDeadline <= now) {
+        // fell behind, drop missed periods instead of sending a burst
+        entry->nextDeadline = now + entry->period;
+    }
+}
+
+void PhotonTmSched_MarkSkipped(PhotonTmSched* self, size_t index)
+{
+    PHOTON_ASSERT(index < self->size);
+    self->entries[index].collectId = self->collectId;
+}
@@ -0,0 +1,50 @@
+#ifndef __PHOTON_TM_SCHED_H__
+#define __PHOTON_TM_SCHED_H__
+
+#include "photongen/onboard/Config.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Status message scheduler.
+// Messages with nonzero period are sent when their deadline passes, most important first.
+// Priority of a late message grows by one for each missed period, so with a short link budget
+// low priority messages slow down instead of stopping completely.
+// Messages with zero period are sent round-robin using space left after all due messages.
+
+typedef struct {
+    uint64_t nextDeadline;
+    uint32_t period;
+    int16_t priority;
+    uint16_t collectId;
+    bool isEnabled;
+} PhotonTmSchedEntry;
+
+typedef struct {
+    PhotonTmSchedEntry* entries;
+    size_t size;
+    size_t current;
+    uint16_t collectId;
+} PhotonTmSched;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void PhotonTmSched_Init(PhotonTmSched* self, PhotonTmSchedEntry* entries, size_t size);
+void PhotonTmSched_SetPeriod(PhotonTmSched* self, size_t index, uint32_t period, uint64_t now);
+void PhotonTmSched_BeginCollect(PhotonTmSched* self);
+// returns self->size if no messages are due
+size_t PhotonTmSched_NextDue(PhotonTmSched* self, uint64_t now);
+// returns self->size if all best effort messages were already tried during current collection
+size_t PhotonTmSched_NextBestEffort(PhotonTmSched* self);
+void PhotonTmSched_MarkSent(PhotonTmSched* self, size_t index, uint64_t now);
+// message did not fit, keep deadline and retry during next collection
+void PhotonTmSched_MarkSkipped(PhotonTmSched* self, size_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
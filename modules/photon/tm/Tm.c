@@ -5,9 +5,14 @@
 #include "photongen/onboard/core/Writer.h"
 #include "photongen/onboard/core/RingBuf.h"
 #include "photon/core/Logging.h"
+#include "photon/core/Assert.h"
 #include "photon/core/Try.h"
+#include "photon/core/Util.h"
 #include "photongen/onboard/tm/MessageDesc.h"
 #include "photongen/onboard/tm/StatusMessage.h"
+#include "photongen/onboard/clk/Clk.Component.h"
+#include "photon/tm/Sched.h"
+#include "photon/tm/Delta.h"
 
 #ifdef PHOTON_HAS_MODULE_BLOG
 # include "photongen/onboard/blog/Blog.Component.h"
@@ -15,18 +20,93 @@
 
 #include "photongen/onboard/StatusTable.inc.c"
 
+#include <string.h>
+
 #define _PHOTON_FNAME "tm/Tm.c"
 
 #define TM_MSG_BEGIN &_messageDesc[0]
 #define TM_MSG_END &_messageDesc[_PHOTON_TM_MSG_COUNT]
 
-#define TM_MAX_ONCE_REQUESTS 16 // TODO: generate
+#ifndef PHOTON_CFG_TM_EVENT_BUFFER_SIZE
+# define PHOTON_CFG_TM_EVENT_BUFFER_SIZE 2048
+#endif
+
+// events are serialized directly into event buffer, this much contiguous space is reserved for each one
+#ifndef PHOTON_CFG_TM_MAX_EVENT_SIZE
+# define PHOTON_CFG_TM_MAX_EVENT_SIZE 512
+#endif
+
+// events are stored as [u16 size, event], record that doesn't fit before buffer end is preceded by
+// padding up to the end: TM_EVENT_PADDING as size or nothing if less than 2 bytes are left
+#define TM_EVENT_PADDING 0xffff
+
+// requests are deduplicated, so queue can't hold more than all status messages
+#ifndef PHOTON_CFG_TM_MAX_ONCE_REQUESTS
+# define PHOTON_CFG_TM_MAX_ONCE_REQUESTS _PHOTON_TM_MSG_COUNT
+#endif
+
+#ifndef PHOTON_CFG_TM_DELTA_STORAGE_SIZE
+# define PHOTON_CFG_TM_DELTA_STORAGE_SIZE 1024
+#endif
+
+typedef struct {
+    uint64_t lastSent;
+    uint32_t hash;
+    uint32_t keepalive;
+    PhotonTmDelta delta;
+    bool hasHash;
+    bool isDeltaEnabled;
+} StatusState;
 
-static uint16_t _onceRequests[TM_MAX_ONCE_REQUESTS];
-static uint8_t eventTmp[1024];
+#define TM_MSG_KEY(desc) (((uint16_t)(desc)->compNum << 8) | (desc)->msgNum)
+
+static uint16_t _onceRequests[PHOTON_CFG_TM_MAX_ONCE_REQUESTS];
+static size_t _onceRequestsHead;
+static bool _isOnceRequested[_PHOTON_TM_MSG_COUNT];
+// message indexes sorted by (compNum, msgNum)
+static uint16_t _msgIndex[_PHOTON_TM_MSG_COUNT];
 static PhotonWriter eventWriter;
-static uint8_t _eventData[2048];
+static uint8_t _eventData[PHOTON_CFG_TM_EVENT_BUFFER_SIZE];
 static PhotonRingBuf _eventRingBuf;
+static PhotonTmSchedEntry _schedEntries[_PHOTON_TM_MSG_COUNT];
+static PhotonTmSched _sched;
+static StatusState _statusState[_PHOTON_TM_MSG_COUNT];
+static uint8_t _deltaStorage[PHOTON_CFG_TM_DELTA_STORAGE_SIZE];
+static size_t _deltaStorageUsed;
+
+static void initMsgIndex()
+{
+    // status table is small and sorted only once, insertion sort is enough
+    for (size_t i = 0; i < _PHOTON_TM_MSG_COUNT; i++) {
+        uint16_t key = TM_MSG_KEY(&_messageDesc[i]);
+        size_t j = i;
+        while (j > 0 && TM_MSG_KEY(&_messageDesc[_msgIndex[j - 1]]) > key) {
+            _msgIndex[j] = _msgIndex[j - 1];
+            j--;
+        }
+        _msgIndex[j] = i;
+    }
+}
+
+static PhotonTmMessageDesc* findMsg(uint8_t compNum, uint8_t msgNum)
+{
+    uint16_t key = ((uint16_t)compNum << 8) | msgNum;
+    size_t begin = 0;
+    size_t end = _PHOTON_TM_MSG_COUNT;
+    while (begin < end) {
+        size_t middle = begin + (end - begin) / 2;
+        PhotonTmMessageDesc* desc = &_messageDesc[_msgIndex[middle]];
+        uint16_t current = TM_MSG_KEY(desc);
+        if (current == key) {
+            return desc;
+        } else if (current < key) {
+            begin = middle + 1;
+        } else {
+            end = middle;
+        }
+    }
+    return NULL;
+}
 
 void PhotonTm_Init()
 {
@@ -34,14 +114,29 @@ void PhotonTm_Init()
     _photonTm.generatedEvents = 0;
     _photonTm.currentDesc = 0;
     size_t allowedMsgCount = 0;
+    PhotonTmSched_Init(&_sched, _schedEntries, _PHOTON_TM_MSG_COUNT);
     for (PhotonTmMessageDesc* it = TM_MSG_BEGIN; it < TM_MSG_END; it++) {
+        PhotonTmSchedEntry* entry = &_schedEntries[it - TM_MSG_BEGIN];
+        entry->priority = it->priority;
+        entry->isEnabled = it->isEnabled;
+        StatusState* state = &_statusState[it - TM_MSG_BEGIN];
+        state->lastSent = 0;
+        state->hash = 0;
+        state->keepalive = 0;
+        PhotonTmDelta_Init(&state->delta);
+        state->hasHash = false;
+        state->isDeltaEnabled = false;
+        _isOnceRequested[it - TM_MSG_BEGIN] = false;
         if (it->isEnabled) {
             allowedMsgCount++;
         }
     }
     _photonTm.allowedMsgCount = allowedMsgCount;
     _photonTm.onceRequestsNum = 0;
-    PhotonWriter_Init(&eventWriter, eventTmp, sizeof(eventTmp));
+    _onceRequestsHead = 0;
+    _deltaStorageUsed = 0;
+    initMsgIndex();
+    PHOTON_ASSERT(PHOTON_CFG_TM_MAX_EVENT_SIZE + 2 <= sizeof(_eventData));
     PhotonRingBuf_Init(&_eventRingBuf, _eventData, sizeof(_eventData));
 }
 
@@ -49,9 +144,64 @@ void PhotonTm_Tick()
 {
 }
 
+// returns number of padding bytes at the start of event buffer, 0 if it starts with an event
+static size_t eventPaddingSize()
+{
+    size_t readable = PhotonRingBuf_ReadableSize(&_eventRingBuf);
+    if (readable == 0) {
+        return 0;
+    }
+    PhotonMemChunks chunks = PhotonRingBuf_PeekChunks(&_eventRingBuf, readable, 0);
+    if (chunks.first.size < 2) {
+        return chunks.first.size;
+    }
+    uint16_t size;
+    memcpy(&size, chunks.first.data, 2);
+    if (size == TM_EVENT_PADDING) {
+        return chunks.first.size;
+    }
+    return 0;
+}
+
+static void dropOldestEvent()
+{
+    size_t padding = eventPaddingSize();
+    if (padding) {
+        PhotonRingBuf_Consume(&_eventRingBuf, padding);
+        return;
+    }
+    PHOTON_DEBUG("removing event to fit new");
+    uint16_t currentSize;
+    PhotonRingBuf_Peek(&_eventRingBuf, &currentSize, 2, 0);
+    PhotonRingBuf_Consume(&_eventRingBuf, currentSize + 2);
+    _photonTm.lostEvents++;
+    _photonTm.storedEvents--;
+}
+
 PhotonWriter* PhotonTm_BeginEventMsg(uint8_t compNum, uint8_t msgNum)
 {
-    eventWriter.current = eventWriter.start;
+    const size_t maxSize = PHOTON_CFG_TM_MAX_EVENT_SIZE + 2;
+    uint8_t* dest;
+    while (true) {
+        dest = PhotonRingBuf_Reserve(&_eventRingBuf, maxSize);
+        if (dest) {
+            break;
+        }
+        size_t linearSize = PhotonRingBuf_LinearWritableSize(&_eventRingBuf);
+        if (linearSize != 0 && (PhotonRingBuf_CurrentWritePtr(&_eventRingBuf) + linearSize) == (_eventData + sizeof(_eventData))) {
+            // not enough space before buffer end, continue from the beginning
+            if (linearSize >= 2) {
+                uint16_t padding = TM_EVENT_PADDING;
+                memcpy(PhotonRingBuf_CurrentWritePtr(&_eventRingBuf), &padding, 2);
+            }
+            PhotonRingBuf_Commit(&_eventRingBuf, linearSize);
+            continue;
+        }
+        dropOldestEvent();
+    }
+    // uncommitted until PhotonTm_EndEventMsg, abandoned event is overwritten by the next one
+    PhotonWriter_Init(&eventWriter, dest, maxSize);
+    PhotonWriter_Skip(&eventWriter, 2);
     PhotonWriter_WriteU8(&eventWriter, compNum);
     PhotonWriter_WriteU8(&eventWriter, msgNum);
     return &eventWriter;
@@ -59,52 +209,27 @@ PhotonWriter* PhotonTm_BeginEventMsg(uint8_t compNum, uint8_t msgNum)
 
 void PhotonTm_EndEventMsg()
 {
-    //TODO: check overflow
-    uint16_t msgSize = eventWriter.current - eventWriter.start;
+    uint16_t msgSize = eventWriter.current - eventWriter.start - 2;
+    memcpy(eventWriter.start, &msgSize, 2);
 
 #ifdef PHOTON_HAS_MODULE_BLOG
-    PhotonBlog_LogTmMsg(eventWriter.start, msgSize);
+    PhotonBlog_LogTmMsg(eventWriter.start + 2, msgSize);
 #endif
 
-    size_t writableSize = PhotonRingBuf_WritableSize(&_eventRingBuf);
-    while ((msgSize + 2u) > writableSize) {
-        PHOTON_DEBUG("removing event to fit new");
-        _photonTm.lostEvents++;
-        _photonTm.storedEvents--;
-        uint16_t currentSize;
-        PhotonRingBuf_Peek(&_eventRingBuf, &currentSize, 2, 0);
-        //TODO: check available size before erase
-        PhotonRingBuf_Erase(&_eventRingBuf, currentSize + 2);
-        writableSize = PhotonRingBuf_WritableSize(&_eventRingBuf);
-    }
-    PhotonRingBuf_Write(&_eventRingBuf, &msgSize, 2);
-    PhotonRingBuf_Write(&_eventRingBuf, eventWriter.start, msgSize);
+    PhotonRingBuf_Commit(&_eventRingBuf, msgSize + 2);
     _photonTm.storedEvents++;
     _photonTm.generatedEvents++;
 }
 
-static void selectNextMessage()
-{
-    _photonTm.currentDesc++;
-    if (_photonTm.currentDesc >= _PHOTON_TM_MSG_COUNT) {
-        _photonTm.currentDesc = 0;
-    }
-}
-
-static inline PhotonTmMessageDesc* currentDesc()
-{
-    return &_messageDesc[_photonTm.currentDesc];
-}
-
 static void popOnceRequests(size_t num)
 {
-    if (num >= _photonTm.onceRequestsNum) {
-        _photonTm.onceRequestsNum = 0;
-        return;
-    }
-    size_t delta = _photonTm.onceRequestsNum - num;
-    for (size_t i = 0; i < delta; i++) {
-        _onceRequests[i] = _onceRequests[i + num];
+    PHOTON_ASSERT(num <= _photonTm.onceRequestsNum);
+    for (size_t i = 0; i < num; i++) {
+        _isOnceRequested[_onceRequests[_onceRequestsHead]] = false;
+        _onceRequestsHead++;
+        if (_onceRequestsHead == PHOTON_CFG_TM_MAX_ONCE_REQUESTS) {
+            _onceRequestsHead = 0;
+        }
     }
     _photonTm.onceRequestsNum -= num;
 }
@@ -115,22 +240,26 @@ static PhotonError collectEvents(PhotonWriter* dest, unsigned* totalMessages)
         if (PhotonRingBuf_ReadableSize(&_eventRingBuf) == 0) {
             break;
         }
+        size_t padding = eventPaddingSize();
+        if (padding) {
+            PhotonRingBuf_Consume(&_eventRingBuf, padding);
+            continue;
+        }
         uint16_t currentSize;
         PhotonRingBuf_Peek(&_eventRingBuf, &currentSize, 2, 0);
-        //TODO: check available size before peak
         if (currentSize > PhotonWriter_WritableSize(dest)) {
             if (*totalMessages == 0) {
                 PHOTON_CRITICAL("unable to fit event, skipping");
-                PhotonRingBuf_Erase(&_eventRingBuf, currentSize + 2);
+                PhotonRingBuf_Consume(&_eventRingBuf, currentSize + 2);
                 _photonTm.storedEvents--;
                 _photonTm.lostEvents++;
             }
             break;
         }
-        uint8_t* current = PhotonWriter_CurrentPtr(dest);
-        PhotonRingBuf_Peek(&_eventRingBuf, current, currentSize, 2);
-        PhotonWriter_SetCurrentPtr(dest, current + currentSize);
-        PhotonRingBuf_Erase(&_eventRingBuf, currentSize + 2);
+        PhotonMemChunks chunks = PhotonRingBuf_PeekChunks(&_eventRingBuf, currentSize, 2);
+        PhotonWriter_Write(dest, chunks.first.data, chunks.first.size);
+        PhotonWriter_Write(dest, chunks.second.data, chunks.second.size);
+        PhotonRingBuf_Consume(&_eventRingBuf, currentSize + 2);
         _photonTm.storedEvents--;
         (*totalMessages)++;
     }
@@ -139,14 +268,9 @@ static PhotonError collectEvents(PhotonWriter* dest, unsigned* totalMessages)
 
 static PhotonError collectOnceRequests(PhotonWriter* dest, unsigned* totalMessages)
 {
-    if (_photonTm.onceRequestsNum > TM_MAX_ONCE_REQUESTS) {
-        _photonTm.onceRequestsNum = TM_MAX_ONCE_REQUESTS;
-        PHOTON_CRITICAL("once requests overflow");
-    }
-
     size_t i;
     for (i = 0; i < _photonTm.onceRequestsNum; i++) {
-        size_t currentId = _onceRequests[i];
+        size_t currentId = _onceRequests[(_onceRequestsHead + i) % PHOTON_CFG_TM_MAX_ONCE_REQUESTS];
         if (currentId >= _PHOTON_TM_MSG_COUNT) {
             PHOTON_CRITICAL("invalid msg id in once requests (%u)", currentId);
             continue;
@@ -181,45 +305,113 @@ static PhotonError collectOnceRequests(PhotonWriter* dest, unsigned* totalMessag
     return PhotonError_Ok;
 }
 
+static uint32_t hashStatus(const uint8_t* data, size_t size)
+{
+    // fnv-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// storage for delta base is assigned on first use and never freed
+static void assignDeltaStorage(StatusState* state, size_t size)
+{
+    if (state->delta.base || size > (PHOTON_CFG_TM_DELTA_STORAGE_SIZE - _deltaStorageUsed)) {
+        return;
+    }
+    PhotonTmDelta_SetStorage(&state->delta, &_deltaStorage[_deltaStorageUsed], size);
+    _deltaStorageUsed += size;
+}
+
+static bool collectStatus(size_t index, uint64_t now, PhotonWriter* dest, unsigned* totalMessages)
+{
+    PhotonTmMessageDesc* desc = &_messageDesc[index];
+    StatusState* state = &_statusState[index];
+    uint8_t* current = PhotonWriter_CurrentPtr(dest);
+    PhotonError rv = PhotonError_Ok;
+    if (state->isDeltaEnabled) {
+        rv = PhotonTmDelta_BeginMsg(&state->delta, dest);
+    }
+    uint8_t* image = PhotonWriter_CurrentPtr(dest);
+    if (rv == PhotonError_Ok) {
+        rv = desc->func(dest);
+    }
+    if (rv == PhotonError_Ok) {
+        size_t imageSize = dest->current - image;
+        if (state->keepalive != 0) {
+            uint32_t hash = hashStatus(image, imageSize);
+            if (state->hasHash && state->hash == hash && (now - state->lastSent) < state->keepalive) {
+                // unchanged, skip until keepalive
+                PhotonWriter_SetCurrentPtr(dest, current);
+                PhotonTmSched_MarkSent(&_sched, index, now);
+                return true;
+            }
+            state->hash = hash;
+            state->hasHash = true;
+        }
+        state->lastSent = now;
+#ifdef PHOTON_HAS_MODULE_BLOG
+        PhotonBlog_LogTmMsg(image, imageSize);
+#endif
+        if (state->isDeltaEnabled) {
+            assignDeltaStorage(state, imageSize);
+            PhotonTmDelta_EndMsg(&state->delta, desc->compNum, desc->msgNum, current, image, dest);
+        }
+        PhotonTmSched_MarkSent(&_sched, index, now);
+        (*totalMessages)++;
+        return true;
+    } else if (rv == PhotonError_NotEnoughSpace) {
+        PhotonWriter_SetCurrentPtr(dest, current);
+        if (*totalMessages == 0) {
+            PHOTON_CRITICAL("unable to fit status (%u, %u), skipping",
+                            (unsigned)desc->compNum,
+                            (unsigned)desc->msgNum);
+            PhotonTmSched_MarkSent(&_sched, index, now);
+            return true;
+        }
+        PhotonTmSched_MarkSkipped(&_sched, index);
+        return false;
+    }
+    PhotonWriter_SetCurrentPtr(dest, current);
+    PHOTON_CRITICAL("unable to serialize status (%u, %u), skipping",
+                    (unsigned)desc->compNum,
+                    (unsigned)desc->msgNum);
+    PhotonTmSched_MarkSent(&_sched, index, now);
+    return true;
+}
+
 static PhotonError collectStatuses(PhotonWriter* dest, unsigned* totalMessages)
 {
     if (_photonTm.allowedMsgCount == 0) {
         return PhotonError_Ok;
     }
 
-    for (size_t i = 0; i < _PHOTON_TM_MSG_COUNT; i++) {
-        if (!currentDesc()->isEnabled) {
-            selectNextMessage();
-            continue;
+    // schedule uses tick time, all statuses collected during one tick see the same time
+    uint64_t now = PhotonClk_GetTickTime();
+    PhotonTmSched_BeginCollect(&_sched);
+
+    // messages that didn't fit are skipped, smaller ones may still fit
+    while (true) {
+        size_t index = PhotonTmSched_NextDue(&_sched, now);
+        if (index >= _PHOTON_TM_MSG_COUNT) {
+            break;
         }
-        uint8_t* current = PhotonWriter_CurrentPtr(dest);
-        PhotonError rv = currentDesc()->func(dest);
-        if (rv == PhotonError_Ok) {
-#ifdef PHOTON_HAS_MODULE_BLOG
-            PhotonBlog_LogTmMsg(current, dest->current - current);
-#endif
-            selectNextMessage();
-            (*totalMessages)++;
-            continue;
-        } else if (rv == PhotonError_NotEnoughSpace) {
-            PhotonWriter_SetCurrentPtr(dest, current);
-            if (*totalMessages == 0) {
-                PHOTON_CRITICAL("unable to fit status (%u, %u), skipping",
-                                (unsigned)currentDesc()->compNum,
-                                (unsigned)currentDesc()->msgNum);
-                selectNextMessage();
-                continue;
-            }
-            return PhotonError_Ok;
-        } else {
-            PhotonWriter_SetCurrentPtr(dest, current);
-            PHOTON_CRITICAL("unable to serialize status (%u, %u), skipping",
-                            (unsigned)currentDesc()->compNum,
-                            (unsigned)currentDesc()->msgNum);
-            selectNextMessage();
-            continue;
+        collectStatus(index, now, dest, totalMessages);
+    }
+
+    while (PhotonWriter_WritableSize(dest) != 0) {
+        size_t index = PhotonTmSched_NextBestEffort(&_sched);
+        if (index >= _PHOTON_TM_MSG_COUNT) {
+            break;
+        }
+        if (!collectStatus(index, now, dest, totalMessages)) {
+            break;
         }
     }
+    _photonTm.currentDesc = _sched.current;
     return PhotonError_Ok;
 }
 
@@ -266,43 +458,87 @@ bool PhotonTm_HasMessages()
 
 PhotonError PhotonTm_SetStatusEnabled(uint8_t compNum, uint8_t msgNum, bool isEnabled)
 {
-    for (PhotonTmMessageDesc* it = TM_MSG_BEGIN; it < TM_MSG_END; it++) {
-        if (it->compNum == compNum && it->msgNum == msgNum) {
-            if (it->isEnabled != isEnabled) {
-                if (isEnabled) {
-                    _photonTm.allowedMsgCount++;
-                } else {
-                    _photonTm.allowedMsgCount--;
-                }
-                it->isEnabled = isEnabled;
-            }
-            return PhotonError_Ok;
+    PhotonTmMessageDesc* it = findMsg(compNum, msgNum);
+    if (!it) {
+        return PhotonError_NoSuchStatusMsg;
+    }
+    if (it->isEnabled != isEnabled) {
+        if (isEnabled) {
+            _photonTm.allowedMsgCount++;
+        } else {
+            _photonTm.allowedMsgCount--;
         }
+        it->isEnabled = isEnabled;
+        _schedEntries[it - TM_MSG_BEGIN].isEnabled = isEnabled;
     }
-    return PhotonError_NoSuchStatusMsg;
+    return PhotonError_Ok;
+}
+
+PhotonError PhotonTm_SetStatusPeriod(uint8_t compNum, uint8_t msgNum, uint32_t period)
+{
+    PhotonTmMessageDesc* it = findMsg(compNum, msgNum);
+    if (!it) {
+        return PhotonError_NoSuchStatusMsg;
+    }
+    PhotonTmSched_SetPeriod(&_sched, it - TM_MSG_BEGIN, period, PhotonClk_GetTickTime());
+    return PhotonError_Ok;
+}
+
+PhotonError PhotonTm_SetStatusPriority(uint8_t compNum, uint8_t msgNum, int16_t priority)
+{
+    PhotonTmMessageDesc* it = findMsg(compNum, msgNum);
+    if (!it) {
+        return PhotonError_NoSuchStatusMsg;
+    }
+    it->priority = priority;
+    _schedEntries[it - TM_MSG_BEGIN].priority = priority;
+    return PhotonError_Ok;
+}
+
+PhotonError PhotonTm_SetStatusKeepalive(uint8_t compNum, uint8_t msgNum, uint32_t keepalive)
+{
+    PhotonTmMessageDesc* it = findMsg(compNum, msgNum);
+    if (!it) {
+        return PhotonError_NoSuchStatusMsg;
+    }
+    StatusState* state = &_statusState[it - TM_MSG_BEGIN];
+    state->keepalive = keepalive;
+    state->hasHash = false;
+    return PhotonError_Ok;
+}
+
+PhotonError PhotonTm_SetStatusDeltaEnabled(uint8_t compNum, uint8_t msgNum, bool isEnabled)
+{
+    PhotonTmMessageDesc* it = findMsg(compNum, msgNum);
+    if (!it) {
+        return PhotonError_NoSuchStatusMsg;
+    }
+    StatusState* state = &_statusState[it - TM_MSG_BEGIN];
+    state->isDeltaEnabled = isEnabled;
+    PhotonTmDelta_Reset(&state->delta);
+    return PhotonError_Ok;
 }
 
 PhotonError PhotonTm_RequestStatusOnce(uint8_t compNum, uint8_t msgNum)
 {
-    if (_photonTm.onceRequestsNum == TM_MAX_ONCE_REQUESTS) {
-        return PhotonError_MaximumOnceRequestsReached;
+    PhotonTmMessageDesc* it = findMsg(compNum, msgNum);
+    if (!it) {
+        return PhotonError_NoSuchStatusMsg;
     }
-    for (PhotonTmMessageDesc* it = TM_MSG_BEGIN; it < TM_MSG_END; it++) {
-        if (it->compNum == compNum && it->msgNum == msgNum) {
-            size_t id = it - TM_MSG_BEGIN;
-            for (size_t i = 0; i < _photonTm.onceRequestsNum; i++) {
-                if (_onceRequests[i] == id) {
-                    PHOTON_DEBUG("once request already set (%u, %u)", (unsigned)it->compNum, (unsigned)it->msgNum);
-                    return PhotonError_Ok;
-                }
-            }
-            PHOTON_DEBUG("setting once request (%u, %u)", (unsigned)it->compNum, (unsigned)it->msgNum);
-            _onceRequests[_photonTm.onceRequestsNum] = id;
-            _photonTm.onceRequestsNum++;
-            return PhotonError_Ok;
-        }
+    size_t id = it - TM_MSG_BEGIN;
+    if (_isOnceRequested[id]) {
+        PHOTON_DEBUG("once request already set (%u, %u)", (unsigned)it->compNum, (unsigned)it->msgNum);
+        return PhotonError_Ok;
+    }
+    if (_photonTm.onceRequestsNum == PHOTON_CFG_TM_MAX_ONCE_REQUESTS) {
+        return PhotonError_MaximumOnceRequestsReached;
     }
-    return PhotonError_NoSuchStatusMsg;
+    PHOTON_DEBUG("setting once request (%u, %u)", (unsigned)it->compNum, (unsigned)it->msgNum);
+    size_t tail = (_onceRequestsHead + _photonTm.onceRequestsNum) % PHOTON_CFG_TM_MAX_ONCE_REQUESTS;
+    _onceRequests[tail] = id;
+    _isOnceRequested[id] = true;
+    _photonTm.onceRequestsNum++;
+    return PhotonError_Ok;
 }
 
 PhotonError PhotonTm_ExecCmd_RequestStatusOnce(uint8_t compNum, uint8_t msgNum)
@@ -315,4 +551,24 @@ PhotonError PhotonTm_ExecCmd_SetStatusEnabled(uint8_t compNum, uint8_t msgNum, b
     return PhotonTm_SetStatusEnabled(compNum, msgNum, isEnabled);
 }
 
+PhotonError PhotonTm_ExecCmd_SetStatusPeriod(uint8_t compNum, uint8_t msgNum, uint32_t period)
+{
+    return PhotonTm_SetStatusPeriod(compNum, msgNum, period);
+}
+
+PhotonError PhotonTm_ExecCmd_SetStatusPriority(uint8_t compNum, uint8_t msgNum, int16_t priority)
+{
+    return PhotonTm_SetStatusPriority(compNum, msgNum, priority);
+}
+
+PhotonError PhotonTm_ExecCmd_SetStatusKeepalive(uint8_t compNum, uint8_t msgNum, uint32_t keepalive)
+{
+    return PhotonTm_SetStatusKeepalive(compNum, msgNum, keepalive);
+}
+
+PhotonError PhotonTm_ExecCmd_SetStatusDeltaEnabled(uint8_t compNum, uint8_t msgNum, bool isEnabled)
+{
+    return PhotonTm_SetStatusDeltaEnabled(compNum, msgNum, isEnabled);
+}
+
 #undef _PHOTON_FNAME
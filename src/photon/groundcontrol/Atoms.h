@@ -11,6 +11,7 @@ using StopAtom                            = caf::atom_constant<caf::atom("sstopa
 using LogAtom                             = caf::atom_constant<caf::atom("logevent")>;
 using RecvDataAtom                        = caf::atom_constant<caf::atom("recvdata")>;
 using RecvPayloadAtom                     = caf::atom_constant<caf::atom("recvpyld")>;
+using RecvPacketAtom                      = caf::atom_constant<caf::atom("recvpckt")>;
 using EnableLoggindAtom                   = caf::atom_constant<caf::atom("enablelg")>;
 using RecvPacketPayloadAtom               = caf::atom_constant<caf::atom("recvupkt")>;
 using SendUnreliablePacketAtom            = caf::atom_constant<caf::atom("sendupkt")>;
@@ -29,11 +30,22 @@ using SubscribeNumberedTmAtom             = caf::atom_constant<caf::atom("subsnu
 using SendCustomCommandAtom               = caf::atom_constant<caf::atom("sendccmd")>;
 using PingAtom                            = caf::atom_constant<caf::atom("pingatom")>;
 
+using AddDeviceAtom                       = caf::atom_constant<caf::atom("adddevic")>;
+using RemoveDeviceAtom                    = caf::atom_constant<caf::atom("rmdevice")>;
+using GetDeviceAtom                       = caf::atom_constant<caf::atom("getdevic")>;
+using AddLinkAtom                         = caf::atom_constant<caf::atom("addlink")>;
+using RemoveLinkAtom                      = caf::atom_constant<caf::atom("rmlink")>;
+
 using RepeatStreamAtom                    = caf::atom_constant<caf::atom("strmrept")>;
 using SetStreamDestAtom                   = caf::atom_constant<caf::atom("strmdest")>;
 
+using SetReplaySpeedAtom                  = caf::atom_constant<caf::atom("rplspeed")>;
+using SeekReplayAtom                      = caf::atom_constant<caf::atom("rplseek")>;
+using ReplayFinishedEventAtom             = caf::atom_constant<caf::atom("rplfinish")>;
+
 using FwtHashAtom                         = caf::atom_constant<caf::atom("fwthash")>;
 using FwtStartAtom                        = caf::atom_constant<caf::atom("fwtstart")>;
+using SetProjectCacheDirAtom              = caf::atom_constant<caf::atom("setpcache")>;
 using FwtCheckAtom                        = caf::atom_constant<caf::atom("fwtcheck")>;
 
 using ExchangeErrorEventAtom              = caf::atom_constant<caf::atom("excerror")>;
@@ -49,5 +61,7 @@ using FirmwareProgressEventAtom           = caf::atom_constant<caf::atom("fevent
 
 using RequestDfuStatus                    = caf::atom_constant<caf::atom("reqsfusta")>;
 using FlashDfuFirmware                    = caf::atom_constant<caf::atom("flashdfuf")>;
+using FlashDfuPatch                       = caf::atom_constant<caf::atom("flashdfup")>;
+using DfuCheckAtom                        = caf::atom_constant<caf::atom("dfucheck")>;
 
 }
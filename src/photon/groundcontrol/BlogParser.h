@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "photon/Config.hpp"
+
+#include "photon/groundcontrol/CompressedPackage.h"
+#include "photon/groundcontrol/Crc.h"
+#include "photon/groundcontrol/LogRecord.h"
+#include "photon/groundcontrol/Lz4.h"
+#include "photon/model/OnboardTime.h"
+#include "photon/model/CoderState.h"
+#include "photongen/groundcontrol/blog/MsgKind.hpp"
+#include "decode/core/Utils.h"
+
+#include <bmcl/Bytes.h>
+#include <bmcl/StringView.h>
+#include <bmcl/MemReader.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace photon {
+
+// block container written by onboard blog module, see modules/photon/blog/Blog.c
+struct BlockStats {
+    std::size_t num = 0;
+    std::size_t compressedNum = 0;
+    std::size_t brokenNum = 0;
+    std::size_t rawSize = 0;
+    std::size_t storedSize = 0;
+};
+
+inline bool isBlockFile(bmcl::Bytes data)
+{
+    static char magicPrefix[4] = {'p', 'b', 'l', 'k'};
+    return data.size() >= 5 && std::memcmp(magicPrefix, data.data(), sizeof(magicPrefix)) == 0;
+}
+
+// returns log stream, broken blocks are skipped
+inline std::vector<uint8_t> decodeBlocks(bmcl::Bytes data, BlockStats* stats)
+{
+    constexpr std::size_t headerSize = 9;
+    constexpr uint8_t syncFirstPart = 0xb1;
+    constexpr uint8_t syncSecondPart = 0x0c;
+
+    std::vector<uint8_t> stream;
+    const uint8_t* current = data.data() + 5;
+    const uint8_t* end = data.data() + data.size();
+    while (std::size_t(end - current) >= headerSize) {
+        if (current[0] != syncFirstPart || current[1] != syncSecondPart) {
+            current = std::find(current + 1, end, syncFirstPart);
+            continue;
+        }
+        uint8_t flags = current[2];
+        std::size_t rawSize = current[3] | (std::size_t(current[4]) << 8);
+        std::size_t storedSize = current[5] | (std::size_t(current[6]) << 8);
+        uint16_t expectedCrc = current[7] | (current[8] << 8);
+        if (std::size_t(end - current - headerSize) < storedSize) {
+            stats->brokenNum++;
+            current++;
+            continue;
+        }
+        Crc16 crc;
+        crc.update(current + 2, 5);
+        crc.update(current + headerSize, storedSize);
+        bmcl::Bytes stored(current + headerSize, storedSize);
+        if (crc.get() != expectedCrc) {
+            stats->brokenNum++;
+            current++;
+            continue;
+        }
+        if (flags & 1) {
+            std::size_t oldSize = stream.size();
+            if (!decompressLz4(stored, &stream, rawSize)) {
+                stream.resize(oldSize);
+                stats->brokenNum++;
+                current += headerSize + storedSize;
+                continue;
+            }
+            stats->compressedNum++;
+        } else {
+            stream.insert(stream.end(), stored.data(), stored.data() + stored.size());
+        }
+        stats->num++;
+        stats->rawSize += rawSize;
+        stats->storedSize += storedSize;
+        current += headerSize + storedSize;
+    }
+    return stream;
+}
+
+struct BlogMsg {
+    BlogMsg(std::size_t offset, OnboardTime time, bmcl::Bytes data)
+        : offset(offset)
+        , time(time)
+        , data(data)
+    {
+    }
+
+    std::size_t offset;
+    OnboardTime time;
+    bmcl::Bytes data;
+};
+
+template <typename B>
+class BlogParser {
+public:
+
+    B& base();
+
+    bool parse(bmcl::Bytes data);
+
+    bool handleDeviceName(std::size_t offset, bmcl::StringView name);
+    bool handleSerializedProject(std::size_t offset, bmcl::Bytes projectData);
+    bool handleBrokenPart(std::size_t offset, bmcl::Bytes data);
+    bool handlePvuCmd(const BlogMsg& msg);
+    bool handleTmMsg(const BlogMsg& msg);
+    bool handleFwtCmd(const BlogMsg& msg);
+    // decodes records and passes them to handleLogRecord, returns false if records are malformed
+    bool handleLogRecords(const BlogMsg& msg);
+    bool handleLogRecord(const BlogMsg& msg, const LogRecord& record);
+
+private:
+    // decompressed project if blog contains compressed package
+    std::vector<uint8_t> _project;
+};
+
+template <typename B>
+inline bool BlogParser<B>::parse(bmcl::Bytes data)
+{
+    static char magicPrefix[4] = {'b', 'l', 'o', 'g'};
+    bmcl::MemReader reader(data);
+    if (reader.sizeLeft() < sizeof(magicPrefix)) {
+        return false;
+    }
+    if (std::memcmp(magicPrefix, reader.current(), sizeof(magicPrefix)) != 0) {
+        return false;
+    }
+    reader.skip(sizeof(magicPrefix));
+
+    auto nameRv = decode::deserializeString(&reader);
+    if (nameRv.isErr()) {
+        return false;
+    }
+    if (!base().handleDeviceName(reader.current() - reader.start(), nameRv.unwrap())) {
+        return true;
+    }
+
+    uint64_t projectSize = 0;
+    if (!reader.readVarUint(&projectSize)) {
+        return false;
+    }
+    if (reader.sizeLeft() < projectSize) {
+        return false;
+    }
+    bmcl::Bytes project(reader.current(), projectSize);
+    if (isCompressedPackage(project)) {
+        if (!decompressPackage(project, &_project)) {
+            return false;
+        }
+        project = bmcl::Bytes(_project.data(), _project.size());
+    }
+    if (!base().handleSerializedProject(reader.current() - reader.start(), project)) {
+        return true;
+    }
+    reader.skip(projectSize);
+
+    constexpr uint8_t sepFirstPart = 0x63;
+    constexpr uint8_t sepSecondPart = 0xc1;
+    const uint8_t* lastOk = reader.current();
+    while (reader.readableSize() != 0) {
+        const uint8_t* start = reader.current();
+        const uint8_t* current = start;
+        const uint8_t* end = reader.end();
+        current = std::find(current, end, sepFirstPart);
+        const uint8_t* csStart = current;
+        if (current == end) {
+            base().handleBrokenPart(reader.start() - lastOk, bmcl::Bytes(lastOk, current));
+            return true;
+        }
+        current++;
+        if (current == end) {
+            base().handleBrokenPart(reader.start() - lastOk, bmcl::Bytes(lastOk, current));
+            return true;
+        }
+        if (*current != sepSecondPart) {
+            reader.skip(current - start);
+            continue;
+        }
+        current++;
+        reader.skip(current - start);
+
+        photongen::blog::MsgKind kind;
+
+        CoderState state(OnboardTime::now());
+        if (!photongenDeserializeBlogMsgKind(&kind, &reader, &state)) {
+            continue;
+        }
+        uint64_t time = 0;
+        if (!reader.readVarUint(&time)) {
+            continue;
+        }
+        uint64_t size = 0;
+        if (!reader.readVarUint(&size)) {
+            continue;
+        }
+        if (reader.readableSize() < size) {
+            continue;
+        }
+        bmcl::Bytes chunk(reader.current(), size);
+        std::size_t offset = reader.current() - reader.start();
+        BlogMsg msg(offset, OnboardTime(time), chunk);
+        switch (kind) {
+        case photongen::blog::MsgKind::PvuCmd:
+            base().handlePvuCmd(msg);
+            break;
+        case photongen::blog::MsgKind::TmMsg:
+            base().handleTmMsg(msg);
+            break;
+        case photongen::blog::MsgKind::FwtCmd:
+            base().handleFwtCmd(msg);
+            break;
+        case photongen::blog::MsgKind::LogRecords:
+            base().handleLogRecords(msg);
+            break;
+        }
+        reader.skip(size);
+        if (lastOk != start) {
+            base().handleBrokenPart(csStart - lastOk, bmcl::Bytes(lastOk, csStart));
+        }
+
+        lastOk = reader.current();
+    }
+
+    return true;
+}
+
+template <typename B>
+inline B& BlogParser<B>::base()
+{
+    return *static_cast<B*>(this);
+}
+
+template <typename B>
+inline bool BlogParser<B>::handleDeviceName(std::size_t offset, bmcl::StringView name)
+{
+    (void)offset;
+    (void)name;
+    return true;
+}
+
+template <typename B>
+inline bool BlogParser<B>::handleSerializedProject(std::size_t offset, bmcl::Bytes data)
+{
+    (void)offset;
+    (void)data;
+    return true;
+}
+
+template <typename B>
+inline bool BlogParser<B>::handleBrokenPart(std::size_t offset, bmcl::Bytes data)
+{
+    (void)offset;
+    (void)data;
+    return true;
+}
+
+template <typename B>
+inline bool BlogParser<B>::handlePvuCmd(const BlogMsg& msg)
+{
+    (void)msg;
+    return true;
+}
+
+template <typename B>
+inline bool BlogParser<B>::handleTmMsg(const BlogMsg& msg)
+{
+    (void)msg;
+    return true;
+}
+
+template <typename B>
+inline bool BlogParser<B>::handleFwtCmd(const BlogMsg& msg)
+{
+    (void)msg;
+    return true;
+}
+
+template <typename B>
+inline bool BlogParser<B>::handleLogRecords(const BlogMsg& msg)
+{
+    std::vector<LogRecord> records;
+    bool isOk = decodeLogRecords(msg.data, &records);
+    for (const LogRecord& record : records) {
+        base().handleLogRecord(msg, record);
+    }
+    return isOk;
+}
+
+template <typename B>
+inline bool BlogParser<B>::handleLogRecord(const BlogMsg& msg, const LogRecord& record)
+{
+    (void)msg;
+    (void)record;
+    return true;
+}
+}
@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "photon/groundcontrol/BlogReplay.h"
+#include "photon/groundcontrol/BlogParser.h"
+#include "photon/groundcontrol/Atoms.h"
+#include "photon/groundcontrol/Packet.h"
+#include "photon/groundcontrol/AllowUnsafeMessageType.h"
+#include "photon/groundcontrol/ProjectUpdate.h"
+#include "decode/core/Diagnostics.h"
+#include "decode/parser/Project.h"
+
+#include <bmcl/Buffer.h>
+#include <bmcl/Bytes.h>
+#include <bmcl/FileUtils.h>
+#include <bmcl/Result.h>
+#include <bmcl/SharedBytes.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(bmcl::SharedBytes);
+DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(photon::PacketHeader);
+DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(photon::ProjectUpdate::ConstPointer);
+
+namespace photon {
+
+using ReplayStepAtom = caf::atom_constant<caf::atom("rplstep")>;
+
+// packets sent to dest without response
+constexpr std::size_t maxInFlight = 16;
+// records with the same time are merged into one packet up to this size
+constexpr std::size_t maxPacketSize = 16 * 1024;
+constexpr std::chrono::milliseconds maxStepDelay(100);
+
+class ReplayCollector : public BlogParser<ReplayCollector> {
+public:
+    struct Record {
+        uint64_t time;
+        bmcl::Bytes data;
+    };
+
+    bool handleDeviceName(std::size_t offset, bmcl::StringView name)
+    {
+        (void)offset;
+        deviceName = name.toStdString();
+        return true;
+    }
+
+    bool handleSerializedProject(std::size_t offset, bmcl::Bytes projectData)
+    {
+        (void)offset;
+        project = projectData;
+        return true;
+    }
+
+    bool handleTmMsg(const BlogMsg& msg)
+    {
+        records.push_back(Record{msg.time.rawValue(), msg.data});
+        return true;
+    }
+
+    std::string deviceName;
+    bmcl::Bytes project;
+    std::vector<Record> records;
+};
+
+BlogReplay::BlogReplay(caf::actor_config& cfg, const std::string& path, const caf::actor& dest, const caf::actor& handler, double speed)
+    : caf::event_based_actor(cfg)
+    , _path(path)
+    , _dest(dest)
+    , _handler(handler)
+    , _begin(0)
+    , _current(0)
+    , _end(0)
+    , _inFlight(0)
+    , _sentMsgs(0)
+    , _stepId(0)
+    , _baseTime(0)
+    , _speed(speed)
+    , _counter(0)
+    , _isLoaded(false)
+    , _isRunning(false)
+    , _isStepScheduled(false)
+{
+}
+
+BlogReplay::~BlogReplay()
+{
+}
+
+const char* BlogReplay::name() const
+{
+    return "BlogReplay";
+}
+
+void BlogReplay::on_exit()
+{
+    destroy(_dest);
+    destroy(_handler);
+}
+
+void BlogReplay::logMsg(std::string&& msg)
+{
+    send(_handler, LogAtom::value, std::move(msg));
+}
+
+void BlogReplay::reportError(std::string&& msg)
+{
+    send(_handler, ExchangeErrorEventAtom::value, std::move(msg));
+}
+
+caf::behavior BlogReplay::make_behavior()
+{
+    return caf::behavior{
+        [this](StartAtom) {
+            start();
+        },
+        [this](StopAtom) {
+            stop();
+        },
+        [this](SetReplaySpeedAtom, double speed) {
+            setSpeed(speed);
+        },
+        [this](SeekReplayAtom, uint64_t from, uint64_t to) {
+            seek(from, to);
+        },
+        [this](ReplayStepAtom, uint64_t stepId) {
+            if (stepId != _stepId) {
+                return;
+            }
+            _isStepScheduled = false;
+            pump();
+        },
+    };
+}
+
+bool BlogReplay::load()
+{
+    if (_isLoaded) {
+        return true;
+    }
+
+    auto fileRv = bmcl::readFileIntoBuffer(_path.c_str());
+    if (fileRv.isErr()) {
+        reportError("failed to read blog file " + _path);
+        return false;
+    }
+    const bmcl::Buffer& file = fileRv.unwrap();
+    bmcl::Bytes data(file.data(), file.size());
+    if (isBlockFile(data)) {
+        BlockStats stats;
+        _data = decodeBlocks(data, &stats);
+        if (stats.brokenNum != 0) {
+            logMsg("blog contains " + std::to_string(stats.brokenNum) + " broken blocks");
+        }
+    } else {
+        _data.assign(data.begin(), data.end());
+    }
+
+    ReplayCollector blog;
+    if (!blog.parse(bmcl::Bytes(_data.data(), _data.size())) || blog.project.size() == 0) {
+        reportError("failed to parse blog file " + _path);
+        return false;
+    }
+
+    Rc<decode::Diagnostics> diag = new decode::Diagnostics;
+    auto project = decode::Project::decodeFromMemory(diag.get(), blog.project.data(), blog.project.size());
+    if (project.isErr()) {
+        reportError("failed to decode project embedded in blog");
+        return false;
+    }
+    ProjectHash hash = ProjectUpdate::calculateHash(blog.project);
+    auto update = ProjectUpdate::fromProjectAndName(project.unwrap().get(), blog.deviceName, hash);
+    if (update.isErr()) {
+        reportError(update.takeErr());
+        return false;
+    }
+    _project = update.unwrap();
+
+    _records.reserve(blog.records.size());
+    for (const ReplayCollector::Record& record : blog.records) {
+        _records.push_back(Record{record.time, std::size_t(record.data.data() - _data.data()), record.data.size()});
+    }
+    _begin = 0;
+    _current = 0;
+    _end = _records.size();
+    _isLoaded = true;
+
+    send(_dest, SetProjectAtom::value, _project);
+    logMsg("loaded blog with " + std::to_string(_records.size()) + " tm messages");
+    return true;
+}
+
+// records are expected to be ordered by onboard time
+void BlogReplay::seek(uint64_t from, uint64_t to)
+{
+    if (!load()) {
+        quit(caf::exit_reason::user_shutdown);
+        return;
+    }
+    auto cmp = [](const Record& record, uint64_t time) {
+        return record.time < time;
+    };
+    _begin = std::lower_bound(_records.begin(), _records.end(), from, cmp) - _records.begin();
+    _end = std::upper_bound(_records.begin(), _records.end(), to, [](uint64_t time, const Record& record) {
+        return time < record.time;
+    }) - _records.begin();
+    _end = std::max(_begin, _end);
+    _current = _begin;
+    rebase();
+}
+
+void BlogReplay::start()
+{
+    if (_isRunning) {
+        return;
+    }
+    if (!load()) {
+        quit(caf::exit_reason::user_shutdown);
+        return;
+    }
+    if (_current == _end) {
+        _current = _begin;
+    }
+    if (_current == _begin) {
+        _sentMsgs = 0;
+        _startWallTime = Clock::now();
+    }
+    _isRunning = true;
+    rebase();
+}
+
+void BlogReplay::stop()
+{
+    _isRunning = false;
+    _stepId++;
+    _isStepScheduled = false;
+}
+
+void BlogReplay::setSpeed(double speed)
+{
+    _speed = std::max(0.0, speed);
+    rebase();
+}
+
+// restarts timing from next record, pending step is dropped
+void BlogReplay::rebase()
+{
+    _stepId++;
+    _isStepScheduled = false;
+    _baseTime = _current < _end ? _records[_current].time : 0;
+    _baseWallTime = Clock::now();
+    pump();
+}
+
+uint64_t BlogReplay::currentTime() const
+{
+    if (_speed <= 0) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    double passed = std::chrono::duration<double, std::milli>(Clock::now() - _baseWallTime).count();
+    return _baseTime + uint64_t(passed * _speed);
+}
+
+void BlogReplay::pump()
+{
+    if (!_isRunning) {
+        return;
+    }
+    sendUntil(currentTime());
+    if (_current == _end) {
+        if (_inFlight == 0) {
+            finish();
+        }
+        return;
+    }
+    if (_inFlight >= maxInFlight) {
+        // continued when dest answers
+        return;
+    }
+    scheduleStep();
+}
+
+void BlogReplay::scheduleStep()
+{
+    if (_isStepScheduled) {
+        return;
+    }
+    _isStepScheduled = true;
+    if (_speed <= 0) {
+        send(this, ReplayStepAtom::value, _stepId);
+        return;
+    }
+    uint64_t now = currentTime();
+    uint64_t next = _records[_current].time;
+    std::chrono::milliseconds delay(0);
+    if (next > now) {
+        delay = std::min(maxStepDelay, std::chrono::milliseconds(uint64_t((next - now) / _speed)));
+    }
+    delayed_send(this, delay, ReplayStepAtom::value, _stepId);
+}
+
+void BlogReplay::sendUntil(uint64_t time)
+{
+    while (_current < _end && _inFlight < maxInFlight && _records[_current].time <= time) {
+        uint64_t packetTime = _records[_current].time;
+        std::size_t first = _current;
+        std::size_t size = 0;
+        do {
+            size += _records[_current].size;
+            _current++;
+        } while (_current < _end && _records[_current].time == packetTime && (size + _records[_current].size) <= maxPacketSize);
+
+        bmcl::SharedBytes packet = bmcl::SharedBytes::create(size);
+        uint8_t* dest = packet.data();
+        for (std::size_t i = first; i < _current; i++) {
+            const Record& record = _records[i];
+            std::memcpy(dest, _data.data() + record.offset, record.size);
+            dest += record.size;
+        }
+
+        PacketHeader header;
+        header.tickTime = OnboardTime(packetTime);
+        header.srcAddress = 0;
+        header.destAddress = 0;
+        header.counter = _counter++;
+        header.streamDirection = StreamDirection::Downlink;
+        header.packetType = PacketType::Unreliable;
+        header.streamType = StreamType::Telem;
+
+        _sentMsgs += _current - first;
+        _inFlight++;
+        request(_dest, caf::infinite, RecvPacketPayloadAtom::value, header, packet).then([this]() {
+            _inFlight--;
+            pump();
+        });
+    }
+}
+
+void BlogReplay::finish()
+{
+    _isRunning = false;
+    _stepId++;
+    _isStepScheduled = false;
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - _startWallTime).count();
+    logMsg("blog replay finished: " + std::to_string(_sentMsgs) + " tm messages in " + std::to_string(duration) + " us");
+    send(_handler, ReplayFinishedEventAtom::value, _sentMsgs, uint64_t(duration));
+}
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "photon/Config.hpp"
+#include "photon/core/Rc.h"
+
+#include <bmcl/Fwd.h>
+
+#include <caf/event_based_actor.hpp>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace photon {
+
+class ProjectUpdate;
+
+// Replays telemetry recorded by onboard blog module into a tm pipeline.
+// Dest is any actor accepting SetProjectAtom and RecvPacketPayloadAtom (TmState, Exchange or GroundControl),
+// embedded project is sent to dest before first packet. Records with the same onboard time are merged
+// into one tm packet.
+//
+// Speed is a multiplier of onboard time, 0 replays as fast as dest accepts packets. Replay is started
+// with StartAtom, paused with StopAtom, SetReplaySpeedAtom changes speed, SeekReplayAtom limits replay to
+// [from, to] onboard time range. At most a few packets are left unanswered by dest, so with TmState or fused
+// GroundControl as dest max speed replay measures decoding throughput. ReplayFinishedEventAtom with number
+// of sent messages and wall time in microseconds is sent to handler when range end is reached.
+// Actor quits if the blog can't be loaded.
+class BlogReplay : public caf::event_based_actor {
+public:
+    BlogReplay(caf::actor_config& cfg, const std::string& path, const caf::actor& dest, const caf::actor& handler, double speed = 1);
+    ~BlogReplay();
+
+    caf::behavior make_behavior() override;
+    const char* name() const override;
+    void on_exit() override;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Record {
+        uint64_t time;
+        std::size_t offset;
+        std::size_t size;
+    };
+
+    bool load();
+    void seek(uint64_t from, uint64_t to);
+    void start();
+    void stop();
+    void setSpeed(double speed);
+    void rebase();
+    void pump();
+    void scheduleStep();
+    void sendUntil(uint64_t time);
+    void finish();
+    uint64_t currentTime() const;
+    void reportError(std::string&& msg);
+    void logMsg(std::string&& msg);
+
+    std::string _path;
+    caf::actor _dest;
+    caf::actor _handler;
+    std::vector<uint8_t> _data;
+    Rc<const ProjectUpdate> _project;
+    std::vector<Record> _records;
+    std::size_t _begin;
+    std::size_t _current;
+    std::size_t _end;
+    std::size_t _inFlight;
+    uint64_t _sentMsgs;
+    uint64_t _stepId;
+    uint64_t _baseTime;
+    Clock::time_point _baseWallTime;
+    Clock::time_point _startWallTime;
+    double _speed;
+    uint16_t _counter;
+    bool _isLoaded;
+    bool _isRunning;
+    bool _isStepScheduled;
+};
+}
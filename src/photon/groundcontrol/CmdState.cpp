@@ -1,6 +1,7 @@
 #include "photon/groundcontrol/CmdState.h"
 #include "photon/groundcontrol/Atoms.h"
 #include "photon/groundcontrol/AllowUnsafeMessageType.h"
+#include "decode/core/Try.h"
 #include "decode/ast/Type.h"
 #include "decode/ast/Ast.h"
 #include "decode/ast/Component.h"
@@ -20,6 +21,7 @@
 #include "photon/groundcontrol/GcCmd.h"
 #include "photon/groundcontrol/TmParamUpdate.h"
 #include "photon/groundcontrol/ProjectUpdate.h"
+#include "photon/groundcontrol/Crc.h"
 
 #include <bmcl/Logging.h>
 #include <bmcl/Buffer.h>
@@ -27,6 +29,8 @@
 
 #include <caf/sec.hpp>
 
+#include <algorithm>
+
 DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(bmcl::SharedBytes);
 DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(photon::TmParamUpdate);
 DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(photon::PacketRequest);
@@ -62,6 +66,63 @@ static CmdState::EncodeResult encodePacket(CmdState::EncodeHandler handler)
     return PacketRequest(writer.writenData(), StreamType::Cmd);
 }
 
+// cmd packet payload limit, leaves room for exchange headers in max onboard packet (1024 bytes)
+constexpr const std::size_t maxCmdPacketSize = 768;
+
+// Packs several commands into cmd stream packets, onboard executes commands of one packet in order
+// and concatenates their results. Packet size is kept below exchange limit.
+class CmdPacketBatcher {
+public:
+    explicit CmdPacketBatcher(std::size_t maxPacketSize = maxCmdPacketSize)
+        : _maxPacketSize(maxPacketSize)
+        , _currentCmdNum(0)
+    {
+    }
+
+    bool append(const CmdState::EncodeHandler& handler)
+    {
+        uint8_t tmp[1024];
+        Encoder writer(tmp, sizeof(tmp));
+        if (!handler(&writer)) {
+            return false;
+        }
+        bmcl::Bytes cmd = writer.writenData();
+        if (cmd.size() > _maxPacketSize) {
+            return false;
+        }
+        if ((_current.size() + cmd.size()) > _maxPacketSize) {
+            flush();
+        }
+        _current.insert(_current.end(), cmd.begin(), cmd.end());
+        _currentCmdNum++;
+        return true;
+    }
+
+    void flush()
+    {
+        if (_currentCmdNum == 0) {
+            return;
+        }
+        _packets.emplace_back(bmcl::Bytes(_current.data(), _current.size()), StreamType::Cmd);
+        _current.clear();
+        _currentCmdNum = 0;
+    }
+
+    std::vector<PacketRequest>& packets()
+    {
+        return _packets;
+    }
+
+private:
+    std::size_t _maxPacketSize;
+    std::vector<uint8_t> _current;
+    std::size_t _currentCmdNum;
+    std::vector<PacketRequest> _packets;
+};
+
+// number of cmd packets queued in exchange at the same time
+constexpr const std::size_t cmdPacketWindow = 4;
+
 struct RouteUploadState {
     RouteUploadState()
         : currentIndex(0)
@@ -77,13 +138,8 @@ struct RouteUploadState {
     std::size_t routeIndex;
 };
 
-using SendNextPointCmdAtom          = caf::atom_constant<caf::atom("sendnxtp")>;
 using SendStartRouteCmdAtom         = caf::atom_constant<caf::atom("sendstrt")>;
-using SendClearRouteCmdAtom         = caf::atom_constant<caf::atom("sendclrt")>;
 using SendEndRouteCmdAtom           = caf::atom_constant<caf::atom("sendenrt")>;
-using SendSetPointActiveCmdAtom     = caf::atom_constant<caf::atom("sendspac")>;
-using SendSetRouteInvertedCmdAtom   = caf::atom_constant<caf::atom("sendsrti")>;
-using SendSetRouteClosedCmdAtom     = caf::atom_constant<caf::atom("sendsrtc")>;
 
 template <typename T>
 class GcActorBase : public caf::event_based_actor {
@@ -123,19 +179,32 @@ protected:
     {
         auto rv = encodePacket(std::bind(encode, actor, std::placeholders::_1));
         if (rv.isErr()) {
-            BMCL_CRITICAL() << "error encoding packet";
-            _promise.deliver(caf::sec::invalid_argument);
-            quit();
+            deliverError("error encoding packet");
             return;
         }
-        request(_exchange, caf::infinite, SendReliablePacketAtom::value, rv.unwrap()).then([=](const PacketResponse& resp) {
+        sendPacket(rv.unwrap(), [=](const PacketResponse& resp) {
+            (actor->*next)(resp);
+        });
+    }
+
+    // exchange queues reliable packets, so several packets can be sent without waiting for receipts,
+    // handlers are called in the same order packets were sent
+    void sendPacket(const PacketRequest& req, std::function<void(const PacketResponse&)>&& next)
+    {
+        sendPacket(req, std::move(next), [this](const PacketResponse&) {
+            deliverError("could not deliver packet");
+        });
+    }
+
+    void sendPacket(const PacketRequest& req, std::function<void(const PacketResponse&)>&& next,
+                    std::function<void(const PacketResponse&)>&& onError)
+    {
+        request(_exchange, caf::infinite, SendReliablePacketAtom::value, req).then([=](const PacketResponse& resp) {
             if (resp.type == ReceiptType::Ok) {
-                (actor->*next)(resp);
+                next(resp);
                 return;
             }
-            BMCL_CRITICAL() << "could not deliver packet";
-            _promise.deliver(caf::sec::invalid_argument);
-            quit();
+            onError(resp);
         },
         [=](const caf::error& err) {
             BMCL_CRITICAL() << err.code();
@@ -144,6 +213,13 @@ protected:
         });
     }
 
+    void deliverError(const char* msg)
+    {
+        BMCL_CRITICAL() << msg;
+        _promise.deliver(caf::sec::invalid_argument);
+        quit();
+    }
+
     std::string _name;
     caf::actor _exchange;
     Rc<const T> _iface;
@@ -161,74 +237,80 @@ public:
                      UploadRouteGcCmd&& route)
         : NavActorBase(cfg, exchange, iface, promise, "RouteUploadActor")
         , _route(std::move(route))
-        , _currentIndex(0)
-    {
-    }
-
-    bool encodeRoutePoint(Encoder* dest) const
+        , _nextPacket(0)
+        , _packetsInFlight(0)
     {
-        return _iface->encodeSetRoutePointCmd(_route.id, _currentIndex, _route.waypoints[_currentIndex], dest);
     }
 
-    bool encodeBeginRoute(Encoder* dest) const
+    // beginRoute and all points are packed into as few packets as possible, route checksum
+    // is requested with the last point
+    bool encodeRoutePackets()
     {
-        return _iface->encodeBeginRouteCmd(_route.id, _route.waypoints.size(), dest);
-    }
-
-    bool encodeClearRoute(Encoder* dest) const
-    {
-        return _iface->encodeClearRouteCmd(_route.id, dest);
+        CmdPacketBatcher batcher;
+        TRY(batcher.append([this](Encoder* dest) {
+            return _iface->encodeBeginRouteCmd(_route.id, _route.waypoints.size(), dest);
+        }));
+        for (std::size_t i = 0; i < _route.waypoints.size(); i++) {
+            TRY(batcher.append([this, i](Encoder* dest) {
+                return _iface->encodeSetRoutePointCmd(_route.id, i, _route.waypoints[i], dest);
+            }));
+        }
+        if (_iface->hasRouteChecksumCmd()) {
+            TRY(batcher.append([this](Encoder* dest) {
+                return _iface->encodeGetRouteChecksumCmd(_route.id, dest);
+            }));
+        }
+        batcher.flush();
+        _packets = std::move(batcher.packets());
+        return true;
     }
 
     bool encodeEndRoute(Encoder* dest) const
     {
-        return _iface->encodeEndRouteCmd(_route.id, dest);
-    }
-
-    void sendFirstPoint(const PacketResponse&)
-    {
-        send(this, SendNextPointCmdAtom::value);
-    }
-
-    void sendClearRoute(const PacketResponse&)
-    {
-        send(this, SendClearRouteCmdAtom::value);
-    }
-
-    void sendNextPoint(const PacketResponse&)
-    {
-        _currentIndex++;
-        send(this, SendNextPointCmdAtom::value);
-    }
-
-    void sendSetActivePoint(const PacketResponse&)
-    {
-        send(this, SendSetPointActiveCmdAtom::value);
-    }
-
-    void sendSetRouteClosed(const PacketResponse&)
-    {
-        send(this, SendSetRouteClosedCmdAtom::value);
-    }
-
-    void sendSetRouteInverted(const PacketResponse&)
-    {
-        send(this, SendSetRouteInvertedCmdAtom::value);
-    }
-
-    bool encodeSetActivePoint(Encoder* dest) const
-    {
-        return _iface->encodeSetRouteActivePointCmd(_route.id, _route.activePoint, dest);
+        TRY(_iface->encodeEndRouteCmd(_route.id, dest));
+        TRY(_iface->encodeSetRouteActivePointCmd(_route.id, _route.activePoint, dest));
+        TRY(_iface->encodeSetRouteClosedCmd(_route.id, _route.isClosed, dest));
+        return _iface->encodeSetRouteInvertedCmd(_route.id, _route.isInverted, dest);
     }
 
-    bool encodeSetRouteClosed(Encoder* dest) const
+    void sendRoutePackets()
     {
-        return _iface->encodeSetRouteClosedCmd(_route.id, _route.isClosed, dest);
+        while (_packetsInFlight < cmdPacketWindow && _nextPacket < _packets.size()) {
+            bool isLast = _nextPacket == (_packets.size() - 1);
+            _packetsInFlight++;
+            sendPacket(_packets[_nextPacket], [this, isLast](const PacketResponse& resp) {
+                _packetsInFlight--;
+                if (isLast) {
+                    checkRoute(resp);
+                    return;
+                }
+                sendRoutePackets();
+            });
+            _nextPacket++;
+        }
     }
 
-    bool encodeSetRouteInverted(Encoder* dest) const
+    void checkRoute(const PacketResponse& resp)
     {
-        return _iface->encodeSetRouteInvertedCmd(_route.id, _route.isInverted, dest);
+        if (_iface->hasRouteChecksumCmd()) {
+            // only getRouteChecksum returns a value
+            Decoder dec(resp.payload.view());
+            uint16_t onboardChecksum;
+            uint16_t checksum;
+            if (!_iface->decodeGetRouteChecksumResponse(&dec, &onboardChecksum)) {
+                deliverError("could not decode route checksum");
+                return;
+            }
+            if (!_iface->calculateRouteChecksum(_route.waypoints, &checksum)) {
+                deliverError("could not calculate route checksum");
+                return;
+            }
+            if (checksum != onboardChecksum) {
+                deliverError("uploaded route checksum mismatch");
+                return;
+            }
+        }
+        send(this, SendEndRouteCmdAtom::value);
     }
 
     void endUpload(const PacketResponse&)
@@ -241,34 +323,24 @@ public:
     {
         send(this, SendStartRouteCmdAtom::value);
         return caf::behavior{
-            [this](SendNextPointCmdAtom) {
-                if (_currentIndex >= _route.waypoints.size()) {
-                    send(this, SendEndRouteCmdAtom::value);
+            [this](SendStartRouteCmdAtom) {
+                if (!encodeRoutePackets()) {
+                    deliverError("error encoding route");
                     return;
                 }
-                action(this, &RouteUploadActor::encodeRoutePoint, &RouteUploadActor::sendNextPoint);
-            },
-            [this](SendStartRouteCmdAtom) {
-                action(this, &RouteUploadActor::encodeBeginRoute, &RouteUploadActor::sendFirstPoint);
+                sendRoutePackets();
             },
             [this](SendEndRouteCmdAtom) {
-                action(this, &RouteUploadActor::encodeEndRoute, &RouteUploadActor::sendSetActivePoint);
-            },
-            [this](SendSetPointActiveCmdAtom) {
-                action(this, &RouteUploadActor::encodeSetActivePoint, &RouteUploadActor::sendSetRouteClosed);
-            },
-            [this](SendSetRouteClosedCmdAtom) {
-                action(this, &RouteUploadActor::encodeSetRouteClosed, &RouteUploadActor::sendSetRouteInverted);
-            },
-            [this](SendSetRouteInvertedCmdAtom) {
-                action(this, &RouteUploadActor::encodeSetRouteInverted, &RouteUploadActor::endUpload);
+                action(this, &RouteUploadActor::encodeEndRoute, &RouteUploadActor::endUpload);
             },
         };
     }
 
 private:
     UploadRouteGcCmd _route;
-    std::size_t _currentIndex;
+    std::vector<PacketRequest> _packets;
+    std::size_t _nextPacket;
+    std::size_t _packetsInFlight;
 };
 
 template <typename T>
@@ -452,6 +524,7 @@ private:
 
 using SendGetInfoAtom       = caf::atom_constant<caf::atom("sendgein")>;
 using SendGetNextPointAtom  = caf::atom_constant<caf::atom("sendgenp")>;
+using SendGetChecksumAtom   = caf::atom_constant<caf::atom("sendgecs")>;
 
 class DownloadRouteActor : public NavActorBase {
 public:
@@ -462,7 +535,9 @@ public:
                        DownloadRouteGcCmd&& cmd,
                        caf::actor handler)
         : NavActorBase(cfg, exchange, iface, promise, "DownloadRouteActor")
-        , _currentIndex(0)
+        , _nextIndex(0)
+        , _pointsPerPacket(maxPointsPerPacket)
+        , _packetsInFlight(0)
         , _handler(handler)
     {
         _route.id = cmd.id;
@@ -473,32 +548,112 @@ public:
         return _iface->encodeGetRouteInfoCmd(_route.id, dest);
     }
 
-    bool encodeGetRoutePoint(Encoder* dest) const
+    bool encodeGetChecksum(Encoder* dest) const
     {
-        return _iface->encodeGetRoutePointCmd(_route.id, _currentIndex, dest);
+        return _iface->encodeGetRouteChecksumCmd(_route.id, dest);
     }
 
-    void unpackInfoAndSendGetPoint(const PacketResponse& resp)
+    void unpackInfoAndSendGetPoints(const PacketResponse& resp)
     {
         Decoder dec(resp.payload.view());
         if (!_iface->decodeGetRouteInfoResponse(&dec, &_route.route.info)) {
-            _promise.deliver(caf::sec::invalid_argument);
+            deliverError("could not decode route info");
+            return;
+        }
+        if (_route.route.info.size > _route.route.info.maxSize) {
+            deliverError("invalid route size");
             return;
         }
+        _route.route.waypoints.resize(_route.route.info.size);
         send(this, SendGetNextPointAtom::value);
     }
 
-    void unpackPointAndSendGetPoint(const PacketResponse& resp)
+    // results of all getRoutePoint commands in packet must fit into onboard cmd result buffer,
+    // waypoint size is not fixed so number of points per packet is halved on error
+    void sendGetPoints()
+    {
+        while (_packetsInFlight < cmdPacketWindow) {
+            std::size_t start;
+            std::size_t count;
+            if (!_retries.empty()) {
+                start = _retries.back().first;
+                count = _retries.back().second;
+                _retries.pop_back();
+            } else if (_nextIndex < _route.route.waypoints.size()) {
+                start = _nextIndex;
+                count = std::min(_pointsPerPacket, _route.route.waypoints.size() - _nextIndex);
+                _nextIndex += count;
+            } else {
+                break;
+            }
+
+            CmdPacketBatcher batcher;
+            for (std::size_t i = start; i < (start + count); i++) {
+                if (!batcher.append([this, i](Encoder* dest) { return _iface->encodeGetRoutePointCmd(_route.id, i, dest); })) {
+                    deliverError("error encoding packet");
+                    return;
+                }
+            }
+            batcher.flush();
+            if (batcher.packets().size() != 1) {
+                deliverError("error encoding packet");
+                return;
+            }
+
+            _packetsInFlight++;
+            sendPacket(batcher.packets()[0], [this, start, count](const PacketResponse& resp) {
+                _packetsInFlight--;
+                unpackPoints(resp, start, count);
+            },
+            [this, start, count](const PacketResponse&) {
+                _packetsInFlight--;
+                if (count == 1) {
+                    deliverError("could not download route point");
+                    return;
+                }
+                std::size_t half = count / 2;
+                _pointsPerPacket = std::min(_pointsPerPacket, half);
+                _retries.emplace_back(start + half, count - half);
+                _retries.emplace_back(start, half);
+                sendGetPoints();
+            });
+        }
+
+        if (_packetsInFlight == 0) {
+            send(this, SendGetChecksumAtom::value);
+        }
+    }
+
+    void unpackPoints(const PacketResponse& resp, std::size_t start, std::size_t count)
     {
         Decoder dec(resp.payload.view());
-        Waypoint point;
-        if (!_iface->decodeGetRoutePointResponse(&dec, &point)) {
-            _promise.deliver(caf::sec::invalid_argument);
+        for (std::size_t i = start; i < (start + count); i++) {
+            if (!_iface->decodeGetRoutePointResponse(&dec, &_route.route.waypoints[i])) {
+                deliverError("could not decode route point");
+                return;
+            }
+        }
+        sendGetPoints();
+    }
+
+    void checkChecksum(const PacketResponse& resp)
+    {
+        Decoder dec(resp.payload.view());
+        uint16_t onboardChecksum;
+        uint16_t checksum;
+        if (!_iface->decodeGetRouteChecksumResponse(&dec, &onboardChecksum)) {
+            deliverError("could not decode route checksum");
             return;
         }
-        _route.route.waypoints.push_back(point);
-        _currentIndex++;
-        send(this, SendGetNextPointAtom::value);
+        if (!_iface->calculateRouteChecksum(_route.route.waypoints, &checksum)) {
+            deliverError("could not calculate route checksum");
+            return;
+        }
+        if (checksum != onboardChecksum) {
+            deliverError("downloaded route checksum mismatch");
+            return;
+        }
+        endDownload();
     }
 
     void endDownload()
@@ -513,28 +668,40 @@ public:
         send(this, SendGetInfoAtom::value);
         return caf::behavior{
             [this](SendGetNextPointAtom) {
-                if (_currentIndex >= _route.route.info.size) {
+                sendGetPoints();
+            },
+            [this](SendGetChecksumAtom) {
+                if (!_iface->hasRouteChecksumCmd()) {
                     endDownload();
                     return;
                 }
-                action(this, &DownloadRouteActor::encodeGetRoutePoint, &DownloadRouteActor::unpackPointAndSendGetPoint);
+                action(this, &DownloadRouteActor::encodeGetChecksum, &DownloadRouteActor::checkChecksum);
             },
             [this](SendGetInfoAtom) {
-                action(this, &DownloadRouteActor::encodeGetInfo, &DownloadRouteActor::unpackInfoAndSendGetPoint);
+                action(this, &DownloadRouteActor::encodeGetInfo, &DownloadRouteActor::unpackInfoAndSendGetPoints);
             },
         };
     }
 
 private:
+    static constexpr const std::size_t maxPointsPerPacket = 8;
+
     RouteTmParam _route;
-    std::size_t _currentIndex;
+    std::size_t _nextIndex;
+    std::size_t _pointsPerPacket;
+    std::size_t _packetsInFlight;
+    // point ranges to request again with smaller packets
+    std::vector<std::pair<std::size_t, std::size_t>> _retries;
     caf::actor _handler;
 };
 
-using SendBeginFileAtom     = caf::atom_constant<caf::atom("sendbef")>;
-using SendNextFileChunkAtom = caf::atom_constant<caf::atom("sendnfc")>;
-using SendEndFileAtom       = caf::atom_constant<caf::atom("sendenf")>;
+using SendGetFileProgressAtom = caf::atom_constant<caf::atom("sendgfp")>;
+using SendBeginFileAtom       = caf::atom_constant<caf::atom("sendbef")>;
+using SendNextFileChunkAtom   = caf::atom_constant<caf::atom("sendnfc")>;
+using SendEndFileAtom         = caf::atom_constant<caf::atom("sendenf")>;
 
+// File is split into chunks filling cmd packets, up to cmdPacketWindow chunks are queued at once.
+// Upload of the same file (same id, size and content hash) is resumed from onboard bitmap of received chunks.
 class UploadFileActor : public GcActorBase<FileGcInterface> {
 public:
     UploadFileActor(caf::actor_config& cfg,
@@ -543,35 +710,155 @@ public:
                     const caf::response_promise& promise,
                     UploadFileGcCmd&& cmd)
         : GcActorBase<FileGcInterface>(cfg, exchange, iface, promise, "UploadFileActor")
-        , _reader(cmd.reader)
+        , _reader(std::move(cmd.reader))
+        , _size(_reader->size())
         , _id(cmd.id)
+        , _chunkSize(0)
+        , _nextChunk(0)
+        , _chunksInFlight(0)
+    {
+    }
+
+    // largest chunk for which writeFile command fits into cmd packet
+    std::size_t calculateChunkSize() const
+    {
+        uint8_t tmp[64];
+        Encoder writer(tmp, sizeof(tmp));
+        // offset is less than size, chunk size prefix takes up to 2 more bytes
+        if (!_iface->encodeWriteFile(_id, _size, bmcl::Bytes(), &writer)) {
+            return 0;
+        }
+        std::size_t headerSize = writer.writenData().size() + 2;
+        return std::min<std::size_t>(_iface->maxFileChunkSize(), maxCmdPacketSize - headerSize);
+    }
+
+    bool encodeGetFileProgress(Encoder* dest) const
     {
+        return _iface->encodeGetFileProgress(dest);
     }
 
     bool encodeBeginFile(Encoder* dest) const
     {
-        return _iface->encodeBeginFile(_id, _reader->size(), dest);
+        return _iface->encodeBeginFile(_id, _size, calculateChunkSize(), dest);
     }
 
     bool encodeEndFile(Encoder* dest) const
     {
-        return _iface->encodeEndFile(_id, _reader->size(), dest);
+        return _iface->encodeEndFile(_id, _size, dest);
     }
 
-    bool encodeNextChunk(Encoder* dest) const
+    void resumeOrBeginFile(const PacketResponse& resp)
     {
-        std::size_t offset = _reader->offset();
-        bmcl::Bytes chunk = _reader->readNext(_iface->maxFileChunkSize());
-        return _iface->encodeWriteFile(_id, offset, chunk, dest);
+        Decoder dec(resp.payload.view());
+        FileProgress progress;
+        if (!_iface->decodeGetFileProgressResponse(&dec, &progress)) {
+            deliverError("could not decode file progress");
+            return;
+        }
+        // resumed upload of different file with the same id and size is detected by checksum after endFile
+        bool isSameFile = progress.isWriting && progress.id == _id && progress.size == _size;
+        if (!isSameFile || !setChunkSize(progress.chunkSize)) {
+            send(this, SendBeginFileAtom::value);
+            return;
+        }
+        std::size_t skipped = 0;
+        for (std::size_t i = 0; i < _received.size(); i++) {
+            std::size_t n = i - progress.firstChunk;
+            if (i < progress.firstChunk || ((n / 8) < progress.received.size() && (progress.received[n / 8] & (1 << (n % 8))))) {
+                _received[i] = true;
+                skipped++;
+            }
+        }
+        BMCL_DEBUG() << "resuming file upload, " << skipped << " of " << _received.size() << " chunks received";
+        send(this, SendNextFileChunkAtom::value);
     }
 
-    void sendNextChunk(const PacketResponse&)
+    void beginChunks(const PacketResponse& resp)
     {
+        Decoder dec(resp.payload.view());
+        uint64_t chunkSize;
+        if (!_iface->decodeBeginFileResponse(&dec, &chunkSize) || !setChunkSize(chunkSize)) {
+            deliverError("invalid file chunk size");
+            return;
+        }
         send(this, SendNextFileChunkAtom::value);
     }
 
-    void endUpload(const PacketResponse&)
+    // chunk size is selected onboard, it can be smaller than requested
+    bool setChunkSize(uint64_t chunkSize)
+    {
+        if (chunkSize == 0 || chunkSize > calculateChunkSize()) {
+            return false;
+        }
+        _chunkSize = chunkSize;
+        _received.assign((_size + _chunkSize - 1) / _chunkSize, false);
+        _nextChunk = 0;
+        return true;
+    }
+
+    // file is read sequentially, chunks received before resume are read only to update checksum
+    bool readChunk(std::size_t size)
+    {
+        _chunk.clear();
+        while (_chunk.size() < size && _reader->hasData()) {
+            bmcl::Bytes data = _reader->readNext(size - _chunk.size());
+            if (data.size() == 0) {
+                break;
+            }
+            _chunk.insert(_chunk.end(), data.begin(), data.end());
+        }
+        if (_chunk.size() != size) {
+            return false;
+        }
+        _checksum.update(_chunk.data(), _chunk.size());
+        return true;
+    }
+
+    void sendChunks()
+    {
+        while (_chunksInFlight < cmdPacketWindow && _nextChunk < _received.size()) {
+            std::size_t index = _nextChunk;
+            uint64_t offset = uint64_t(index) * _chunkSize;
+            if (!readChunk(std::min<uint64_t>(_chunkSize, _size - offset))) {
+                deliverError("unexpected end of file");
+                return;
+            }
+            _nextChunk++;
+            if (_received[index]) {
+                continue;
+            }
+            // sent packet keeps its own copy of chunk until it is acknowledged
+            auto rv = encodePacket([&](Encoder* dest) {
+                return _iface->encodeWriteFile(_id, offset, bmcl::Bytes(_chunk.data(), _chunk.size()), dest);
+            });
+            if (rv.isErr()) {
+                deliverError("error encoding packet");
+                return;
+            }
+            _chunksInFlight++;
+            sendPacket(rv.unwrap(), [this](const PacketResponse&) {
+                _chunksInFlight--;
+                sendChunks();
+            });
+        }
+        if (_chunksInFlight == 0 && _nextChunk >= _received.size()) {
+            send(this, SendEndFileAtom::value);
+        }
+    }
+
+    void endUpload(const PacketResponse& resp)
     {
+        Decoder dec(resp.payload.view());
+        uint32_t onboardChecksum;
+        if (!_iface->decodeEndFileResponse(&dec, &onboardChecksum)) {
+            deliverError("could not decode file checksum");
+            return;
+        }
+        // onboard returns crc16 of file
+        if (onboardChecksum != _checksum.get()) {
+            deliverError("uploaded file checksum mismatch");
+            return;
+        }
         _promise.deliver(caf::unit);
         quit();
     }
@@ -583,17 +870,20 @@ public:
 
     caf::behavior make_behavior() override
     {
-        send(this, SendBeginFileAtom::value);
+        if (_iface->hasFileProgressCmd()) {
+            send(this, SendGetFileProgressAtom::value);
+        } else {
+            send(this, SendBeginFileAtom::value);
+        }
         return caf::behavior{
+            [this](SendGetFileProgressAtom) {
+                action(this, &UploadFileActor::encodeGetFileProgress, &UploadFileActor::resumeOrBeginFile);
+            },
             [this](SendBeginFileAtom) {
-                action(this, &UploadFileActor::encodeBeginFile, &UploadFileActor::sendNextChunk);
+                action(this, &UploadFileActor::encodeBeginFile, &UploadFileActor::beginChunks);
             },
             [this](SendNextFileChunkAtom) {
-                if (_reader->hasData()) {
-                    action(this, &UploadFileActor::encodeNextChunk, &UploadFileActor::sendNextChunk);
-                    return;
-                }
-                send(this, SendEndFileAtom::value);
+                sendChunks();
             },
             [this](SendEndFileAtom) {
                 action(this, &UploadFileActor::encodeEndFile, &UploadFileActor::endUpload);
@@ -603,7 +893,15 @@ public:
 
 private:
     Rc<decode::DataReader> _reader;
+    uint64_t _size;
     std::uintmax_t _id;
+    std::size_t _chunkSize;
+    // chunks received onboard before upload was resumed
+    std::vector<bool> _received;
+    std::size_t _nextChunk;
+    std::size_t _chunksInFlight;
+    std::vector<uint8_t> _chunk;
+    Crc16 _checksum;
 };
 
 caf::behavior CmdState::make_behavior()
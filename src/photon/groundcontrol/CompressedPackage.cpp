@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "photon/groundcontrol/CompressedPackage.h"
+#include "photon/groundcontrol/Lz4.h"
+
+#include <bmcl/Bytes.h>
+
+#include <cstring>
+
+namespace photon {
+
+static const char magicPrefix[4] = {'p', 'k', 'z', '4'};
+constexpr std::size_t headerSize = 8;
+constexpr std::size_t blockHeaderSize = 4;
+// lz4 block can't expand more than 255 times, raw blocks are not expanded at all
+constexpr std::size_t maxCompressionRatio = 255;
+
+bool isCompressedPackage(bmcl::Bytes data)
+{
+    return data.size() >= headerSize && std::memcmp(magicPrefix, data.data(), sizeof(magicPrefix)) == 0;
+}
+
+bool decompressPackage(bmcl::Bytes package, std::vector<uint8_t>* dest)
+{
+    if (!isCompressedPackage(package)) {
+        return false;
+    }
+    const uint8_t* current = package.data() + sizeof(magicPrefix);
+    const uint8_t* end = package.data() + package.size();
+    std::size_t rawSize = current[0] | (std::size_t(current[1]) << 8) | (std::size_t(current[2]) << 16) | (std::size_t(current[3]) << 24);
+    current += 4;
+    if (rawSize > (package.size() - headerSize) * maxCompressionRatio) {
+        // malformed size, don't reserve memory for it
+        return false;
+    }
+
+    dest->clear();
+    dest->reserve(rawSize);
+    while (current != end) {
+        if (std::size_t(end - current) < blockHeaderSize) {
+            return false;
+        }
+        std::size_t blockRawSize = current[0] | (std::size_t(current[1]) << 8);
+        std::size_t storedSize = current[2] | (std::size_t(current[3]) << 8);
+        current += blockHeaderSize;
+        if (std::size_t(end - current) < storedSize || storedSize > blockRawSize) {
+            return false;
+        }
+        if (dest->size() + blockRawSize > rawSize) {
+            return false;
+        }
+        if (storedSize == blockRawSize) {
+            dest->insert(dest->end(), current, current + storedSize);
+        } else if (!decompressLz4(bmcl::Bytes(current, storedSize), dest, blockRawSize)) {
+            return false;
+        }
+        current += storedSize;
+    }
+    return dest->size() == rawSize;
+}
+}
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "photon/Config.hpp"
+
+#include <bmcl/Fwd.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace photon {
+
+// Project package compressed at build time by tools/PackageCompress.c, served by fwt module
+// and embedded in blog files instead of raw package if PHOTON_CFG_FWT_PACKAGE_LZ4 is enabled.
+//
+// package: ["pkz4"][u32le rawSize][blocks]
+// block: [u16le rawSize][u16le storedSize][stored data], data is lz4 block or raw data if sizes are equal
+bool isCompressedPackage(bmcl::Bytes data);
+
+// package hash is not checked, returns false if package is malformed
+bool decompressPackage(bmcl::Bytes package, std::vector<uint8_t>* dest);
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "photon/groundcontrol/DeviceRouter.h"
+#include "photon/groundcontrol/GroundControl.h"
+#include "photon/groundcontrol/Atoms.h"
+#include "photon/groundcontrol/AllowUnsafeMessageType.h"
+
+#include <bmcl/Bytes.h>
+#include <bmcl/Option.h>
+#include <bmcl/SharedBytes.h>
+
+#include <caf/actor_system_config.hpp>
+
+DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(bmcl::SharedBytes);
+
+#define ROUTER_LOG(msg)      \
+    if (_isLoggingEnabled) { \
+        logMsg(msg);         \
+    }
+
+namespace photon {
+
+DeviceRouter::DeviceRouter(caf::actor_config& cfg, uint64_t selfAddress, const caf::actor& sink,
+                           const caf::actor& defaultHandler, PipelineMode mode)
+    : caf::event_based_actor(cfg)
+    , _sink(sink)
+    , _handler(defaultHandler)
+    , _selfAddress(selfAddress)
+    , _droppedPackets(0)
+    , _mode(mode)
+    , _isRunning(false)
+    , _isLoggingEnabled(false)
+{
+    set_down_handler([this](caf::down_msg& dm) {
+        removeDevice(dm.source);
+    });
+}
+
+DeviceRouter::~DeviceRouter()
+{
+}
+
+void DeviceRouter::configureWorkers(caf::actor_system_config* cfg, std::size_t workerNum)
+{
+    cfg->scheduler_max_threads = workerNum;
+}
+
+void DeviceRouter::logMsg(std::string&& msg)
+{
+    send(_handler, LogAtom::value, std::move(msg));
+}
+
+template <typename... A>
+void DeviceRouter::sendAllDevices(A&&... args)
+{
+    for (auto& it : _devices) {
+        send(it.second.gc, std::forward<A>(args)...);
+    }
+}
+
+caf::behavior DeviceRouter::make_behavior()
+{
+    return caf::behavior{
+        [this](RecvDataAtom, const bmcl::SharedBytes& data) {
+            acceptData(data);
+        },
+        [this](AddDeviceAtom, uint64_t address, const caf::actor& handler) {
+            return addDevice(address, handler);
+        },
+        [this](RemoveDeviceAtom, uint64_t address) {
+            removeDevice(address);
+        },
+        [this](GetDeviceAtom, uint64_t address) {
+            auto it = _devices.find(address);
+            if (it == _devices.end()) {
+                return caf::actor();
+            }
+            return it->second.gc;
+        },
+        [this](StartAtom) {
+            _isRunning = true;
+            sendAllDevices(StartAtom::value);
+        },
+        [this](StopAtom) {
+            _isRunning = false;
+            sendAllDevices(StopAtom::value);
+        },
+        [this](EnableLoggindAtom, bool isEnabled) {
+            _isLoggingEnabled = isEnabled;
+            sendAllDevices(EnableLoggindAtom::value, isEnabled);
+        },
+    };
+}
+
+const char* DeviceRouter::name() const
+{
+    return "DeviceRouter";
+}
+
+void DeviceRouter::on_exit()
+{
+    for (auto& it : _devices) {
+        send_exit(it.second.gc, caf::exit_reason::user_shutdown);
+    }
+    _devices.clear();
+    destroy(_sink);
+    destroy(_handler);
+}
+
+caf::actor DeviceRouter::addDevice(uint64_t address, const caf::actor& handler)
+{
+    auto it = _devices.find(address);
+    if (it != _devices.end()) {
+        return it->second.gc;
+    }
+    ROUTER_LOG("router adding device " + std::to_string(address));
+    caf::actor gc = spawn<GroundControl, caf::monitored>(_selfAddress, address, _sink, handler, _mode);
+    if (_isRunning) {
+        send(gc, StartAtom::value);
+    }
+    if (_isLoggingEnabled) {
+        send(gc, EnableLoggindAtom::value, true);
+    }
+    _devices.emplace(address, DeviceState{gc, 0});
+    return gc;
+}
+
+void DeviceRouter::removeDevice(uint64_t address)
+{
+    auto it = _devices.find(address);
+    if (it == _devices.end()) {
+        return;
+    }
+    ROUTER_LOG("router removing device " + std::to_string(address));
+    demonitor(it->second.gc);
+    send_exit(it->second.gc, caf::exit_reason::user_shutdown);
+    _devices.erase(it);
+}
+
+void DeviceRouter::removeDevice(const caf::actor_addr& addr)
+{
+    for (auto it = _devices.begin(); it != _devices.end(); it++) {
+        if (it->second.gc.address() == addr) {
+            ROUTER_LOG("router device " + std::to_string(it->first) + " exited");
+            _devices.erase(it);
+            return;
+        }
+    }
+}
+
+void DeviceRouter::acceptData(const bmcl::SharedBytes& data)
+{
+    _incoming.write(data.data(), data.size());
+    if (!_isRunning) {
+        return;
+    }
+
+    while (_incoming.size() != 0) {
+        SearchResult rv = GroundControl::findPacket(_incoming);
+        if (rv.dataSize == 0) {
+            if (rv.junkSize) {
+                _incoming.removeFront(rv.junkSize);
+            }
+            return;
+        }
+        routePacket(_incoming.asBytes().slice(rv.junkSize, rv.junkSize + rv.dataSize));
+        _incoming.removeFront(rv.junkSize + rv.dataSize);
+    }
+}
+
+void DeviceRouter::routePacket(bmcl::Bytes packet)
+{
+    bmcl::Option<PacketAddress> addr = GroundControl::extractPacketAddress(packet);
+    if (addr.isNone()) {
+        _droppedPackets++;
+        ROUTER_LOG("router recieved packet without address");
+        return;
+    }
+    if (addr->destAddress != _selfAddress) {
+        _droppedPackets++;
+        return;
+    }
+
+    auto it = _devices.find(addr->srcAddress);
+    if (it == _devices.end()) {
+        if (!_handler) {
+            _droppedPackets++;
+            ROUTER_LOG("router recieved packet from unknown device " + std::to_string(addr->srcAddress));
+            return;
+        }
+        addDevice(addr->srcAddress, _handler);
+        it = _devices.find(addr->srcAddress);
+    }
+
+    it->second.recievedPackets++;
+    send(it->second.gc, RecvPacketAtom::value, bmcl::SharedBytes::create(packet));
+}
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "photon/Config.hpp"
+#include "photon/groundcontrol/Packet.h"
+
+#include <bmcl/Fwd.h>
+#include <bmcl/Buffer.h>
+
+#include <caf/event_based_actor.hpp>
+
+#include <unordered_map>
+
+namespace caf {
+class actor_system_config;
+}
+
+namespace photon {
+
+// Splits one link carrying several devices into per device GroundControl pipelines.
+// Every device gets its own actor, so packets of one device are processed in order
+// and a slow device never delays others. Device actors run on the actor system scheduler,
+// its thread count is the worker pool size (see configureWorkers).
+class DeviceRouter : public caf::event_based_actor {
+public:
+    // if defaultHandler is valid devices are registered automatically on first recieved packet
+    DeviceRouter(caf::actor_config& cfg, uint64_t selfAddress, const caf::actor& sink,
+                 const caf::actor& defaultHandler, PipelineMode mode = PipelineMode::Actors);
+    ~DeviceRouter();
+
+    caf::behavior make_behavior() override;
+    const char* name() const override;
+    void on_exit() override;
+
+    static void configureWorkers(caf::actor_system_config* cfg, std::size_t workerNum);
+
+private:
+    struct DeviceState {
+        caf::actor gc;
+        uint64_t recievedPackets;
+    };
+
+    void acceptData(const bmcl::SharedBytes& data);
+    void routePacket(bmcl::Bytes packet);
+    caf::actor addDevice(uint64_t address, const caf::actor& handler);
+    void removeDevice(uint64_t address);
+    void removeDevice(const caf::actor_addr& addr);
+    template <typename... A>
+    void sendAllDevices(A&&... args);
+    void logMsg(std::string&& msg);
+
+    std::unordered_map<uint64_t, DeviceState> _devices;
+    caf::actor _sink;
+    caf::actor _handler;
+    bmcl::Buffer _incoming;
+    uint64_t _selfAddress;
+    uint64_t _droppedPackets;
+    PipelineMode _mode;
+    bool _isRunning;
+    bool _isLoggingEnabled;
+};
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "photon/groundcontrol/DfuPatch.h"
+
+#include <bmcl/Bytes.h>
+
+#include <cstring>
+#include <unordered_map>
+
+namespace photon {
+
+// same as PHOTON_DFU_PATCH_OP_* in dfu/Patch.h
+constexpr const uint8_t opCopy = 0;
+constexpr const uint8_t opInsert = 1;
+
+constexpr const std::size_t hashWindowSize = 8;
+// copy with offset and size takes up to 11 bytes, shorter matches are inserted
+constexpr const std::size_t minMatch = 16;
+
+static uint64_t readWindow(const uint8_t* src)
+{
+    uint64_t value;
+    std::memcpy(&value, src, sizeof(value));
+    return value;
+}
+
+static void writeNumber(std::vector<uint8_t>* dest, uint64_t value)
+{
+    while (value >= 0x80) {
+        dest->push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    dest->push_back(uint8_t(value));
+}
+
+std::vector<uint8_t> makeDfuPatch(bmcl::Bytes base, bmcl::Bytes target)
+{
+    std::unordered_map<uint64_t, std::size_t> index;
+    if (base.size() >= hashWindowSize) {
+        index.reserve(base.size());
+        // first occurrence is kept
+        for (std::size_t i = base.size() - hashWindowSize + 1; i > 0; i--) {
+            index[readWindow(base.data() + i - 1)] = i - 1;
+        }
+    }
+
+    auto matchLength = [&](std::size_t baseOffset, std::size_t targetOffset) {
+        std::size_t length = 0;
+        while (baseOffset + length < base.size() && targetOffset + length < target.size()
+               && base[baseOffset + length] == target[targetOffset + length]) {
+            length++;
+        }
+        return length;
+    };
+
+    std::vector<uint8_t> patch;
+    std::size_t literalStart = 0;
+    auto flushLiterals = [&](std::size_t end) {
+        if (end == literalStart) {
+            return;
+        }
+        patch.push_back(opInsert);
+        writeNumber(&patch, end - literalStart);
+        patch.insert(patch.end(), target.begin() + literalStart, target.begin() + end);
+    };
+
+    // position in base aligned with current target position after last copy,
+    // checked first so that small in-place changes don't require hash lookups
+    std::size_t expectedBase = 0;
+    std::size_t i = 0;
+    while (i < target.size()) {
+        std::size_t bestLength = 0;
+        std::size_t bestOffset = 0;
+        if (expectedBase < base.size()) {
+            bestLength = matchLength(expectedBase, i);
+            bestOffset = expectedBase;
+        }
+        if (bestLength < minMatch && (i + hashWindowSize) <= target.size()) {
+            auto it = index.find(readWindow(target.data() + i));
+            if (it != index.end()) {
+                std::size_t length = matchLength(it->second, i);
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestOffset = it->second;
+                }
+            }
+        }
+
+        if (bestLength >= minMatch) {
+            flushLiterals(i);
+            patch.push_back(opCopy);
+            writeNumber(&patch, bestOffset);
+            writeNumber(&patch, bestLength);
+            i += bestLength;
+            literalStart = i;
+            expectedBase = bestOffset + bestLength;
+        } else {
+            i++;
+            expectedBase++;
+        }
+    }
+    flushLiterals(target.size());
+    return patch;
+}
+}
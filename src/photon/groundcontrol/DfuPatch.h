@@ -0,0 +1,23 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "photon/Config.hpp"
+
+#include <bmcl/Fwd.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace photon {
+
+// Builds binary patch applied onboard by dfu/Patch.c, see format description there.
+// Target is matched greedily against base using hashes of 8 byte windows, unmatched parts are inserted as is.
+std::vector<uint8_t> makeDfuPatch(bmcl::Bytes base, bmcl::Bytes target);
+}
@@ -11,16 +11,23 @@
 #include "photon/groundcontrol/ProjectUpdate.h"
 #include "photon/groundcontrol/Packet.h"
 #include "photon/groundcontrol/AllowUnsafeMessageType.h"
+#include "photon/groundcontrol/Crc.h"
+#include "photon/groundcontrol/DfuPatch.h"
 #include "decode/core/Try.h"
 #include "decode/core/DataReader.h"
 #include "decode/core/Utils.h"
 #include "photongen/groundcontrol/dfu/Cmd.hpp"
 #include "photongen/groundcontrol/dfu/Response.hpp"
+#include "photongen/groundcontrol/dfu/State.hpp"
 
 #include <bmcl/Logging.h>
 #include <bmcl/Buffer.h>
 #include <bmcl/SharedBytes.h>
 #include <bmcl/Result.h>
+#include <bmcl/MemReader.h>
+
+#include <algorithm>
+#include <cstring>
 
 DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(photon::PacketRequest);
 DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(photon::Rc<const photon::DfuStatus>);
@@ -28,10 +35,35 @@ DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(decode::DataReader::Pointer);
 
 namespace photon {
 
+// requested block size, onboard can decrease it to fit packet or increase to fit written blocks bitmap
+constexpr const std::size_t requestedBlockSize = 512;
+// used by onboard if block size was not negotiated
+constexpr const std::size_t defaultBlockSize = 256;
+constexpr const std::size_t windowSize = 8;
+constexpr const std::size_t maxRetries = 10;
+constexpr const std::size_t maxRestarts = 3;
+constexpr const std::chrono::milliseconds checkTimeout(500);
+
 DfuState::DfuState(caf::actor_config& cfg, const caf::actor& exchange, const caf::actor& eventHandler)
     : caf::event_based_actor(cfg)
     , _exc(exchange)
     , _handler(eventHandler)
+    , _sectorId(0)
+    , _transferId(0)
+    , _baseSectorId(0)
+    , _baseId(0)
+    , _targetId(0)
+    , _targetSize(0)
+    , _targetCrc(0)
+    , _isPatch(false)
+    , _blockSize(defaultBlockSize)
+    , _nextBlock(0)
+    , _inFlight(0)
+    , _ackedBlocks(0)
+    , _retries(0)
+    , _restarts(0)
+    , _checkId(0)
+    , _phase(Phase::Idle)
 {
 }
 
@@ -79,6 +111,9 @@ caf::behavior DfuState::make_behavior()
             case photongen::dfu::Response::Error:
                 handleError(&reader, &state);
                 break;
+            case photongen::dfu::Response::Progress:
+                handleProgress(&reader, &state);
+                break;
             case photongen::dfu::Response::None:
                 break;
             }
@@ -92,17 +127,31 @@ caf::behavior DfuState::make_behavior()
         [](SetProjectAtom, const ProjectUpdate::ConstPointer& update) {
         },
         [this](FlashDfuFirmware, std::uintmax_t id, const decode::DataReader::Pointer& reader) {
-            _flashPromise = make_response_promise();
-            _fwReader = reader;
-            _sectorId = id;
-            beginUpload();
-            return _flashPromise;
+            auto promise = make_response_promise();
+            if (_phase != Phase::Idle) {
+                promise.deliver(std::string("firmware is already being flashed"));
+                return promise;
+            }
+            _flashPromise = promise;
+            startFlash(id, reader.get());
+            return promise;
+        },
+        [this](FlashDfuPatch, std::uintmax_t baseId, std::uintmax_t id, const decode::DataReader::Pointer& base, const decode::DataReader::Pointer& reader) {
+            auto promise = make_response_promise();
+            if (_phase != Phase::Idle) {
+                promise.deliver(std::string("firmware is already being flashed"));
+                return promise;
+            }
+            _flashPromise = promise;
+            startPatch(baseId, id, base.get(), reader.get());
+            return promise;
+        },
+        [this](DfuCheckAtom, uint64_t id) {
+            handleCheck(id);
         },
         [this](RequestDfuStatus) {
             _statesPromises.emplace_back(make_response_promise());
-            sendCmd([](bmcl::Buffer* dest, CoderState* state) -> bool {
-                return photongenSerializeDfuCmd(photongen::dfu::Cmd::GetInfo, dest, state);
-            });
+            requestInfo();
             return _statesPromises.back();
         },
     };
@@ -119,6 +168,13 @@ void DfuState::handleReportInfo(bmcl::MemReader* reader, CoderState* state)
         //TODO: report error
         return;
     }
+    if (reader->sizeLeft() != 0 && !photongenDeserializeDfuAllImagesDesc(&status->imagesDesc, reader, state)) {
+        //TODO: report error
+        return;
+    }
+    if (_phase == Phase::CheckingBase) {
+        checkBase(status.get());
+    }
     for (caf::response_promise& promise : _statesPromises) {
         promise.deliver(Rc<const DfuStatus>(status));
     }
@@ -127,6 +183,9 @@ void DfuState::handleReportInfo(bmcl::MemReader* reader, CoderState* state)
 
 void DfuState::handleBegin(bmcl::MemReader* reader, CoderState* state)
 {
+    if (_phase != Phase::Beginning) {
+        return;
+    }
     std::uint64_t sectorId;
     if (!reader->readVarUint(&sectorId)) {
         BMCL_CRITICAL() << "invalid begin response";
@@ -137,46 +196,77 @@ void DfuState::handleBegin(bmcl::MemReader* reader, CoderState* state)
         BMCL_CRITICAL() << "invalid begin response";
         return;
     }
+    std::uint64_t blockSize = defaultBlockSize;
+    if (reader->sizeLeft() != 0 && !reader->readVarUint(&blockSize)) {
+        BMCL_CRITICAL() << "invalid begin response";
+        return;
+    }
 
     if (sectorId != _sectorId) {
         BMCL_CRITICAL() << "invalid sector id";
         return;
     }
 
-    if (dataSize != _fwReader->size()) {
+    if (dataSize != _image.size()) {
         BMCL_CRITICAL() << "invalid sector size";
         return;
     }
-    sendNextChunk();
+
+    if (blockSize == 0) {
+        finishFlash("invalid block size");
+        return;
+    }
+    BMCL_DEBUG() << "begin, block size " << blockSize;
+    resetBlocks(blockSize);
+    _phase = Phase::Writing;
+    _lastAnswerTime = Clock::now();
+    _retries = 0;
+    fillWindow();
 }
 
 void DfuState::handleWrite(bmcl::MemReader* reader, CoderState* state)
 {
+    if (_phase != Phase::Writing) {
+        return;
+    }
     std::uint64_t offset;
-    if (!reader->readVarUint(&offset)) {
+    std::uint64_t writtenSize;
+    std::uint64_t bitmapSize;
+    if (!reader->readVarUint(&offset) || !reader->readVarUint(&writtenSize) || !reader->readVarUint(&bitmapSize)) {
         BMCL_CRITICAL() << "invalid write response";
         return;
     }
-    if (offset != _fwReader->offset()) {
-        BMCL_CRITICAL() << "invalid offset " << offset << " " << _fwReader->offset();
+    if (bitmapSize > reader->sizeLeft()) {
+        BMCL_CRITICAL() << "invalid write response";
         return;
     }
-    sendNextChunk();
+    if ((offset % _blockSize) != 0 || (offset / _blockSize) >= _blocks.size()) {
+        BMCL_CRITICAL() << "invalid offset " << offset;
+        return;
+    }
+    _lastAnswerTime = Clock::now();
+    _retries = 0;
+
+    acceptWriteAck(offset / _blockSize, bmcl::Bytes(reader->current(), bitmapSize));
+    fillWindow();
 }
 
 void DfuState::handleEnd(bmcl::MemReader* reader, CoderState* state)
 {
+    if (_phase != Phase::Ending) {
+        return;
+    }
     std::uint64_t size;
     if (!reader->readVarUint(&size)) {
         BMCL_CRITICAL() << "invalid end response";
         return;
     }
-    if (size != _fwReader->size()) {
-        BMCL_CRITICAL() << "invalid total size " << size << " " << _fwReader->size();
+    if (size != _image.size()) {
+        BMCL_CRITICAL() << "invalid total size " << size << " " << _image.size();
         return;
     }
     BMCL_DEBUG() << "end...";
-    _flashPromise.deliver(std::string("ok"));
+    finishFlash("ok");
 }
 
 void DfuState::handleError(bmcl::MemReader* reader, CoderState* state)
@@ -186,52 +276,366 @@ void DfuState::handleError(bmcl::MemReader* reader, CoderState* state)
         BMCL_CRITICAL() << "invalid error response";
         return;
     }
-    BMCL_CRITICAL() << "recieved error: " << rv.unwrap().toStdString();
+    std::string msg = rv.unwrap().toStdString();
+    BMCL_CRITICAL() << "recieved error: " << msg;
+    switch (_phase) {
+    case Phase::Beginning:
+    case Phase::Ending:
+        // all blocks were acknowledged, image itself is invalid
+        finishFlash(std::move(msg));
+        break;
+    case Phase::Writing:
+        // onboard could have been reset or some blocks lost, resynchronize using onboard progress
+        requestProgress();
+        break;
+    default:
+        break;
+    }
+}
+
+void DfuState::handleProgress(bmcl::MemReader* reader, CoderState* state)
+{
+    photongen::dfu::State onboardState;
+    if (!photongenDeserializeDfuState(&onboardState, reader, state)) {
+        BMCL_CRITICAL() << "invalid progress response";
+        return;
+    }
+    std::uint64_t sectorId;
+    std::uint64_t dataSize;
+    std::uint64_t blockSize;
+    if (!reader->readVarUint(&sectorId) || !reader->readVarUint(&dataSize) || !reader->readVarUint(&blockSize)) {
+        BMCL_CRITICAL() << "invalid progress response";
+        return;
+    }
+    if (reader->sizeLeft() < 8) {
+        BMCL_CRITICAL() << "invalid progress response";
+        return;
+    }
+    std::uint64_t transferId = reader->readUint64Le();
+    std::uint64_t bitmapSize;
+    if (!reader->readVarUint(&bitmapSize) || bitmapSize > reader->sizeLeft()) {
+        BMCL_CRITICAL() << "invalid progress response";
+        return;
+    }
+    bmcl::Bytes bitmap(reader->current(), bitmapSize);
+
+    if (_phase != Phase::Negotiating && _phase != Phase::Writing && _phase != Phase::Ending) {
+        return;
+    }
+    _lastAnswerTime = Clock::now();
+    _retries = 0;
+
+    bool isSameTransfer = sectorId == _sectorId && dataSize == _image.size() && transferId == _transferId && blockSize != 0;
+    if (_phase == Phase::Ending && isSameTransfer && onboardState == photongen::dfu::State::Idle) {
+        // end answer was lost
+        finishFlash("ok");
+        return;
+    }
+    bool canResume = isSameTransfer && onboardState == photongen::dfu::State::Writing;
+    if (canResume && _phase == Phase::Negotiating) {
+        resetBlocks(blockSize);
+    }
+    if (!canResume || blockSize != _blockSize) {
+        if (_phase != Phase::Negotiating) {
+            _restarts++;
+            if (_restarts > maxRestarts) {
+                finishFlash("onboard transfer state lost too many times");
+                return;
+            }
+            BMCL_WARNING() << "onboard transfer state lost, restarting";
+        }
+        beginUpload();
+        return;
+    }
+
+    acceptBitmap(bitmap);
+    if (_phase == Phase::Negotiating) {
+        BMCL_DEBUG() << "resuming, " << _ackedBlocks << "/" << _blocks.size() << " blocks already written";
+    }
+    _phase = Phase::Writing;
+    fillWindow();
+}
+
+void DfuState::handleCheck(uint64_t id)
+{
+    if (_phase == Phase::Idle || id != _checkId) {
+        return;
+    }
+    if ((Clock::now() - _lastAnswerTime) >= checkTimeout) {
+        _retries++;
+        if (_retries > maxRetries) {
+            finishFlash("onboard does not respond");
+            return;
+        }
+        _lastAnswerTime = Clock::now();
+        switch (_phase) {
+        case Phase::CheckingBase:
+            requestInfo();
+            break;
+        case Phase::Beginning:
+            beginUpload();
+            break;
+        case Phase::Ending:
+            endFlash();
+            break;
+        default:
+            // in flight blocks or their answers could have been lost
+            requestProgress();
+            break;
+        }
+    }
+    scheduleCheck();
+}
+
+static std::vector<uint8_t> readImage(decode::DataReader* reader)
+{
+    std::vector<uint8_t> image;
+    while (reader->hasData()) {
+        bmcl::Bytes chunk = reader->readNext(4096);
+        image.insert(image.end(), chunk.begin(), chunk.end());
+    }
+    return image;
+}
+
+// image id stored onboard, also used as transfer id
+static uint64_t imageId(const std::vector<uint8_t>& image)
+{
+    ProjectHash hash = ProjectUpdate::calculateHash(bmcl::Bytes(image.data(), image.size()));
+    uint64_t id;
+    std::memcpy(&id, hash.data(), sizeof(id));
+    return id;
+}
+
+void DfuState::startFlash(std::uintmax_t id, decode::DataReader* reader)
+{
+    _image = readImage(reader);
+    _transferId = imageId(_image);
+    _sectorId = id;
+    _isPatch = false;
+    _checkId++;
+    negotiate();
+    scheduleCheck();
+}
+
+void DfuState::startPatch(std::uintmax_t baseId, std::uintmax_t id, decode::DataReader* base, decode::DataReader* reader)
+{
+    _base = readImage(base);
+    _image = readImage(reader);
+    _baseSectorId = baseId;
+    _baseId = imageId(_base);
+    _sectorId = id;
+    _isPatch = false;
+    _checkId++;
+    _retries = 0;
+    _lastAnswerTime = Clock::now();
+    _phase = Phase::CheckingBase;
+    requestInfo();
+    scheduleCheck();
+}
+
+// base image can be unknown to onboard (written before image ids were stored or by other tools),
+// full image is flashed in that case
+bool DfuState::isBaseValid(const DfuStatus* status) const
+{
+    if (_baseSectorId >= status->imagesDesc.size()) {
+        BMCL_WARNING() << "onboard does not report base image, flashing full image";
+        return false;
+    }
+    const photongen::dfu::ImageDesc& desc = status->imagesDesc[_baseSectorId];
+    if (desc.id() != _baseId || desc.size() != _base.size()) {
+        BMCL_WARNING() << "base image does not match onboard image, flashing full image";
+        return false;
+    }
+    return true;
+}
+
+void DfuState::checkBase(const DfuStatus* status)
+{
+    _transferId = imageId(_image);
+    if (!isBaseValid(status)) {
+        _base.clear();
+        negotiate();
+        return;
+    }
+
+    std::vector<uint8_t> patch = makeDfuPatch(bmcl::Bytes(_base.data(), _base.size()), bmcl::Bytes(_image.data(), _image.size()));
+    _base.clear();
+    if (patch.size() >= _image.size()) {
+        BMCL_DEBUG() << "patch is not smaller than image, flashing full image";
+        negotiate();
+        return;
+    }
+    BMCL_DEBUG() << "patch size " << patch.size() << ", image size " << _image.size();
+
+    Crc16 crc;
+    crc.update(_image.data(), _image.size());
+    _targetCrc = crc.get();
+    _targetId = _transferId;
+    _targetSize = _image.size();
+    _image = std::move(patch);
+    _transferId = imageId(_image);
+    _isPatch = true;
+    negotiate();
 }
 
-constexpr const std::size_t chunkSize = 256;
+void DfuState::negotiate()
+{
+    _blocks.clear();
+    _retries = 0;
+    _restarts = 0;
+    _lastAnswerTime = Clock::now();
+    _phase = Phase::Negotiating;
+    requestProgress();
+}
+
+void DfuState::requestInfo()
+{
+    sendCmd([](bmcl::Buffer* dest, CoderState* state) -> bool {
+        return photongenSerializeDfuCmd(photongen::dfu::Cmd::GetInfo, dest, state);
+    });
+}
+
+void DfuState::requestProgress()
+{
+    sendCmd([](bmcl::Buffer* dest, CoderState* state) -> bool {
+        return photongenSerializeDfuCmd(photongen::dfu::Cmd::GetProgress, dest, state);
+    });
+}
 
 void DfuState::beginUpload()
 {
+    _phase = Phase::Beginning;
+    if (_isPatch) {
+        sendCmd([this](bmcl::Buffer* dest, CoderState* state) -> bool {
+            TRY(photongenSerializeDfuCmd(photongen::dfu::Cmd::BeginPatch, dest, state));
+            dest->writeVarUint(_sectorId);
+            dest->writeVarUint(_image.size());
+            dest->writeVarUint(requestedBlockSize);
+            dest->writeUint64Le(_transferId);
+            dest->writeVarUint(_baseSectorId);
+            dest->writeUint64Le(_baseId);
+            dest->writeVarUint(_targetSize);
+            dest->writeUint64Le(_targetId);
+            dest->writeUint16Le(_targetCrc);
+            return true;
+        });
+        return;
+    }
     sendCmd([this](bmcl::Buffer* dest, CoderState* state) -> bool {
         TRY(photongenSerializeDfuCmd(photongen::dfu::Cmd::BeginUpdate, dest, state));
         dest->writeVarUint(_sectorId);
-        dest->writeVarUint(_fwReader->size());
+        dest->writeVarUint(_image.size());
+        dest->writeVarUint(requestedBlockSize);
+        dest->writeUint64Le(_transferId);
         return true;
     });
 }
 
-void DfuState::endFlash()
+void DfuState::resetBlocks(std::size_t blockSize)
 {
-    sendCmd([this](bmcl::Buffer* dest, CoderState* state) -> bool {
-        TRY(photongenSerializeDfuCmd(photongen::dfu::Cmd::EndUpdate, dest, state));
-        dest->writeVarUint(_sectorId);
-        dest->writeVarUint(_fwReader->size());
-        return true;
-    });
+    _blockSize = blockSize;
+    _blocks.assign((_image.size() + blockSize - 1) / blockSize, BlockState::Missing);
+    _nextBlock = 0;
+    _inFlight = 0;
+    _ackedBlocks = 0;
 }
 
-void DfuState::sendNextChunk()
+void DfuState::acceptBitmap(bmcl::Bytes bitmap)
 {
-    if (_fwReader.isNull()) {
-        //internal error
-        endFlash();
-        return;
+    _nextBlock = 0;
+    _inFlight = 0;
+    _ackedBlocks = 0;
+    for (std::size_t i = 0; i < _blocks.size(); i++) {
+        std::size_t byte = i / 8;
+        bool isWritten = byte < bitmap.size() && (bitmap[byte] & (1 << (i % 8)));
+        if (isWritten) {
+            _blocks[i] = BlockState::Acked;
+            _ackedBlocks++;
+        } else {
+            _blocks[i] = BlockState::Missing;
+        }
     }
-    if (!_fwReader->hasData()) {
+}
+
+// onboard answers once for all blocks received since previous answer, blocks are sent in ascending order,
+// so sent blocks before last received one that are missing from bitmap were lost or ignored
+void DfuState::acceptWriteAck(std::size_t lastBlock, bmcl::Bytes bitmap)
+{
+    for (std::size_t i = 0; i < _blocks.size(); i++) {
+        std::size_t byte = i / 8;
+        bool isWritten = byte < bitmap.size() && (bitmap[byte] & (1 << (i % 8)));
+        BlockState& block = _blocks[i];
+        if (isWritten) {
+            if (block == BlockState::Sent) {
+                _inFlight--;
+            }
+            if (block != BlockState::Acked) {
+                block = BlockState::Acked;
+                _ackedBlocks++;
+            }
+        } else if (block == BlockState::Sent && i <= lastBlock) {
+            block = BlockState::Missing;
+            _inFlight--;
+            _nextBlock = std::min(_nextBlock, i);
+        }
+    }
+}
+
+void DfuState::fillWindow()
+{
+    if (_ackedBlocks == _blocks.size()) {
+        _phase = Phase::Ending;
         endFlash();
         return;
     }
-    sendCmd([this](bmcl::Buffer* dest, CoderState* state) -> bool {
+    while (_inFlight < windowSize && _nextBlock < _blocks.size()) {
+        if (_blocks[_nextBlock] == BlockState::Missing) {
+            sendBlock(_nextBlock);
+            _blocks[_nextBlock] = BlockState::Sent;
+            _inFlight++;
+        }
+        _nextBlock++;
+    }
+}
+
+void DfuState::sendBlock(std::size_t block)
+{
+    sendCmd([this, block](bmcl::Buffer* dest, CoderState* state) -> bool {
         TRY(photongenSerializeDfuCmd(photongen::dfu::Cmd::WriteChunk, dest, state));
-        dest->writeVarUint(_fwReader->offset());
-        bmcl::Bytes chunk = _fwReader->readNext(chunkSize);
-        dest->writeVarUint(chunk.size());
-        dest->write(chunk.data(), chunk.size());
+        std::size_t offset = block * _blockSize;
+        std::size_t size = std::min(_blockSize, _image.size() - offset);
+        dest->writeVarUint(offset);
+        dest->writeVarUint(size);
+        dest->write(_image.data() + offset, size);
         return true;
     });
 }
 
+void DfuState::endFlash()
+{
+    sendCmd([this](bmcl::Buffer* dest, CoderState* state) -> bool {
+        TRY(photongenSerializeDfuCmd(photongen::dfu::Cmd::EndUpdate, dest, state));
+        dest->writeVarUint(_sectorId);
+        dest->writeVarUint(_image.size());
+        return true;
+    });
+}
+
+void DfuState::finishFlash(std::string&& status)
+{
+    _phase = Phase::Idle;
+    _checkId++;
+    _image.clear();
+    _base.clear();
+    _blocks.clear();
+    _flashPromise.deliver(std::move(status));
+}
+
+void DfuState::scheduleCheck()
+{
+    delayed_send(this, checkTimeout, DfuCheckAtom::value, _checkId);
+}
+
 const char* DfuState::name() const
 {
     return "dfu";
@@ -13,12 +13,16 @@
 
 #include "photongen/groundcontrol/dfu/SectorData.hpp"
 #include "photongen/groundcontrol/dfu/AllSectorsDesc.hpp"
+#include "photongen/groundcontrol/dfu/AllImagesDesc.hpp"
 
 #include <bmcl/Fwd.h>
 #include <bmcl/Buffer.h>
 
 #include <caf/event_based_actor.hpp>
 
+#include <chrono>
+#include <vector>
+
 namespace decode {
 class DataReader;
 }
@@ -30,8 +34,19 @@ class ProjectUpdate;
 struct DfuStatus : public RefCountable {
     photongen::dfu::SectorData sectorData;
     photongen::dfu::AllSectorsDesc sectorDesc;
+    // empty if onboard does not report images
+    photongen::dfu::AllImagesDesc imagesDesc;
 };
 
+// Flashes firmware sectors using onboard dfu module. Image is split into blocks of negotiated size,
+// up to a window of blocks is sent without waiting for answers, each onboard answer carries bitmap of written blocks,
+// so one answer acknowledges all blocks received before it and lost blocks are resent without waiting for timeout.
+// If answers stop arriving onboard progress (bitmap of written blocks) is requested and missing blocks
+// are resent. Flashing is resumed from onboard progress if the same image was being written to the same sector.
+//
+// FlashDfuPatch sends only the difference between base image already present in another sector and target image.
+// Onboard image id reported by GetInfo must match base image, patched image is verified onboard before end is
+// acknowledged. Full image is sent if patch is not smaller.
 class DfuState : public caf::event_based_actor {
 public:
     DfuState(caf::actor_config& cfg, const caf::actor& exchange, const caf::actor& eventHandler);
@@ -42,6 +57,23 @@ public:
     void on_exit() override;
 
 private:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Phase {
+        Idle,
+        CheckingBase,
+        Negotiating,
+        Beginning,
+        Writing,
+        Ending,
+    };
+
+    enum class BlockState : uint8_t {
+        Missing,
+        Sent,
+        Acked,
+    };
+
     template <typename C, typename... A>
     void sendCmd(C&& ser, A&&... args);
 
@@ -50,18 +82,51 @@ private:
     void handleWrite(bmcl::MemReader* reader, CoderState* state);
     void handleEnd(bmcl::MemReader* reader, CoderState* state);
     void handleError(bmcl::MemReader* reader, CoderState* state);
-
+    void handleProgress(bmcl::MemReader* reader, CoderState* state);
+    void handleCheck(uint64_t id);
+
+    void startFlash(std::uintmax_t id, decode::DataReader* reader);
+    void startPatch(std::uintmax_t baseId, std::uintmax_t id, decode::DataReader* base, decode::DataReader* reader);
+    bool isBaseValid(const DfuStatus* status) const;
+    void checkBase(const DfuStatus* status);
+    void negotiate();
+    void requestInfo();
+    void requestProgress();
     void beginUpload();
-    void sendNextChunk();
+    void resetBlocks(std::size_t blockSize);
+    void acceptBitmap(bmcl::Bytes bitmap);
+    void acceptWriteAck(std::size_t lastBlock, bmcl::Bytes bitmap);
+    void fillWindow();
+    void sendBlock(std::size_t block);
     void endFlash();
+    void finishFlash(std::string&& status);
+    void scheduleCheck();
 
     caf::actor _exc;
     caf::actor _handler;
     Rc<const ProjectUpdate> _projectUpdate;
     bmcl::Buffer _temp;
     std::vector<caf::response_promise> _statesPromises;
-    Rc<decode::DataReader> _fwReader;
+    std::vector<uint8_t> _image;
+    std::vector<uint8_t> _base;
+    std::vector<BlockState> _blocks;
     std::uintmax_t _sectorId;
+    uint64_t _transferId;
+    std::uintmax_t _baseSectorId;
+    uint64_t _baseId;
+    uint64_t _targetId;
+    uint64_t _targetSize;
+    uint16_t _targetCrc;
+    bool _isPatch;
+    std::size_t _blockSize;
+    std::size_t _nextBlock;
+    std::size_t _inFlight;
+    std::size_t _ackedBlocks;
+    std::size_t _retries;
+    std::size_t _restarts;
+    uint64_t _checkId;
+    Clock::time_point _lastAnswerTime;
+    Phase _phase;
     caf::response_promise _flashPromise;
 };
 }
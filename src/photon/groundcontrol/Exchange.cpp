@@ -65,7 +65,8 @@ StreamState::StreamState(StreamType type)
 }
 
 Exchange::Exchange(caf::actor_config& cfg, uint64_t selfAddress, uint64_t destAddress,
-                   const caf::actor& gc, const caf::actor& dataSink, const caf::actor& handler)
+                   const caf::actor& gc, const caf::actor& dataSink, const caf::actor& handler,
+                   PipelineMode mode)
     : caf::event_based_actor(cfg)
     , _fwtStream(StreamType::Firmware)
     , _cmdStream(StreamType::Cmd)
@@ -77,12 +78,15 @@ Exchange::Exchange(caf::actor_config& cfg, uint64_t selfAddress, uint64_t destAd
     , _handler(handler)
     , _selfAddress(selfAddress)
     , _deviceAddress(destAddress)
+    , _mode(mode)
     , _isRunning(false)
     , _dataReceived(false)
     , _isLoggingEnabled(false)
 {
     _fwtStream.client = spawn<FwtState, caf::linked>(this, _handler);
-    _tmStream.client = spawn<TmState, caf::linked>(_handler);
+    if (mode == PipelineMode::Actors) {
+        _tmStream.client = spawn<TmState, caf::linked>(_handler);
+    }
     _dfuStream.client = spawn<DfuState, caf::linked>(this, _handler);
 }
 
@@ -114,6 +118,15 @@ caf::behavior Exchange::make_behavior()
             _dataReceived = true;
             handlePayload(data.view());
         },
+        [this](RecvPacketPayloadAtom, const PacketHeader& header, const bmcl::SharedBytes& data) {
+            // already decoded telemetry, see BlogReplay
+            if (_mode == PipelineMode::Fused) {
+                // there is no tm stream actor, telemetry is processed inside GroundControl
+                send(_gc, RecvPacketPayloadAtom::value, header, data);
+                return;
+            }
+            send(_tmStream.client, RecvPacketPayloadAtom::value, header, data);
+        },
         [this](CheckQueueAtom, StreamType type, std::size_t id) {
             StreamState* state;
             switch (type) {
@@ -165,6 +178,9 @@ caf::behavior Exchange::make_behavior()
         [this](FlashDfuFirmware atom, std::uintmax_t id, const Rc<decode::DataReader>& reader) {
             return delegate(_dfuStream.client, atom, id, reader);
         },
+        [this](FlashDfuPatch atom, std::uintmax_t baseId, std::uintmax_t id, const Rc<decode::DataReader>& base, const Rc<decode::DataReader>& reader) {
+            return delegate(_dfuStream.client, atom, baseId, id, base, reader);
+        },
         [this](SubscribeNamedTmAtom atom, const std::string& path, const caf::actor& dest) {
             return delegate(_tmStream.client, atom, path, dest);
         },
@@ -216,7 +232,7 @@ void Exchange::reportError(std::string&& msg)
     send(_handler, ExchangeErrorEventAtom::value, std::move(msg));
 }
 
-static bmcl::Result<PacketHeader, std::string> decodeHeader(bmcl::MemReader* reader)
+bmcl::Result<PacketHeader, std::string> Exchange::decodeHeader(bmcl::MemReader* reader)
 {
     PacketHeader header;
     if (!reader->readVarUint(&header.srcAddress)) {
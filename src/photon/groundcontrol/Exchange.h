@@ -64,13 +64,16 @@ struct StreamState {
 class Exchange : public caf::event_based_actor {
 public:
     Exchange(caf::actor_config& cfg, uint64_t selfAddress, uint64_t destAddress,
-             const caf::actor& gc, const caf::actor& dataSink, const caf::actor& handler);
+             const caf::actor& gc, const caf::actor& dataSink, const caf::actor& handler,
+             PipelineMode mode = PipelineMode::Actors);
     ~Exchange();
 
     caf::behavior make_behavior() override;
     const char* name() const override;
     void on_exit() override;
 
+    static bmcl::Result<PacketHeader, std::string> decodeHeader(bmcl::MemReader* reader);
+
 private:
     template <typename... A>
     void sendAllStreams(A&&... args);
@@ -105,6 +108,7 @@ private:
     caf::actor _handler;
     uint64_t _selfAddress;
     uint64_t _deviceAddress;
+    PipelineMode _mode;
     bool _isRunning;
     bool _dataReceived;
     bool _isLoggingEnabled;
@@ -7,6 +7,7 @@
  */
 
 #include "photon/groundcontrol/FwtState.h"
+#include "photon/groundcontrol/CompressedPackage.h"
 #include "photon/groundcontrol/MemIntervalSet.h"
 #include "photon/groundcontrol/AllowUnsafeMessageType.h"
 #include "decode/core/Diagnostics.h"
@@ -28,7 +29,10 @@
 
 #include <caf/atom.hpp>
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstring>
 #include <random>
 
 #define FWT_LOG(msg)         \
@@ -45,6 +49,16 @@ DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(photon::ProjectUpdate::ConstPointer);
 
 namespace photon {
 
+// ranges requested at once, matches onboard chunk queue size
+constexpr std::size_t maxPendingRanges = 8;
+// big gaps are split so that lost ranges are rerequested sooner
+constexpr std::size_t maxRangeSize = 16 * 1024;
+constexpr std::chrono::milliseconds minTimeout(100);
+constexpr std::chrono::milliseconds maxTimeout(5000);
+constexpr std::chrono::milliseconds initialTimeout(500);
+// devices without RequestChunks ignore it, single range requests are used after this many unanswered requests
+constexpr std::size_t maxUnansweredRangeRequests = 3;
+
 struct StartCmdRndGen {
     StartCmdRndGen() : last(0)
     {
@@ -65,7 +79,15 @@ struct StartCmdRndGen {
 
 FwtState::FwtState(caf::actor_config& cfg, const caf::actor& exchange, const caf::actor& eventHandler)
     : caf::event_based_actor(cfg)
+    , _maxAccepted(0)
+    , _srtt(0)
+    , _rttVar(0)
+    , _hasRtt(false)
+    , _unansweredRangeRequests(0)
+    , _isRangesCmdConfirmed(false)
+    , _useSingleRangeCmd(false)
     , _hasStartCommandPassed(false)
+    , _isCompressed(false)
     , _isRunning(false)
     , _isDownloading(false)
     , _isLoggingEnabled(false)
@@ -108,50 +130,78 @@ caf::behavior FwtState::make_behavior()
             stopDownload();
         },
         [this](SetProjectAtom, const ProjectUpdate::ConstPointer& update) {
-            setProject(update->project(), update->device(), update->cache());
+            setProject(update.get());
         },
         [this](EnableLoggindAtom, bool isEnabled) {
             _isLoggingEnabled = isEnabled;
         },
+        [this](SetProjectCacheDirAtom, const std::string& dir) {
+            _projectCache.setDir(dir);
+        },
     };
 }
 
 bool FwtState::hashMatches(const HashContainer& hash, bmcl::Bytes data)
 {
-    decode::Project::HashType state;
-    state.update(data);
-    auto calculatedHash = state.finalize();
-    if (hash.size() != calculatedHash.size()) {
+    return ProjectUpdate::calculateHash(data) == hash;
+}
+
+bool FwtState::loadCachedProject()
+{
+    auto data = _projectCache.load(bmcl::Bytes(_hash.unwrap().data(), _hash.unwrap().size()));
+    if (data.isNone()) {
+        return false;
+    }
+
+    Rc<decode::Diagnostics> diag = new decode::Diagnostics();
+    auto project = decode::Project::decodeFromMemory(diag.get(), data.unwrap().data(), data.unwrap().size());
+    if (project.isErr()) {
+        FWT_LOG("failed to decode cached project");
+        return false;
+    }
+    auto update = ProjectUpdate::fromProjectAndName(project.unwrap().get(), _deviceName, _hash.unwrap());
+    if (update.isErr()) {
+        FWT_LOG("cached project update error: " + update.unwrapErr());
         return false;
     }
-    return hash == bmcl::Bytes(calculatedHash.data(), calculatedHash.size());
+
+    _downloadedHash = _hash.unwrap();
+    _project = project.unwrap();
+    _device = update.unwrap()->device();
+    send(_handler, FirmwareDownloadFinishedEventAtom::value);
+    send(_exc, SetProjectAtom::value, update.take());
+    FWT_LOG("project loaded from cache, no need to download");
+    stopDownload();
+    return true;
 }
 
-void FwtState::setProject(const decode::Project* proj, const decode::Device* dev, const ValueInfoCache* cache)
+void FwtState::setProject(const ProjectUpdate* update)
 {
     FWT_LOG("setting project");
-    if (_project == proj && _device == dev) {
+    if (_project == update->project() && _device == update->device()) {
         FWT_LOG("no need to update project");
         return;
     }
-    _project = proj;
-    _device = dev;
+    _project = update->project();
+    _device = update->device();
+
+    HashContainer hash;
+    if (update->hash().isSome()) {
+        hash = update->hash().unwrap();
+    } else {
+        // project was not created from serialized form, encoded once to get its hash
+        hash = ProjectUpdate::calculateHash(_project->encode());
+    }
+
     if (_downloadedHash.isNone()) {
         FWT_LOG("project set");
-        decode::Project::HashType state;
-        auto buf = _project->encode();
-        state.update(buf);
-        auto calculatedHash = state.finalize();
-        assert(calculatedHash.size() == 64);
-        _downloadedHash.emplace();
-        std::memcpy(_downloadedHash.unwrap().data(), calculatedHash.data(), 64);
+        _downloadedHash = hash;
         if (_isRunning) {
             startDownload();
         }
         return;
     }
-    auto buf = _project->encode();
-    if (!hashMatches(_downloadedHash.unwrap(), buf)) {
+    if (_downloadedHash.unwrap() != hash) {
         FWT_LOG("project hash mismatch");
         _downloadedHash = bmcl::None;
         if (_isRunning) {
@@ -178,11 +228,17 @@ void FwtState::stopDownload()
         FWT_LOG("stopping firmware download");
     }
     _acceptedChunks.clear();
+    _pendingRanges.clear();
+    _maxAccepted = 0;
     _desc.resize(0);
     _deviceName.clear();
     _hash = bmcl::None;
     _hasStartCommandPassed = false;
+    _isCompressed = false;
     _isDownloading = false;
+    _unansweredRangeRequests = 0;
+    _isRangesCmdConfirmed = false;
+    _useSingleRangeCmd = false;
 }
 
 void FwtState::on_exit()
@@ -205,22 +261,42 @@ inline void FwtState::packAndSendPacket(C&& enc, A&&... args)
     send(_exc, SendUnreliablePacketAtom::value, std::move(req));
 }
 
+// Jacobson/Karels estimator, see RFC 6298
+void FwtState::addRttSample(Clock::duration rtt)
+{
+    double sample = std::chrono::duration<double, std::milli>(rtt).count();
+    if (!_hasRtt) {
+        _srtt = sample;
+        _rttVar = sample / 2;
+        _hasRtt = true;
+        return;
+    }
+    _rttVar = 0.75 * _rttVar + 0.25 * std::abs(_srtt - sample);
+    _srtt = 0.875 * _srtt + 0.125 * sample;
+}
+
+std::chrono::milliseconds FwtState::timeout() const
+{
+    if (!_hasRtt) {
+        return initialTimeout;
+    }
+    std::chrono::milliseconds t(uint64_t(_srtt + 4 * _rttVar));
+    return std::min(maxTimeout, std::max(minTimeout, t));
+}
+
 void FwtState::scheduleHash()
 {
-    auto hashTimeout = std::chrono::milliseconds(500);
-    delayed_send(this, hashTimeout, FwtHashAtom::value);
+    delayed_send(this, timeout(), FwtHashAtom::value);
 }
 
 void FwtState::scheduleStart()
 {
-    auto startTimeout = std::chrono::milliseconds(500);
-    delayed_send(this, startTimeout, FwtStartAtom::value);
+    delayed_send(this, timeout(), FwtStartAtom::value);
 }
 
 void FwtState::scheduleCheck(std::size_t id)
 {
-    auto checkTimeout = std::chrono::milliseconds(500);
-    delayed_send(this, checkTimeout, FwtCheckAtom::value, id);
+    delayed_send(this, timeout(), FwtCheckAtom::value, id);
 }
 
 void FwtState::handleHashAction()
@@ -231,6 +307,7 @@ void FwtState::handleHashAction()
     if (_hash.isSome()) {
         return;
     }
+    _hashSentTime = Clock::now();
     packAndSendPacket(&FwtState::genHashCmd);
     scheduleHash();
 }
@@ -244,6 +321,7 @@ void FwtState::handleStartAction()
         return;
     }
     send(_handler, FirmwareStartCmdSentEventAtom::value);
+    _startSentTime = Clock::now();
     packAndSendPacket(&FwtState::genStartCmd);
     scheduleStart();
 }
@@ -340,42 +418,130 @@ void FwtState::acceptChunkResponse(bmcl::MemReader* src)
 
     src->read(_desc.data() + os.start(), os.size());
 
-
     FWT_LOG("recieved firmware chunk (" + std::to_string(os.start()) + ", " + std::to_string(os.end()) + ")");
+    auto now = Clock::now();
+    _lastChunkTime = now;
+    // chunk behind sequential transfer could only be sent in answer to requested range
+    bool isBehind = os.start() < _maxAccepted;
+    _maxAccepted = std::max(_maxAccepted, os.end());
     _acceptedChunks.add(os);
+
+    auto it = std::find_if(_pendingRanges.begin(), _pendingRanges.end(), [&os](const PendingRange& pending) {
+        return os.start() >= pending.range.start() && os.start() < pending.range.end();
+    });
+    if (it != _pendingRanges.end() && isBehind) {
+        _isRangesCmdConfirmed = true;
+    }
+    if (it == _pendingRanges.begin() && it != _pendingRanges.end() && os.start() == it->range.start()) {
+        addRttSample(now - it->sentTime);
+    }
+    expirePendingRanges(it - _pendingRanges.begin(), now);
+
     send(_handler, FirmwareProgressEventAtom::value, std::size_t(_acceptedChunks.dataSize()), std::size_t(_desc.size()));
     checkIntervals();
     _checkId++;
     scheduleCheck(_checkId);
 }
 
+// acceptedIndex is index of pending range recieved chunk belongs to or pending range count if chunk is from sequential transfer
+void FwtState::expirePendingRanges(std::size_t acceptedIndex, Clock::time_point now)
+{
+    std::vector<MemInterval> missing;
+    std::size_t kept = 0;
+    bool hasUnanswered = false;
+    for (std::size_t i = 0; i < _pendingRanges.size(); i++) {
+        const PendingRange& pending = _pendingRanges[i];
+        bool isExpired;
+        if (i < acceptedIndex) {
+            // onboard has already finished this range, lost parts have to be rerequested,
+            // if chunk is from sequential transfer range could still be on its way to device
+            isExpired = acceptedIndex != _pendingRanges.size() || (now - pending.sentTime) > timeout();
+            hasUnanswered |= isExpired && acceptedIndex == _pendingRanges.size();
+        } else {
+            missing.clear();
+            _acceptedChunks.missing(pending.range, 1, &missing);
+            isExpired = missing.empty();
+        }
+        if (!isExpired) {
+            _pendingRanges[kept] = pending;
+            kept++;
+        }
+    }
+    _pendingRanges.erase(_pendingRanges.begin() + kept, _pendingRanges.end());
+    if (hasUnanswered) {
+        handleUnansweredRanges();
+    }
+}
+
+void FwtState::handleUnansweredRanges()
+{
+    if (_isRangesCmdConfirmed || _useSingleRangeCmd) {
+        return;
+    }
+    _unansweredRangeRequests++;
+    if (_unansweredRangeRequests >= maxUnansweredRangeRequests) {
+        logMsg("device does not answer multiple range requests, falling back to single range requests");
+        _useSingleRangeCmd = true;
+    }
+}
+
 void FwtState::checkIntervals()
 {
     FWT_LOG("checking firmware intervals");
-    if (_acceptedChunks.size() == 0) {
-        packAndSendPacket(&FwtState::genChunkCmd, MemInterval(0, _desc.size()));
+    if (_acceptedChunks.dataSize() == _desc.size()) {
+        readFirmware();
+        return;
+    }
+
+    auto now = Clock::now();
+    bool isStalled = (now - _lastChunkTime) >= timeout();
+    if (isStalled && !_pendingRanges.empty()) {
+        // nothing was recieved for a while, everything requested is lost
+        _pendingRanges.clear();
+        handleUnansweredRanges();
+    }
+    if (_pendingRanges.size() >= maxPendingRanges) {
         return;
     }
-    if (_acceptedChunks.size() == 1) {
-        MemInterval chunk = _acceptedChunks.at(0);
-        if (chunk.start() == 0) {
-            if (chunk.size() == _desc.size()) {
-                readFirmware();
-                return;
+
+    // while sequential transfer is running only gaps behind it are requested
+    std::size_t end = isStalled ? _desc.size() : _maxAccepted;
+    std::size_t maxNum = maxPendingRanges - _pendingRanges.size();
+    std::vector<MemInterval> gaps;
+    _acceptedChunks.missing(MemInterval(0, end), maxNum + _pendingRanges.size(), &gaps);
+
+    MemIntervalSet pendingSet;
+    for (const PendingRange& pending : _pendingRanges) {
+        pendingSet.add(pending.range);
+    }
+    std::vector<MemInterval> ranges;
+    std::vector<MemInterval> parts;
+    for (MemInterval gap : gaps) {
+        parts.clear();
+        pendingSet.missing(gap, maxNum, &parts);
+        for (MemInterval part : parts) {
+            for (std::size_t start = part.start(); start < part.end() && ranges.size() < maxNum; start += maxRangeSize) {
+                ranges.emplace_back(start, std::min(part.end(), start + maxRangeSize));
             }
-            packAndSendPacket(&FwtState::genChunkCmd, MemInterval(chunk.end(), _desc.size()));
-            return;
         }
-        packAndSendPacket(&FwtState::genChunkCmd, MemInterval(0, chunk.start()));
+        if (ranges.size() >= maxNum) {
+            break;
+        }
+    }
+    if (ranges.empty()) {
         return;
     }
-    MemInterval chunk1 = _acceptedChunks.at(0);
-    MemInterval chunk2 = _acceptedChunks.at(1);
-    if (chunk1.start() == 0) {
-        packAndSendPacket(&FwtState::genChunkCmd, MemInterval(chunk1.end(), chunk2.start()));
+
+    for (MemInterval range : ranges) {
+        _pendingRanges.emplace_back(range, now);
+    }
+    if (_useSingleRangeCmd) {
+        for (MemInterval range : ranges) {
+            packAndSendPacket(&FwtState::genChunkCmd, range);
+        }
         return;
     }
-    packAndSendPacket(&FwtState::genChunkCmd, MemInterval(0, chunk1.start()));
+    packAndSendPacket(&FwtState::genChunksCmd, ranges);
 }
 
 void FwtState::readFirmware()
@@ -387,6 +553,18 @@ void FwtState::readFirmware()
     _checkId = 0;
     send(_handler, FirmwareDownloadFinishedEventAtom::value);
 
+    if (_isCompressed) {
+        std::vector<uint8_t> raw;
+        if (!decompressPackage(_desc, &raw)) {
+            reportFirmwareError("Invalid compressed firmware package");
+            stopDownload();
+            return;
+        }
+        FWT_LOG("decompressed firmware package: " + std::to_string(_desc.size()) + " -> " + std::to_string(raw.size()) + " bytes");
+        _desc.resize(raw.size());
+        std::memcpy(_desc.data(), raw.data(), raw.size());
+    }
+
     if (!hashMatches(_hash.unwrap(), _desc)) {
         reportFirmwareError("Invalid firmware hash");
         stopDownload();
@@ -404,7 +582,10 @@ void FwtState::readFirmware()
 
     _downloadedHash = _hash.unwrap();
     _project = project.unwrap();
-    auto update = ProjectUpdate::fromProjectAndName(_project.get(), _deviceName);
+    if (!_projectCache.store(bmcl::Bytes(_hash.unwrap().data(), _hash.unwrap().size()), _desc)) {
+        FWT_LOG("failed to store project in cache");
+    }
+    auto update = ProjectUpdate::fromProjectAndName(_project.get(), _deviceName, _downloadedHash.unwrap());
     if (update.isErr()) {
         reportFirmwareError("Project update error: " + update.unwrapErr());
         //TODO: restart download
@@ -439,14 +620,26 @@ void FwtState::acceptHashResponse(bmcl::MemReader* src)
     _deviceName = name.unwrap().toStdString();
 
     //TODO: check descSize for overflow
-    if (src->readableSize() != 64) {
+    if (src->readableSize() < 64) {
         reportFirmwareError("Recieved hash response with invalid hash size: " + std::to_string(src->readableSize()));
         scheduleHash();
         return;
     }
 
-    _hash.emplace();
-    src->read(_hash.unwrap().data(), 64);
+    HashContainer hash;
+    src->read(hash.data(), 64);
+
+    // package encoding is omitted by older firmware
+    uint64_t encoding = 0;
+    if (src->readableSize() != 0 && (!src->readVarUint(&encoding) || encoding > 1 || src->readableSize() != 0)) {
+        reportFirmwareError("Recieved hash response with invalid package encoding");
+        scheduleHash();
+        return;
+    }
+
+    _hash.emplace(hash);
+    _isCompressed = encoding == 1;
+    addRttSample(Clock::now() - _hashSentTime);
 
     _desc.resize(descSize);
     _acceptedChunks.clear();
@@ -456,6 +649,11 @@ void FwtState::acceptHashResponse(bmcl::MemReader* src)
     send(_handler, FirmwareSizeRecievedEventAtom::value, std::size_t(_desc.size()));
     send(_handler, FirmwareHashDownloadedEventAtom::value, name.unwrap().toStdString(), bmcl::SharedBytes::create(_hash.unwrap()));
 
+    bool isLoaded = _downloadedHash.isSome() && _downloadedHash.unwrap() == _hash.unwrap() && !_project.isNull();
+    if (!isLoaded && loadCachedProject()) {
+        return;
+    }
+
     if (_downloadedHash.isNone()) {
         packAndSendPacket(&FwtState::genStartCmd);
         scheduleStart();
@@ -467,21 +665,15 @@ void FwtState::acceptHashResponse(bmcl::MemReader* src)
         return;
     }
 
+    // _downloadedHash is always a hash of current project bytes, so project is not encoded and hashed again
     if (_project .isNull()|| _device.isNull()) {
         packAndSendPacket(&FwtState::genStartCmd);
         scheduleStart();
         return;
     }
-    auto buf = _project->encode();
-    if (!hashMatches(_downloadedHash.unwrap(), buf)) {
-        FWT_LOG("firmware hash mismatch");
-        packAndSendPacket(&FwtState::genStartCmd);
-        scheduleStart();
-        return;
-    }
 
     send(_handler, FirmwareDownloadFinishedEventAtom::value);
-    auto update = ProjectUpdate::fromProjectAndName(_project.get(), _deviceName);
+    auto update = ProjectUpdate::fromProjectAndName(_project.get(), _deviceName, _downloadedHash.unwrap());
     if (update.isErr()) {
         reportFirmwareError("Project update error: " + update.unwrapErr());
         //TODO: restart download
@@ -517,7 +709,9 @@ void FwtState::acceptStartResponse(bmcl::MemReader* src)
         return;
     }
     FWT_LOG("recieved start response");
+    addRttSample(Clock::now() - _startSentTime);
     _hasStartCommandPassed = true;
+    _lastChunkTime = Clock::now();
     send(_handler, FirmwareStartCmdPassedEventAtom::value);
     scheduleCheck(_checkId);
 }
@@ -530,6 +724,7 @@ void FwtState::acceptStopResponse(bmcl::MemReader* src)
 //RequestChunk = 1
 //Start = 2
 //Stop = 3
+//RequestChunks = 4
 
 void FwtState::genHashCmd(bmcl::MemWriter* dest)
 {
@@ -537,13 +732,24 @@ void FwtState::genHashCmd(bmcl::MemWriter* dest)
     BMCL_ASSERT(dest->writeVarInt(0));
 }
 
-void FwtState::genChunkCmd(bmcl::MemWriter* dest, MemInterval os)
+void FwtState::genChunkCmd(bmcl::MemWriter* dest, MemInterval range)
 {
     FWT_LOG("sending firmware chunk request");
     BMCL_ASSERT(dest->writeVarInt(1));
+    BMCL_ASSERT(dest->writeVarUint(range.start()));
+    BMCL_ASSERT(dest->writeVarUint(range.end()));
+}
 
-    BMCL_ASSERT(dest->writeVarUint(os.start()));
-    BMCL_ASSERT(dest->writeVarUint(os.end()));
+void FwtState::genChunksCmd(bmcl::MemWriter* dest, const std::vector<MemInterval>& ranges)
+{
+    FWT_LOG("sending firmware chunks request");
+    BMCL_ASSERT(dest->writeVarInt(4));
+
+    BMCL_ASSERT(dest->writeVarUint(ranges.size()));
+    for (MemInterval os : ranges) {
+        BMCL_ASSERT(dest->writeVarUint(os.start()));
+        BMCL_ASSERT(dest->writeVarUint(os.end()));
+    }
 }
 
 void FwtState::genStartCmd(bmcl::MemWriter* dest)
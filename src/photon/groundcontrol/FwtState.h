@@ -11,6 +11,8 @@
 #include "photon/Config.hpp"
 #include "photon/core/Rc.h"
 #include "photon/groundcontrol/MemIntervalSet.h"
+#include "photon/groundcontrol/ProjectCache.h"
+#include "photon/groundcontrol/ProjectUpdate.h"
 
 #include <bmcl/Fwd.h>
 #include <bmcl/Buffer.h>
@@ -19,7 +21,9 @@
 #include <caf/event_based_actor.hpp>
 
 #include <array>
+#include <chrono>
 #include <cstring>
+#include <vector>
 
 namespace decode {
 class Project;
@@ -43,7 +47,20 @@ public:
     void on_exit() override;
 
 private:
-    using HashContainer = std::array<uint8_t, 64>;
+    using HashContainer = ProjectHash;
+    using Clock = std::chrono::steady_clock;
+
+    // requested range, onboard serves requested ranges in order
+    struct PendingRange {
+        PendingRange(MemInterval range, Clock::time_point sentTime)
+            : range(range)
+            , sentTime(sentTime)
+        {
+        }
+
+        MemInterval range;
+        Clock::time_point sentTime;
+    };
 
     void acceptData(bmcl::Bytes packet);
     void handleHashAction();
@@ -59,7 +76,8 @@ private:
     void acceptStopResponse(bmcl::MemReader* src);
 
     void genHashCmd(bmcl::MemWriter* dest);
-    void genChunkCmd(bmcl::MemWriter* dest, MemInterval os);
+    void genChunkCmd(bmcl::MemWriter* dest, MemInterval range);
+    void genChunksCmd(bmcl::MemWriter* dest, const std::vector<MemInterval>& ranges);
     void genStartCmd(bmcl::MemWriter* dest);
     void genStopCmd(bmcl::MemWriter* dest);
 
@@ -68,31 +86,49 @@ private:
     void scheduleCheck(std::size_t id);
 
     void checkIntervals();
+    void expirePendingRanges(std::size_t acceptedIndex, Clock::time_point now);
+    void handleUnansweredRanges();
+    void addRttSample(Clock::duration rtt);
+    std::chrono::milliseconds timeout() const;
     void readFirmware();
+    bool loadCachedProject();
 
     void reportFirmwareError(std::string&& msg);
     void logMsg(std::string&& msg);
 
     void startDownload();
     void stopDownload();
-    void setProject(const decode::Project* proj, const decode::Device* dev, const ValueInfoCache* cache);
+    void setProject(const ProjectUpdate* update);
 
     bool hashMatches(const HashContainer& hash, bmcl::Bytes data);
 
     bmcl::Option<HashContainer> _hash;
     bmcl::Option<HashContainer> _downloadedHash;
 
+    ProjectCache _projectCache;
     MemIntervalSet _acceptedChunks;
+    std::vector<PendingRange> _pendingRanges;
+    std::size_t _maxAccepted;
+    Clock::time_point _lastChunkTime;
+    Clock::time_point _hashSentTime;
+    Clock::time_point _startSentTime;
+    double _srtt; // ms
+    double _rttVar; // ms
+    bool _hasRtt;
+    std::size_t _unansweredRangeRequests;
+    bool _isRangesCmdConfirmed;
+    bool _useSingleRangeCmd;
     bmcl::Buffer _desc;
     std::string _deviceName;
 
     bool _hasStartCommandPassed;
+    bool _isCompressed;
     bool _isRunning;
     bool _isDownloading;
     bool _isLoggingEnabled;
     std::size_t _checkId;
     std::unique_ptr<StartCmdRndGen> _startCmdState;
-    uint8_t _temp[20];
+    uint8_t _temp[256];
     caf::actor _exc;
     caf::actor _handler;
     Rc<const decode::Project> _project;
@@ -1,4 +1,5 @@
 #include "photon/groundcontrol/GcInterface.h"
+#include "photon/groundcontrol/Crc.h"
 #include "decode/core/Try.h"
 #include "decode/ast/Type.h"
 #include "decode/ast/Ast.h"
@@ -220,7 +221,10 @@ static bmcl::Option<std::string> expectArrayField(const decode::Field* arrayFiel
 
 static bmcl::Option<std::string> expectReturnValue(const decode::Function* func, bmcl::OptionPtr<const decode::Type> rv)
 {
-    if (func->type()->returnValue() != rv) {
+    bmcl::OptionPtr<const decode::Type> funcRv = func->type()->returnValue();
+    // builtin types of core interface are not shared with project, compare by value
+    bool isEqual = funcRv.isSome() == rv.isSome() && (rv.isNone() || funcRv.unwrap()->equals(rv.unwrap()));
+    if (!isEqual) {
         return "Command " + wrapWithQuotes(func->name()) + " has invalid return value";
     }
     return bmcl::None;
@@ -383,6 +387,12 @@ bmcl::Option<std::string> WaypointGcInterface::init()
     GC_TRY(expectFieldNum(_getRoutesInfoCmd.get(), 0));
     GC_TRY(expectReturnValue(_getRoutesInfoCmd.get(), _allRoutesInfoStruct.get()));
 
+    if (findCmd(_navComponent.get(), "getRouteChecksum", &_getRouteChecksumCmd).isNone()) {
+        GC_TRY(expectFieldNum(_getRouteChecksumCmd.get(), 1));
+        GC_TRY(expectField(_getRouteChecksumCmd.get(), 0, "routeId", varuintType));
+        GC_TRY(expectReturnValue(_getRouteChecksumCmd.get(), _coreIface->u16Type()));
+    }
+
     return bmcl::None;
 }
 
@@ -479,6 +489,11 @@ bool WaypointGcInterface::encodeSetRoutePointCmd(std::uintmax_t id, std::uintmax
     TRY(beginNavCmd(_setRoutePointCmd.get(), dest));
     TRY(dest->writeVarUint(id));
     TRY(dest->writeVarUint(pointIndex));
+    return encodeWaypoint(wp, dest);
+}
+
+bool WaypointGcInterface::encodeWaypoint(const Waypoint& wp, Encoder* dest) const
+{
     TRY(dest->writeF64(wp.position.latLon.latitude));
     TRY(dest->writeF64(wp.position.latLon.longitude));
     TRY(dest->writeF64(wp.position.altitude));
@@ -534,6 +549,38 @@ bool WaypointGcInterface::encodeGetRoutePointCmd(uintmax_t id, uintmax_t pointIn
     return dest->writeVarUint(pointIndex);
 }
 
+bool WaypointGcInterface::encodeGetRouteChecksumCmd(uintmax_t id, Encoder* dest) const
+{
+    if (_getRouteChecksumCmd.isNull()) {
+        return false;
+    }
+    TRY(beginNavCmd(_getRouteChecksumCmd.get(), dest));
+    return dest->writeVarUint(id);
+}
+
+bool WaypointGcInterface::hasRouteChecksumCmd() const
+{
+    return !_getRouteChecksumCmd.isNull();
+}
+
+bool WaypointGcInterface::calculateRouteChecksum(const std::vector<Waypoint>& waypoints, uint16_t* dest) const
+{
+    Crc16 crc;
+    for (const Waypoint& wp : waypoints) {
+        uint8_t tmp[1024];
+        Encoder encoder(tmp, sizeof(tmp));
+        TRY(encodeWaypoint(wp, &encoder));
+        crc.update(encoder.writenData());
+    }
+    *dest = crc.get();
+    return true;
+}
+
+bool WaypointGcInterface::decodeGetRouteChecksumResponse(Decoder* src, uint16_t* dest) const
+{
+    return src->readU16(dest);
+}
+
 static bool decodeRouteInfo(Decoder* src, RouteInfo* info)
 {
     TRY(src->readVarUint(&info->id));
@@ -664,9 +711,11 @@ bmcl::Option<std::string> FileGcInterface::init()
     _flComponent = _flModule->component().unwrap();
 
     GC_TRY(findCmd(_flComponent.get(), "beginFile", &_beginFileCmd));
-    GC_TRY(expectFieldNum(_beginFileCmd.get(), 2));
+    GC_TRY(expectFieldNum(_beginFileCmd.get(), 3));
     GC_TRY(expectField(_beginFileCmd.get(), 0, "id", varuintType));
     GC_TRY(expectField(_beginFileCmd.get(), 1, "size", varuintType));
+    GC_TRY(expectField(_beginFileCmd.get(), 2, "chunkSize", varuintType));
+    GC_TRY(expectReturnValue(_beginFileCmd.get(), varuintType));
 
     GC_TRY(findCmd(_flComponent.get(), "writeFile", &_writeFileCmd));
     GC_TRY(expectFieldNum(_writeFileCmd.get(), 3));
@@ -679,6 +728,20 @@ bmcl::Option<std::string> FileGcInterface::init()
     GC_TRY(expectField(_endFileCmd.get(), 0, "id", varuintType));
     GC_TRY(expectField(_endFileCmd.get(), 1, "size", varuintType));
 
+    if (findCmd(_flComponent.get(), "getFileProgress", &_getFileProgressCmd).isNone()) {
+        std::uintmax_t maxBitmapSize;
+        GC_TRY(findType<decode::StructType>(_flModule.get(), "FileProgress", &_fileProgressStruct));
+        GC_TRY(expectFieldNum(_fileProgressStruct.get(), 6));
+        GC_TRY(expectField(_fileProgressStruct.get(), 0, "isWriting", _coreIface->boolType()));
+        GC_TRY(expectField(_fileProgressStruct.get(), 1, "id", varuintType));
+        GC_TRY(expectField(_fileProgressStruct.get(), 2, "size", varuintType));
+        GC_TRY(expectField(_fileProgressStruct.get(), 3, "chunkSize", varuintType));
+        GC_TRY(expectField(_fileProgressStruct.get(), 4, "firstChunk", varuintType));
+        GC_TRY(expectDynArrayField(_fileProgressStruct->fieldAt(5), u8Type, &maxBitmapSize));
+        GC_TRY(expectFieldNum(_getFileProgressCmd.get(), 0));
+        GC_TRY(expectReturnValue(_getFileProgressCmd.get(), _fileProgressStruct.get()));
+    }
+
     return bmcl::None;
 }
 
@@ -695,11 +758,12 @@ bool FileGcInterface::beginCmd(const decode::Function* func, Encoder* dest) cons
     return dest->writeVarUint(std::distance(_flComponent->cmdsBegin(), it));
 }
 
-bool FileGcInterface::encodeBeginFile(uintmax_t id, uintmax_t size, Encoder* dest) const
+bool FileGcInterface::encodeBeginFile(uintmax_t id, uintmax_t size, uintmax_t chunkSize, Encoder* dest) const
 {
     TRY(beginCmd(_beginFileCmd.get(), dest));
     TRY(dest->writeVarUint(id));
-    return dest->writeVarUint(size);
+    TRY(dest->writeVarUint(size));
+    return dest->writeVarUint(chunkSize);
 }
 
 bool FileGcInterface::encodeWriteFile(uintmax_t id, uintmax_t offset, bmcl::Bytes data, Encoder* dest) const
@@ -721,6 +785,47 @@ bool FileGcInterface::encodeEndFile(uintmax_t id, uintmax_t size, Encoder* dest)
     return dest->writeVarUint(size);
 }
 
+bool FileGcInterface::encodeGetFileProgress(Encoder* dest) const
+{
+    if (_getFileProgressCmd.isNull()) {
+        return false;
+    }
+    return beginCmd(_getFileProgressCmd.get(), dest);
+}
+
+bool FileGcInterface::decodeBeginFileResponse(Decoder* src, uint64_t* chunkSize) const
+{
+    return src->readVarUint(chunkSize);
+}
+
+bool FileGcInterface::decodeEndFileResponse(Decoder* src, uint32_t* checksum) const
+{
+    return src->readU32(checksum);
+}
+
+bool FileGcInterface::decodeGetFileProgressResponse(Decoder* src, FileProgress* dest) const
+{
+    TRY(src->readBool(&dest->isWriting));
+    TRY(src->readVarUint(&dest->id));
+    TRY(src->readVarUint(&dest->size));
+    TRY(src->readVarUint(&dest->chunkSize));
+    TRY(src->readVarUint(&dest->firstChunk));
+    uint64_t bitmapSize;
+    TRY(src->readDynArraySize(&bitmapSize));
+    dest->received.clear();
+    for (uint64_t i = 0; i < bitmapSize; i++) {
+        uint8_t value;
+        TRY(src->readU8(&value));
+        dest->received.push_back(value);
+    }
+    return true;
+}
+
+bool FileGcInterface::hasFileProgressCmd() const
+{
+    return !_getFileProgressCmd.isNull();
+}
+
 std::uintmax_t FileGcInterface::maxFileChunkSize() const
 {
     return _maxChunkSize;
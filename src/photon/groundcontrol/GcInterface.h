@@ -77,10 +77,18 @@ public:
     bool encodeGetRouteInfoCmd(uintmax_t id, Encoder* dest) const;
     bool encodeGetRoutePointCmd(uintmax_t id, uintmax_t pointIndex, Encoder* dest) const;
     bool encodeGetRoutesInfoCmd(Encoder* dest) const;
+    bool encodeGetRouteChecksumCmd(uintmax_t id, Encoder* dest) const;
+    bool encodeWaypoint(const Waypoint& wp, Encoder* dest) const;
 
     bool decodeGetRoutesInfoResponse(Decoder* src, AllRoutesInfo* dest) const;
     bool decodeGetRouteInfoResponse(Decoder* src, RouteInfo* dest) const;
     bool decodeGetRoutePointResponse(Decoder* src, Waypoint* dest) const;
+    bool decodeGetRouteChecksumResponse(Decoder* src, uint16_t* dest) const;
+
+    // getRouteChecksum command is optional, routes are not verified if it is missing
+    bool hasRouteChecksumCmd() const;
+    // crc16 of serialized waypoints, same as returned by getRouteChecksum
+    bool calculateRouteChecksum(const std::vector<Waypoint>& waypoints, uint16_t* dest) const;
 
 private:
     WaypointGcInterface(const decode::Device* dev, const CoreGcInterface* coreIface);
@@ -115,6 +123,7 @@ private:
     Rc<const decode::Function> _getRoutesInfoCmd;
     Rc<const decode::Function> _getRouteInfoCmd;
     Rc<const decode::Function> _getRoutePointCmd;
+    Rc<const decode::Function> _getRouteChecksumCmd;
     std::size_t _formationArrayMaxSize;
     std::size_t _allRoutesInfoMaxSize;
 };
@@ -125,9 +134,18 @@ public:
 
     static GcInterfaceResult<FileGcInterface> create(const decode::Device* dev, const CoreGcInterface* coreIface);
 
-    bool encodeBeginFile(uintmax_t id, uintmax_t size, Encoder* dest) const;
+    bool encodeBeginFile(uintmax_t id, uintmax_t size, uintmax_t chunkSize, Encoder* dest) const;
     bool encodeWriteFile(uintmax_t id, uintmax_t offset, bmcl::Bytes data, Encoder* dest) const;
     bool encodeEndFile(uintmax_t id, uintmax_t size, Encoder* dest) const;
+    bool encodeGetFileProgress(Encoder* dest) const;
+
+    // onboard may decrease requested chunk size
+    bool decodeBeginFileResponse(Decoder* src, uint64_t* chunkSize) const;
+    bool decodeEndFileResponse(Decoder* src, uint32_t* checksum) const;
+    bool decodeGetFileProgressResponse(Decoder* src, FileProgress* dest) const;
+
+    // getFileProgress command is optional, interrupted uploads are restarted if it is missing
+    bool hasFileProgressCmd() const;
 
     std::uintmax_t maxFileChunkSize() const;
 
@@ -143,6 +161,8 @@ private:
     Rc<const decode::Function> _beginFileCmd;
     Rc<const decode::Function> _writeFileCmd;
     Rc<const decode::Function> _endFileCmd;
+    Rc<const decode::Function> _getFileProgressCmd;
+    Rc<const decode::StructType> _fileProgressStruct;
     std::uintmax_t _maxChunkSize;
 };
 
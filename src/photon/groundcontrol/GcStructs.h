@@ -112,4 +112,15 @@ struct Route {
     std::vector<Waypoint> waypoints;
     RouteInfo info;
 };
+
+struct FileProgress {
+    bool isWriting;
+    uint64_t id;
+    uint64_t size;
+    uint64_t chunkSize;
+    // all chunks before it are received
+    uint64_t firstChunk;
+    // bit per received chunk starting from firstChunk
+    std::vector<uint8_t> received;
+};
 };
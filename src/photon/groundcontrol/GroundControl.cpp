@@ -19,15 +19,18 @@
 #include "photon/groundcontrol/GcCmd.h"
 #include "photon/groundcontrol/ProjectUpdate.h"
 #include "photon/groundcontrol/TmState.h"
+#include "photon/groundcontrol/TmProcessor.h"
 
 #include <bmcl/Logging.h>
 #include <bmcl/Bytes.h>
 #include <bmcl/MemReader.h>
+#include <bmcl/Result.h>
 #include <bmcl/SharedBytes.h>
 
 DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(bmcl::SharedBytes);
 DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(photon::PacketRequest);
 DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(photon::PacketResponse);
+DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(photon::PacketHeader);
 DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(decode::Project::ConstPointer);
 DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(decode::Device::ConstPointer);
 DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(decode::DataReader::Pointer);
@@ -45,14 +48,21 @@ DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(photon::NumberedSub);
 namespace photon {
 
 GroundControl::GroundControl(caf::actor_config& cfg, uint64_t selfAddress, uint64_t destAddress,
-                             const caf::actor& sink, const caf::actor& eventHandler)
+                             const caf::actor& sink, const caf::actor& eventHandler,
+                             PipelineMode mode)
     : caf::event_based_actor(cfg)
     , _sink(sink)
     , _handler(eventHandler)
+    , _selfAddress(selfAddress)
+    , _deviceAddress(destAddress)
+    , _mode(mode)
     , _isRunning(false)
     , _isLoggingEnabled(false)
 {
-    _exc = spawn<Exchange, caf::linked>(selfAddress, destAddress, this, _sink, _handler);
+    if (mode == PipelineMode::Fused) {
+        _tm.reset(new TmProcessor(this, _handler));
+    }
+    _exc = spawn<Exchange, caf::linked>(selfAddress, destAddress, this, _sink, _handler, mode);
     _cmd = spawn<CmdState, caf::linked>(_exc, _handler);
 }
 
@@ -71,6 +81,21 @@ caf::behavior GroundControl::make_behavior()
         [this](RecvDataAtom, const bmcl::SharedBytes& data) {
             acceptData(data);
         },
+        [this](RecvPacketAtom, const bmcl::SharedBytes& packet) {
+            if (!_isRunning) {
+                GC_LOG("gc not running");
+                return;
+            }
+            acceptPacket(packet.view());
+        },
+        [this](RecvPacketPayloadAtom, const PacketHeader& header, const bmcl::SharedBytes& data) {
+            // already decoded telemetry, see BlogReplay
+            if (_mode == PipelineMode::Fused) {
+                _tm->acceptData(header, data.view());
+                return;
+            }
+            send(_exc, RecvPacketPayloadAtom::value, header, data);
+        },
         [this](SendUnreliablePacketAtom, const PacketRequest& packet) {
             sendUnreliablePacket(packet);
         },
@@ -80,10 +105,16 @@ caf::behavior GroundControl::make_behavior()
         [this](SendGcCommandAtom atom, const GcCmd& cmd) {
             return delegate(_cmd, atom, cmd);
         },
-        [this](SubscribeNumberedTmAtom atom, const NumberedSub& sub, const caf::actor& dest) {
+        [this](SubscribeNumberedTmAtom atom, const NumberedSub& sub, const caf::actor& dest) -> caf::result<bool> {
+            if (_tm) {
+                return _tm->subscribeTm(sub, dest);
+            }
             return delegate(_exc, atom, sub, dest);
         },
-        [this](SubscribeNamedTmAtom atom, const std::string& path, const caf::actor& dest) {
+        [this](SubscribeNamedTmAtom atom, const std::string& path, const caf::actor& dest) -> caf::result<bool> {
+            if (_tm) {
+                return _tm->subscribeTm(path, dest);
+            }
             return delegate(_exc, atom, path, dest);
         },
         [this](SendCustomCommandAtom atom, const std::string& compName, const std::string& cmdName, const std::vector<Value>& args) {
@@ -105,6 +136,9 @@ caf::behavior GroundControl::make_behavior()
         },
         [this](EnableLoggindAtom, bool isEnabled) {
             send(_exc, EnableLoggindAtom::value, isEnabled);
+            if (_tm) {
+                _tm->setLoggingEnabled(isEnabled);
+            }
             _isLoggingEnabled = isEnabled;
         },
         [this](UpdateFirmware) {
@@ -116,6 +150,9 @@ caf::behavior GroundControl::make_behavior()
         [this](FlashDfuFirmware atom, std::uintmax_t id, const Rc<decode::DataReader>& reader) {
             return delegate(_exc, atom, id, reader);
         },
+        [this](FlashDfuPatch atom, std::uintmax_t baseId, std::uintmax_t id, const Rc<decode::DataReader>& base, const Rc<decode::DataReader>& reader) {
+            return delegate(_exc, atom, baseId, id, base, reader);
+        },
     };
 }
 
@@ -141,6 +178,9 @@ void GroundControl::updateProject(const ProjectUpdate::ConstPointer& update)
 {
     _project = update->project();
     _dev = update->device();
+    if (_tm) {
+        _tm->setProject(update.get());
+    }
     send(_cmd, SetProjectAtom::value, update);
     send(_exc, SetProjectAtom::value, update);
     send(_handler, SetProjectAtom::value, update);
@@ -197,7 +237,38 @@ bool GroundControl::acceptPacket(bmcl::Bytes packet)
         return false;
     }
 
-    send(_exc, RecvPayloadAtom::value, bmcl::SharedBytes::create(packet.data() + 2, payloadSize - 2));
+    bmcl::Bytes payload(packet.data() + 2, payloadSize - 2);
+    if (_mode == PipelineMode::Fused) {
+        return acceptFusedPayload(payload);
+    }
+    send(_exc, RecvPayloadAtom::value, bmcl::SharedBytes::create(payload));
+    return true;
+}
+
+bool GroundControl::acceptFusedPayload(bmcl::Bytes payload)
+{
+    bmcl::MemReader reader(payload);
+    auto rv = Exchange::decodeHeader(&reader);
+    if (rv.isErr() || rv.unwrap().streamType != StreamType::Telem) {
+        // everything except telemetry still goes through Exchange which reports errors
+        send(_exc, RecvPayloadAtom::value, bmcl::SharedBytes::create(payload));
+        return true;
+    }
+
+    const PacketHeader& header = rv.unwrap();
+    if (header.srcAddress != _deviceAddress) {
+        send(_handler, ExchangeErrorEventAtom::value, std::string("recieved wrong src address"));
+        return true;
+    }
+    if (header.destAddress != _selfAddress) {
+        send(_handler, ExchangeErrorEventAtom::value, std::string("recieved wrong dest address"));
+        return true;
+    }
+    if (header.streamDirection != StreamDirection::Downlink || header.packetType != PacketType::Unreliable) {
+        send(_handler, ExchangeErrorEventAtom::value, std::string("recieved invalid tm packet"));
+        return true;
+    }
+    _tm->acceptData(header, bmcl::Bytes(reader.current(), reader.end()));
     return true;
 }
 
@@ -10,12 +10,14 @@
 
 #include "photon/Config.hpp"
 #include "photon/core/Rc.h"
+#include "photon/groundcontrol/Packet.h"
 
 #include <bmcl/Fwd.h>
 #include <bmcl/Buffer.h>
 
 #include <caf/event_based_actor.hpp>
 
+#include <memory>
 #include <string>
 
 namespace decode {
@@ -32,6 +34,7 @@ class GcTmState;
 class Model;
 struct PacketRequest;
 class ProjectUpdate;
+class TmProcessor;
 
 struct SearchResult {
 public:
@@ -59,7 +62,8 @@ struct PacketAddress {
 class GroundControl : public caf::event_based_actor {
 public:
     GroundControl(caf::actor_config& cfg, uint64_t selfAddress, uint64_t deviceAddress,
-                  const caf::actor& sink, const caf::actor& eventHandler);
+                  const caf::actor& sink, const caf::actor& eventHandler,
+                  PipelineMode mode = PipelineMode::Actors);
     ~GroundControl();
 
     caf::behavior make_behavior() override;
@@ -76,6 +80,7 @@ private:
     void sendUnreliablePacket(const PacketRequest& packet);
     void acceptData(const bmcl::SharedBytes& data);
     bool acceptPacket(bmcl::Bytes packet);
+    bool acceptFusedPayload(bmcl::Bytes payload);
     void reportError(std::string&& msg);
 
     void updateProject(const Rc<const ProjectUpdate>& update);
@@ -85,9 +90,13 @@ private:
     caf::actor _handler;
     caf::actor _exc;
     caf::actor _cmd;
+    std::unique_ptr<TmProcessor> _tm;
     bmcl::Buffer _incoming;
     Rc<const decode::Project> _project;
     Rc<const decode::Device> _dev;
+    uint64_t _selfAddress;
+    uint64_t _deviceAddress;
+    PipelineMode _mode;
     bool _isRunning;
     bool _isLoggingEnabled;
 };
@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "photon/groundcontrol/LinkBond.h"
+#include "photon/groundcontrol/GroundControl.h"
+#include "photon/groundcontrol/Exchange.h"
+#include "photon/groundcontrol/Atoms.h"
+#include "photon/groundcontrol/AllowUnsafeMessageType.h"
+
+#include <bmcl/Bytes.h>
+#include <bmcl/MemReader.h>
+#include <bmcl/Result.h>
+
+#include <algorithm>
+
+DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(bmcl::SharedBytes);
+
+namespace photon {
+
+using CheckLinksAtom = caf::atom_constant<caf::atom("chklinks")>;
+
+constexpr std::size_t windowSize = 64;
+
+DuplicateFilter::DuplicateFilter(std::chrono::milliseconds timeout)
+    : _timeout(timeout)
+{
+    reset();
+}
+
+void DuplicateFilter::reset()
+{
+    for (Window& window : _windows) {
+        window.isValid = false;
+    }
+}
+
+void DuplicateFilter::resetWindow(Window* window, uint16_t counter, Clock::time_point now)
+{
+    window->lastTime = now;
+    window->mask = 1;
+    window->lastCounter = counter;
+    window->isValid = true;
+}
+
+bool DuplicateFilter::isDuplicate(const PacketHeader& header, Clock::time_point now, Clock::duration* delay)
+{
+    *delay = Clock::duration::zero();
+    std::size_t index = std::size_t(header.streamType) * 3 + std::size_t(header.packetType);
+    if (index >= _windows.size()) {
+        return false;
+    }
+    Window* window = &_windows[index];
+    if (!window->isValid || (now - window->lastTime) > _timeout) {
+        resetWindow(window, header.counter, now);
+        return false;
+    }
+
+    int16_t delta = int16_t(uint16_t(header.counter - window->lastCounter));
+    if (delta > 0) {
+        if (std::size_t(delta) >= windowSize) {
+            window->mask = 1;
+        } else {
+            window->mask = (window->mask << delta) | 1;
+        }
+        window->lastCounter = header.counter;
+        window->lastTime = now;
+        return false;
+    }
+
+    std::size_t distance = -int32_t(delta);
+    if (distance >= windowSize) {
+        // counter went far back, device was restarted
+        resetWindow(window, header.counter, now);
+        return false;
+    }
+    uint64_t bit = uint64_t(1) << distance;
+    if (window->mask & bit) {
+        *delay = now - window->lastTime;
+        return true;
+    }
+    window->mask |= bit;
+    return false;
+}
+
+LinkBond::Link::Link(const caf::actor& actor)
+    : actor(actor)
+    , lastRecvTime(Clock::now())
+    , latency(0)
+    , recievedPackets(0)
+    , duplicatePackets(0)
+    , sentPackets(0)
+    , isHealthy(true)
+{
+}
+
+LinkBond::LinkBond(caf::actor_config& cfg, const caf::actor& eventHandler,
+                   const std::vector<StreamType>& criticalStreams, std::chrono::milliseconds healthTimeout)
+    : caf::event_based_actor(cfg)
+    , _handler(eventHandler)
+    , _healthTimeout(healthTimeout)
+    , _criticalStreams(0)
+    , _isRunning(false)
+{
+    for (StreamType type : criticalStreams) {
+        _criticalStreams |= 1u << unsigned(type);
+    }
+    set_down_handler([this](caf::down_msg& dm) {
+        removeLink(dm.source);
+    });
+}
+
+LinkBond::~LinkBond()
+{
+}
+
+caf::behavior LinkBond::make_behavior()
+{
+    return caf::behavior{
+        [this](RecvDataAtom, const bmcl::SharedBytes& data) {
+            auto sender = caf::actor_cast<caf::actor_addr>(current_sender());
+            Link* link = findLink(sender);
+            if (link) {
+                acceptDownlink(link, data);
+            } else {
+                sendUplink(data);
+            }
+        },
+        [this](SetStreamDestAtom, const caf::actor& actor) {
+            _dest = actor;
+        },
+        [this](AddLinkAtom, const caf::actor& actor) {
+            addLink(actor);
+        },
+        [this](RemoveLinkAtom, const caf::actor& actor) {
+            demonitor(actor);
+            removeLink(actor.address());
+        },
+        [this](StartAtom) {
+            if (_isRunning) {
+                return;
+            }
+            _isRunning = true;
+            for (const Link& link : _links) {
+                send(link.actor, StartAtom::value);
+            }
+            delayed_send(this, _healthTimeout / 4, CheckLinksAtom::value);
+        },
+        [this](CheckLinksAtom) {
+            checkLinks();
+            delayed_send(this, _healthTimeout / 4, CheckLinksAtom::value);
+        },
+    };
+}
+
+const char* LinkBond::name() const
+{
+    return "LinkBond";
+}
+
+void LinkBond::on_exit()
+{
+    for (Link& link : _links) {
+        destroy(link.actor);
+    }
+    _links.clear();
+    destroy(_dest);
+    destroy(_handler);
+}
+
+void LinkBond::logMsg(std::string&& msg)
+{
+    send(_handler, LogAtom::value, std::move(msg));
+}
+
+LinkBond::Link* LinkBond::findLink(const caf::actor_addr& addr)
+{
+    for (Link& link : _links) {
+        if (link.actor.address() == addr) {
+            return &link;
+        }
+    }
+    return nullptr;
+}
+
+void LinkBond::addLink(const caf::actor& actor)
+{
+    if (findLink(actor.address())) {
+        return;
+    }
+    _links.emplace_back(actor);
+    monitor(actor);
+    send(actor, SetStreamDestAtom::value, caf::actor_cast<caf::actor>(this));
+    if (_isRunning) {
+        send(actor, StartAtom::value);
+    }
+}
+
+void LinkBond::removeLink(const caf::actor_addr& addr)
+{
+    auto it = std::find_if(_links.begin(), _links.end(), [&addr](const Link& link) {
+        return link.actor.address() == addr;
+    });
+    if (it == _links.end()) {
+        return;
+    }
+    _links.erase(it);
+    if (_primary == addr) {
+        // primary is kept until replaced so that failover treats removed link as degraded
+        checkLinks();
+    }
+}
+
+void LinkBond::acceptDownlink(Link* link, const bmcl::SharedBytes& data)
+{
+    link->incoming.write(data.data(), data.size());
+    Clock::time_point now = Clock::now();
+
+    while (link->incoming.size() != 0) {
+        SearchResult rv = GroundControl::findPacket(link->incoming);
+        if (rv.dataSize == 0) {
+            if (rv.junkSize) {
+                link->incoming.removeFront(rv.junkSize);
+            }
+            return;
+        }
+        acceptDownlinkPacket(link, link->incoming.asBytes().slice(rv.junkSize, rv.junkSize + rv.dataSize), now);
+        link->incoming.removeFront(rv.junkSize + rv.dataSize);
+    }
+}
+
+void LinkBond::acceptDownlinkPacket(Link* link, bmcl::Bytes packet, Clock::time_point now)
+{
+    link->lastRecvTime = now;
+    link->recievedPackets++;
+
+    // [u16 sep, u16 size, header, payload, u16 crc]
+    bmcl::MemReader reader(packet.data() + 4, packet.size() - 6);
+    auto header = Exchange::decodeHeader(&reader);
+    if (header.isOk()) {
+        Clock::duration delay;
+        if (_filter.isDuplicate(header.unwrap(), now, &delay)) {
+            link->duplicatePackets++;
+            double sample = std::chrono::duration<double, std::micro>(delay).count();
+            link->latency += (sample - link->latency) / 8;
+            return;
+        }
+        link->latency -= link->latency / 8;
+
+        const PacketHeader& h = header.unwrap();
+        std::size_t index = std::size_t(h.streamType);
+        if (h.packetType == PacketType::Receipt && index < _pendingUplink.size()) {
+            bmcl::Option<PendingUplink>& pending = _pendingUplink[index];
+            if (pending.isSome() && pending->counter == h.counter) {
+                pending.clear();
+            }
+        }
+    }
+
+    send(_dest, RecvPacketAtom::value, bmcl::SharedBytes::create(packet));
+}
+
+LinkBond::Link* LinkBond::selectPrimaryLink()
+{
+    Link* best = nullptr;
+    for (Link& link : _links) {
+        if (!link.isHealthy) {
+            continue;
+        }
+        if (!best || link.latency < best->latency) {
+            best = &link;
+        }
+    }
+    return best;
+}
+
+void LinkBond::checkLinks()
+{
+    Clock::time_point now = Clock::now();
+    for (Link& link : _links) {
+        link.isHealthy = (now - link.lastRecvTime) < _healthTimeout;
+    }
+    Link* primary = selectPrimaryLink();
+    if (primary && primary->actor.address() != _primary) {
+        failover(primary);
+    }
+}
+
+void LinkBond::failover(Link* newPrimary)
+{
+    bool hadPrimary = _primary != caf::actor_addr();
+    Link* oldPrimary = findLink(_primary);
+    bool isDegraded = !oldPrimary || !oldPrimary->isHealthy;
+    _primary = newPrimary->actor.address();
+    if (!hadPrimary) {
+        return;
+    }
+    logMsg("switching uplink to link " + caf::to_string(_primary));
+    if (!isDegraded) {
+        // lower latency link, packets sent over healthy old primary are still delivered
+        return;
+    }
+    // resend unacknowledged reliable packets without waiting for exchange timeouts
+    for (const bmcl::Option<PendingUplink>& pending : _pendingUplink) {
+        if (pending.isSome()) {
+            send(newPrimary->actor, RecvDataAtom::value, pending->packet);
+            newPrimary->sentPackets++;
+        }
+    }
+}
+
+void LinkBond::sendUplink(const bmcl::SharedBytes& data)
+{
+    Clock::time_point now = Clock::now();
+    for (Link& link : _links) {
+        link.isHealthy = (now - link.lastRecvTime) < _healthTimeout;
+    }
+    Link* primary = selectPrimaryLink();
+    if (primary && primary->actor.address() != _primary) {
+        failover(primary);
+    }
+
+    bool isCritical = false;
+    if (data.size() >= 6) {
+        bmcl::MemReader reader(data.data() + 4, data.size() - 6);
+        auto header = Exchange::decodeHeader(&reader);
+        if (header.isOk()) {
+            const PacketHeader& h = header.unwrap();
+            isCritical = _criticalStreams & (1u << unsigned(h.streamType));
+            std::size_t index = std::size_t(h.streamType);
+            if (h.packetType == PacketType::Reliable && index < _pendingUplink.size()) {
+                _pendingUplink[index] = PendingUplink{data, h.counter};
+            }
+        }
+    }
+
+    if (primary && !isCritical) {
+        send(primary->actor, RecvDataAtom::value, data);
+        primary->sentPackets++;
+        return;
+    }
+
+    // critical stream or no healthy links left, use everything
+    for (Link& link : _links) {
+        if (primary && !link.isHealthy) {
+            continue;
+        }
+        send(link.actor, RecvDataAtom::value, data);
+        link.sentPackets++;
+    }
+}
+}
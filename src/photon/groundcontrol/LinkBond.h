@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "photon/Config.hpp"
+#include "photon/groundcontrol/Packet.h"
+
+#include <bmcl/Fwd.h>
+#include <bmcl/Buffer.h>
+#include <bmcl/Option.h>
+#include <bmcl/SharedBytes.h>
+
+#include <caf/event_based_actor.hpp>
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace photon {
+
+// drops packets with already seen (stream, packet type, counter) triplets
+class DuplicateFilter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit DuplicateFilter(std::chrono::milliseconds timeout = std::chrono::milliseconds(2000));
+
+    // returns true if the packet was already accepted, delay is set to time passed since newest accepted packet
+    bool isDuplicate(const PacketHeader& header, Clock::time_point now, Clock::duration* delay);
+    void reset();
+
+private:
+    struct Window {
+        Clock::time_point lastTime;
+        uint64_t mask;
+        uint16_t lastCounter;
+        bool isValid;
+    };
+
+    void resetWindow(Window* window, uint16_t counter, Clock::time_point now);
+
+    std::array<Window, 5 * 3> _windows;
+    std::chrono::milliseconds _timeout;
+};
+
+// Joins several links (stream actors) connected to the same device into one stream.
+// Downlink packets are deduplicated using exchange counters, uplink packets are sent over
+// the healthy link with the lowest latency, packets of critical streams are sent over all healthy links.
+// Used in place of a stream actor: GroundControl sink is set to LinkBond and stream dest of LinkBond to GroundControl.
+class LinkBond : public caf::event_based_actor {
+public:
+    LinkBond(caf::actor_config& cfg, const caf::actor& eventHandler,
+             const std::vector<StreamType>& criticalStreams = std::vector<StreamType>(),
+             std::chrono::milliseconds healthTimeout = std::chrono::milliseconds(500));
+    ~LinkBond();
+
+    caf::behavior make_behavior() override;
+    const char* name() const override;
+    void on_exit() override;
+
+private:
+    using Clock = DuplicateFilter::Clock;
+
+    struct Link {
+        explicit Link(const caf::actor& actor);
+
+        caf::actor actor;
+        bmcl::Buffer incoming;
+        Clock::time_point lastRecvTime;
+        double latency; // relative to the fastest link, microseconds
+        uint64_t recievedPackets;
+        uint64_t duplicatePackets;
+        uint64_t sentPackets;
+        bool isHealthy;
+    };
+
+    struct PendingUplink {
+        bmcl::SharedBytes packet;
+        uint16_t counter;
+    };
+
+    void addLink(const caf::actor& actor);
+    void removeLink(const caf::actor_addr& addr);
+    Link* findLink(const caf::actor_addr& addr);
+    void acceptDownlink(Link* link, const bmcl::SharedBytes& data);
+    void acceptDownlinkPacket(Link* link, bmcl::Bytes packet, Clock::time_point now);
+    void sendUplink(const bmcl::SharedBytes& data);
+    Link* selectPrimaryLink();
+    void checkLinks();
+    void failover(Link* newPrimary);
+    void logMsg(std::string&& msg);
+
+    std::vector<Link> _links;
+    std::array<bmcl::Option<PendingUplink>, 5> _pendingUplink;
+    DuplicateFilter _filter;
+    caf::actor _dest;
+    caf::actor _handler;
+    caf::actor_addr _primary;
+    std::chrono::milliseconds _healthTimeout;
+    uint32_t _criticalStreams;
+    bool _isRunning;
+};
+}
@@ -0,0 +1,632 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "photon/groundcontrol/LogRecord.h"
+
+#include <bmcl/Bytes.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace photon {
+
+constexpr const std::size_t recordHeaderSize = 23;
+constexpr const std::size_t argValueSize = 8;
+
+struct FormatSpec {
+    std::size_t begin;
+    // first char of length modifier or conversion
+    std::size_t lengthBegin;
+    std::size_t end;
+    unsigned starCount;
+    bool isValid;
+    LogArgKind kind;
+    char conversion;
+};
+
+int64_t LogArg::asInt() const
+{
+    return int64_t(value);
+}
+
+double LogArg::asDouble() const
+{
+    double d;
+    std::memcpy(&d, &value, sizeof(d));
+    return d;
+}
+
+static uint64_t readLe(const uint8_t* src, std::size_t size)
+{
+    uint64_t value = 0;
+    for (std::size_t i = 0; i < size; i++) {
+        value |= uint64_t(src[i]) << (i * 8);
+    }
+    return value;
+}
+
+static bool decodeArgs(const uint8_t* current, const uint8_t* end, std::vector<LogArg>* dest)
+{
+    while (current != end) {
+        LogArg arg;
+        arg.kind = LogArgKind(*current);
+        arg.value = 0;
+        current++;
+        switch (arg.kind) {
+        case LogArgKind::Int:
+        case LogArgKind::Uint:
+        case LogArgKind::Double:
+        case LogArgKind::Ptr:
+            if (std::size_t(end - current) < argValueSize) {
+                return false;
+            }
+            arg.value = readLe(current, argValueSize);
+            current += argValueSize;
+            break;
+        case LogArgKind::String: {
+            if (current == end || std::size_t(end - current) < 1u + *current) {
+                return false;
+            }
+            std::size_t size = *current;
+            arg.str.assign((const char*)current + 1, size);
+            current += 1 + size;
+            break;
+        }
+        default:
+            return false;
+        }
+        dest->push_back(std::move(arg));
+    }
+    return true;
+}
+
+bool decodeLogRecords(bmcl::Bytes data, std::vector<LogRecord>* dest)
+{
+    const uint8_t* current = data.data();
+    const uint8_t* end = data.data() + data.size();
+    while (current != end) {
+        if (std::size_t(end - current) < recordHeaderSize) {
+            return false;
+        }
+        std::size_t size = readLe(current, 2);
+        if (size < recordHeaderSize || size > std::size_t(end - current)) {
+            return false;
+        }
+        LogRecord record;
+        record.level = current[2];
+        record.line = uint32_t(readLe(current + 3, 4));
+        record.time = int64_t(readLe(current + 7, 8));
+        record.fnameId = uint32_t(readLe(current + 15, 4));
+        record.fmtId = uint32_t(readLe(current + 19, 4));
+        if (!decodeArgs(current + recordHeaderSize, current + size, &record.args)) {
+            return false;
+        }
+        dest->push_back(std::move(record));
+        current += size;
+    }
+    return true;
+}
+
+// same parsing as nextSpec in Logging.c, %% is skipped
+static std::size_t nextSpec(const std::string& fmt, std::size_t pos, FormatSpec* spec)
+{
+    while (true) {
+        pos = fmt.find('%', pos);
+        if (pos == std::string::npos) {
+            return pos;
+        }
+        if (pos + 1 >= fmt.size() || fmt[pos + 1] != '%') {
+            break;
+        }
+        pos += 2;
+    }
+    spec->begin = pos;
+    spec->starCount = 0;
+    std::size_t p = pos + 1;
+    while (p < fmt.size() && fmt[p] != '\0' && std::strchr("-+ #0123456789.*", fmt[p])) {
+        if (fmt[p] == '*') {
+            spec->starCount++;
+        }
+        p++;
+    }
+    spec->lengthBegin = p;
+    if (p < fmt.size() && (fmt[p] == 'h' || fmt[p] == 'l')) {
+        p++;
+        if (p < fmt.size() && fmt[p] == fmt[p - 1]) {
+            p++;
+        }
+    } else if (p < fmt.size() && fmt[p] != '\0' && std::strchr("zjtL", fmt[p])) {
+        p++;
+    }
+    spec->conversion = p < fmt.size() ? fmt[p] : '\0';
+    spec->isValid = true;
+    switch (spec->conversion) {
+    case 'd':
+    case 'i':
+    case 'c':
+        spec->kind = LogArgKind::Int;
+        break;
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+        spec->kind = LogArgKind::Uint;
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        spec->kind = LogArgKind::Double;
+        break;
+    case 's':
+        spec->kind = LogArgKind::String;
+        break;
+    case 'p':
+        spec->kind = LogArgKind::Ptr;
+        break;
+    default:
+        // %n and invalid specifiers are not supported
+        spec->isValid = false;
+        break;
+    }
+    if (p < fmt.size()) {
+        p++;
+    }
+    spec->end = p;
+    return pos;
+}
+
+// literal text, %% is printed as single %
+static void appendLiteral(std::string* dest, const std::string& fmt, std::size_t begin, std::size_t end)
+{
+    while (begin < end) {
+        std::size_t percent = fmt.find("%%", begin);
+        if (percent == std::string::npos || percent >= end) {
+            dest->append(fmt, begin, end - begin);
+            return;
+        }
+        dest->append(fmt, begin, percent - begin + 1);
+        begin = percent + 2;
+    }
+}
+
+template <typename T>
+static int printFormatted(char* dest, std::size_t size, const char* spec, const int* stars, unsigned starCount, T value)
+{
+    switch (starCount) {
+    case 0:
+        return std::snprintf(dest, size, spec, value);
+    case 1:
+        return std::snprintf(dest, size, spec, stars[0], value);
+    default:
+        return std::snprintf(dest, size, spec, stars[0], stars[1], value);
+    }
+}
+
+template <typename T>
+static void appendFormatted(std::string* dest, const char* spec, const int* stars, unsigned starCount, T value)
+{
+    int size = printFormatted(nullptr, 0, spec, stars, starCount, value);
+    if (size <= 0) {
+        return;
+    }
+    std::vector<char> buf(size + 1);
+    printFormatted(buf.data(), buf.size(), spec, stars, starCount, value);
+    dest->append(buf.data(), size);
+}
+
+std::string formatLogRecord(const LogRecord& record, const std::string& fmt)
+{
+    std::string dest;
+    std::size_t it = 0;
+    std::size_t next;
+    auto arg = record.args.begin();
+    auto nextArg = [&record, &arg](LogArgKind kind) -> const LogArg* {
+        if (arg == record.args.end() || arg->kind != kind) {
+            return nullptr;
+        }
+        return &*arg++;
+    };
+    FormatSpec spec;
+    while ((next = nextSpec(fmt, it, &spec)) != std::string::npos) {
+        appendLiteral(&dest, fmt, it, next);
+        if (!spec.isValid || spec.starCount > 2) {
+            dest.append("...");
+            return dest;
+        }
+        // flags, width and precision are kept, length modifier is replaced to match stored value
+        std::string specStr = fmt.substr(spec.begin, spec.lengthBegin - spec.begin);
+        if ((spec.kind == LogArgKind::Int && spec.conversion != 'c') || spec.kind == LogArgKind::Uint) {
+            specStr.append("ll");
+        }
+        specStr.push_back(spec.conversion);
+        int stars[2];
+        for (unsigned i = 0; i < spec.starCount; i++) {
+            const LogArg* star = nextArg(LogArgKind::Int);
+            if (!star) {
+                dest.append("...");
+                return dest;
+            }
+            stars[i] = int(star->asInt());
+        }
+        const LogArg* value = nextArg(spec.kind);
+        if (!value) {
+            dest.append("...");
+            return dest;
+        }
+        switch (spec.kind) {
+        case LogArgKind::Int:
+            if (spec.conversion == 'c') {
+                appendFormatted(&dest, specStr.c_str(), stars, spec.starCount, int(value->asInt()));
+            } else {
+                appendFormatted(&dest, specStr.c_str(), stars, spec.starCount, (long long)value->asInt());
+            }
+            break;
+        case LogArgKind::Uint:
+            appendFormatted(&dest, specStr.c_str(), stars, spec.starCount, (unsigned long long)value->value);
+            break;
+        case LogArgKind::Double:
+            appendFormatted(&dest, specStr.c_str(), stars, spec.starCount, value->asDouble());
+            break;
+        case LogArgKind::Ptr:
+            appendFormatted(&dest, specStr.c_str(), stars, spec.starCount, (void*)uintptr_t(value->value));
+            break;
+        case LogArgKind::String:
+            appendFormatted(&dest, specStr.c_str(), stars, spec.starCount, value->str.c_str());
+            break;
+        }
+        it = spec.end;
+    }
+    appendLiteral(&dest, fmt, it, fmt.size());
+    return dest;
+}
+
+// FNV-1a
+uint32_t logStringId(const std::string& str)
+{
+    uint32_t hash = 2166136261u;
+    for (char c : str) {
+        hash ^= uint8_t(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void LogStringTable::add(const std::string& str)
+{
+    _strings.emplace(logStringId(str), str);
+}
+
+bool LogStringTable::load(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        add(unescapeLogString(line));
+    }
+    return !file.bad();
+}
+
+const std::string* LogStringTable::find(uint32_t id) const
+{
+    auto it = _strings.find(id);
+    if (it == _strings.end()) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+std::size_t LogStringTable::size() const
+{
+    return _strings.size();
+}
+
+std::string escapeLogString(const std::string& str)
+{
+    static const char* digits = "0123456789abcdef";
+    std::string dest;
+    for (char c : str) {
+        uint8_t b = c;
+        switch (c) {
+        case '\\':
+            dest.append("\\\\");
+            break;
+        case '\n':
+            dest.append("\\n");
+            break;
+        case '\r':
+            dest.append("\\r");
+            break;
+        case '\t':
+            dest.append("\\t");
+            break;
+        default:
+            if (b < 0x20 || b == 0x7f) {
+                dest.append("\\x");
+                dest.push_back(digits[b >> 4]);
+                dest.push_back(digits[b & 0xf]);
+            } else {
+                dest.push_back(c);
+            }
+        }
+    }
+    return dest;
+}
+
+static int hexDigit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+std::string unescapeLogString(const std::string& str)
+{
+    std::string dest;
+    for (std::size_t i = 0; i < str.size(); i++) {
+        if (str[i] != '\\' || i + 1 == str.size()) {
+            dest.push_back(str[i]);
+            continue;
+        }
+        i++;
+        switch (str[i]) {
+        case 'n':
+            dest.push_back('\n');
+            break;
+        case 'r':
+            dest.push_back('\r');
+            break;
+        case 't':
+            dest.push_back('\t');
+            break;
+        case 'x':
+            if (i + 2 < str.size() && hexDigit(str[i + 1]) >= 0 && hexDigit(str[i + 2]) >= 0) {
+                dest.push_back(char(hexDigit(str[i + 1]) * 16 + hexDigit(str[i + 2])));
+                i += 2;
+                break;
+            }
+            dest.push_back('x');
+            break;
+        default:
+            dest.push_back(str[i]);
+        }
+    }
+    return dest;
+}
+
+// reads c string literal contents after opening quote, returns position after closing quote
+static std::size_t readLiteral(const std::string& src, std::size_t i, std::string* dest)
+{
+    while (i < src.size() && src[i] != '"' && src[i] != '\n') {
+        if (src[i] != '\\' || i + 1 == src.size()) {
+            dest->push_back(src[i]);
+            i++;
+            continue;
+        }
+        i++;
+        char c = src[i];
+        i++;
+        switch (c) {
+        case 'n':
+            dest->push_back('\n');
+            break;
+        case 't':
+            dest->push_back('\t');
+            break;
+        case 'r':
+            dest->push_back('\r');
+            break;
+        case 'a':
+            dest->push_back('\a');
+            break;
+        case 'b':
+            dest->push_back('\b');
+            break;
+        case 'f':
+            dest->push_back('\f');
+            break;
+        case 'v':
+            dest->push_back('\v');
+            break;
+        case 'x': {
+            int value = 0;
+            while (i < src.size() && hexDigit(src[i]) >= 0) {
+                value = value * 16 + hexDigit(src[i]);
+                i++;
+            }
+            dest->push_back(char(value));
+            break;
+        }
+        case '\n':
+            // line continuation
+            break;
+        default:
+            if (c >= '0' && c <= '7') {
+                int value = c - '0';
+                for (int n = 0; n < 2 && i < src.size() && src[i] >= '0' && src[i] <= '7'; n++, i++) {
+                    value = value * 8 + (src[i] - '0');
+                }
+                dest->push_back(char(value));
+            } else {
+                dest->push_back(c);
+            }
+        }
+    }
+    if (i < src.size() && src[i] == '"') {
+        i++;
+    }
+    return i;
+}
+
+// length modifiers used by inttypes.h PRI* macros on supported targets and hosts
+struct PriProfile {
+    const char* size8;
+    const char* size16;
+    const char* size32;
+    const char* size64;
+    const char* sizeMax;
+    const char* sizePtr;
+    const char* fast16;
+    const char* fast32;
+};
+
+static const PriProfile priProfiles[] = {
+    // glibc, 64 bit
+    {"", "", "", "l", "l", "l", "l", "l"},
+    // glibc, 32 bit
+    {"", "", "", "ll", "ll", "", "", ""},
+    // newlib, 32 bit targets with int32_t defined as long
+    {"", "", "l", "ll", "ll", "", "", "l"},
+    {"hh", "h", "l", "ll", "ll", "", "", "l"},
+    // msvc and mingw
+    {"hh", "h", "", "ll", "ll", "ll", "", ""},
+    {"", "", "", "I64", "I64", "I64", "", ""},
+};
+
+// returns false if name is not a PRI* macro
+static bool expandPriMacro(const std::string& name, const PriProfile& profile, std::string* dest)
+{
+    if (name.size() < 5 || name.compare(0, 3, "PRI") != 0 || !std::strchr("diouxX", name[3])) {
+        return false;
+    }
+    std::string size = name.substr(4);
+    const char* modifier;
+    if (size == "8" || size == "LEAST8" || size == "FAST8") {
+        modifier = profile.size8;
+    } else if (size == "16" || size == "LEAST16") {
+        modifier = profile.size16;
+    } else if (size == "32" || size == "LEAST32") {
+        modifier = profile.size32;
+    } else if (size == "64" || size == "LEAST64" || size == "FAST64") {
+        modifier = profile.size64;
+    } else if (size == "FAST16") {
+        modifier = profile.fast16;
+    } else if (size == "FAST32") {
+        modifier = profile.fast32;
+    } else if (size == "MAX") {
+        modifier = profile.sizeMax;
+    } else if (size == "PTR") {
+        modifier = profile.sizePtr;
+    } else {
+        return false;
+    }
+    dest->append(modifier);
+    dest->push_back(name[3]);
+    return true;
+}
+
+std::vector<std::string> extractLogStrings(const std::string& source)
+{
+    std::vector<std::string> strings;
+    // adjacent literals and PRI* macros, macros are expanded when literal ends
+    std::vector<std::string> parts;
+    std::vector<bool> isMacro;
+    auto finish = [&]() {
+        if (parts.empty()) {
+            return;
+        }
+        bool hasMacros = std::find(isMacro.begin(), isMacro.end(), true) != isMacro.end();
+        std::size_t firstVariant = strings.size();
+        for (const PriProfile& profile : priProfiles) {
+            std::string str;
+            for (std::size_t i = 0; i < parts.size(); i++) {
+                if (isMacro[i]) {
+                    expandPriMacro(parts[i], profile, &str);
+                } else {
+                    str.append(parts[i]);
+                }
+            }
+            if (std::find(strings.begin() + firstVariant, strings.end(), str) == strings.end()) {
+                strings.push_back(std::move(str));
+            }
+            if (!hasMacros) {
+                break;
+            }
+        }
+        parts.clear();
+        isMacro.clear();
+    };
+
+    std::size_t i = 0;
+    while (i < source.size()) {
+        char c = source[i];
+        char next = i + 1 < source.size() ? source[i + 1] : '\0';
+        if (c == '/' && next == '/') {
+            i = source.find('\n', i);
+            if (i == std::string::npos) {
+                break;
+            }
+            continue;
+        }
+        if (c == '/' && next == '*') {
+            i = source.find("*/", i + 2);
+            if (i == std::string::npos) {
+                break;
+            }
+            i += 2;
+            continue;
+        }
+        if (std::isspace((unsigned char)c)) {
+            i++;
+            continue;
+        }
+        if (c == '\'') {
+            finish();
+            i++;
+            while (i < source.size() && source[i] != '\'' && source[i] != '\n') {
+                i += source[i] == '\\' ? 2 : 1;
+            }
+            i++;
+            continue;
+        }
+        if (c == '"') {
+            std::string literal;
+            i = readLiteral(source, i + 1, &literal);
+            parts.push_back(std::move(literal));
+            isMacro.push_back(false);
+            continue;
+        }
+        if (std::isalpha((unsigned char)c) || c == '_') {
+            std::size_t begin = i;
+            while (i < source.size() && (std::isalnum((unsigned char)source[i]) || source[i] == '_')) {
+                i++;
+            }
+            std::string name = source.substr(begin, i - begin);
+            std::string expanded;
+            if (!parts.empty() && expandPriMacro(name, priProfiles[0], &expanded)) {
+                parts.push_back(std::move(name));
+                isMacro.push_back(true);
+            } else {
+                finish();
+            }
+            continue;
+        }
+        finish();
+        i++;
+    }
+    finish();
+    return strings;
+}
+}
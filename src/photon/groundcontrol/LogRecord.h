@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "photon/Config.hpp"
+
+#include <bmcl/Fwd.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace photon {
+
+// Deferred log records written by onboard Photon_Log if PHOTON_CFG_LOG_DEFERRED is enabled,
+// see modules/photon/core/Logging.c
+//
+// record: [u16le size][u8 level][u32le line][i64le time][u32le fname id][u32le fmt id][args]
+// arg: [u8 tag][u64le value] or [u8 tag][u8 size][chars] for strings
+
+// same as arg tags in Logging.c
+enum class LogArgKind : uint8_t {
+    Int = 1,
+    Uint = 2,
+    Double = 3,
+    String = 4,
+    Ptr = 5,
+};
+
+struct LogArg {
+    int64_t asInt() const;
+    double asDouble() const;
+
+    LogArgKind kind;
+    uint64_t value;
+    std::string str;
+};
+
+struct LogRecord {
+    uint8_t level;
+    uint32_t line;
+    int64_t time;
+    uint32_t fnameId;
+    uint32_t fmtId;
+    std::vector<LogArg> args;
+};
+
+// decodes records returned by Photon_ReadLogRecords, returns false if data is malformed
+bool decodeLogRecords(bmcl::Bytes data, std::vector<LogRecord>* dest);
+
+// formats record the same way as onboard Photon_FormatLogRecord
+std::string formatLogRecord(const LogRecord& record, const std::string& fmt);
+
+// same hash as onboard Photon_LogStringId
+uint32_t logStringId(const std::string& str);
+
+// Format and file name strings of log calls, ids are calculated on load.
+// Table is generated from onboard sources at build time by tools/LogStrings.cpp
+class LogStringTable {
+public:
+    void add(const std::string& str);
+    // one string per line, escaped with escapeLogString
+    bool load(const std::string& path);
+
+    const std::string* find(uint32_t id) const;
+    std::size_t size() const;
+
+private:
+    std::unordered_map<uint32_t, std::string> _strings;
+};
+
+std::string escapeLogString(const std::string& str);
+std::string unescapeLogString(const std::string& str);
+
+// Returns all string literals from C source with adjacent literals joined, this includes
+// log formats passed through wrapper macros and _PHOTON_FNAME definitions.
+// Literals containing PRI* macros are returned once per expansion used by supported
+// targets and hosts so that ids match records from any of them
+std::vector<std::string> extractLogStrings(const std::string& source);
+}
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "photon/groundcontrol/Lz4.h"
+#include "photon/blog/Lz4.h"
+
+#include <bmcl/Bytes.h>
+
+namespace photon {
+
+bool decompressLz4(bmcl::Bytes src, std::vector<uint8_t>* dest, std::size_t rawSize)
+{
+    if (rawSize == 0) {
+        // onboard decoder returns 0 on error, empty block is a single zero token
+        return src.size() == 1 && *src.data() == 0;
+    }
+    std::size_t start = dest->size();
+    dest->resize(start + rawSize);
+    if (PhotonLz4_Decompress(src.data(), src.size(), dest->data() + start, rawSize) != rawSize) {
+        dest->resize(start);
+        return false;
+    }
+    return true;
+}
+}
@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "photon/Config.hpp"
+
+#include <bmcl/Fwd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace photon {
+
+// LZ4 block format, decoded by onboard PhotonLz4_Decompress (modules/photon/blog/Lz4.c).
+// Appends exactly rawSize bytes to dest, dest is left unchanged if block is malformed
+bool decompressLz4(bmcl::Bytes src, std::vector<uint8_t>* dest, std::size_t rawSize);
+}
@@ -8,6 +8,8 @@
 
 #include "photon/groundcontrol/MemIntervalSet.h"
 
+#include <algorithm>
+
 namespace photon {
 
 IntervalComparison MemInterval::mergeIntoIfIntersects(MemInterval* other)
@@ -33,51 +35,49 @@ IntervalComparison MemInterval::mergeIntoIfIntersects(MemInterval* other)
     return IntervalComparison::Intersects;
 }
 
+// intervals are sorted and never touch each other, so insertion position is found by binary search
 void MemIntervalSet::add(MemInterval interval)
 {
-    if (_intervals.size() == 0) {
-        _intervals.push_back(interval);
+    auto end = _intervals.end();
+    auto it = std::lower_bound(_intervals.begin(), end, interval.start(), [](const MemInterval& i, std::size_t start) {
+        return i.end() < start;
+    });
+    if (it == end || it->start() > interval.end()) {
+        _intervals.insert(it, interval);
+        _dataSize += interval.size();
         return;
     }
 
-    auto begin = _intervals.begin();
-    auto it = begin;
-    auto end = _intervals.end();
-
-    while (it < end) {
-        IntervalComparison rv =  interval.mergeIntoIfIntersects(&(*it));
-        if (rv == IntervalComparison::Before) {
-            _intervals.insert(it, interval);
-            return;
-        } else if (rv == IntervalComparison::Intersects) {
-            auto merged = it;
-            it++;
-            auto removeBegin = it;
-            while (it < end) {
-                rv = it->mergeIntoIfIntersects(&(*merged));
-                BMCL_ASSERT(rv != IntervalComparison::Before);
-                if (rv == IntervalComparison::After) {
-                    break;
-                }
-                it++;
-            }
-            _intervals.erase(removeBegin, it);
-            return;
-        } else {
-            it++;
-            continue;
+    auto last = it;
+    while (last < end) {
+        if (last->mergeIntoIfIntersects(&interval) == IntervalComparison::After) {
+            break;
         }
+        _dataSize -= last->size();
+        last++;
     }
-    _intervals.insert(it, interval);
+    *it = interval;
+    _dataSize += interval.size();
+    _intervals.erase(it + 1, last);
 }
 
-//TODO: calculate on addition
-std::size_t MemIntervalSet::dataSize() const
+void MemIntervalSet::missing(MemInterval range, std::size_t maxNum, std::vector<MemInterval>* dest) const
 {
-    std::size_t s = 0;
-    for (const MemInterval& i : _intervals) {
-        s += i.size();
+    std::size_t current = range.start();
+    auto it = std::lower_bound(_intervals.begin(), _intervals.end(), current, [](const MemInterval& i, std::size_t start) {
+        return i.end() <= start;
+    });
+    while (current < range.end() && maxNum != 0) {
+        if (it == _intervals.end() || it->start() >= range.end()) {
+            dest->emplace_back(current, range.end());
+            return;
+        }
+        if (it->start() > current) {
+            dest->emplace_back(current, it->start());
+            maxNum--;
+        }
+        current = std::max(current, it->end());
+        it++;
     }
-    return s;
 }
 }
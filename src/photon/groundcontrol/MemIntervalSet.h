@@ -77,25 +77,40 @@ public:
     std::size_t dataSize() const;
     MemInterval at(std::size_t index) const;
 
+    // appends up to maxNum parts of range not covered by set intervals
+    void missing(MemInterval range, std::size_t maxNum, std::vector<MemInterval>* dest) const;
+
     const std::vector<MemInterval>& intervals() const;
 
 private:
     std::vector<MemInterval> _intervals;
+    std::size_t _dataSize;
 };
 
 inline MemIntervalSet::MemIntervalSet()
+    : _dataSize(0)
 {
 }
 
 //TODO: sort vec
 inline MemIntervalSet::MemIntervalSet(std::vector<MemInterval>&& vec)
     : _intervals(std::move(vec))
+    , _dataSize(0)
 {
+    for (const MemInterval& i : _intervals) {
+        _dataSize += i.size();
+    }
 }
 
 inline void MemIntervalSet::clear()
 {
     _intervals.clear();
+    _dataSize = 0;
+}
+
+inline std::size_t MemIntervalSet::dataSize() const
+{
+    return _dataSize;
 }
 
 inline std::size_t MemIntervalSet::size() const
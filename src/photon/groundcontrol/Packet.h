@@ -30,6 +30,13 @@ enum class PacketType : uint8_t {
     Receipt = 2,
 };
 
+// Actors - every stage of the downlink has its own mailbox
+// Fused - framing, header decoding and telemetry decoding run inside GroundControl using direct calls
+enum class PipelineMode : uint8_t {
+    Actors = 0,
+    Fused = 1,
+};
+
 enum class ReceiptType : uint8_t {
     Ok = 0,
     PacketError = 1,
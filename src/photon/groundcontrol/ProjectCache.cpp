@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "photon/groundcontrol/ProjectCache.h"
+#include "photon/groundcontrol/ProjectUpdate.h"
+
+#include <bmcl/Bytes.h>
+#include <bmcl/Logging.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+# include <direct.h>
+# include <process.h>
+#else
+# include <sys/stat.h>
+# include <sys/types.h>
+# include <unistd.h>
+#endif
+
+namespace photon {
+
+static void makeDir(const std::string& path)
+{
+#ifdef _WIN32
+    _mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+}
+
+static void makeDirs(const std::string& path)
+{
+    for (std::size_t i = 1; i < path.size(); i++) {
+        if (path[i] == '/' || path[i] == '\\') {
+            makeDir(path.substr(0, i));
+        }
+    }
+    makeDir(path);
+}
+
+// unique for every store call of every process sharing cache directory
+static std::string tempSuffix()
+{
+    static std::atomic<unsigned> counter(0);
+#ifdef _WIN32
+    int pid = _getpid();
+#else
+    int pid = getpid();
+#endif
+    return "." + std::to_string(pid) + "." + std::to_string(counter++) + ".tmp";
+}
+
+ProjectCache::ProjectCache()
+    : _dir(defaultDir())
+{
+}
+
+ProjectCache::ProjectCache(const std::string& dir)
+    : _dir(dir)
+{
+}
+
+ProjectCache::~ProjectCache()
+{
+}
+
+std::string ProjectCache::defaultDir()
+{
+    const char* dir = std::getenv("PHOTON_PROJECT_CACHE");
+    if (dir) {
+        return dir;
+    }
+#ifdef _WIN32
+    dir = std::getenv("LOCALAPPDATA");
+    if (dir) {
+        return std::string(dir) + "\\photon\\projects";
+    }
+#else
+    dir = std::getenv("XDG_CACHE_HOME");
+    if (dir) {
+        return std::string(dir) + "/photon/projects";
+    }
+    dir = std::getenv("HOME");
+    if (dir) {
+        return std::string(dir) + "/.cache/photon/projects";
+    }
+#endif
+    return std::string();
+}
+
+void ProjectCache::setDir(const std::string& dir)
+{
+    _dir = dir;
+}
+
+const std::string& ProjectCache::dir() const
+{
+    return _dir;
+}
+
+bool ProjectCache::hashMatches(bmcl::Bytes hash, bmcl::Bytes data)
+{
+    ProjectHash calculatedHash = ProjectUpdate::calculateHash(data);
+    if (hash.size() != calculatedHash.size()) {
+        return false;
+    }
+    return std::memcmp(hash.data(), calculatedHash.data(), calculatedHash.size()) == 0;
+}
+
+std::string ProjectCache::pathForHash(bmcl::Bytes hash) const
+{
+    static const char* digits = "0123456789abcdef";
+    std::string path = _dir;
+    path.push_back('/');
+    for (uint8_t b : hash) {
+        path.push_back(digits[b >> 4]);
+        path.push_back(digits[b & 0xf]);
+    }
+    path.append(".pdesc");
+    return path;
+}
+
+bmcl::Option<bmcl::Buffer> ProjectCache::load(bmcl::Bytes hash) const
+{
+    if (_dir.empty()) {
+        return bmcl::None;
+    }
+    std::string path = pathForHash(hash);
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return bmcl::None;
+    }
+    std::streamoff size = file.tellg();
+    if (size <= 0) {
+        return bmcl::None;
+    }
+    bmcl::Buffer data;
+    data.resize(std::size_t(size));
+    file.seekg(0);
+    if (!file.read((char*)data.data(), size)) {
+        return bmcl::None;
+    }
+    file.close();
+
+    if (!hashMatches(hash, data)) {
+        BMCL_WARNING() << "removing corrupted cached project " << path;
+        std::remove(path.c_str());
+        return bmcl::None;
+    }
+    return std::move(data);
+}
+
+bool ProjectCache::store(bmcl::Bytes hash, bmcl::Bytes data) const
+{
+    if (_dir.empty()) {
+        return false;
+    }
+    makeDirs(_dir);
+    std::string path = pathForHash(hash);
+    // written to temporary file of this call and renamed, so that concurrent stores of the same project
+    // don't write into one file and partial files are never loaded
+    std::string tempPath = path + tempSuffix();
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        if (!file.write((const char*)data.data(), data.size())) {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+#ifdef _WIN32
+    // rename does not replace existing files on windows
+    std::remove(path.c_str());
+#endif
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "photon/Config.hpp"
+
+#include <bmcl/Fwd.h>
+#include <bmcl/Buffer.h>
+#include <bmcl/Option.h>
+
+#include <string>
+
+namespace photon {
+
+// On-disk cache of verified project descriptions, each stored in a file named after hex encoded SHA3-512 hash.
+// Default directory is PHOTON_PROJECT_CACHE environment variable or photon/projects in user cache directory.
+// Loaded descriptions are verified again so that corrupted files are ignored and removed.
+class ProjectCache {
+public:
+    ProjectCache();
+    explicit ProjectCache(const std::string& dir);
+    ~ProjectCache();
+
+    static std::string defaultDir();
+
+    void setDir(const std::string& dir);
+    const std::string& dir() const;
+
+    bmcl::Option<bmcl::Buffer> load(bmcl::Bytes hash) const;
+    // data hash is expected to be already checked
+    bool store(bmcl::Bytes hash, bmcl::Bytes data) const;
+
+    static bool hashMatches(bmcl::Bytes hash, bmcl::Bytes data);
+
+private:
+    std::string pathForHash(bmcl::Bytes hash) const;
+
+    std::string _dir;
+};
+}
@@ -13,6 +13,9 @@
 #include <bmcl/Bytes.h>
 #include <bmcl/MemReader.h>
 
+#include <cassert>
+#include <cstring>
+
 namespace photon {
 
 ProjectUpdate::ProjectUpdate()
@@ -24,6 +27,16 @@ ProjectUpdate::~ProjectUpdate()
 }
 
 ProjectUpdateResult ProjectUpdate::fromProjectAndName(const decode::Project* project, bmcl::StringView name)
+{
+    return create(project, name, bmcl::None);
+}
+
+ProjectUpdateResult ProjectUpdate::fromProjectAndName(const decode::Project* project, bmcl::StringView name, const ProjectHash& hash)
+{
+    return create(project, name, hash);
+}
+
+ProjectUpdateResult ProjectUpdate::create(const decode::Project* project, bmcl::StringView name, const bmcl::Option<ProjectHash>& hash)
 {
     bmcl::OptionPtr<const decode::Device> dev = project->deviceWithName(name);
     if (dev.isNone()) {
@@ -35,9 +48,21 @@ ProjectUpdateResult ProjectUpdate::fromProjectAndName(const decode::Project* pro
     update->_device = dev.unwrap();
     update->_interface = new photongen::Validator(project, dev.unwrap());
     update->_cache = new ValueInfoCache(project->package());
+    update->_hash = hash;
     return Rc<const ProjectUpdate>(update);
 }
 
+ProjectHash ProjectUpdate::calculateHash(bmcl::Bytes data)
+{
+    decode::Project::HashType state;
+    state.update(data);
+    auto calculatedHash = state.finalize();
+    ProjectHash hash;
+    assert(calculatedHash.size() == hash.size());
+    std::memcpy(hash.data(), calculatedHash.data(), hash.size());
+    return hash;
+}
+
 ProjectUpdateResult ProjectUpdate::fromMemory(const void* src, std::size_t size)
 {
     bmcl::MemReader reader(src, size);
@@ -55,6 +80,7 @@ ProjectUpdateResult ProjectUpdate::fromMemory(const void* src, std::size_t size)
     if (proj.isErr()) {
         return ProjectUpdateResult("error deserializing project");
     }
+    ProjectHash hash = calculateHash(bmcl::Bytes(reader.current(), projSize));
     reader.skip(projSize);
 
     auto name = decode::deserializeString(&reader);
@@ -62,7 +88,7 @@ ProjectUpdateResult ProjectUpdate::fromMemory(const void* src, std::size_t size)
         return name.takeErr();
     }
 
-    return ProjectUpdate::fromProjectAndName(proj.unwrap().get(), name.unwrap());
+    return ProjectUpdate::fromProjectAndName(proj.unwrap().get(), name.unwrap(), hash);
 }
 
 ProjectUpdateResult ProjectUpdate::fromMemory(bmcl::Bytes memory)
@@ -100,4 +126,9 @@ const ValueInfoCache* ProjectUpdate::cache() const
 {
     return _cache.get();
 }
+
+const bmcl::Option<ProjectHash>& ProjectUpdate::hash() const
+{
+    return _hash;
+}
 }
@@ -4,7 +4,10 @@
 #include "photon/core/Rc.h"
 
 #include <bmcl/Fwd.h>
+#include <bmcl/Option.h>
 
+#include <array>
+#include <cstdint>
 #include <string>
 
 namespace decode {
@@ -22,6 +25,8 @@ class ValueInfoCache;
 class ProjectUpdate;
 
 using ProjectUpdateResult = bmcl::Result<Rc<const ProjectUpdate>, std::string>;
+// SHA3-512 of serialized project, same as sent by onboard fwt module
+using ProjectHash = std::array<uint8_t, 64>;
 
 class ProjectUpdate : public RefCountable {
 public:
@@ -31,23 +36,32 @@ public:
     ~ProjectUpdate();
 
     static ProjectUpdateResult fromProjectAndName(const decode::Project* project, bmcl::StringView name);
+    // hash of serialized project is already known, project is never encoded again to calculate it
+    static ProjectUpdateResult fromProjectAndName(const decode::Project* project, bmcl::StringView name, const ProjectHash& hash);
     static ProjectUpdateResult fromMemory(const void* src, std::size_t size);
     static ProjectUpdateResult fromMemory(bmcl::Bytes memory);
 
     bmcl::Buffer serialize() const;
 
+    static ProjectHash calculateHash(bmcl::Bytes data);
+
     const decode::Project* project() const;
     const decode::Device* device() const;
     const photongen::Validator* interface() const;
     const ValueInfoCache* cache() const;
+    // none if update was created from project without serialized form
+    const bmcl::Option<ProjectHash>& hash() const;
 
 private:
     Rc<const decode::Project> _project;
     Rc<const decode::Device> _device;
     Rc<const photongen::Validator> _interface;
     Rc<const ValueInfoCache> _cache;
+    bmcl::Option<ProjectHash> _hash;
 
 private:
     ProjectUpdate();
+
+    static ProjectUpdateResult create(const decode::Project* project, bmcl::StringView name, const bmcl::Option<ProjectHash>& hash);
 };
 }
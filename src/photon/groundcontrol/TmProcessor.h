@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "photon/Config.hpp"
+#include "photon/core/Rc.h"
+#include "photon/groundcontrol/NumberedSub.h"
+
+#include <bmcl/Fwd.h>
+
+#include <caf/actor.hpp>
+
+#include <unordered_map>
+#include <vector>
+#include <string>
+
+namespace caf {
+class event_based_actor;
+}
+
+namespace decode {
+class Project;
+class Device;
+}
+
+namespace photon {
+
+struct PacketHeader;
+class CoderState;
+class ProjectUpdate;
+class TmModel;
+class ValueNode;
+
+// telemetry decoding logic without mailbox of its own, all events are sent from the owning actor
+class TmProcessor {
+public:
+    TmProcessor(caf::event_based_actor* self, const caf::actor& handler);
+    ~TmProcessor();
+
+    void setProject(const ProjectUpdate* update);
+    void acceptData(const PacketHeader& header, bmcl::Bytes packet);
+    void pushTmUpdates();
+    bool subscribeTm(const std::string& path, const caf::actor& dest);
+    bool subscribeTm(const NumberedSub& sub, const caf::actor& dest);
+    void setLoggingEnabled(bool isEnabled);
+
+    uint64_t updateCount() const;
+    const TmModel* model() const;
+
+private:
+    struct NamedSub {
+        NamedSub(const ValueNode* node, const std::string& path, const caf::actor& dest);
+        ~NamedSub();
+
+        Rc<const ValueNode> node;
+        std::string path;
+        caf::actor actor;
+    };
+
+    void reportError(std::string&& msg);
+    void logMsg(std::string&& msg);
+    // returns false if delta header or framing is broken and rest of the packet can't be parsed
+    bool acceptDelta(CoderState* ctx, bmcl::MemReader* src);
+    void notifyNumberedSubs(uint32_t compNum, uint32_t msgNum, bmcl::Bytes body);
+
+    caf::event_based_actor* _self;
+    caf::actor _handler;
+    Rc<const decode::Project> _project;
+    Rc<const decode::Device> _dev;
+    Rc<TmModel> _model;
+    std::vector<NamedSub> _namedSubs;
+    std::unordered_map<NumberedSub, std::vector<caf::actor>, NumberedSubHash> _numberedSubs;
+    uint64_t _updateCount;
+    bool _isLoggingEnabled;
+};
+
+inline uint64_t TmProcessor::updateCount() const
+{
+    return _updateCount;
+}
+
+inline const TmModel* TmProcessor::model() const
+{
+    return _model.get();
+}
+}
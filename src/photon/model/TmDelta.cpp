@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "photon/model/TmDelta.h"
+#include "photon/model/CoderState.h"
+
+#include <bmcl/Bytes.h>
+#include <bmcl/MemReader.h>
+
+namespace photon {
+
+TmDeltaDecoder::TmDeltaDecoder()
+    : _seq(0)
+    , _hasBase(false)
+{
+}
+
+TmDeltaDecoder::~TmDeltaDecoder()
+{
+}
+
+void TmDeltaDecoder::setBase(uint64_t seq, bmcl::Bytes image)
+{
+    _base.assign(image.begin(), image.end());
+    _seq = seq;
+    _hasBase = true;
+}
+
+bool TmDeltaDecoder::apply(CoderState* ctx, bmcl::MemReader* src)
+{
+    uint64_t seq;
+    if (!src->readVarUint(&seq)) {
+        ctx->setError("failed to read tm delta base number");
+        return false;
+    }
+    // deltas are encoded against base, not against previous delta
+    _image = _base;
+    std::size_t offset = 0;
+    bool isValid = _hasBase && seq == _seq;
+    while (true) {
+        uint64_t gap;
+        uint64_t size;
+        if (!src->readVarUint(&gap) || !src->readVarUint(&size)) {
+            ctx->setError("failed to read tm delta run");
+            return false;
+        }
+        if (size == 0) {
+            break;
+        }
+        if (src->sizeLeft() < size) {
+            ctx->setError("tm delta run is too big");
+            return false;
+        }
+        offset += gap;
+        if (isValid && (offset + size) <= _image.size()) {
+            src->read(_image.data() + offset, size);
+        } else {
+            isValid = false;
+            src->skip(size);
+        }
+        offset += size;
+    }
+    if (!isValid) {
+        ctx->setError("recieved tm delta without valid base message");
+        return false;
+    }
+    return true;
+}
+
+bool TmDeltaDecoder::skip(CoderState* ctx, bmcl::MemReader* src)
+{
+    uint64_t seq;
+    if (!src->readVarUint(&seq)) {
+        ctx->setError("failed to read tm delta base number");
+        return false;
+    }
+    while (true) {
+        uint64_t gap;
+        uint64_t size;
+        if (!src->readVarUint(&gap) || !src->readVarUint(&size)) {
+            ctx->setError("failed to read tm delta run");
+            return false;
+        }
+        if (size == 0) {
+            return true;
+        }
+        if (src->sizeLeft() < size) {
+            ctx->setError("tm delta run is too big");
+            return false;
+        }
+        src->skip(size);
+    }
+}
+
+bmcl::Bytes TmDeltaDecoder::image() const
+{
+    return bmcl::Bytes(_image.data(), _image.size());
+}
+}
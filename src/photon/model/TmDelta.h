@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2017 CPB9 team. See the COPYRIGHT file at the top-level directory.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#pragma once
+
+#include "photon/Config.hpp"
+
+#include <bmcl/Fwd.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace bmcl { class MemReader; }
+
+namespace photon {
+
+class CoderState;
+
+// Rebuilds delta encoded status message from last base, see tm/Delta.h for format
+class TmDeltaDecoder {
+public:
+    TmDeltaDecoder();
+    ~TmDeltaDecoder();
+
+    // image is a full serialized message including component and message numbers
+    void setBase(uint64_t seq, bmcl::Bytes image);
+    // reads base sequence number and runs following delta header, delta to another base is rejected;
+    // runs are always consumed from src so that following messages can be parsed
+    bool apply(CoderState* ctx, bmcl::MemReader* src);
+    // consumes base sequence number and runs without applying them, fails only if delta is truncated
+    static bool skip(CoderState* ctx, bmcl::MemReader* src);
+    // base with last applied delta
+    bmcl::Bytes image() const;
+
+private:
+    std::vector<uint8_t> _base;
+    std::vector<uint8_t> _image;
+    uint64_t _seq;
+    bool _hasBase;
+};
+}
@@ -248,6 +248,7 @@ TmModel::TmModel(const decode::Device* dev, const ValueInfoCache* cache)
     , _events(new EventsNode)
     , _statistics(new TmStatsNode)
 {
+    Rc<decode::BuiltinType> u64Type = new decode::BuiltinType(decode::BuiltinTypeKind::U64);
     for (const decode::Ast* ast : dev->modules()) {
         if (ast->component().isNone()) {
             continue;
@@ -262,8 +263,6 @@ TmModel::TmModel(const decode::Device* dev, const ValueInfoCache* cache)
         Rc<ComponentVarsNode> node = new ComponentVarsNode(comp, cache, _statuses.get());
         _statuses->addVarsNode(node.get());
 
-        Rc<decode::BuiltinType> u64Type = new decode::BuiltinType(decode::BuiltinTypeKind::U64);
-
         std::size_t compNum = comp->number();
         for (const decode::StatusMsg* msg : comp->statusesRange()) {
             std::size_t msgNum = msg->number();
@@ -311,11 +310,70 @@ bool TmModel::acceptTmMsg(CoderState* ctx, uint32_t compNum, uint32_t msgNum, bm
         _events->addEvent(std::move(eventNode.unwrap()));
     }
 
+    updateStats(&state);
+    return true;
+}
+
+bool TmModel::acceptTmDelta(CoderState* ctx, uint32_t compNum, uint32_t msgNum, bmcl::MemReader* delta, bmcl::Bytes* body)
+{
+    auto it = _decoders.find((uint64_t(compNum) << 32) | uint64_t(msgNum));
+    if (it == _decoders.end() || !it->second.decoder.isFirst()) {
+        ctx->setError("Invalid component id or status msg id: " + std::to_string(compNum) + " " + std::to_string(msgNum));
+        return false;
+    }
+
+    MsgState& state = it->second;
+    if (!state.decoder.unwrapFirst().decodeDelta(ctx, delta, body)) {
+        return false;
+    }
+
+    updateStats(&state);
+    return true;
+}
+
+void TmModel::setTmDeltaBase(uint32_t compNum, uint32_t msgNum, uint64_t seq, bmcl::Bytes image)
+{
+    auto it = _decoders.find((uint64_t(compNum) << 32) | uint64_t(msgNum));
+    if (it == _decoders.end() || !it->second.decoder.isFirst()) {
+        return;
+    }
+    it->second.decoder.unwrapFirst().setDeltaBase(seq, image);
+}
+
+bool TmModel::decodeTmMsg(CoderState* ctx, uint32_t compNum, uint32_t msgNum, bmcl::MemReader* src,
+                          bmcl::StringView* name, std::vector<Rc<Node>>* decoded)
+{
+    auto it = _decoders.find((uint64_t(compNum) << 32) | uint64_t(msgNum));
+    if (it == _decoders.end()) {
+        ctx->setError("Invalid component id or tm msg id: " + std::to_string(compNum) + " " + std::to_string(msgNum));
+        return false;
+    }
+
+    MsgState& state = it->second;
+    *name = state.statNode->fieldName();
+    decoded->clear();
+
+    if (state.decoder.isFirst()) {
+        if (!state.decoder.unwrapFirst().decode(ctx, src)) {
+            return false;
+        }
+        state.decoder.unwrapFirst().appendNodes(decoded);
+    } else {
+        bmcl::Option<Rc<EventNode>> eventNode = state.decoder.unwrapSecond().decode(ctx, src);
+        if (eventNode.isNone()) {
+            return false;
+        }
+        decoded->emplace_back(eventNode.unwrap().get());
+    }
+    return true;
+}
+
+void TmModel::updateStats(MsgState* state)
+{
     auto now = OnboardTime::now();
-    state.statNode->incRawValue(now);
+    state->statNode->incRawValue(now);
     _statistics->incTotal(now);
     _statistics->setLastUpdateTime(now);
-    return true;
 }
 
 TmModel::~TmModel()
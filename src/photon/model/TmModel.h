@@ -62,12 +62,21 @@ public:
     ~TmModel();
 
     bool acceptTmMsg(CoderState* ctx, uint32_t compNum, uint32_t msgNum, bmcl::MemReader* payload);
+    // body is set to decoded message payload (without component and message numbers),
+    // delta is rejected if its base sequence number differs from last base
+    bool acceptTmDelta(CoderState* ctx, uint32_t compNum, uint32_t msgNum, bmcl::MemReader* delta, bmcl::Bytes* body);
+    void setTmDeltaBase(uint32_t compNum, uint32_t msgNum, uint64_t seq, bmcl::Bytes image);
+    // decodes message without touching model nodes or statistics, decoded status nodes are reused by next call
+    bool decodeTmMsg(CoderState* ctx, uint32_t compNum, uint32_t msgNum, bmcl::MemReader* payload,
+                     bmcl::StringView* name, std::vector<Rc<Node>>* decoded);
 
     Node* statusesNode();
     Node* eventsNode();
     Node* statisticsNode();
 
 private:
+    void updateStats(MsgState* state);
+
     decode::HashMap<uint64_t, MsgState> _decoders;
     Rc<const decode::Device> _device;
     Rc<StatusesNode> _statuses;
@@ -207,6 +207,38 @@ bool StatusMsgDecoder::decode(CoderState* ctx, bmcl::MemReader* src)
     return true;
 }
 
+void StatusMsgDecoder::appendNodes(std::vector<Rc<Node>>* dest) const
+{
+    for (const ChainElement& elem : _chain) {
+        dest->emplace_back(elem.node.get());
+    }
+}
+
+void StatusMsgDecoder::setDeltaBase(uint64_t seq, bmcl::Bytes image)
+{
+    _delta.setBase(seq, image);
+}
+
+bool StatusMsgDecoder::decodeDelta(CoderState* ctx, bmcl::MemReader* src, bmcl::Bytes* image)
+{
+    if (!_delta.apply(ctx, src)) {
+        return false;
+    }
+
+    bmcl::MemReader reader(_delta.image());
+    uint64_t num;
+    if (!reader.readVarUint(&num) || !reader.readVarUint(&num)) {
+        ctx->setError("invalid tm delta base message");
+        return false;
+    }
+    const uint8_t* begin = reader.current();
+    if (!decode(ctx, &reader)) {
+        return false;
+    }
+    *image = bmcl::Bytes(begin, reader.current());
+    return true;
+}
+
 EventMsgDecoder::EventMsgDecoder(const decode::EventMsg* msg, const ValueInfoCache* cache)
     : _msg(msg)
     , _cache(cache)
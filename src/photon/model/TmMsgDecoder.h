@@ -11,6 +11,7 @@
 #include "photon/Config.hpp"
 #include "photon/core/Rc.h"
 #include "photon/model/FieldsNode.h"
+#include "photon/model/TmDelta.h"
 #include "decode/core/HashMap.h"
 
 #include <bmcl/Fwd.h>
@@ -53,8 +54,17 @@ public:
 
     bool decode(CoderState* ctx, bmcl::MemReader* src);
 
+    // image is a full serialized message including component and message numbers
+    void setDeltaBase(uint64_t seq, bmcl::Bytes image);
+    // applies changed byte runs to the last base and decodes the result, see TmDeltaDecoder
+    bool decodeDelta(CoderState* ctx, bmcl::MemReader* src, bmcl::Bytes* image);
+
+    // nodes updated by decode() in message order
+    void appendNodes(std::vector<Rc<Node>>* dest) const;
+
 private:
     std::vector<ChainElement> _chain;
+    TmDeltaDecoder _delta;
 };
 
 class EventNode : public FieldsNode {
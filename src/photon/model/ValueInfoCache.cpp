@@ -16,21 +16,44 @@
 
 #include <bmcl/Logging.h>
 
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+
 namespace photon {
 
-// vector<string> when relocating copies strings instead of moving for some reason
-// using allocated const char* instead
-static void updateIndexes(ValueInfoCache::StringVecType* dest, std::size_t newSize)
+// index names are shared by all caches and never freed, chunks are allocated on first use and never moved
+// so that returned views stay valid without locking
+constexpr std::size_t indexChunkSize = 1024;
+constexpr std::size_t maxIndexChunks = 4096;
+
+struct IndexName {
+    char data[15];
+    uint8_t size;
+};
+
+static std::atomic<IndexName*> indexChunks[maxIndexChunks];
+static std::mutex indexMutex;
+
+static const IndexName* indexChunk(std::size_t chunkIdx)
 {
-    dest->reserve(newSize);
-    for (std::size_t i = dest->size(); i < newSize; i++) {
-        char* buf = (char*)alloca(sizeof(std::size_t) * 4);
-        int stringSize = std::sprintf(buf, "%zu", i);
+    IndexName* chunk = indexChunks[chunkIdx].load(std::memory_order_acquire);
+    if (chunk) {
+        return chunk;
+    }
+    std::lock_guard<std::mutex> lock(indexMutex);
+    chunk = indexChunks[chunkIdx].load(std::memory_order_relaxed);
+    if (chunk) {
+        return chunk;
+    }
+    chunk = new IndexName[indexChunkSize];
+    for (std::size_t i = 0; i < indexChunkSize; i++) {
+        int stringSize = std::snprintf(chunk[i].data, sizeof(chunk[i].data), "%zu", chunkIdx * indexChunkSize + i);
         assert(stringSize > 0);
-        char* allocatedBuf  = new char[stringSize];
-        std::memcpy(allocatedBuf, buf, stringSize);
-        dest->push_back(bmcl::StringView(allocatedBuf, stringSize));
+        chunk[i].size = uint8_t(stringSize);
     }
+    indexChunks[chunkIdx].store(chunk, std::memory_order_release);
+    return chunk;
 }
 
 static void buildNamedTypeName(const decode::NamedType* type, decode::StringBuilder* dest)
@@ -194,114 +217,108 @@ static bool buildTypeName(const decode::Type* type, decode::StringBuilder* dest)
     assert(false);
 }
 
-class CacheCollector : public decode::ConstAstVisitor<CacheCollector> {
+class InstantiationCollector : public decode::ConstAstVisitor<InstantiationCollector> {
 public:
-    void collectNames(const decode::Package* package,
-                      ValueInfoCache::TypeMapType* typeNameMap,
-                      ValueInfoCache::TmMsgMapType* tmMsgNameMap,
-                      ValueInfoCache::StringVecType* strIndexes)
+    void collect(const decode::Package* package, ValueInfoCache::InstantiationMapType* dest)
     {
-        _typeNameMap = typeNameMap;
-        _tmMsgNameMap = tmMsgNameMap;
-        _strIndexes = strIndexes;
+        _dest = dest;
         for (const decode::Ast* ast : package->modules()) {
             for (const decode::Type* type : ast->typesRange()) {
                 traverseType(type);
             }
-            if (ast->component().isNone()) {
-                continue;
-            }
-            const decode::Component* comp = ast->component().unwrap();
-            for (const decode::StatusMsg* msg : comp->statusesRange()) {
-                addTmMsg(comp, msg);
-            }
-            for (const decode::EventMsg* msg : comp->eventsRange()) {
-                addTmMsg(comp, msg);
-            }
         }
     }
 
-    void addTmMsg(const decode::Component* comp, const decode::TmMsg* msg)
-    {
-        std::string name;
-        name.reserve(comp->name().size() + 2 + msg->name().size());
-        name.append(comp->name().begin(), comp->name().end());
-        name.append("::", 2);
-        name.append(msg->name().begin(), msg->name().end());
-        _tmMsgNameMap->emplace(msg, std::move(name));
-    }
-
-    bool visitArrayType(const decode::ArrayType* type)
-    {
-        updateIndexes(_strIndexes, type->elementCount());
-        return true;
-    }
-
-    bool visitDynArrayType(const decode::DynArrayType* type)
-    {
-        updateIndexes(_strIndexes, type->maxSize());
-        return true;
-    }
-
-    bool visitTupleVariantField(const decode::TupleVariantField* field)
-    {
-        updateIndexes(_strIndexes, field->typesRange().size());
-        return true;
-    }
-
     bool visitType(const decode::Type* type)
     {
-        bool rv = true;
-        auto pair = _typeNameMap->emplace(type, std::string());
-        if (pair.second) {
-            decode::StringBuilder b;
-            rv = buildTypeName(type, &b);
-            pair.first->second = b.view().toStdString();
-            if (type->isGenericInstantiation()) {
-                _typeNameMap->emplace(type->asGenericInstantiation()->instantiatedType(), pair.first->second);
-            }
+        if (type->isGenericInstantiation()) {
+            _dest->emplace(type->asGenericInstantiation()->instantiatedType(), type);
+            return false;
         }
-        return rv;
+        return type->typeKind() != decode::TypeKind::Generic;
     }
 
 private:
-    ValueInfoCache::TypeMapType* _typeNameMap;
-    ValueInfoCache::TmMsgMapType* _tmMsgNameMap;
-    ValueInfoCache::StringVecType* _strIndexes;
+    ValueInfoCache::InstantiationMapType* _dest;
 };
 
 ValueInfoCache::ValueInfoCache(const decode::Package* package)
+    : _package(package)
+    , _hasInstantiations(false)
+    , _hasTmMsgs(false)
 {
-    CacheCollector b;
-    updateIndexes(&_arrayIndexes, 64); //HACK: limit maximum number of commands
-    b.collectNames(package, &_names, &_tmMsgs, &_arrayIndexes);
-
 }
 
 ValueInfoCache::~ValueInfoCache()
 {
-    for (bmcl::StringView view : _arrayIndexes) {
-        delete [] view.data();
+}
+
+void ValueInfoCache::collectInstantiations() const
+{
+    InstantiationCollector c;
+    c.collect(_package.get(), &_instantiations);
+    _hasInstantiations = true;
+}
+
+void ValueInfoCache::collectTmMsgs() const
+{
+    auto addTmMsg = [this](const decode::Component* comp, const decode::TmMsg* msg) {
+        std::string name;
+        name.reserve(comp->name().size() + 2 + msg->name().size());
+        name.append(comp->name().begin(), comp->name().end());
+        name.append("::", 2);
+        name.append(msg->name().begin(), msg->name().end());
+        _tmMsgs.emplace(msg, std::move(name));
+    };
+    for (const decode::Ast* ast : _package->modules()) {
+        if (ast->component().isNone()) {
+            continue;
+        }
+        const decode::Component* comp = ast->component().unwrap();
+        for (const decode::StatusMsg* msg : comp->statusesRange()) {
+            addTmMsg(comp, msg);
+        }
+        for (const decode::EventMsg* msg : comp->eventsRange()) {
+            addTmMsg(comp, msg);
+        }
     }
+    _hasTmMsgs = true;
 }
 
 bmcl::StringView ValueInfoCache::arrayIndex(std::size_t idx) const
 {
-    assert(idx < _arrayIndexes.size());
-    return _arrayIndexes[idx];
+    assert(idx < indexChunkSize * maxIndexChunks);
+    const IndexName& name = indexChunk(idx / indexChunkSize)[idx % indexChunkSize];
+    return bmcl::StringView(name.data, name.size);
 }
 
 bmcl::StringView ValueInfoCache::nameForType(const decode::Type* type) const
 {
+    std::lock_guard<std::mutex> lock(_mutex);
     auto it = _names.find(type);
-    if (it == _names.end()) {
-        return bmcl::StringView("UNITIALIZED");
+    if (it != _names.end()) {
+        return it->second;
     }
-    return it->second;
+    if (!_hasInstantiations) {
+        collectInstantiations();
+    }
+    const decode::Type* namedType = type;
+    auto instIt = _instantiations.find(type);
+    if (instIt != _instantiations.end()) {
+        namedType = instIt->second.get();
+    }
+    decode::StringBuilder b;
+    buildTypeName(namedType, &b);
+    auto pair = _names.emplace(type, b.view().toStdString());
+    return pair.first->second;
 }
 
 bmcl::StringView ValueInfoCache::nameForTmMsg(const decode::TmMsg* msg) const
 {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_hasTmMsgs) {
+        collectTmMsgs();
+    }
     auto it = _tmMsgs.find(msg);
     if (it == _tmMsgs.end()) {
         return bmcl::StringView("UNITIALIZED");
@@ -14,6 +14,7 @@
 
 #include <bmcl/StringView.h>
 
+#include <mutex>
 #include <string>
 
 namespace decode {
@@ -39,18 +40,29 @@ public:
 
     using TypeMapType = decode::HashMap<Rc<const decode::Type>, std::string, Hasher<const decode::Type>>;
     using TmMsgMapType = decode::HashMap<Rc<const decode::TmMsg>, std::string, Hasher<const decode::TmMsg>>;
-    using StringVecType = std::vector<bmcl::StringView>;
+    using InstantiationMapType = decode::HashMap<Rc<const decode::Type>, Rc<const decode::Type>, Hasher<const decode::Type>>;
 
+    // nothing is built on construction, names are created on first request and kept until cache is destroyed.
+    // Cache is shared between actors and ui, so lookups are locked
     ValueInfoCache(const decode::Package* package);
     ~ValueInfoCache();
 
+    // index names are shared by all caches
     bmcl::StringView arrayIndex(std::size_t idx) const;
     bmcl::StringView nameForType(const decode::Type* type) const;
     bmcl::StringView nameForTmMsg(const decode::TmMsg* msg) const;
 
 private:
-    StringVecType _arrayIndexes;
-    TypeMapType _names;
-    TmMsgMapType _tmMsgs;
+    void collectInstantiations() const;
+    void collectTmMsgs() const;
+
+    Rc<const decode::Package> _package;
+    mutable std::mutex _mutex;
+    mutable TypeMapType _names;
+    mutable TmMsgMapType _tmMsgs;
+    // generic instantiation for each instantiated type, instantiated type is named after it
+    mutable InstantiationMapType _instantiations;
+    mutable bool _hasInstantiations;
+    mutable bool _hasTmMsgs;
 };
 }
@@ -0,0 +1,109 @@
+#include "photon/core/Crc.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// every variant of onboard crc is compiled into its own namespace
+
+namespace nibble {
+#define PHOTON_CFG_CRC16_IMPL PHOTON_CRC16_IMPL_NIBBLE
+#include "photon/core/Crc.c"
+#undef PHOTON_CFG_CRC16_IMPL
+}
+
+namespace byte {
+#define PHOTON_CFG_CRC16_IMPL PHOTON_CRC16_IMPL_BYTE
+#include "photon/core/Crc.c"
+#undef PHOTON_CFG_CRC16_IMPL
+#undef _PHOTON_CRC16_TABLES
+}
+
+namespace slice4 {
+#define PHOTON_CFG_CRC16_IMPL PHOTON_CRC16_IMPL_SLICE4
+#include "photon/core/Crc.c"
+#undef PHOTON_CFG_CRC16_IMPL
+#undef _PHOTON_CRC16_TABLES
+}
+
+namespace slice8 {
+#define PHOTON_CFG_CRC16_IMPL PHOTON_CRC16_IMPL_SLICE8
+#include "photon/core/Crc.c"
+#undef PHOTON_CFG_CRC16_IMPL
+#undef _PHOTON_CRC16_TABLES
+}
+
+using CrcFunc = uint16_t (*)(const void*, std::size_t);
+
+struct Variant {
+    const char* name;
+    CrcFunc func;
+};
+
+static const Variant variants[] = {
+    {"nibble", nibble::Photon_Crc16},
+    {"byte", byte::Photon_Crc16},
+    {"slice-by-4", slice4::Photon_Crc16},
+    {"slice-by-8", slice8::Photon_Crc16},
+};
+
+static bool checkVariants(const std::vector<uint8_t>& data)
+{
+    const char* check = "123456789";
+    for (const Variant& v : variants) {
+        if (v.func(check, 9) != 0xf66d) {
+            std::printf("%s: invalid check value\n", v.name);
+            return false;
+        }
+    }
+    // odd sizes and offsets to test tails of sliced variants
+    for (std::size_t size = 0; size < 100; size++) {
+        for (std::size_t offset = 0; offset < 8; offset++) {
+            uint16_t expected = variants[0].func(data.data() + offset, size);
+            for (const Variant& v : variants) {
+                if (v.func(data.data() + offset, size) != expected) {
+                    std::printf("%s: mismatch, size %zu, offset %zu\n", v.name, size, offset);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t packetSize = 256;
+    std::size_t totalSize = 256 * 1024 * 1024;
+    if (argc > 1) {
+        packetSize = std::strtoul(argv[1], nullptr, 10);
+    }
+    if (packetSize == 0) {
+        std::printf("usage: %s [packet size]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<uint8_t> data(packetSize + 128);
+    for (std::size_t i = 0; i < data.size(); i++) {
+        data[i] = uint8_t(std::rand());
+    }
+
+    if (!checkVariants(data)) {
+        return 1;
+    }
+
+    std::size_t iterations = totalSize / packetSize;
+    std::printf("%zu byte packets, %zu MiB total\n", packetSize, totalSize / (1024 * 1024));
+    for (const Variant& v : variants) {
+        volatile uint16_t result = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < iterations; i++) {
+            result = v.func(data.data() + (i & 63), packetSize);
+        }
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        std::printf("%-12s %8.1f MiB/s (%04x)\n", v.name, totalSize / seconds / (1024 * 1024), unsigned(result));
+    }
+    return 0;
+}
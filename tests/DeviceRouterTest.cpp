@@ -0,0 +1,229 @@
+#include "photon/groundcontrol/DeviceRouter.h"
+#include "photon/groundcontrol/Atoms.h"
+#include "photon/groundcontrol/Crc.h"
+#include "photon/groundcontrol/AllowUnsafeMessageType.h"
+
+#include <bmcl/MemWriter.h>
+#include <bmcl/SharedBytes.h>
+
+#include <caf/all.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace photon;
+
+DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(bmcl::SharedBytes);
+
+constexpr uint64_t selfAddress = 1;
+
+// telemetry packets must be unreliable, GroundControl reports an error to device handler
+// for every reliable one, which shows what device packet was routed to
+static const char* invalidTmMsg = "recieved invalid tm packet";
+
+static bmcl::SharedBytes makePacket(uint64_t srcAddress, uint64_t destAddress)
+{
+    uint8_t header[64];
+    bmcl::MemWriter headerWriter(header, sizeof(header));
+    headerWriter.writeVarUint(srcAddress);
+    headerWriter.writeVarUint(destAddress);
+    headerWriter.writeVarInt((int64_t)StreamDirection::Downlink);
+    headerWriter.writeVarInt((int64_t)PacketType::Reliable);
+    headerWriter.writeVarInt((int64_t)StreamType::Telem);
+    headerWriter.writeUint16Le(0);
+    headerWriter.writeVarUint(0);
+
+    std::size_t packetSize = headerWriter.writenData().size() + 2;
+    bmcl::SharedBytes packet = bmcl::SharedBytes::create(4 + packetSize);
+    bmcl::MemWriter packWriter(packet.data(), packet.size());
+    packWriter.writeUint16Be(0x9c3e);
+    packWriter.writeUint16Le(packetSize);
+    packWriter.write(headerWriter.writenData());
+    Crc16 crc;
+    crc.update(packWriter.writenData().sliceFrom(2));
+    packWriter.writeUint16Le(crc.get());
+    return packet;
+}
+
+class DeviceRouterTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        _system.reset(new caf::actor_system(_cfg));
+        _self.reset(new caf::scoped_actor(*_system));
+        _sink = _system->spawn([](caf::event_based_actor* self) -> caf::behavior {
+            self->set_default_handler(caf::drop);
+            return {
+                [](RecvDataAtom, const bmcl::SharedBytes&) {
+                },
+            };
+        });
+    }
+
+    void TearDown() override
+    {
+        caf::anon_send_exit(_router, caf::exit_reason::user_shutdown);
+        caf::anon_send_exit(_sink, caf::exit_reason::user_shutdown);
+        for (const caf::actor& handler : _handlers) {
+            caf::anon_send_exit(handler, caf::exit_reason::user_shutdown);
+        }
+        _self.reset();
+        _system->await_all_actors_done();
+    }
+
+    // forwards exchange errors to test actor tagged with handler id
+    caf::actor spawnHandler(int id)
+    {
+        caf::actor collector = *_self;
+        caf::actor handler = _system->spawn([collector, id](caf::event_based_actor* self) -> caf::behavior {
+            self->set_default_handler(caf::drop);
+            return {
+                [self, collector, id](ExchangeErrorEventAtom, const std::string& msg) {
+                    self->send(collector, id, msg);
+                },
+            };
+        });
+        _handlers.push_back(handler);
+        return handler;
+    }
+
+    void startRouter(const caf::actor& defaultHandler)
+    {
+        _router = _system->spawn<DeviceRouter>(selfAddress, _sink, defaultHandler, PipelineMode::Fused);
+        (*_self)->send(_router, StartAtom::value);
+    }
+
+    caf::actor addDevice(uint64_t address, const caf::actor& handler)
+    {
+        caf::actor gc;
+        (*_self)->request(_router, caf::infinite, AddDeviceAtom::value, address, handler).receive(
+            [&gc](const caf::actor& actor) {
+                gc = actor;
+            },
+            [](const caf::error&) {
+            }
+        );
+        return gc;
+    }
+
+    caf::actor getDevice(uint64_t address)
+    {
+        caf::actor gc;
+        (*_self)->request(_router, caf::infinite, GetDeviceAtom::value, address).receive(
+            [&gc](const caf::actor& actor) {
+                gc = actor;
+            },
+            [](const caf::error&) {
+            }
+        );
+        return gc;
+    }
+
+    void sendData(const bmcl::SharedBytes& data)
+    {
+        (*_self)->send(_router, RecvDataAtom::value, data);
+    }
+
+    // receives handler ids of routed packets until timeout
+    std::vector<int> collect(std::chrono::milliseconds timeout)
+    {
+        std::vector<int> ids;
+        bool isTimeout = false;
+        while (!isTimeout) {
+            (*_self)->receive(
+                [&ids](int id, const std::string& msg) {
+                    EXPECT_EQ(invalidTmMsg, msg);
+                    ids.push_back(id);
+                },
+                caf::after(timeout) >> [&isTimeout] {
+                    isTimeout = true;
+                }
+            );
+        }
+        return ids;
+    }
+
+    caf::actor_system_config _cfg;
+    std::unique_ptr<caf::actor_system> _system;
+    std::unique_ptr<caf::scoped_actor> _self;
+    caf::actor _sink;
+    caf::actor _router;
+    std::vector<caf::actor> _handlers;
+};
+
+TEST_F(DeviceRouterTest, packetsAreRoutedBySrcAddress)
+{
+    startRouter(caf::actor());
+    caf::actor first = addDevice(5, spawnHandler(5));
+    caf::actor second = addDevice(6, spawnHandler(6));
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(first, addDevice(5, spawnHandler(7)));
+
+    // several packets in one chunk, second one split between chunks
+    bmcl::SharedBytes packet5 = makePacket(5, selfAddress);
+    bmcl::SharedBytes packet6 = makePacket(6, selfAddress);
+    std::vector<uint8_t> data;
+    data.insert(data.end(), packet5.data(), packet5.data() + packet5.size());
+    data.insert(data.end(), packet6.data(), packet6.data() + packet6.size());
+    data.insert(data.end(), packet5.data(), packet5.data() + packet5.size());
+    std::size_t split = packet5.size() + 3;
+    sendData(bmcl::SharedBytes::create(data.data(), split));
+    sendData(bmcl::SharedBytes::create(data.data() + split, data.size() - split));
+
+    std::vector<int> ids = collect(std::chrono::milliseconds(200));
+    ASSERT_EQ(3u, ids.size());
+    EXPECT_EQ(2, std::count(ids.begin(), ids.end(), 5));
+    EXPECT_EQ(1, std::count(ids.begin(), ids.end(), 6));
+}
+
+TEST_F(DeviceRouterTest, unknownDeviceIsDropped)
+{
+    startRouter(caf::actor());
+    addDevice(5, spawnHandler(5));
+
+    sendData(makePacket(9, selfAddress));
+    sendData(makePacket(5, selfAddress + 1));
+    EXPECT_FALSE(getDevice(9));
+    EXPECT_TRUE(collect(std::chrono::milliseconds(100)).empty());
+
+    // known device is not affected
+    sendData(makePacket(5, selfAddress));
+    EXPECT_EQ(std::vector<int>{5}, collect(std::chrono::milliseconds(200)));
+}
+
+TEST_F(DeviceRouterTest, unknownDeviceIsAddedWithDefaultHandler)
+{
+    startRouter(spawnHandler(0));
+    addDevice(5, spawnHandler(5));
+
+    sendData(makePacket(9, selfAddress));
+    sendData(makePacket(8, selfAddress + 1));
+    EXPECT_TRUE(getDevice(9));
+    // packets for other ground stations do not register devices
+    EXPECT_FALSE(getDevice(8));
+
+    sendData(makePacket(5, selfAddress));
+    std::vector<int> ids = collect(std::chrono::milliseconds(200));
+    ASSERT_EQ(2u, ids.size());
+    EXPECT_EQ(1, std::count(ids.begin(), ids.end(), 0));
+    EXPECT_EQ(1, std::count(ids.begin(), ids.end(), 5));
+}
+
+TEST_F(DeviceRouterTest, removedDeviceIsNotRouted)
+{
+    startRouter(caf::actor());
+    addDevice(5, spawnHandler(5));
+    (*_self)->send(_router, RemoveDeviceAtom::value, uint64_t(5));
+
+    sendData(makePacket(5, selfAddress));
+    EXPECT_FALSE(getDevice(5));
+    EXPECT_TRUE(collect(std::chrono::milliseconds(100)).empty());
+}
@@ -14,6 +14,7 @@
 #include <bmcl/ColorStream.h>
 #include <bmcl/SharedBytes.h>
 #include <bmcl/FileUtils.h>
+#include <bmcl/Option.h>
 
 #include <tclap/CmdLine.h>
 
@@ -122,6 +123,61 @@ public:
         });
     }
 
+    bmcl::Option<bmcl::SharedBytes> readFile(const std::string& path)
+    {
+        bmcl::Result<bmcl::SharedBytes, int> rv = bmcl::readFileIntoBytes(path.c_str());
+        if (rv.isErr()) {
+            exitWithError("could not read file " + path);
+            return bmcl::None;
+        }
+        return rv.take();
+    }
+
+    bmcl::Option<std::uintmax_t> readSectorId(const std::string& idStr)
+    {
+        bmcl::Result<std::uintmax_t, void> rv = uintFromString(idStr, 10);
+        if (rv.isErr()) {
+            exitWithError("failed to parse sector id " + idStr);
+            return bmcl::None;
+        }
+        return rv.unwrap();
+    }
+
+    void execPatch(const std::vector<std::string>& cmds)
+    {
+        if (cmds.size() != 5) {
+            exitWithError("patch command requires 4 arguments, base file, base sector id, file and sector id");
+            return;
+        }
+        auto base = readFile(cmds[1]);
+        if (base.isNone()) {
+            return;
+        }
+        auto baseId = readSectorId(cmds[2]);
+        if (baseId.isNone()) {
+            return;
+        }
+        auto file = readFile(cmds[3]);
+        if (file.isNone()) {
+            return;
+        }
+        auto id = readSectorId(cmds[4]);
+        if (id.isNone()) {
+            return;
+        }
+
+        Rc<decode::DataReader> baseReader = new decode::MemDataReader(base.unwrap());
+        Rc<decode::DataReader> reader = new decode::MemDataReader(file.unwrap());
+        printCommandMsg("Flashing patch");
+        request(_gc, caf::infinite, FlashDfuPatch::value, baseId.unwrap(), id.unwrap(), baseReader, reader).then([this](const std::string& status) {
+            if (status != "ok") {
+                exitWithError(status);
+                return;
+            }
+            quit();
+        });
+    }
+
     void execCmd(const std::vector<std::string>& cmds)
     {
         if (cmds.empty()) {
@@ -139,6 +195,11 @@ public:
             return;
         }
 
+        if (cmds[0] == "patch") {
+            execPatch(cmds);
+            return;
+        }
+
         exitWithError("unknown cmd (" + joinCmds(cmds) + ")");
     }
 
@@ -251,6 +312,9 @@ private:
 
 const char* usage =
 "Examples:\n"
+"photon-dfu -d udp,127.0.0.1,6666 status\n"
+"photon-dfu -d udp,127.0.0.1,6666 write firmware.bin 2\n"
+"photon-dfu -d udp,127.0.0.1,6666 patch old.bin 2 firmware.bin 3\n"
 ;
 
 int main(int argc, char** argv)
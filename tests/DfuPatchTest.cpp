@@ -0,0 +1,160 @@
+#include "photon/dfu/Patch.h"
+#include "photon/groundcontrol/DfuPatch.h"
+
+#include <bmcl/Bytes.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+class DfuPatchTest : public ::testing::Test {
+protected:
+    static bool readBase(void* ctx, uint64_t offset, void* dest, size_t size)
+    {
+        DfuPatchTest* self = (DfuPatchTest*)ctx;
+        if (offset + size > self->_base.size()) {
+            return false;
+        }
+        std::copy_n(self->_base.begin() + offset, size, (uint8_t*)dest);
+        return true;
+    }
+
+    static bool writeTarget(void* ctx, uint64_t offset, const void* src, size_t size)
+    {
+        DfuPatchTest* self = (DfuPatchTest*)ctx;
+        // patched image is written sequentially in whole sectors, only last one may be shorter
+        EXPECT_EQ(self->_written, offset);
+        EXPECT_EQ(0u, offset % PHOTON_CFG_DFU_PATCH_SECTOR_SIZE);
+        if (offset + size != self->_result.size()) {
+            EXPECT_EQ(PHOTON_CFG_DFU_PATCH_SECTOR_SIZE, size);
+        }
+        if (offset + size > self->_result.size()) {
+            return false;
+        }
+        std::copy_n((const uint8_t*)src, size, self->_result.begin() + offset);
+        self->_written += size;
+        self->_writes++;
+        return true;
+    }
+
+    bool apply(const std::vector<uint8_t>& patch, std::size_t targetSize, std::size_t chunkSize)
+    {
+        _result.assign(targetSize, 0xff);
+        _written = 0;
+        _writes = 0;
+        PhotonDfuPatch state;
+        PhotonDfuPatch_Init(&state, _base.size(), targetSize, readBase, writeTarget, this);
+        for (std::size_t i = 0; i < patch.size(); i += chunkSize) {
+            if (!PhotonDfuPatch_Feed(&state, patch.data() + i, std::min(chunkSize, patch.size() - i))) {
+                return false;
+            }
+        }
+        return PhotonDfuPatch_IsFinished(&state);
+    }
+
+    // returns patch size
+    std::size_t roundTrip(const std::vector<uint8_t>& target)
+    {
+        std::vector<uint8_t> patch = photon::makeDfuPatch(bmcl::Bytes(_base.data(), _base.size()),
+                                                          bmcl::Bytes(target.data(), target.size()));
+        for (std::size_t chunkSize : {1, 7, 512}) {
+            EXPECT_TRUE(apply(patch, target.size(), chunkSize));
+            EXPECT_EQ(target, _result);
+        }
+        return patch.size();
+    }
+
+    static std::vector<uint8_t> randomImage(std::size_t size, unsigned seed)
+    {
+        std::vector<uint8_t> data(size);
+        std::mt19937 gen(seed);
+        for (uint8_t& b : data) {
+            b = uint8_t(gen());
+        }
+        return data;
+    }
+
+    std::vector<uint8_t> _base;
+    std::vector<uint8_t> _result;
+    uint64_t _written;
+    std::size_t _writes;
+};
+
+TEST_F(DfuPatchTest, sameImage)
+{
+    _base = randomImage(20000, 1);
+    std::size_t size = roundTrip(_base);
+    EXPECT_LT(size, 16u);
+}
+
+TEST_F(DfuPatchTest, smallChanges)
+{
+    _base = randomImage(20000, 1);
+    std::vector<uint8_t> target = _base;
+    target[100] ^= 0xff;
+    target[5000] ^= 0x01;
+    target[5001] ^= 0x01;
+    target[19999] = 0;
+    std::size_t size = roundTrip(target);
+    EXPECT_LT(size, 100u);
+}
+
+TEST_F(DfuPatchTest, shiftedCode)
+{
+    _base = randomImage(20000, 1);
+    std::vector<uint8_t> target = _base;
+    std::vector<uint8_t> inserted = randomImage(300, 2);
+    target.insert(target.begin() + 1000, inserted.begin(), inserted.end());
+    target.erase(target.begin() + 15000, target.begin() + 15100);
+    std::size_t size = roundTrip(target);
+    EXPECT_LT(size, 400u);
+}
+
+TEST_F(DfuPatchTest, targetIsWrittenInAlignedSectors)
+{
+    const std::size_t sectorSize = PHOTON_CFG_DFU_PATCH_SECTOR_SIZE;
+    _base = randomImage(10 * sectorSize, 1);
+    // copies and inserts of odd sizes at odd offsets
+    std::vector<uint8_t> target(_base.begin() + 3, _base.begin() + 3 + 2 * sectorSize + 5);
+    std::vector<uint8_t> inserted = randomImage(sectorSize + 7, 2);
+    target.insert(target.end(), inserted.begin(), inserted.end());
+    target.insert(target.end(), _base.begin() + 1001, _base.end() - 11);
+    std::vector<uint8_t> patch = photon::makeDfuPatch(bmcl::Bytes(_base.data(), _base.size()),
+                                                      bmcl::Bytes(target.data(), target.size()));
+    for (std::size_t chunkSize : {1, 7, 512}) {
+        ASSERT_TRUE(apply(patch, target.size(), chunkSize));
+        EXPECT_EQ(target, _result);
+        EXPECT_EQ((target.size() + sectorSize - 1) / sectorSize, _writes);
+    }
+}
+
+TEST_F(DfuPatchTest, unrelatedImages)
+{
+    _base = randomImage(5000, 1);
+    std::vector<uint8_t> target = randomImage(7000, 2);
+    std::size_t size = roundTrip(target);
+    EXPECT_LT(size, target.size() + 16);
+}
+
+TEST_F(DfuPatchTest, emptyBaseAndTarget)
+{
+    roundTrip(randomImage(100, 1));
+    _base = randomImage(100, 1);
+    roundTrip(std::vector<uint8_t>());
+}
+
+TEST_F(DfuPatchTest, invalidPatches)
+{
+    _base = randomImage(100, 1);
+    // unknown op
+    EXPECT_FALSE(apply({2, 0, 0}, 10, 1));
+    // copy past base end
+    EXPECT_FALSE(apply({PHOTON_DFU_PATCH_OP_COPY, 90, 20}, 20, 1));
+    // insert past target end
+    EXPECT_FALSE(apply({PHOTON_DFU_PATCH_OP_INSERT, 2, 1, 2}, 1, 1));
+    // truncated
+    EXPECT_FALSE(apply({PHOTON_DFU_PATCH_OP_INSERT, 3, 1, 2}, 3, 1));
+    EXPECT_FALSE(apply({PHOTON_DFU_PATCH_OP_COPY, 0}, 10, 1));
+}
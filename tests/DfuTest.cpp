@@ -0,0 +1,393 @@
+#include "Photon.h"
+#include "photongen/onboard/dfu/Dfu.Component.h"
+#include "photongen/onboard/dfu/Cmd.h"
+#include "photongen/onboard/dfu/Response.h"
+#include "photongen/onboard/dfu/State.h"
+#include "photon/groundcontrol/Crc.h"
+#include "photon/groundcontrol/DfuPatch.h"
+
+#include <bmcl/Bytes.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#if defined(PHOTON_HAS_MODULE_DFU) && defined(PHOTON_STUB)
+
+// stub firmware sector
+constexpr uint64_t sectorId = 3;
+// stub user data sector, used as patch base
+constexpr uint64_t baseSectorId = 2;
+constexpr uint64_t blockSize = 256;
+constexpr uint64_t transferId = 0x1122334455667788;
+constexpr uint64_t baseId = 0x0102030405060708;
+constexpr uint64_t targetId = 0x1020304050607080;
+
+struct WriteAck {
+    uint64_t lastOffset;
+    uint64_t writtenSize;
+    std::vector<uint8_t> bitmap;
+};
+
+class DfuTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        PhotonDfu_Init();
+        _image.resize(blockSize * 4 - 10);
+        for (size_t i = 0; i < _image.size(); i++) {
+            _image[i] = uint8_t(i * 7);
+        }
+    }
+
+    template <typename F>
+    PhotonError accept(PhotonDfuCmd cmd, F&& ser)
+    {
+        uint8_t buf[1024];
+        PhotonWriter dest;
+        PhotonWriter_Init(&dest, buf, sizeof(buf));
+        EXPECT_EQ(PhotonError_Ok, PhotonDfuCmd_Serialize(cmd, &dest));
+        ser(&dest);
+        PhotonReader src;
+        PhotonReader_Init(&src, buf, PhotonWriter_CurrentPtr(&dest) - buf);
+        uint8_t out[16];
+        PhotonWriter unused;
+        PhotonWriter_Init(&unused, out, sizeof(out));
+        return PhotonDfu_AcceptCmd(0, &src, &unused);
+    }
+
+    void beginUpdate()
+    {
+        accept(PhotonDfuCmd_BeginUpdate, [this](PhotonWriter* dest) {
+            PhotonWriter_WriteVaruint(dest, sectorId);
+            PhotonWriter_WriteVaruint(dest, _image.size());
+            PhotonWriter_WriteVaruint(dest, blockSize);
+            PhotonWriter_WriteU64Le(dest, transferId);
+        });
+        ASSERT_EQ(PhotonDfuResponse_BeginOk, genAnswer().front());
+    }
+
+    PhotonError writeBlock(size_t block)
+    {
+        return writeBlock(_image, block);
+    }
+
+    PhotonError writeBlock(const std::vector<uint8_t>& data, size_t block)
+    {
+        return accept(PhotonDfuCmd_WriteChunk, [&data, block](PhotonWriter* dest) {
+            uint64_t offset = block * blockSize;
+            uint64_t size = std::min<uint64_t>(blockSize, data.size() - offset);
+            PhotonWriter_WriteVaruint(dest, offset);
+            PhotonWriter_WriteVaruint(dest, size);
+            PhotonWriter_Write(dest, data.data() + offset, size);
+        });
+    }
+
+    PhotonError endUpdate()
+    {
+        return endUpdate(sectorId, _image.size());
+    }
+
+    PhotonError endUpdate(uint64_t sector, uint64_t size)
+    {
+        return accept(PhotonDfuCmd_EndUpdate, [sector, size](PhotonWriter* dest) {
+            PhotonWriter_WriteVaruint(dest, sector);
+            PhotonWriter_WriteVaruint(dest, size);
+        });
+    }
+
+    // writes all blocks of data to sector that was begun
+    void writeAll(const std::vector<uint8_t>& data)
+    {
+        size_t blocks = (data.size() + blockSize - 1) / blockSize;
+        for (size_t i = 0; i < blocks; i++) {
+            EXPECT_EQ(PhotonError_Ok, writeBlock(data, i));
+        }
+        WriteAck ack;
+        ASSERT_TRUE(genWriteAck(&ack));
+        EXPECT_EQ(data.size(), ack.writtenSize);
+    }
+
+    // flashes _image to patch base sector
+    void flashBase()
+    {
+        accept(PhotonDfuCmd_BeginUpdate, [this](PhotonWriter* dest) {
+            PhotonWriter_WriteVaruint(dest, baseSectorId);
+            PhotonWriter_WriteVaruint(dest, _image.size());
+            PhotonWriter_WriteVaruint(dest, blockSize);
+            PhotonWriter_WriteU64Le(dest, baseId);
+        });
+        ASSERT_EQ(PhotonDfuResponse_BeginOk, genAnswer().front());
+        writeAll(_image);
+        ASSERT_EQ(PhotonError_Ok, endUpdate(baseSectorId, _image.size()));
+        ASSERT_EQ(PhotonDfuResponse_EndOk, genAnswer().front());
+    }
+
+    PhotonError beginPatch(const std::vector<uint8_t>& patch, const std::vector<uint8_t>& target, uint64_t patchBaseId, uint16_t targetCrc)
+    {
+        return accept(PhotonDfuCmd_BeginPatch, [&](PhotonWriter* dest) {
+            PhotonWriter_WriteVaruint(dest, sectorId);
+            PhotonWriter_WriteVaruint(dest, patch.size());
+            PhotonWriter_WriteVaruint(dest, blockSize);
+            PhotonWriter_WriteU64Le(dest, transferId);
+            PhotonWriter_WriteVaruint(dest, baseSectorId);
+            PhotonWriter_WriteU64Le(dest, patchBaseId);
+            PhotonWriter_WriteVaruint(dest, target.size());
+            PhotonWriter_WriteU64Le(dest, targetId);
+            PhotonWriter_WriteU16Le(dest, targetCrc);
+        });
+    }
+
+    // base with a replaced middle part and appended tail
+    std::vector<uint8_t> makeTarget() const
+    {
+        std::vector<uint8_t> target(_image.begin(), _image.begin() + 300);
+        for (size_t i = 0; i < 700; i++) {
+            target.push_back(uint8_t(i * 13 + 5));
+        }
+        target.insert(target.end(), _image.begin() + 500, _image.end());
+        target.insert(target.end(), _image.begin(), _image.begin() + 200);
+        return target;
+    }
+
+    static uint16_t crc16(const std::vector<uint8_t>& data)
+    {
+        photon::Crc16 crc;
+        crc.update(data.data(), data.size());
+        return crc.get();
+    }
+
+    static std::vector<uint8_t> makePatch(const std::vector<uint8_t>& base, const std::vector<uint8_t>& target)
+    {
+        return photon::makeDfuPatch(bmcl::Bytes(base.data(), base.size()), bmcl::Bytes(target.data(), target.size()));
+    }
+
+    std::vector<uint8_t> genAnswer()
+    {
+        uint8_t buf[1024];
+        PhotonWriter dest;
+        PhotonWriter_Init(&dest, buf, sizeof(buf));
+        EXPECT_EQ(PhotonError_Ok, PhotonDfu_GenAnswer(&dest));
+        return std::vector<uint8_t>(buf, PhotonWriter_CurrentPtr(&dest));
+    }
+
+    static std::vector<uint8_t> readBitmap(PhotonReader* src)
+    {
+        uint64_t size;
+        EXPECT_EQ(PhotonError_Ok, PhotonReader_ReadVaruint(src, &size));
+        EXPECT_EQ(size, PhotonReader_ReadableSize(src));
+        std::vector<uint8_t> bitmap(PhotonReader_CurrentPtr(src), PhotonReader_CurrentPtr(src) + size);
+        PhotonReader_Skip(src, size);
+        return bitmap;
+    }
+
+    bool genWriteAck(WriteAck* ack)
+    {
+        std::vector<uint8_t> answer = genAnswer();
+        PhotonReader src;
+        PhotonReader_Init(&src, answer.data(), answer.size());
+        PhotonDfuResponse resp;
+        EXPECT_EQ(PhotonError_Ok, PhotonDfuResponse_Deserialize(&resp, &src));
+        if (resp != PhotonDfuResponse_WriteOk) {
+            return false;
+        }
+        EXPECT_EQ(PhotonError_Ok, PhotonReader_ReadVaruint(&src, &ack->lastOffset));
+        EXPECT_EQ(PhotonError_Ok, PhotonReader_ReadVaruint(&src, &ack->writtenSize));
+        ack->bitmap = readBitmap(&src);
+        return true;
+    }
+
+    std::vector<uint8_t> readSector()
+    {
+        return readSector(_image.size());
+    }
+
+    std::vector<uint8_t> readSector(size_t size)
+    {
+        std::vector<uint8_t> data(size);
+        const PhotonDfuSectorDesc* sector = &_photonDfu.allSectorsDesc.data[sectorId];
+        EXPECT_EQ(PhotonError_Ok, PhotonDfu_HandleReadSector(sector, 0, data.data(), data.size()));
+        return data;
+    }
+
+    std::vector<uint8_t> _image;
+};
+
+TEST_F(DfuTest, windowIsAcknowledgedByOneAnswer)
+{
+    beginUpdate();
+    for (size_t i = 0; i < 4; i++) {
+        EXPECT_EQ(PhotonError_Ok, writeBlock(i));
+    }
+    ASSERT_TRUE(PhotonDfu_HasAnswers());
+    WriteAck ack;
+    ASSERT_TRUE(genWriteAck(&ack));
+    EXPECT_EQ(3 * blockSize, ack.lastOffset);
+    EXPECT_EQ(_image.size(), ack.writtenSize);
+    EXPECT_EQ(std::vector<uint8_t>{0x0f}, ack.bitmap);
+    EXPECT_FALSE(PhotonDfu_HasAnswers());
+}
+
+TEST_F(DfuTest, lostBlockIsResent)
+{
+    beginUpdate();
+    EXPECT_EQ(PhotonError_Ok, writeBlock(0));
+    EXPECT_EQ(PhotonError_Ok, writeBlock(2));
+    EXPECT_EQ(PhotonError_Ok, writeBlock(3));
+    WriteAck ack;
+    ASSERT_TRUE(genWriteAck(&ack));
+    EXPECT_EQ(std::vector<uint8_t>{0x0d}, ack.bitmap);
+
+    EXPECT_NE(PhotonError_Ok, endUpdate());
+    EXPECT_EQ(PhotonDfuResponse_Error, genAnswer().front());
+
+    EXPECT_EQ(PhotonError_Ok, writeBlock(1));
+    ASSERT_TRUE(genWriteAck(&ack));
+    EXPECT_EQ(blockSize, ack.lastOffset);
+    EXPECT_EQ(std::vector<uint8_t>{0x0f}, ack.bitmap);
+
+    EXPECT_EQ(PhotonError_Ok, endUpdate());
+    EXPECT_EQ(PhotonDfuResponse_EndOk, genAnswer().front());
+    EXPECT_EQ(_image, readSector());
+}
+
+TEST_F(DfuTest, duplicateBlockIsAcknowledged)
+{
+    beginUpdate();
+    EXPECT_EQ(PhotonError_Ok, writeBlock(1));
+    WriteAck ack;
+    ASSERT_TRUE(genWriteAck(&ack));
+    EXPECT_EQ(PhotonError_Ok, writeBlock(1));
+    ASSERT_TRUE(genWriteAck(&ack));
+    EXPECT_EQ(blockSize, ack.lastOffset);
+    EXPECT_EQ(blockSize, ack.writtenSize);
+    EXPECT_EQ(std::vector<uint8_t>{0x02}, ack.bitmap);
+}
+
+TEST_F(DfuTest, errorIsNotOverwrittenByAck)
+{
+    beginUpdate();
+    EXPECT_NE(PhotonError_Ok, accept(PhotonDfuCmd_WriteChunk, [](PhotonWriter* dest) {
+        PhotonWriter_WriteVaruint(dest, 1);
+        PhotonWriter_WriteVaruint(dest, 0);
+    }));
+    EXPECT_EQ(PhotonError_Ok, writeBlock(0));
+    EXPECT_EQ(PhotonDfuResponse_Error, genAnswer().front());
+    WriteAck ack;
+    ASSERT_TRUE(genWriteAck(&ack));
+    EXPECT_EQ(std::vector<uint8_t>{0x01}, ack.bitmap);
+    EXPECT_FALSE(PhotonDfu_HasAnswers());
+}
+
+TEST_F(DfuTest, progressAllowsResume)
+{
+    beginUpdate();
+    EXPECT_EQ(PhotonError_Ok, writeBlock(0));
+    EXPECT_EQ(PhotonError_Ok, writeBlock(3));
+    // answer lost
+    genAnswer();
+
+    EXPECT_EQ(PhotonError_Ok, accept(PhotonDfuCmd_GetProgress, [](PhotonWriter*) {}));
+    std::vector<uint8_t> answer = genAnswer();
+    PhotonReader src;
+    PhotonReader_Init(&src, answer.data(), answer.size());
+    PhotonDfuResponse resp;
+    ASSERT_EQ(PhotonError_Ok, PhotonDfuResponse_Deserialize(&resp, &src));
+    ASSERT_EQ(PhotonDfuResponse_Progress, resp);
+    PhotonDfuState state;
+    ASSERT_EQ(PhotonError_Ok, PhotonDfuState_Deserialize(&state, &src));
+    EXPECT_EQ(PhotonDfuState_Writing, state);
+    uint64_t sector, size, progressBlockSize;
+    ASSERT_EQ(PhotonError_Ok, PhotonReader_ReadVaruint(&src, &sector));
+    ASSERT_EQ(PhotonError_Ok, PhotonReader_ReadVaruint(&src, &size));
+    ASSERT_EQ(PhotonError_Ok, PhotonReader_ReadVaruint(&src, &progressBlockSize));
+    EXPECT_EQ(sectorId, sector);
+    EXPECT_EQ(_image.size(), size);
+    EXPECT_EQ(blockSize, progressBlockSize);
+    ASSERT_LE(8u, PhotonReader_ReadableSize(&src));
+    EXPECT_EQ(transferId, PhotonReader_ReadU64Le(&src));
+    EXPECT_EQ(std::vector<uint8_t>{0x09}, readBitmap(&src));
+
+    EXPECT_EQ(PhotonError_Ok, writeBlock(1));
+    EXPECT_EQ(PhotonError_Ok, writeBlock(2));
+    WriteAck ack;
+    ASSERT_TRUE(genWriteAck(&ack));
+    EXPECT_EQ(std::vector<uint8_t>{0x0f}, ack.bitmap);
+    EXPECT_EQ(PhotonError_Ok, endUpdate());
+    EXPECT_EQ(PhotonDfuResponse_EndOk, genAnswer().front());
+    EXPECT_EQ(_image, readSector());
+}
+
+TEST_F(DfuTest, patchIsAppliedToBase)
+{
+    flashBase();
+    std::vector<uint8_t> target = makeTarget();
+    std::vector<uint8_t> patch = makePatch(_image, target);
+    ASSERT_LT(patch.size(), target.size());
+    ASSERT_LT(blockSize, patch.size());
+
+    ASSERT_EQ(PhotonError_Ok, beginPatch(patch, target, baseId, crc16(target)));
+    ASSERT_EQ(PhotonDfuResponse_BeginOk, genAnswer().front());
+    writeAll(patch);
+    EXPECT_EQ(PhotonError_Ok, endUpdate(sectorId, patch.size()));
+    EXPECT_EQ(PhotonDfuResponse_EndOk, genAnswer().front());
+    EXPECT_EQ(target, readSector(target.size()));
+    EXPECT_EQ(targetId, _photonDfu.allImagesDesc.data[sectorId].id);
+    EXPECT_EQ(target.size(), _photonDfu.allImagesDesc.data[sectorId].size);
+}
+
+TEST_F(DfuTest, patchBlocksAfterLostOneAreResent)
+{
+    flashBase();
+    std::vector<uint8_t> target = makeTarget();
+    std::vector<uint8_t> patch = makePatch(_image, target);
+    ASSERT_LT(2 * blockSize, patch.size());
+
+    ASSERT_EQ(PhotonError_Ok, beginPatch(patch, target, baseId, crc16(target)));
+    ASSERT_EQ(PhotonDfuResponse_BeginOk, genAnswer().front());
+    EXPECT_EQ(PhotonError_Ok, writeBlock(patch, 0));
+    EXPECT_EQ(PhotonError_Ok, writeBlock(patch, 2));
+    WriteAck ack;
+    ASSERT_TRUE(genWriteAck(&ack));
+    // patch is applied sequentially, block 2 is ignored until block 1 is written
+    EXPECT_EQ(std::vector<uint8_t>{0x01}, ack.bitmap);
+
+    writeAll(patch);
+    EXPECT_EQ(PhotonError_Ok, endUpdate(sectorId, patch.size()));
+    EXPECT_EQ(PhotonDfuResponse_EndOk, genAnswer().front());
+    EXPECT_EQ(target, readSector(target.size()));
+}
+
+TEST_F(DfuTest, patchedImageWithWrongCrcIsRejected)
+{
+    flashBase();
+    std::vector<uint8_t> target = makeTarget();
+    std::vector<uint8_t> patch = makePatch(_image, target);
+
+    uint16_t crc = crc16(target);
+    ASSERT_EQ(PhotonError_Ok, beginPatch(patch, target, baseId, crc ^ 1));
+    ASSERT_EQ(PhotonDfuResponse_BeginOk, genAnswer().front());
+    writeAll(patch);
+    EXPECT_NE(PhotonError_Ok, endUpdate(sectorId, patch.size()));
+    EXPECT_EQ(PhotonDfuResponse_Error, genAnswer().front());
+    EXPECT_EQ(PhotonDfuState_Idle, _photonDfu.state);
+    EXPECT_EQ(0u, _photonDfu.allImagesDesc.data[sectorId].id);
+}
+
+TEST_F(DfuTest, patchRequiresKnownBase)
+{
+    std::vector<uint8_t> target = makeTarget();
+    std::vector<uint8_t> patch = makePatch(_image, target);
+    uint16_t crc = crc16(target);
+
+    // base sector has no stored image id
+    EXPECT_NE(PhotonError_Ok, beginPatch(patch, target, baseId, crc));
+    EXPECT_EQ(PhotonDfuResponse_Error, genAnswer().front());
+
+    flashBase();
+    EXPECT_NE(PhotonError_Ok, beginPatch(patch, target, baseId + 1, crc));
+    EXPECT_EQ(PhotonDfuResponse_Error, genAnswer().front());
+}
+
+#endif
@@ -0,0 +1,101 @@
+#include "photon/groundcontrol/LinkBond.h"
+
+#include <gtest/gtest.h>
+
+using namespace photon;
+
+class DuplicateFilterTest : public ::testing::Test {
+protected:
+    using Clock = DuplicateFilter::Clock;
+
+    DuplicateFilterTest()
+        : _filter(std::chrono::milliseconds(1000))
+        , _now(Clock::now())
+    {
+    }
+
+    bool isDuplicate(uint16_t counter, StreamType streamType = StreamType::Telem, PacketType packetType = PacketType::Unreliable)
+    {
+        PacketHeader header;
+        header.srcAddress = 1;
+        header.destAddress = 0;
+        header.counter = counter;
+        header.streamDirection = StreamDirection::Downlink;
+        header.packetType = packetType;
+        header.streamType = streamType;
+        return _filter.isDuplicate(header, _now, &_delay);
+    }
+
+    void advance(std::chrono::milliseconds delta)
+    {
+        _now += delta;
+    }
+
+    DuplicateFilter _filter;
+    Clock::time_point _now;
+    Clock::duration _delay;
+};
+
+TEST_F(DuplicateFilterTest, repeatedCounterIsDuplicate)
+{
+    EXPECT_FALSE(isDuplicate(10));
+    EXPECT_FALSE(isDuplicate(11));
+    advance(std::chrono::milliseconds(30));
+    EXPECT_TRUE(isDuplicate(11));
+    EXPECT_EQ(std::chrono::milliseconds(30), _delay);
+    EXPECT_TRUE(isDuplicate(10));
+}
+
+TEST_F(DuplicateFilterTest, reorderedPacketsAreAccepted)
+{
+    EXPECT_FALSE(isDuplicate(10));
+    EXPECT_FALSE(isDuplicate(13));
+    EXPECT_FALSE(isDuplicate(11));
+    EXPECT_FALSE(isDuplicate(12));
+    EXPECT_TRUE(isDuplicate(11));
+    EXPECT_TRUE(isDuplicate(13));
+}
+
+TEST_F(DuplicateFilterTest, counterWrapsAround)
+{
+    EXPECT_FALSE(isDuplicate(65534));
+    EXPECT_FALSE(isDuplicate(65535));
+    EXPECT_FALSE(isDuplicate(0));
+    EXPECT_TRUE(isDuplicate(65535));
+    EXPECT_TRUE(isDuplicate(0));
+}
+
+TEST_F(DuplicateFilterTest, streamsAndPacketTypesAreSeparate)
+{
+    EXPECT_FALSE(isDuplicate(5, StreamType::Telem, PacketType::Unreliable));
+    EXPECT_FALSE(isDuplicate(5, StreamType::Cmd, PacketType::Unreliable));
+    EXPECT_FALSE(isDuplicate(5, StreamType::Cmd, PacketType::Receipt));
+    EXPECT_TRUE(isDuplicate(5, StreamType::Cmd, PacketType::Receipt));
+}
+
+TEST_F(DuplicateFilterTest, windowExpiresAfterTimeout)
+{
+    EXPECT_FALSE(isDuplicate(10));
+    advance(std::chrono::milliseconds(900));
+    EXPECT_TRUE(isDuplicate(10));
+    // window time is only updated by new packets
+    advance(std::chrono::milliseconds(200));
+    EXPECT_FALSE(isDuplicate(10));
+    EXPECT_TRUE(isDuplicate(10));
+}
+
+TEST_F(DuplicateFilterTest, counterFarBehindResetsWindow)
+{
+    EXPECT_FALSE(isDuplicate(1000));
+    EXPECT_FALSE(isDuplicate(1001));
+    // device was restarted
+    EXPECT_FALSE(isDuplicate(0));
+    EXPECT_FALSE(isDuplicate(1001));
+}
+
+TEST_F(DuplicateFilterTest, resetForgetsCounters)
+{
+    EXPECT_FALSE(isDuplicate(10));
+    _filter.reset();
+    EXPECT_FALSE(isDuplicate(10));
+}
@@ -0,0 +1,212 @@
+#include "Photon.h"
+#include "photongen/onboard/exc/Exc.Component.h"
+#include "photongen/onboard/exc/Device.h"
+#include "photongen/onboard/exc/DataHeader.h"
+#include "photongen/onboard/exc/ReceiptType.h"
+#include "photon/exc/Utils.h"
+#ifdef PHOTON_HAS_MODULE_TEST
+# include "photongen/onboard/test/Test.Component.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#ifdef PHOTON_HAS_MODULE_PVU
+
+static PhotonError encodePacket(const PhotonExcDataHeader* header, const std::vector<uint8_t>& payload, PhotonWriter* dest)
+{
+    PhotonWriter_WriteU16Be(dest, PHOTON_EXC_STREAM_SEPARATOR);
+    PHOTON_EXC_ENCODE_PACKET_HEADER(dest, reserved);
+    PHOTON_TRY(PhotonExcDataHeader_Serialize(header, &reserved));
+    if (PhotonWriter_WritableSize(&reserved) < payload.size()) {
+        return PhotonError_NotEnoughSpace;
+    }
+    PhotonWriter_Write(&reserved, payload.data(), payload.size());
+    PHOTON_EXC_ENCODE_PACKET_FOOTER(dest, reserved);
+    return PhotonError_Ok;
+}
+
+class ExcQueueTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        Photon_Init();
+        PhotonExcDevice_InitGroundControl(&_device, _address);
+    }
+
+    void sendReliableCmd(uint16_t counter, const std::vector<uint8_t>& payload = std::vector<uint8_t>())
+    {
+        PhotonExcDataHeader header;
+        header.srcAddress = _address;
+        header.destAddress = PhotonExc_SelfAddress();
+        header.streamDirection = PhotonExcStreamDirection_Uplink;
+        header.packetType = PhotonExcPacketType_Reliable;
+        header.streamType = PhotonExcStreamType_Cmd;
+        header.counter = counter;
+        header.time = 0;
+
+        uint8_t buf[1024];
+        PhotonWriter dest;
+        PhotonWriter_Init(&dest, buf, sizeof(buf));
+        ASSERT_EQ(PhotonError_Ok, encodePacket(&header, payload, &dest));
+        PhotonExcDevice_AcceptInput(&_device, buf, PhotonWriter_CurrentPtr(&dest) - buf);
+    }
+
+    // returns false if no packet was generated
+    bool genPacket(PhotonExcDataHeader* header, PhotonReader* payload)
+    {
+        PhotonWriter dest;
+        PhotonWriter_Init(&dest, _out, sizeof(_out));
+        if (PhotonExcDevice_GenNextPacket(&_device, &dest) != PhotonError_Ok) {
+            return false;
+        }
+        PhotonReader_Init(payload, _out, PhotonWriter_CurrentPtr(&dest) - _out);
+        PhotonReader_Skip(payload, 4);
+        EXPECT_EQ(PhotonError_Ok, PhotonExcDataHeader_Deserialize(header, payload));
+        return true;
+    }
+
+    void expectCounterCorrection(uint16_t counter, uint16_t expected)
+    {
+        PhotonExcDataHeader header;
+        PhotonReader payload;
+        ASSERT_TRUE(genPacket(&header, &payload));
+        EXPECT_EQ(PhotonExcPacketType_Receipt, header.packetType);
+        EXPECT_EQ(counter, header.counter);
+        PhotonExcReceiptType type;
+        ASSERT_EQ(PhotonError_Ok, PhotonExcReceiptType_Deserialize(&type, &payload));
+        EXPECT_EQ(PhotonExcReceiptType_CounterCorrection, type);
+        EXPECT_EQ(expected, PhotonReader_ReadU16Le(&payload));
+    }
+
+    void expectOkReceipt(uint16_t counter, const std::vector<uint8_t>& results)
+    {
+        PhotonExcDataHeader header;
+        PhotonReader payload;
+        ASSERT_TRUE(genPacket(&header, &payload));
+        EXPECT_EQ(PhotonExcPacketType_Receipt, header.packetType);
+        EXPECT_EQ(counter, header.counter);
+        PhotonExcReceiptType type;
+        ASSERT_EQ(PhotonError_Ok, PhotonExcReceiptType_Deserialize(&type, &payload));
+        EXPECT_EQ(PhotonExcReceiptType_Ok, type);
+        // payload reader includes crc
+        ASSERT_EQ(results.size() + 2, PhotonReader_ReadableSize(&payload));
+        const uint8_t* data = PhotonReader_CurrentPtr(&payload);
+        EXPECT_EQ(results, std::vector<uint8_t>(data, data + results.size()));
+    }
+
+    static PhotonError genCustom(void* data, PhotonWriter* dest)
+    {
+        (void)data;
+        PhotonWriter_WriteU8(dest, 0xaa);
+        return PhotonError_Ok;
+    }
+
+    const uint64_t _address = 5;
+    PhotonExcDevice _device;
+    uint8_t _out[1024];
+};
+
+TEST_F(ExcQueueTest, receiptsKeepOrder)
+{
+    sendReliableCmd(10);
+    sendReliableCmd(11);
+    sendReliableCmd(12);
+
+    expectCounterCorrection(10, 0);
+    expectCounterCorrection(11, 0);
+    expectCounterCorrection(12, 0);
+
+    // next packet is not a receipt
+    ASSERT_EQ(PhotonError_Ok, PhotonExcDevice_QueueCustomCmdPacket(&_device, 0, genCustom));
+    PhotonExcDataHeader header;
+    PhotonReader payload;
+    ASSERT_TRUE(genPacket(&header, &payload));
+    EXPECT_EQ(PhotonExcPacketType_Unreliable, header.packetType);
+    EXPECT_EQ(0xaa, PhotonReader_ReadU8(&payload));
+    EXPECT_EQ(0u, _device.droppedPackets);
+}
+
+TEST_F(ExcQueueTest, receiptsBeforeCustomPackets)
+{
+    ASSERT_EQ(PhotonError_Ok, PhotonExcDevice_QueueCustomCmdPacket(&_device, 0, genCustom));
+    sendReliableCmd(7);
+
+    expectCounterCorrection(7, 0);
+
+    PhotonExcDataHeader header;
+    PhotonReader payload;
+    ASSERT_TRUE(genPacket(&header, &payload));
+    EXPECT_EQ(PhotonExcStreamType_Cmd, header.streamType);
+    EXPECT_EQ(PhotonExcPacketType_Unreliable, header.packetType);
+    EXPECT_EQ(0xaa, PhotonReader_ReadU8(&payload));
+}
+
+TEST_F(ExcQueueTest, overflowCounted)
+{
+    std::size_t queueSize = sizeof(_device.outQueue) / sizeof(_device.outQueue[0]);
+    for (std::size_t i = 0; i < queueSize + 2; i++) {
+        sendReliableCmd(100 + i);
+    }
+    EXPECT_EQ(2u, _device.droppedPackets);
+    EXPECT_EQ(PhotonError_NotEnoughSpace, PhotonExcDevice_QueueCustomCmdPacket(&_device, 0, genCustom));
+
+    for (std::size_t i = 0; i < queueSize; i++) {
+        expectCounterCorrection(100 + i, 0);
+    }
+}
+
+#ifdef PHOTON_HAS_MODULE_TEST
+
+// index of testU8 in test.decode commands, it returns its argument
+constexpr uint8_t testU8Cmd = 18;
+
+// script of testU8 commands, results are the same bytes
+static std::vector<uint8_t> echoCmds(const std::vector<uint8_t>& values)
+{
+    std::vector<uint8_t> payload;
+    for (uint8_t value : values) {
+        payload.push_back(PHOTON_TEST_COMPONENT_ID);
+        payload.push_back(testU8Cmd);
+        payload.push_back(value);
+    }
+    return payload;
+}
+
+TEST_F(ExcQueueTest, okReceiptsCarryResultsInOrder)
+{
+    sendReliableCmd(0, echoCmds({1}));
+    sendReliableCmd(1, echoCmds({}));
+    sendReliableCmd(2, echoCmds({2, 3, 4}));
+    // counter correction is sent before queued ok receipts
+    sendReliableCmd(7);
+
+    expectCounterCorrection(7, 3);
+    expectOkReceipt(0, {1});
+    expectOkReceipt(1, {});
+    expectOkReceipt(2, {2, 3, 4});
+    EXPECT_EQ(0u, _device.droppedPackets);
+    EXPECT_EQ(0u, PhotonRingBuf_ReadableSize(&_device.resultsRingBuf));
+}
+
+TEST_F(ExcQueueTest, okReceiptResultsWrapAround)
+{
+    // results take more than resultsRingBuf in total, two receipts are queued at once
+    uint16_t counter = 0;
+    for (std::size_t i = 0; i < 20; i++) {
+        std::vector<uint8_t> first(100, uint8_t(i));
+        std::vector<uint8_t> second(37, uint8_t(i + 100));
+        sendReliableCmd(counter, echoCmds(first));
+        sendReliableCmd(counter + 1, echoCmds(second));
+        expectOkReceipt(counter, first);
+        expectOkReceipt(counter + 1, second);
+        counter += 2;
+    }
+    EXPECT_EQ(0u, _device.droppedPackets);
+    EXPECT_EQ(0u, PhotonRingBuf_ReadableSize(&_device.resultsRingBuf));
+}
+
+#endif
+
+#endif
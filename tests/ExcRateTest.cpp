@@ -0,0 +1,186 @@
+#include "Photon.h"
+#include "photongen/onboard/exc/Exc.Component.h"
+#include "photongen/onboard/exc/Device.h"
+#include "photongen/onboard/exc/DataHeader.h"
+#ifdef PHOTON_HAS_MODULE_FWT
+# include "photongen/onboard/fwt/Fwt.Component.h"
+# include "photongen/onboard/fwt/CmdType.h"
+#endif
+#ifdef PHOTON_HAS_MODULE_TM
+# include "photongen/onboard/tm/Tm.Component.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#ifdef PHOTON_HAS_MODULE_TM
+
+class ExcRateTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        Photon_Init();
+        PhotonExcDevice_InitGroundControl(&_device, 5);
+    }
+
+    // emulates link driver calling genPackets every step ms, returns number of generated bytes
+    std::size_t run(uint64_t from, uint64_t duration, uint64_t step)
+    {
+        std::size_t total = 0;
+        for (uint64_t now = from; now < from + duration; now += step) {
+            PhotonWriter dest;
+            PhotonWriter_Init(&dest, _out, sizeof(_out));
+            PhotonExcDevice_GenPackets(&_device, &dest, now);
+            total += PhotonWriter_CurrentPtr(&dest) - _out;
+        }
+        return total;
+    }
+
+    PhotonExcDevice _device;
+    uint8_t _out[8192];
+};
+
+TEST_F(ExcRateTest, slowLinkRate)
+{
+    PhotonExcDevice_SetBitrate(&_device, 9600, 256);
+    std::size_t total = run(0, 10000, 10);
+    // 12000 bytes, first burst and last overdraw are within one packet
+    EXPECT_NEAR(12000, total, 1024);
+}
+
+TEST_F(ExcRateTest, fastLinkRate)
+{
+    PhotonExcDevice_SetBitrate(&_device, 1000000, 2048);
+    std::size_t total = run(0, 10000, 10);
+    EXPECT_NEAR(1250000, total, 2048 + 1024);
+}
+
+TEST_F(ExcRateTest, coarseTicksEmitBursts)
+{
+    PhotonExcDevice_SetBitrate(&_device, 64000, 4096);
+    PhotonWriter dest;
+    PhotonWriter_Init(&dest, _out, sizeof(_out));
+    // 100ms worth of data in a single tick
+    PhotonExcDevice_GenPackets(&_device, &dest, 100);
+    std::size_t size = PhotonWriter_CurrentPtr(&dest) - _out;
+    EXPECT_GE(size, 800u);
+    EXPECT_LE(size, 800u + 1024u);
+
+    // bucket is empty on the same tick
+    PhotonWriter_Init(&dest, _out, sizeof(_out));
+    EXPECT_EQ(PhotonError_NoDataAvailable, PhotonExcDevice_GenPackets(&_device, &dest, 100));
+}
+
+TEST_F(ExcRateTest, rateChangeTakesEffect)
+{
+    PhotonExcDevice_SetBitrate(&_device, 8000, 128);
+    std::size_t slow = run(0, 5000, 10);
+    PhotonExcDevice_SetBitrate(&_device, 32000, 128);
+    std::size_t fast = run(5000, 5000, 10);
+    EXPECT_NEAR(5000, slow, 1024);
+    EXPECT_NEAR(20000, fast, 1024);
+}
+
+TEST_F(ExcRateTest, zeroWeightDisablesStream)
+{
+    ASSERT_EQ(PhotonError_Ok, PhotonExcDevice_SetStreamWeight(&_device, PhotonExcStreamType_Telem, 0));
+    EXPECT_EQ(0u, run(0, 1000, 10));
+    EXPECT_EQ(PhotonError_InvalidValue, PhotonExcDevice_SetStreamWeight(&_device, PhotonExcStreamType_Cmd, 1));
+}
+
+#ifdef PHOTON_HAS_MODULE_FWT
+
+// restarts firmware transfer so that fwt stream always has data
+static void restartFwt(uint64_t startId)
+{
+    uint8_t buf[16];
+    PhotonWriter dest;
+    PhotonWriter_Init(&dest, buf, sizeof(buf));
+    PhotonFwtCmdType_Serialize(PhotonFwtCmdType_Start, &dest);
+    PhotonWriter_WriteVaruint(&dest, startId);
+    PhotonReader src;
+    PhotonReader_Init(&src, buf, PhotonWriter_CurrentPtr(&dest) - buf);
+    PhotonExcDataHeader header;
+    ASSERT_EQ(PhotonError_Ok, PhotonFwt_AcceptCmd(&header, &src, &dest));
+}
+
+// [separator][u16 size][header and payload][crc], size covers size field, header and payload
+static void countStreamSizes(const uint8_t* data, std::size_t dataSize, std::size_t* fwtSize, std::size_t* tmSize)
+{
+    PhotonReader src;
+    PhotonReader_Init(&src, data, dataSize);
+    while (PhotonReader_ReadableSize(&src) != 0) {
+        ASSERT_LE(4u, PhotonReader_ReadableSize(&src));
+        PhotonReader_Skip(&src, 2);
+        std::size_t size = PhotonReader_ReadU16Le(&src);
+        ASSERT_LE(size, PhotonReader_ReadableSize(&src));
+        PhotonReader packet;
+        PhotonReader_Init(&packet, PhotonReader_CurrentPtr(&src), size - 2);
+        PhotonExcDataHeader header;
+        ASSERT_EQ(PhotonError_Ok, PhotonExcDataHeader_Deserialize(&header, &packet));
+        if (header.streamType == PhotonExcStreamType_Firmware) {
+            *fwtSize += size + 4;
+        } else if (header.streamType == PhotonExcStreamType_Telem) {
+            *tmSize += size + 4;
+        }
+        PhotonReader_Skip(&src, size);
+    }
+}
+
+TEST_F(ExcRateTest, weightedStreamsShareBandwidth)
+{
+    ASSERT_EQ(PhotonError_Ok, PhotonExcDevice_SetStreamWeight(&_device, PhotonExcStreamType_Firmware, 3));
+    ASSERT_EQ(PhotonError_Ok, PhotonExcDevice_SetStreamWeight(&_device, PhotonExcStreamType_Telem, 1));
+    PhotonExcDevice_SetBitrate(&_device, 64000, 1024);
+
+    std::size_t fwtSize = 0;
+    std::size_t tmSize = 0;
+    uint64_t startId = 1;
+    for (uint64_t now = 0; now < 20000; now += 10) {
+        if (!PhotonFwt_HasAnswers()) {
+            restartFwt(startId++);
+        }
+        PhotonWriter dest;
+        PhotonWriter_Init(&dest, _out, sizeof(_out));
+        PhotonExcDevice_GenPackets(&_device, &dest, now);
+
+        countStreamSizes(_out, PhotonWriter_CurrentPtr(&dest) - _out, &fwtSize, &tmSize);
+    }
+    ASSERT_NE(0u, tmSize);
+    // 160000 bytes, shares differ from weights by packet granularity
+    EXPECT_NEAR(160000, fwtSize + tmSize, 2048);
+    EXPECT_NEAR(3.0, double(fwtSize) / double(tmSize), 0.3);
+}
+
+TEST_F(ExcRateTest, idleTelemetryDoesNotBlockOtherStreams)
+{
+    for (unsigned compNum = 0; compNum <= 255; compNum++) {
+        for (unsigned msgNum = 0; msgNum <= 255; msgNum++) {
+            PhotonTm_SetStatusEnabled(compNum, msgNum, false);
+        }
+    }
+    // tick time is not advanced by run, status is sent once and telemetry has nothing due afterwards
+    ASSERT_EQ(PhotonError_Ok, PhotonTm_SetStatusEnabled(PHOTON_TM_COMPONENT_ID, 0, true));
+    ASSERT_EQ(PhotonError_Ok, PhotonTm_SetStatusPeriod(PHOTON_TM_COMPONENT_ID, 0, 3600000));
+    ASSERT_TRUE(PhotonTm_HasMessages());
+    PhotonExcDevice_SetBitrate(&_device, 64000, 1024);
+
+    std::size_t fwtSize = 0;
+    std::size_t tmSize = 0;
+    uint64_t startId = 1;
+    for (uint64_t now = 0; now < 2000; now += 10) {
+        if (!PhotonFwt_HasAnswers()) {
+            restartFwt(startId++);
+        }
+        PhotonWriter dest;
+        PhotonWriter_Init(&dest, _out, sizeof(_out));
+        PhotonExcDevice_GenPackets(&_device, &dest, now);
+        countStreamSizes(_out, PhotonWriter_CurrentPtr(&dest) - _out, &fwtSize, &tmSize);
+    }
+    EXPECT_LE(tmSize, 1024u);
+    // whole bandwidth is used by firmware stream
+    EXPECT_NEAR(16000, fwtSize + tmSize, 2048);
+}
+
+#endif
+
+#endif
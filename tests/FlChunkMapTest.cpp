@@ -0,0 +1,121 @@
+#include "photon/fl/ChunkMap.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+class FlChunkMapTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        PhotonFlChunkMap_Init(&_map, _bitmap, sizeof(_bitmap));
+    }
+
+    uint8_t _bitmap[4];
+    PhotonFlChunkMap _map;
+};
+
+TEST_F(FlChunkMapTest, zeroChunkSize)
+{
+    EXPECT_FALSE(PhotonFlChunkMap_Reset(&_map, 10, 0));
+    EXPECT_TRUE(PhotonFlChunkMap_Reset(&_map, 10, 1));
+}
+
+TEST_F(FlChunkMapTest, outOfOrderChunks)
+{
+    ASSERT_TRUE(PhotonFlChunkMap_Reset(&_map, 1000, 300));
+    EXPECT_EQ(4u, _map.chunkNum);
+
+    EXPECT_TRUE(PhotonFlChunkMap_IsValidChunk(&_map, 900, 100));
+    EXPECT_TRUE(PhotonFlChunkMap_IsValidChunk(&_map, 300, 300));
+    EXPECT_FALSE(PhotonFlChunkMap_IsValidChunk(&_map, 900, 300));
+    EXPECT_FALSE(PhotonFlChunkMap_IsValidChunk(&_map, 300, 100));
+    EXPECT_FALSE(PhotonFlChunkMap_IsValidChunk(&_map, 100, 300));
+    EXPECT_FALSE(PhotonFlChunkMap_IsValidChunk(&_map, 1200, 300));
+
+    for (uint64_t offset : {900, 0, 600}) {
+        EXPECT_FALSE(PhotonFlChunkMap_HasChunk(&_map, offset));
+        PhotonFlChunkMap_SetChunk(&_map, offset);
+        EXPECT_TRUE(PhotonFlChunkMap_HasChunk(&_map, offset));
+        EXPECT_FALSE(PhotonFlChunkMap_IsComplete(&_map));
+    }
+    // repeated chunk is counted once
+    PhotonFlChunkMap_SetChunk(&_map, 600);
+    EXPECT_FALSE(PhotonFlChunkMap_IsComplete(&_map));
+    // first chunk is received, window starts from chunk 1
+    EXPECT_EQ(1u, _map.firstMissing);
+    uint8_t window[4];
+    EXPECT_EQ(1u, PhotonFlChunkMap_CopyWindow(&_map, window, sizeof(window)));
+    EXPECT_EQ(0x06u, window[0]);
+
+    PhotonFlChunkMap_SetChunk(&_map, 300);
+    EXPECT_TRUE(PhotonFlChunkMap_IsComplete(&_map));
+}
+
+TEST_F(FlChunkMapTest, resetClearsBitmap)
+{
+    ASSERT_TRUE(PhotonFlChunkMap_Reset(&_map, 32, 1));
+    for (uint64_t i = 1; i < 32; i++) {
+        PhotonFlChunkMap_SetChunk(&_map, i);
+    }
+    EXPECT_FALSE(PhotonFlChunkMap_IsComplete(&_map));
+    EXPECT_EQ(0xffu, _bitmap[3]);
+
+    ASSERT_TRUE(PhotonFlChunkMap_Reset(&_map, 0, 1));
+    EXPECT_TRUE(PhotonFlChunkMap_IsComplete(&_map));
+    EXPECT_EQ(0u, _bitmap[3]);
+}
+
+TEST_F(FlChunkMapTest, fileLargerThanWindow)
+{
+    // 32 bit window, 100000 chunks
+    const uint64_t chunkSize = 768;
+    const uint64_t size = 100000 * chunkSize - 100;
+    ASSERT_TRUE(PhotonFlChunkMap_Reset(&_map, size, chunkSize));
+    EXPECT_EQ(100000u, _map.chunkNum);
+
+    // chunks outside of window are rejected
+    EXPECT_TRUE(PhotonFlChunkMap_IsValidChunk(&_map, 31 * chunkSize, chunkSize));
+    EXPECT_FALSE(PhotonFlChunkMap_IsValidChunk(&_map, 32 * chunkSize, chunkSize));
+
+    // window of 8 chunks in flight, every chunk is received in reverse order within window and some twice
+    for (uint64_t first = 0; first < _map.chunkNum; first += 8) {
+        for (uint64_t i = std::min<uint64_t>(first + 8, _map.chunkNum); i > first; i--) {
+            uint64_t offset = (i - 1) * chunkSize;
+            uint64_t chunk = std::min(chunkSize, size - offset);
+            ASSERT_TRUE(PhotonFlChunkMap_IsValidChunk(&_map, offset, chunk));
+            ASSERT_FALSE(PhotonFlChunkMap_HasChunk(&_map, offset));
+            PhotonFlChunkMap_SetChunk(&_map, offset);
+            ASSERT_TRUE(PhotonFlChunkMap_HasChunk(&_map, offset));
+            if ((i % 3) == 0) {
+                PhotonFlChunkMap_SetChunk(&_map, offset);
+            }
+        }
+        ASSERT_EQ(std::min<uint64_t>(first + 8, _map.chunkNum), _map.firstMissing);
+        ASSERT_TRUE(PhotonFlChunkMap_HasChunk(&_map, first * chunkSize));
+    }
+    EXPECT_TRUE(PhotonFlChunkMap_IsComplete(&_map));
+}
+
+TEST_F(FlChunkMapTest, windowWrapsAroundBitmap)
+{
+    ASSERT_TRUE(PhotonFlChunkMap_Reset(&_map, 100, 1));
+    for (uint64_t i = 1; i < 32; i++) {
+        PhotonFlChunkMap_SetChunk(&_map, i);
+    }
+    EXPECT_FALSE(PhotonFlChunkMap_IsValidChunk(&_map, 32, 1));
+    PhotonFlChunkMap_SetChunk(&_map, 0);
+    EXPECT_EQ(32u, _map.firstMissing);
+
+    // chunks 32 and 34 reuse bits of chunks 0 and 2
+    EXPECT_TRUE(PhotonFlChunkMap_IsValidChunk(&_map, 63, 1));
+    EXPECT_FALSE(PhotonFlChunkMap_HasChunk(&_map, 34));
+    PhotonFlChunkMap_SetChunk(&_map, 34);
+    EXPECT_TRUE(PhotonFlChunkMap_HasChunk(&_map, 34));
+    EXPECT_TRUE(PhotonFlChunkMap_HasChunk(&_map, 2));
+
+    uint8_t window[4];
+    EXPECT_EQ(4u, PhotonFlChunkMap_CopyWindow(&_map, window, sizeof(window)));
+    EXPECT_EQ(0x04u, window[0]);
+    EXPECT_EQ(0u, window[1] | window[2] | window[3]);
+}
@@ -100,12 +100,13 @@ public:
         : caf::event_based_actor(cfg)
         , _testCfg(testCfg)
     {
+        set_default_handler(caf::drop);
     }
 
     caf::behavior make_behavior() override
     {
         return caf::behavior{
-            [this](SetProjectAtom, const ProjectUpdate&) {
+            [this](SetProjectAtom, const ProjectUpdate::ConstPointer&) {
                 _testCfg->projectUpdated = true;
                 if (_testCfg->exitOnProjectUpdate) {
                     _testCfg->parent->stop();
@@ -121,7 +122,7 @@ public:
                     _testCfg->parent->stop();
                 }
             },
-            [this](SetTmViewAtom, const Rc<NodeView>& tmView) {
+            [this](SetTmViewAtom, const Rc<NodeView>&, const Rc<NodeView>&, const Rc<NodeView>&) {
             },
             [this](FirmwareDownloadStartedEventAtom) {
             },
@@ -165,7 +166,7 @@ public:
     caf::behavior make_behavior() override
     {
         return caf::behavior{
-            [this](SendDataAtom, const bmcl::SharedBytes& data) {
+            [this](RecvDataAtom, const bmcl::SharedBytes& data) {
                 if (_streamCfg->shouldRecievePacket()) {
                     for (const uint8_t* it = data.data(); it < data.view().end(); it += _streamCfg->chunkSize) {
                         std::size_t size = std::min<std::size_t>(_streamCfg->chunkSize, data.view().end() - it);
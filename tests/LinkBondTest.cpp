@@ -0,0 +1,232 @@
+#include "photon/groundcontrol/LinkBond.h"
+#include "photon/groundcontrol/Atoms.h"
+#include "photon/groundcontrol/Crc.h"
+#include "photon/groundcontrol/AllowUnsafeMessageType.h"
+
+#include <bmcl/MemWriter.h>
+#include <bmcl/SharedBytes.h>
+
+#include <caf/all.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <vector>
+
+using namespace photon;
+
+DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(bmcl::SharedBytes);
+
+using InjectAtom = caf::atom_constant<caf::atom("inject")>;
+
+using Packet = std::vector<uint8_t>;
+
+// [u16 sep, u16 size, header, u16 crc], packets without payload
+static bmcl::SharedBytes makePacket(StreamDirection direction, PacketType packetType, StreamType streamType, uint16_t counter)
+{
+    uint8_t header[64];
+    bmcl::MemWriter headerWriter(header, sizeof(header));
+    headerWriter.writeVarUint(direction == StreamDirection::Uplink ? 0 : 1);
+    headerWriter.writeVarUint(direction == StreamDirection::Uplink ? 1 : 0);
+    headerWriter.writeVarInt((int64_t)direction);
+    headerWriter.writeVarInt((int64_t)packetType);
+    headerWriter.writeVarInt((int64_t)streamType);
+    headerWriter.writeUint16Le(counter);
+    headerWriter.writeVarUint(0);
+
+    std::size_t packetSize = headerWriter.writenData().size() + 2;
+    bmcl::SharedBytes packet = bmcl::SharedBytes::create(4 + packetSize);
+    bmcl::MemWriter packWriter(packet.data(), packet.size());
+    packWriter.writeUint16Be(0x9c3e);
+    packWriter.writeUint16Le(packetSize);
+    packWriter.write(headerWriter.writenData());
+    Crc16 crc;
+    crc.update(packWriter.writenData().sliceFrom(2));
+    packWriter.writeUint16Le(crc.get());
+    return packet;
+}
+
+static Packet toVector(const bmcl::SharedBytes& data)
+{
+    return Packet(data.data(), data.data() + data.size());
+}
+
+class LinkBondTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        _system.reset(new caf::actor_system(_cfg));
+        _self.reset(new caf::scoped_actor(*_system));
+        _handler = _system->spawn([](caf::event_based_actor*) -> caf::behavior {
+            return {
+                [](LogAtom, const std::string&) {
+                },
+            };
+        });
+        _telemCounter = 0;
+    }
+
+    void TearDown() override
+    {
+        caf::anon_send_exit(_bond, caf::exit_reason::user_shutdown);
+        for (const caf::actor& link : _links) {
+            caf::anon_send_exit(link, caf::exit_reason::user_shutdown);
+        }
+        caf::anon_send_exit(_handler, caf::exit_reason::user_shutdown);
+        _self.reset();
+        _system->await_all_actors_done();
+    }
+
+    // link forwards uplink packets to test actor tagged with link index,
+    // injected packets are sent to bond as downlink data
+    caf::actor spawnLink(int index)
+    {
+        caf::actor collector = *_self;
+        return _system->spawn([collector, index](caf::event_based_actor* self) -> caf::behavior {
+            return {
+                [self, collector, index](RecvDataAtom, const bmcl::SharedBytes& data) {
+                    self->send(collector, index, data);
+                },
+                [self](InjectAtom, const caf::actor& bond, const bmcl::SharedBytes& data) {
+                    self->send(bond, RecvDataAtom::value, data);
+                },
+                [](SetStreamDestAtom, const caf::actor&) {
+                },
+                [](StartAtom) {
+                },
+            };
+        });
+    }
+
+    void startBond(std::chrono::milliseconds healthTimeout)
+    {
+        _bond = _system->spawn<LinkBond>(_handler, std::vector<StreamType>(), healthTimeout);
+        (*_self)->send(_bond, SetStreamDestAtom::value, caf::actor(*_self));
+        for (int i = 0; i < 2; i++) {
+            _links[i] = spawnLink(i);
+            (*_self)->send(_bond, AddLinkAtom::value, _links[i]);
+        }
+        (*_self)->send(_bond, StartAtom::value);
+    }
+
+    void sendUplink(const bmcl::SharedBytes& packet)
+    {
+        (*_self)->send(_bond, RecvDataAtom::value, packet);
+    }
+
+    void inject(int link, const bmcl::SharedBytes& packet)
+    {
+        (*_self)->send(_links[link], InjectAtom::value, _bond, packet);
+    }
+
+    // receives uplink and downlink packets until timeout
+    void collect(std::chrono::milliseconds duration)
+    {
+        auto deadline = std::chrono::steady_clock::now() + duration;
+        while (true) {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) {
+                return;
+            }
+            bool isTimeout = false;
+            (*_self)->receive(
+                [this](int link, const bmcl::SharedBytes& data) {
+                    _uplink.emplace_back(link, toVector(data));
+                },
+                [this](RecvPacketAtom, const bmcl::SharedBytes& data) {
+                    _downlink.push_back(toVector(data));
+                },
+                caf::after(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now)) >> [&isTimeout] {
+                    isTimeout = true;
+                }
+            );
+            if (isTimeout) {
+                return;
+            }
+        }
+    }
+
+    // only given link receives telemetry, other link becomes unhealthy after health timeout
+    void keepAlive(int link, std::chrono::milliseconds duration)
+    {
+        auto step = std::chrono::milliseconds(10);
+        for (auto passed = std::chrono::milliseconds(0); passed < duration; passed += step) {
+            inject(link, makePacket(StreamDirection::Downlink, PacketType::Unreliable, StreamType::Telem, _telemCounter++));
+            collect(step);
+        }
+    }
+
+    std::size_t uplinkCount(int link, const Packet& packet) const
+    {
+        return std::count(_uplink.begin(), _uplink.end(), std::make_pair(link, packet));
+    }
+
+    caf::actor_system_config _cfg;
+    std::unique_ptr<caf::actor_system> _system;
+    std::unique_ptr<caf::scoped_actor> _self;
+    caf::actor _handler;
+    caf::actor _bond;
+    caf::actor _links[2];
+    std::vector<std::pair<int, Packet>> _uplink;
+    std::vector<Packet> _downlink;
+    uint16_t _telemCounter;
+};
+
+TEST_F(LinkBondTest, degradedPrimaryResendsPendingUplink)
+{
+    startBond(std::chrono::milliseconds(100));
+    bmcl::SharedBytes cmd = makePacket(StreamDirection::Uplink, PacketType::Reliable, StreamType::Cmd, 5);
+    sendUplink(cmd);
+    collect(std::chrono::milliseconds(20));
+    ASSERT_EQ(1u, _uplink.size());
+    int primary = _uplink[0].first;
+    int backup = 1 - primary;
+
+    keepAlive(backup, std::chrono::milliseconds(250));
+    EXPECT_EQ(1u, uplinkCount(primary, toVector(cmd)));
+    // resent once on failover, not on every link check
+    EXPECT_EQ(1u, uplinkCount(backup, toVector(cmd)));
+
+    // receipt of resent packet arrives over both links, only one is passed to exchange
+    bmcl::SharedBytes receipt = makePacket(StreamDirection::Downlink, PacketType::Receipt, StreamType::Cmd, 5);
+    inject(backup, receipt);
+    inject(primary, receipt);
+    collect(std::chrono::milliseconds(50));
+    EXPECT_EQ(1, std::count(_downlink.begin(), _downlink.end(), toVector(receipt)));
+
+    // acknowledged packet is not resent on next failover
+    keepAlive(primary, std::chrono::milliseconds(250));
+    EXPECT_EQ(1u, uplinkCount(primary, toVector(cmd)));
+}
+
+TEST_F(LinkBondTest, lowerLatencyLinkDoesNotResendUplink)
+{
+    startBond(std::chrono::milliseconds(1000));
+    bmcl::SharedBytes cmd = makePacket(StreamDirection::Uplink, PacketType::Reliable, StreamType::Cmd, 7);
+    sendUplink(cmd);
+    collect(std::chrono::milliseconds(20));
+    ASSERT_EQ(1u, _uplink.size());
+    int primary = _uplink[0].first;
+    int other = 1 - primary;
+
+    // primary delivers the same telemetry later than other link
+    for (int i = 0; i < 4; i++) {
+        bmcl::SharedBytes telem = makePacket(StreamDirection::Downlink, PacketType::Unreliable, StreamType::Telem, _telemCounter++);
+        inject(other, telem);
+        collect(std::chrono::milliseconds(20));
+        inject(primary, telem);
+        collect(std::chrono::milliseconds(5));
+    }
+
+    bmcl::SharedBytes next = makePacket(StreamDirection::Uplink, PacketType::Unreliable, StreamType::Cmd, 1);
+    sendUplink(next);
+    collect(std::chrono::milliseconds(50));
+    EXPECT_EQ(1u, uplinkCount(other, toVector(next)));
+    EXPECT_EQ(0u, uplinkCount(primary, toVector(next)));
+    // reliable packet was sent over healthy link and is not duplicated
+    EXPECT_EQ(0u, uplinkCount(other, toVector(cmd)));
+    EXPECT_EQ(4u, _downlink.size());
+}
@@ -0,0 +1,216 @@
+#include "photon/core/Logging.h"
+#include "photon/groundcontrol/LogRecord.h"
+
+#include <bmcl/Bytes.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define _PHOTON_FNAME "LogRecordTest.cpp"
+
+using namespace photon;
+
+class LogRecordTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        // drop records left by previous tests
+        Photon_FlushLog(SIZE_MAX);
+        _data.clear();
+    }
+
+    std::vector<LogRecord> readRecords()
+    {
+        _data.resize(8192);
+        _data.resize(Photon_ReadLogRecords(_data.data(), _data.size()));
+        std::vector<LogRecord> records;
+        EXPECT_TRUE(decodeLogRecords(bmcl::Bytes(_data.data(), _data.size()), &records));
+        return records;
+    }
+
+    // formatted onboard from the same data as readRecords
+    std::vector<std::string> onboardLines() const
+    {
+        std::vector<std::string> lines;
+        std::size_t offset = 0;
+        while (offset < _data.size()) {
+            std::size_t size = _data[offset] | (_data[offset + 1] << 8);
+            char line[256];
+            Photon_FormatLogRecord(&_data[offset], size, line, sizeof(line));
+            lines.emplace_back(line);
+            offset += size;
+        }
+        return lines;
+    }
+
+    std::vector<uint8_t> _data;
+};
+
+TEST_F(LogRecordTest, headerIsDecoded)
+{
+    const char* fmt = "header %d";
+    unsigned line = __LINE__ + 1;
+    PHOTON_WARNING(fmt, 1);
+
+    auto records = readRecords();
+    ASSERT_EQ(1u, records.size());
+    EXPECT_EQ(PHOTON_LOG_LEVEL_WARNING, records[0].level);
+    EXPECT_EQ(line, records[0].line);
+    EXPECT_EQ(logStringId(_PHOTON_FNAME), records[0].fnameId);
+    EXPECT_EQ(logStringId(fmt), records[0].fmtId);
+    EXPECT_EQ(Photon_LogStringId(fmt), records[0].fmtId);
+    EXPECT_LT(0, records[0].time);
+}
+
+TEST_F(LogRecordTest, argsAreTaggedAndFixedWidth)
+{
+    PHOTON_DEBUG("%hd %hhu %lu %p %f %.2s", (short)-2, (unsigned char)200, 7ul, (void*)0x1234, 0.25, "abc");
+
+    auto records = readRecords();
+    ASSERT_EQ(1u, records.size());
+    const auto& args = records[0].args;
+    ASSERT_EQ(6u, args.size());
+    EXPECT_EQ(LogArgKind::Int, args[0].kind);
+    EXPECT_EQ(-2, args[0].asInt());
+    EXPECT_EQ(LogArgKind::Uint, args[1].kind);
+    EXPECT_EQ(200u, args[1].value);
+    EXPECT_EQ(LogArgKind::Uint, args[2].kind);
+    EXPECT_EQ(7u, args[2].value);
+    EXPECT_EQ(LogArgKind::Ptr, args[3].kind);
+    EXPECT_EQ(0x1234u, args[3].value);
+    EXPECT_EQ(LogArgKind::Double, args[4].kind);
+    EXPECT_EQ(0.25, args[4].asDouble());
+    EXPECT_EQ(LogArgKind::String, args[5].kind);
+    EXPECT_EQ("ab", args[5].str);
+}
+
+TEST_F(LogRecordTest, groundFormatMatchesOnboard)
+{
+    const char* fmts[] = {
+        "ints %d %i %u %x %X %o %c",
+        "sized %hd %hhu %ld %lld %zu %jd %td",
+        "u64 %" PRIu64 ", i32 %" PRIi32,
+        "floats %5.2f %e %g %Lg",
+        "strings %s|%-6s|%.3s",
+        "stars %*d|%-*d|%.*f|%*.*s",
+        "percent 100%% %d%%",
+        "unsupported %n",
+    };
+    int n = 0;
+    PHOTON_DEBUG(fmts[0], -7, 8, 42u, 0xbeefu, 0xbeefu, 8u, 'z');
+    PHOTON_DEBUG(fmts[1], (short)-300, (unsigned char)255, -70000l, -5000000000ll, std::size_t(1000), intmax_t(-1), ptrdiff_t(-3));
+    PHOTON_DEBUG(fmts[2], UINT64_MAX, INT32_MIN);
+    PHOTON_DEBUG(fmts[3], 3.14159, 1e10, 0.5, (long double)2.5);
+    PHOTON_DEBUG(fmts[4], "first", "left", "truncated");
+    PHOTON_DEBUG(fmts[5], 4, 12, 4, 12, 3, 1.0, 5, 2, "abc");
+    PHOTON_DEBUG(fmts[6], 5);
+    PHOTON_DEBUG(fmts[7], &n);
+
+    auto records = readRecords();
+    auto lines = onboardLines();
+    ASSERT_EQ(8u, records.size());
+    ASSERT_EQ(8u, lines.size());
+    for (std::size_t i = 0; i < records.size(); i++) {
+        EXPECT_EQ(lines[i], formatLogRecord(records[i], fmts[i]));
+    }
+    EXPECT_EQ("ints -7 8 42 beef BEEF 10 z", lines[0]);
+    EXPECT_EQ("sized -300 255 -70000 -5000000000 1000 -1 -3", lines[1]);
+    EXPECT_EQ("u64 18446744073709551615, i32 -2147483648", lines[2]);
+    EXPECT_EQ("floats  3.14 1.000000e+10 0.5 2.5", lines[3]);
+    EXPECT_EQ("strings first|left  |tru", lines[4]);
+    EXPECT_EQ("stars   12|12  |1.000|   ab", lines[5]);
+    EXPECT_EQ("percent 100% 5%", lines[6]);
+    EXPECT_EQ("unsupported ...", lines[7]);
+}
+
+TEST_F(LogRecordTest, truncatedRecordStopsFormatting)
+{
+    std::string str(40, 'a');
+    PHOTON_DEBUG("%s %s %s %s %d", str.c_str(), str.c_str(), str.c_str(), str.c_str(), 1);
+
+    auto records = readRecords();
+    ASSERT_EQ(1u, records.size());
+    std::string line = formatLogRecord(records[0], "%s %s %s %s %d");
+    EXPECT_EQ(onboardLines()[0], line);
+    EXPECT_EQ("...", line.substr(line.size() - 3));
+}
+
+TEST_F(LogRecordTest, malformedRecordsAreRejected)
+{
+    PHOTON_DEBUG("malformed %d", 1);
+    readRecords();
+    ASSERT_LT(23u, _data.size());
+
+    std::vector<LogRecord> records;
+    EXPECT_FALSE(decodeLogRecords(bmcl::Bytes(_data.data(), _data.size() - 1), &records));
+    _data[23] = 0xff;
+    EXPECT_FALSE(decodeLogRecords(bmcl::Bytes(_data.data(), _data.size()), &records));
+}
+
+TEST_F(LogRecordTest, stringsAreExtractedFromSource)
+{
+    std::string source =
+        "#define _PHOTON_FNAME \"mod/File.c\"\n"
+        "// PHOTON_DEBUG(\"commented out\");\n"
+        "#define WRAP(fmt, ...) PHOTON_WARNING(\"wrapped: \" fmt, __VA_ARGS__)\n"
+        "void f() {\n"
+        "    char c = '\"';\n"
+        "    PHOTON_DEBUG(\"joined \" /* comment */ \"literal\\t%d\\n\", 1);\n"
+        "    WRAP(\"value %\" PRIu64 \" of %\" PRIu8, a, b);\n"
+        "}\n";
+    std::vector<std::string> strings = extractLogStrings(source);
+    auto contains = [&strings](const std::string& str) {
+        return std::find(strings.begin(), strings.end(), str) != strings.end();
+    };
+    EXPECT_TRUE(contains("mod/File.c"));
+    EXPECT_TRUE(contains("wrapped: "));
+    EXPECT_TRUE(contains("joined literal\t%d\n"));
+    EXPECT_TRUE(contains("value %llu of %hhu"));
+    EXPECT_TRUE(contains("value %lu of %u"));
+    // macros are expanded consistently for each target
+    EXPECT_FALSE(contains("value %I64u of %hhu"));
+    EXPECT_FALSE(contains("commented out"));
+    EXPECT_FALSE(contains(";\n    PHOTON_DEBUG("));
+}
+
+TEST_F(LogRecordTest, tableEscapesStrings)
+{
+    std::string str = "a\nb\\c\x01\td%%";
+    EXPECT_EQ(std::string::npos, escapeLogString(str).find('\n'));
+    EXPECT_EQ(str, unescapeLogString(escapeLogString(str)));
+}
+
+// same as table generated at build time, but from this file only
+TEST_F(LogRecordTest, recordsAreFormattedWithTableFromSource)
+{
+    PHOTON_INFO("from table %s %" PRIu64, "ok", uint64_t(5));
+    PHOTON_INFO("joined %d" " literal", 1);
+
+    std::ifstream file(__FILE__);
+    ASSERT_TRUE(file.is_open());
+    std::stringstream source;
+    source << file.rdbuf();
+    LogStringTable table;
+    for (const std::string& str : extractLogStrings(source.str())) {
+        table.add(str);
+    }
+
+    auto records = readRecords();
+    ASSERT_EQ(2u, records.size());
+    const std::string* fname = table.find(records[0].fnameId);
+    ASSERT_NE(nullptr, fname);
+    EXPECT_EQ("LogRecordTest.cpp", *fname);
+    const std::string* fmt = table.find(records[0].fmtId);
+    ASSERT_NE(nullptr, fmt);
+    EXPECT_EQ("from table ok 5", formatLogRecord(records[0], *fmt));
+    fmt = table.find(records[1].fmtId);
+    ASSERT_NE(nullptr, fmt);
+    EXPECT_EQ("joined 1 literal", formatLogRecord(records[1], *fmt));
+}
@@ -0,0 +1,122 @@
+#include "photon/core/Logging.h"
+
+#include <gtest/gtest.h>
+
+#include <cinttypes>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define _PHOTON_FNAME "LoggingTest.cpp"
+
+class LoggingTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        // drop records left by previous tests
+        Photon_FlushLog(SIZE_MAX);
+    }
+
+    std::vector<std::string> readAll()
+    {
+        std::vector<uint8_t> data(8192);
+        std::size_t size = Photon_ReadLogRecords(data.data(), data.size());
+        std::vector<std::string> lines;
+        std::size_t offset = 0;
+        while (offset < size) {
+            uint16_t recordSize;
+            std::memcpy(&recordSize, &data[offset], 2);
+            char line[256];
+            Photon_FormatLogRecord(&data[offset], recordSize, line, sizeof(line));
+            lines.emplace_back(line);
+            offset += recordSize;
+        }
+        return lines;
+    }
+};
+
+TEST_F(LoggingTest, integersAndFloats)
+{
+    uint64_t big = UINT64_MAX;
+    PHOTON_DEBUG("ints %d %u %x %zu", -7, 42u, 0xbeef, std::size_t(1000));
+    PHOTON_WARNING("u64 %" PRIu64 ", double %.2f, percent 100%%", big, 1.5);
+    PHOTON_INFO("no args");
+
+    auto lines = readAll();
+    ASSERT_EQ(3u, lines.size());
+    EXPECT_EQ("ints -7 42 beef 1000", lines[0]);
+    EXPECT_EQ("u64 18446744073709551615, double 1.50, percent 100%", lines[1]);
+    EXPECT_EQ("no args", lines[2]);
+}
+
+TEST_F(LoggingTest, stringsAreCopied)
+{
+    char buf[16];
+    std::strcpy(buf, "first");
+    PHOTON_DEBUG("name: %s, width: %*d", buf, 4, 12);
+    std::strcpy(buf, "second");
+
+    auto lines = readAll();
+    ASSERT_EQ(1u, lines.size());
+    EXPECT_EQ("name: first, width:   12", lines[0]);
+}
+
+TEST_F(LoggingTest, longStringsTruncated)
+{
+    std::string str(100, 'a');
+    PHOTON_DEBUG("%s!", str.c_str());
+
+    auto lines = readAll();
+    ASSERT_EQ(1u, lines.size());
+    EXPECT_GT(str.size(), lines[0].size());
+    EXPECT_EQ('!', lines[0].back());
+}
+
+TEST_F(LoggingTest, overflowIsCounted)
+{
+    std::size_t dropped = Photon_LogDroppedCount();
+    for (int i = 0; i < 10000; i++) {
+        PHOTON_DEBUG("filling buffer %d", i);
+    }
+    EXPECT_LT(dropped, Photon_LogDroppedCount());
+
+    auto lines = readAll();
+    ASSERT_FALSE(lines.empty());
+    EXPECT_EQ("filling buffer 0", lines[0]);
+}
+
+TEST_F(LoggingTest, flushPrintsRecords)
+{
+    PHOTON_CRITICAL("flushed %d", 1);
+    PHOTON_CRITICAL("flushed %d", 2);
+    EXPECT_EQ(1u, Photon_FlushLog(1));
+    EXPECT_EQ(1u, Photon_FlushLog(10));
+    EXPECT_EQ(0u, Photon_FlushLog(10));
+}
+
+TEST_F(LoggingTest, precisionBoundsStrings)
+{
+    // not null terminated
+    char buf[4] = {'a', 'b', 'c', 'd'};
+    PHOTON_DEBUG("%.3s|%.*s", buf, 2, buf);
+
+    auto lines = readAll();
+    ASSERT_EQ(1u, lines.size());
+    EXPECT_EQ("abc|ab", lines[0]);
+}
+
+TEST_F(LoggingTest, recordsHaveStringIds)
+{
+    const char* fmt = "id test %d";
+    PHOTON_DEBUG(fmt, 1);
+
+    std::vector<uint8_t> data(256);
+    std::size_t size = Photon_ReadLogRecords(data.data(), data.size());
+    ASSERT_LE(23u, size);
+    uint32_t fnameId;
+    uint32_t fmtId;
+    std::memcpy(&fnameId, &data[15], 4);
+    std::memcpy(&fmtId, &data[19], 4);
+    EXPECT_EQ(Photon_LogStringId(_PHOTON_FNAME), fnameId);
+    EXPECT_EQ(Photon_LogStringId(fmt), fmtId);
+}
@@ -0,0 +1,86 @@
+#include "photon/blog/Lz4.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+class Lz4Test : public ::testing::Test {
+protected:
+    // returns compressed size
+    std::size_t roundTrip(const std::vector<uint8_t>& data)
+    {
+        std::vector<uint8_t> compressed(data.size() + data.size() / 255 + 16);
+        std::size_t size = PhotonLz4_Compress(data.data(), data.size(), compressed.data(), compressed.size(), _table);
+        EXPECT_NE(0u, size);
+
+        std::vector<uint8_t> decompressed(data.size());
+        std::size_t decompressedSize = PhotonLz4_Decompress(compressed.data(), size, decompressed.data(), decompressed.size());
+        EXPECT_EQ(data.size(), decompressedSize);
+        EXPECT_EQ(data, decompressed);
+        return size;
+    }
+
+    uint16_t _table[PHOTON_LZ4_HASH_TABLE_SIZE];
+};
+
+TEST_F(Lz4Test, smallInputs)
+{
+    for (std::size_t size = 1; size < 40; size++) {
+        std::vector<uint8_t> data(size, 'a');
+        roundTrip(data);
+    }
+}
+
+TEST_F(Lz4Test, repetitiveDataCompresses)
+{
+    // telemetry-like records with slowly changing fields
+    std::vector<uint8_t> data;
+    for (uint32_t i = 0; data.size() < 4096; i++) {
+        const uint8_t record[] = {0x63, 0xc1, 1, uint8_t(i), 12, 0, 0, 0, 0, 0x10, 0x20, 0x30};
+        data.insert(data.end(), record, record + sizeof(record));
+    }
+    std::size_t size = roundTrip(data);
+    EXPECT_LT(size, data.size() / 3);
+}
+
+TEST_F(Lz4Test, longRunsAndLiterals)
+{
+    std::vector<uint8_t> data(20000, 0);
+    std::mt19937 gen(1);
+    for (std::size_t i = 5000; i < 6000; i++) {
+        data[i] = uint8_t(gen());
+    }
+    roundTrip(data);
+}
+
+TEST_F(Lz4Test, randomDataDoesNotFit)
+{
+    std::vector<uint8_t> data(2048);
+    std::mt19937 gen(2);
+    for (uint8_t& b : data) {
+        b = uint8_t(gen());
+    }
+    roundTrip(data);
+
+    std::vector<uint8_t> dest(data.size());
+    EXPECT_EQ(0u, PhotonLz4_Compress(data.data(), data.size(), dest.data(), dest.size() - 1, _table));
+}
+
+TEST_F(Lz4Test, malformedInputRejected)
+{
+    std::vector<uint8_t> data(1000, 'x');
+    std::vector<uint8_t> compressed(1100);
+    std::size_t size = PhotonLz4_Compress(data.data(), data.size(), compressed.data(), compressed.size(), _table);
+    ASSERT_NE(0u, size);
+
+    std::vector<uint8_t> dest(data.size());
+    // output too small
+    EXPECT_EQ(0u, PhotonLz4_Decompress(compressed.data(), size, dest.data(), dest.size() - 1));
+    // truncated input
+    EXPECT_EQ(0u, PhotonLz4_Decompress(compressed.data(), 3, dest.data(), dest.size()));
+    // offset pointing before output start
+    const uint8_t bad[] = {0x10, 'a', 0x05, 0x00};
+    EXPECT_EQ(0u, PhotonLz4_Decompress(bad, sizeof(bad), dest.data(), dest.size()));
+}
@@ -1,4 +1,4 @@
-#include "photon/gc/MemIntervalSet.h"
+#include "photon/groundcontrol/MemIntervalSet.h"
 
 #include <gtest/gtest.h>
 
@@ -148,7 +148,7 @@ protected:
 
     void init(const std::vector<MemInterval>& lst)
     {
-        _vec = MemIntervalSet(lst);
+        _vec = MemIntervalSet(std::vector<MemInterval>(lst));
     }
 
     void expect(std::initializer_list<MemInterval> lst)
@@ -236,3 +236,33 @@ TEST_F(MemIntervalSetTest, intersectSeveralBig)
     add({25, 975});
     expect({{0, 10}, {20, 975}, {980, 990}});
 }
+
+TEST_F(MemIntervalSetTest, dataSizeTracked)
+{
+    init({{10, 20}, {30, 40}});
+    add({15, 35});
+    add({50, 55});
+    EXPECT_EQ(35u, _vec.dataSize());
+    _vec.clear();
+    EXPECT_EQ(0u, _vec.dataSize());
+}
+
+TEST_F(MemIntervalSetTest, missing)
+{
+    init({{10, 20}, {30, 40}, {50, 60}});
+    std::vector<MemInterval> gaps;
+    _vec.missing({0, 100}, 10, &gaps);
+    EXPECT_EQ(std::vector<MemInterval>({{0, 10}, {20, 30}, {40, 50}, {60, 100}}), gaps);
+
+    gaps.clear();
+    _vec.missing({15, 55}, 10, &gaps);
+    EXPECT_EQ(std::vector<MemInterval>({{20, 30}, {40, 50}}), gaps);
+
+    gaps.clear();
+    _vec.missing({0, 100}, 2, &gaps);
+    EXPECT_EQ(std::vector<MemInterval>({{0, 10}, {20, 30}}), gaps);
+
+    gaps.clear();
+    _vec.missing({30, 40}, 10, &gaps);
+    EXPECT_TRUE(gaps.empty());
+}
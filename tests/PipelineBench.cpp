@@ -0,0 +1,336 @@
+#include <decode/core/Rc.h>
+#include <photon/groundcontrol/GroundControl.h>
+#include <photon/groundcontrol/Exchange.h>
+#include <photon/groundcontrol/Atoms.h>
+#include <photon/groundcontrol/AllowUnsafeMessageType.h>
+#include <photon/groundcontrol/ProjectUpdate.h>
+#include <photon/groundcontrol/Packet.h>
+#include <photon/model/NodeViewUpdater.h>
+
+#include "Photon.h"
+
+#include <bmcl/Assert.h>
+#include <bmcl/Logging.h>
+#include <bmcl/MemReader.h>
+#include <bmcl/Result.h>
+#include <bmcl/SharedBytes.h>
+
+#include <tclap/CmdLine.h>
+
+#include <caf/send.hpp>
+#include <caf/actor_system.hpp>
+#include <caf/actor_system_config.hpp>
+#include <caf/event_based_actor.hpp>
+#include <caf/scoped_actor.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace photon;
+
+DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(bmcl::SharedBytes);
+DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(photon::ProjectUpdate::ConstPointer);
+DECODE_ALLOW_UNSAFE_MESSAGE_TYPE(photon::NodeViewUpdater::Pointer);
+
+using BenchProjectAtom = caf::atom_constant<caf::atom("bnchproj")>;
+using BenchExpectAtom  = caf::atom_constant<caf::atom("bnchexpt")>;
+using BenchDoneAtom    = caf::atom_constant<caf::atom("bnchdone")>;
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint64_t mccId = 1;
+constexpr uint64_t uavId = 2;
+
+class OnboardStream : public caf::event_based_actor {
+public:
+    OnboardStream(caf::actor_config& cfg, PhotonExcDevice* dev)
+        : caf::event_based_actor(cfg)
+        , _dev(dev)
+    {
+    }
+
+    caf::behavior make_behavior() override
+    {
+        return caf::behavior{
+            [this](RecvDataAtom, const bmcl::SharedBytes& data) {
+                PhotonExcDevice_AcceptInput(_dev, data.data(), data.size());
+                Photon_Tick();
+            },
+            [this](SetStreamDestAtom, const caf::actor& actor) {
+                _dest = actor;
+            },
+            [this](StartAtom) {
+                send(this, RepeatStreamAtom::value);
+            },
+            [this](RepeatStreamAtom) {
+                Photon_Tick();
+                uint8_t temp[1024];
+                PhotonWriter writer;
+                PhotonWriter_Init(&writer, temp, sizeof(temp));
+                PhotonExcDevice_GenNextPacket(_dev, &writer);
+                if (writer.current != writer.start) {
+                    send(_dest, RecvDataAtom::value, bmcl::SharedBytes::create(writer.start, writer.current - writer.start));
+                }
+                delayed_send(this, std::chrono::milliseconds(1), RepeatStreamAtom::value);
+            },
+        };
+    }
+
+    void on_exit() override
+    {
+        destroy(_dest);
+    }
+
+private:
+    PhotonExcDevice* _dev;
+    caf::actor _dest;
+};
+
+class NullSink : public caf::event_based_actor {
+public:
+    explicit NullSink(caf::actor_config& cfg)
+        : caf::event_based_actor(cfg)
+    {
+        set_default_handler(caf::drop);
+    }
+
+    caf::behavior make_behavior() override
+    {
+        return caf::behavior{
+            [this](RecvDataAtom, const bmcl::SharedBytes&) {
+                (void)this;
+            },
+        };
+    }
+};
+
+class BenchHandler : public caf::event_based_actor {
+public:
+    BenchHandler(caf::actor_config& cfg, const caf::actor& waiter)
+        : caf::event_based_actor(cfg)
+        , _waiter(waiter)
+        , _expected(0)
+        , _count(0)
+    {
+        set_default_handler(caf::drop);
+    }
+
+    caf::behavior make_behavior() override
+    {
+        return caf::behavior{
+            [this](SetProjectAtom, const ProjectUpdate::ConstPointer& update) {
+                send(_waiter, BenchProjectAtom::value, update);
+            },
+            [this](BenchExpectAtom, uint64_t count) {
+                _expected = count;
+                _count = 0;
+            },
+            [this](UpdateTmViewAtom, const NodeViewUpdater::Pointer&, const NodeViewUpdater::Pointer&, const NodeViewUpdater::Pointer&) {
+                _count++;
+                if (_count == _expected) {
+                    send(_waiter, BenchDoneAtom::value);
+                }
+            },
+        };
+    }
+
+    void on_exit() override
+    {
+        destroy(_waiter);
+    }
+
+private:
+    caf::actor _waiter;
+    uint64_t _expected;
+    uint64_t _count;
+};
+
+static ProjectUpdate::ConstPointer downloadProject(caf::actor_system& system, PhotonExcDevice* dev)
+{
+    caf::scoped_actor self(system);
+    caf::actor stream = system.spawn<OnboardStream>(dev);
+    caf::actor handler = system.spawn<BenchHandler>(caf::actor_cast<caf::actor>(self));
+    caf::actor gc = system.spawn<GroundControl>(mccId, uavId, stream, handler);
+
+    caf::anon_send(stream, SetStreamDestAtom::value, gc);
+    caf::anon_send(gc, StartAtom::value);
+    caf::anon_send(stream, StartAtom::value);
+
+    ProjectUpdate::ConstPointer project;
+    self->receive(
+        [&](BenchProjectAtom, const ProjectUpdate::ConstPointer& update) {
+            project = update;
+        },
+        caf::after(std::chrono::seconds(60)) >> [&]() {
+            BMCL_CRITICAL() << "project download timed out";
+        }
+    );
+
+    caf::anon_send_exit(stream, caf::exit_reason::user_shutdown);
+    caf::anon_send_exit(gc, caf::exit_reason::user_shutdown);
+    caf::anon_send_exit(handler, caf::exit_reason::user_shutdown);
+    return project;
+}
+
+static std::vector<bmcl::SharedBytes> generateTmFrames(PhotonExcDevice* dev, std::size_t count)
+{
+    std::vector<bmcl::SharedBytes> frames;
+    frames.reserve(count);
+    std::size_t attempts = count * 16;
+    while (frames.size() < count && attempts != 0) {
+        attempts--;
+        Photon_Tick();
+        uint8_t temp[1024];
+        PhotonWriter writer;
+        PhotonWriter_Init(&writer, temp, sizeof(temp));
+        PhotonExcDevice_GenNextPacket(dev, &writer);
+        std::size_t size = writer.current - writer.start;
+        if (size < 6) {
+            continue;
+        }
+        bmcl::MemReader reader(writer.start + 4, size - 6);
+        auto header = Exchange::decodeHeader(&reader);
+        if (header.isErr() || header.unwrap().streamType != StreamType::Telem) {
+            continue;
+        }
+        frames.push_back(bmcl::SharedBytes::create(writer.start, size));
+    }
+    return frames;
+}
+
+struct BenchResult {
+    double framesPerSecond;
+    double megabytesPerSecond;
+    double meanLatency;
+    double medianLatency;
+    double p99Latency;
+};
+
+static bool waitDone(caf::scoped_actor& self)
+{
+    bool isOk = false;
+    self->receive(
+        [&](BenchDoneAtom) {
+            isOk = true;
+        },
+        caf::after(std::chrono::seconds(30)) >> [&]() {
+            BMCL_CRITICAL() << "benchmark timed out";
+        }
+    );
+    return isOk;
+}
+
+static bmcl::Option<BenchResult> runBench(caf::actor_system& system, PipelineMode mode, const ProjectUpdate::ConstPointer& project,
+                                          const std::vector<bmcl::SharedBytes>& frames, std::size_t latencySamples)
+{
+    caf::scoped_actor self(system);
+    caf::actor sink = system.spawn<NullSink>();
+    caf::actor handler = system.spawn<BenchHandler>(caf::actor_cast<caf::actor>(self));
+    caf::actor gc = system.spawn<GroundControl>(mccId, uavId, sink, handler, mode);
+
+    self->send(gc, SetProjectAtom::value, project);
+    self->send(gc, StartAtom::value);
+
+    BenchResult result;
+    std::size_t totalSize = 0;
+    for (const bmcl::SharedBytes& frame : frames) {
+        totalSize += frame.size();
+    }
+
+    self->send(handler, BenchExpectAtom::value, uint64_t(frames.size()));
+    auto start = Clock::now();
+    for (const bmcl::SharedBytes& frame : frames) {
+        self->send(gc, RecvDataAtom::value, frame);
+    }
+    bool isOk = waitDone(self);
+    auto end = Clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    result.framesPerSecond = frames.size() / seconds;
+    result.megabytesPerSecond = totalSize / seconds / (1024 * 1024);
+
+    std::vector<double> latencies;
+    latencies.reserve(latencySamples);
+    for (std::size_t i = 0; i < latencySamples && isOk; i++) {
+        self->send(handler, BenchExpectAtom::value, uint64_t(1));
+        auto sendTime = Clock::now();
+        self->send(gc, RecvDataAtom::value, frames[i % frames.size()]);
+        isOk = waitDone(self);
+        latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sendTime).count());
+    }
+
+    self->send_exit(gc, caf::exit_reason::user_shutdown);
+    self->send_exit(handler, caf::exit_reason::user_shutdown);
+    self->send_exit(sink, caf::exit_reason::user_shutdown);
+
+    if (!isOk || latencies.empty()) {
+        return bmcl::None;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for (double l : latencies) {
+        sum += l;
+    }
+    result.meanLatency = sum / latencies.size();
+    result.medianLatency = latencies[latencies.size() / 2];
+    result.p99Latency = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+    return result;
+}
+
+static void printResult(const char* name, const BenchResult& result)
+{
+    std::printf("%-8s %14.0f %10.2f %12.2f %12.2f %12.2f\n", name,
+                result.framesPerSecond, result.megabytesPerSecond,
+                result.meanLatency, result.medianLatency, result.p99Latency);
+}
+
+int main(int argc, char** argv)
+{
+    TCLAP::CmdLine cmdLine("PipelineBench");
+    TCLAP::ValueArg<std::size_t> framesArg("n", "frames", "Number of telemetry frames for throughput test", false, 100000, "number");
+    TCLAP::ValueArg<std::size_t> samplesArg("s", "samples", "Number of latency samples", false, 10000, "number");
+    TCLAP::ValueArg<unsigned> logArg("l", "log-level", "Log level", false, 3, "level");
+
+    cmdLine.add(&framesArg);
+    cmdLine.add(&samplesArg);
+    cmdLine.add(&logArg);
+    cmdLine.parse(argc, argv);
+
+    bmcl::setLogLevel(bmcl::LogLevel(logArg.getValue()));
+
+    Photon_Init();
+    PhotonExc_SetAddress(uavId);
+    PhotonExcDevice* dev;
+    auto err = PhotonExc_RegisterGroundControl(mccId, &dev);
+    BMCL_ASSERT(err == PhotonExcClientError_Ok);
+
+    caf::actor_system_config cfg;
+    caf::actor_system system(cfg);
+
+    ProjectUpdate::ConstPointer project = downloadProject(system, dev);
+    if (project.isNull()) {
+        return -1;
+    }
+    system.await_all_actors_done();
+
+    std::vector<bmcl::SharedBytes> frames = generateTmFrames(dev, framesArg.getValue());
+    if (frames.empty()) {
+        BMCL_CRITICAL() << "onboard side generated no telemetry";
+        return -1;
+    }
+
+    std::printf("%-8s %14s %10s %12s %12s %12s\n", "mode", "frames/s", "MB/s", "mean(us)", "median(us)", "p99(us)");
+    auto actors = runBench(system, PipelineMode::Actors, project, frames, samplesArg.getValue());
+    auto fused = runBench(system, PipelineMode::Fused, project, frames, samplesArg.getValue());
+    if (actors.isNone() || fused.isNone()) {
+        return -1;
+    }
+    printResult("actors", actors.unwrap());
+    printResult("fused", fused.unwrap());
+
+    system.await_all_actors_done();
+    return 0;
+}
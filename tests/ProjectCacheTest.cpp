@@ -0,0 +1,98 @@
+#include "photon/groundcontrol/ProjectCache.h"
+#include "photon/groundcontrol/ProjectUpdate.h"
+
+#include <bmcl/Bytes.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace photon;
+
+class ProjectCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        const ::testing::TestInfo* info = ::testing::UnitTest::GetInstance()->current_test_info();
+        _cache.setDir(::testing::TempDir() + "photon-project-cache-" + info->name());
+        _data = {'p', 'r', 'o', 'j', 'e', 'c', 't'};
+        _hash = ProjectUpdate::calculateHash(data());
+    }
+
+    void TearDown() override
+    {
+        std::remove(path().c_str());
+        std::remove(_cache.dir().c_str());
+    }
+
+    bmcl::Bytes data() const
+    {
+        return bmcl::Bytes(_data.data(), _data.size());
+    }
+
+    bmcl::Bytes hash() const
+    {
+        return bmcl::Bytes(_hash.data(), _hash.size());
+    }
+
+    std::string path() const
+    {
+        static const char* digits = "0123456789abcdef";
+        std::string path = _cache.dir() + "/";
+        for (uint8_t b : _hash) {
+            path.push_back(digits[b >> 4]);
+            path.push_back(digits[b & 0xf]);
+        }
+        return path + ".pdesc";
+    }
+
+    ProjectCache _cache;
+    std::vector<uint8_t> _data;
+    ProjectHash _hash;
+};
+
+TEST_F(ProjectCacheTest, storedProjectIsLoaded)
+{
+    ASSERT_TRUE(_cache.store(hash(), data()));
+    bmcl::Option<bmcl::Buffer> loaded = _cache.load(hash());
+    ASSERT_TRUE(loaded.isSome());
+    EXPECT_EQ(_data, std::vector<uint8_t>(loaded->data(), loaded->data() + loaded->size()));
+
+    // stored again over existing file
+    ASSERT_TRUE(_cache.store(hash(), data()));
+    EXPECT_TRUE(_cache.load(hash()).isSome());
+}
+
+TEST_F(ProjectCacheTest, missingProjectIsNotLoaded)
+{
+    EXPECT_TRUE(_cache.load(hash()).isNone());
+}
+
+TEST_F(ProjectCacheTest, corruptedProjectIsRemoved)
+{
+    ASSERT_TRUE(_cache.store(hash(), data()));
+    {
+        std::ofstream file(path(), std::ios::binary | std::ios::trunc);
+        file << "corrupted";
+    }
+    EXPECT_TRUE(_cache.load(hash()).isNone());
+    EXPECT_FALSE(std::ifstream(path()).good());
+}
+
+TEST_F(ProjectCacheTest, hashMismatch)
+{
+    EXPECT_TRUE(ProjectCache::hashMatches(hash(), data()));
+    _data.push_back(0);
+    EXPECT_FALSE(ProjectCache::hashMatches(hash(), data()));
+    EXPECT_FALSE(ProjectCache::hashMatches(bmcl::Bytes(_hash.data(), 8), bmcl::Bytes(_data.data(), _data.size() - 1)));
+}
+
+TEST_F(ProjectCacheTest, emptyDirDisablesCache)
+{
+    ProjectCache cache(std::string(""));
+    EXPECT_FALSE(cache.store(hash(), data()));
+    EXPECT_TRUE(cache.load(hash()).isNone());
+}
@@ -0,0 +1,138 @@
+#include <decode/core/Rc.h>
+#include <decode/core/Diagnostics.h>
+#include <decode/parser/Project.h>
+#include <photon/groundcontrol/CompressedPackage.h>
+#include <photon/groundcontrol/ProjectUpdate.h>
+#include <photon/model/TmModel.h>
+
+#include "Photon.h"
+
+#include <bmcl/Buffer.h>
+#include <bmcl/Bytes.h>
+#include <bmcl/FileUtils.h>
+#include <bmcl/Logging.h>
+#include <bmcl/Result.h>
+
+#include <tclap/CmdLine.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Compares project loading done by FwtState on connect. Previously downloaded bytes were hashed, decoded and then
+// the project was encoded and hashed again in FwtState::setProject and again on every hash response. Now the hash
+// is verified on received bytes only and carried by ProjectUpdate.
+// Also measures startup stages done on every connect before ui gets tm views.
+
+using namespace photon;
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static ProjectUpdate::ConstPointer load(bmcl::Bytes data, const std::string& deviceName, bool isOld)
+{
+    ProjectHash hash = ProjectUpdate::calculateHash(data);
+    Rc<decode::Diagnostics> diag = new decode::Diagnostics;
+    auto project = decode::Project::decodeFromMemory(diag.get(), data.data(), data.size());
+    BMCL_ASSERT(project.isOk());
+    if (isOld) {
+        auto update = ProjectUpdate::fromProjectAndName(project.unwrap().get(), deviceName);
+        BMCL_ASSERT(update.isOk());
+        // setProject and next hash response
+        for (int i = 0; i < 2; i++) {
+            BMCL_ASSERT(ProjectUpdate::calculateHash(project.unwrap()->encode()) == hash);
+        }
+        return update.take();
+    }
+    auto update = ProjectUpdate::fromProjectAndName(project.unwrap().get(), deviceName, hash);
+    BMCL_ASSERT(update.isOk());
+    return update.take();
+}
+
+int main(int argc, char** argv)
+{
+    TCLAP::CmdLine cmdLine("ProjectLoadBench");
+    TCLAP::ValueArg<std::string> pathArg("f", "file", "Serialized project, package of this device by default", false, "", "path");
+    TCLAP::ValueArg<std::string> deviceArg("d", "device", "Device name, master device by default", false, "", "name");
+    TCLAP::ValueArg<std::size_t> iterArg("n", "iterations", "Number of loads", false, 10, "number");
+
+    cmdLine.add(&pathArg);
+    cmdLine.add(&deviceArg);
+    cmdLine.add(&iterArg);
+    cmdLine.parse(argc, argv);
+
+    std::vector<uint8_t> data;
+    if (pathArg.getValue().empty()) {
+        data.assign(PhotonFwt_GetFirmwareData(), PhotonFwt_GetFirmwareData() + PhotonFwt_GetFirmwareSize());
+    } else {
+        auto file = bmcl::readFileIntoBuffer(pathArg.getValue().c_str());
+        if (file.isErr()) {
+            BMCL_CRITICAL() << "failed to read " << pathArg.getValue();
+            return -1;
+        }
+        data.assign(file.unwrap().data(), file.unwrap().data() + file.unwrap().size());
+    }
+    if (isCompressedPackage(bmcl::Bytes(data.data(), data.size()))) {
+        std::vector<uint8_t> raw;
+        if (!decompressPackage(bmcl::Bytes(data.data(), data.size()), &raw)) {
+            BMCL_CRITICAL() << "invalid compressed package";
+            return -1;
+        }
+        data.swap(raw);
+    }
+    bmcl::Bytes bytes(data.data(), data.size());
+
+    std::string deviceName = deviceArg.getValue();
+    if (deviceName.empty()) {
+        Rc<decode::Diagnostics> diag = new decode::Diagnostics;
+        auto project = decode::Project::decodeFromMemory(diag.get(), data.data(), data.size());
+        if (project.isErr()) {
+            BMCL_CRITICAL() << "failed to decode project";
+            return -1;
+        }
+        deviceName = project.unwrap()->master()->name().toStdString();
+    }
+
+    std::size_t iterations = std::max<std::size_t>(1, iterArg.getValue());
+    std::printf("project size: %zu bytes, %zu iterations\n", data.size(), iterations);
+    std::printf("%-12s %12s\n", "mode", "mean(ms)");
+    const char* names[2] = {"reencode", "bytes-hash"};
+    for (int mode = 0; mode < 2; mode++) {
+        auto start = Clock::now();
+        for (std::size_t i = 0; i < iterations; i++) {
+            load(bytes, deviceName, mode == 0);
+        }
+        std::printf("%-12s %12.2f\n", names[mode], msSince(start) / iterations);
+    }
+
+    double decodeTime = 0;
+    double updateTime = 0;
+    double modelTime = 0;
+    for (std::size_t i = 0; i < iterations; i++) {
+        auto start = Clock::now();
+        Rc<decode::Diagnostics> diag = new decode::Diagnostics;
+        auto project = decode::Project::decodeFromMemory(diag.get(), data.data(), data.size());
+        BMCL_ASSERT(project.isOk());
+        decodeTime += msSince(start);
+
+        start = Clock::now();
+        auto update = ProjectUpdate::fromProjectAndName(project.unwrap().get(), deviceName);
+        BMCL_ASSERT(update.isOk());
+        updateTime += msSince(start);
+
+        start = Clock::now();
+        Rc<TmModel> model = new TmModel(update.unwrap()->device(), update.unwrap()->cache());
+        modelTime += msSince(start);
+    }
+    std::printf("\n%-12s %12s\n", "stage", "mean(ms)");
+    std::printf("%-12s %12.2f\n", "decode", decodeTime / iterations);
+    std::printf("%-12s %12.2f\n", "update", updateTime / iterations);
+    std::printf("%-12s %12.2f\n", "tm-model", modelTime / iterations);
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include "photongen/onboard/core/RingBuf.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+class RingBufTest : public ::testing::Test {
+protected:
+    void init(std::size_t size)
+    {
+        _data.assign(size, 0);
+        PhotonRingBuf_Init(&_buf, _data.data(), size);
+    }
+
+    void write(uint8_t first, std::size_t size)
+    {
+        std::vector<uint8_t> data(size);
+        for (std::size_t i = 0; i < size; i++) {
+            data[i] = first + i;
+        }
+        PhotonRingBuf_Write(&_buf, data.data(), size);
+    }
+
+    std::vector<uint8_t> _data;
+    PhotonRingBuf _buf;
+};
+
+TEST_F(RingBufTest, reserveCommit)
+{
+    init(16);
+    uint8_t* dest = PhotonRingBuf_Reserve(&_buf, 10);
+    ASSERT_NE(nullptr, dest);
+    dest[0] = 1;
+    dest[1] = 2;
+    dest[2] = 3;
+    PhotonRingBuf_Commit(&_buf, 3);
+
+    EXPECT_EQ(3u, PhotonRingBuf_ReadableSize(&_buf));
+    EXPECT_EQ(13u, PhotonRingBuf_WritableSize(&_buf));
+    uint8_t out[3];
+    PhotonRingBuf_Read(&_buf, out, 3);
+    EXPECT_EQ(1, out[0]);
+    EXPECT_EQ(2, out[1]);
+    EXPECT_EQ(3, out[2]);
+}
+
+TEST_F(RingBufTest, reserveRequiresContiguousSpace)
+{
+    init(16);
+    write(0, 12);
+    PhotonRingBuf_Consume(&_buf, 8);
+
+    // 12 bytes are free, but only 4 before buffer end
+    EXPECT_EQ(12u, PhotonRingBuf_WritableSize(&_buf));
+    EXPECT_EQ(nullptr, PhotonRingBuf_Reserve(&_buf, 5));
+    EXPECT_NE(nullptr, PhotonRingBuf_Reserve(&_buf, 4));
+}
+
+TEST_F(RingBufTest, reserveEmptyRewinds)
+{
+    init(16);
+    write(0, 12);
+    PhotonRingBuf_Consume(&_buf, 12);
+
+    uint8_t* dest = PhotonRingBuf_Reserve(&_buf, 16);
+    EXPECT_EQ(_data.data(), dest);
+}
+
+TEST_F(RingBufTest, peekChunksAcrossEnd)
+{
+    init(16);
+    write(0, 12);
+    PhotonRingBuf_Consume(&_buf, 10);
+    write(12, 8);
+
+    PhotonMemChunks chunks = PhotonRingBuf_PeekChunks(&_buf, 9, 1);
+    ASSERT_EQ(5u, chunks.first.size);
+    ASSERT_EQ(4u, chunks.second.size);
+    EXPECT_EQ(&_data[11], chunks.first.data);
+    EXPECT_EQ(&_data[0], chunks.second.data);
+    for (std::size_t i = 0; i < 5; i++) {
+        EXPECT_EQ(11 + i, chunks.first.data[i]);
+    }
+    for (std::size_t i = 0; i < 4; i++) {
+        EXPECT_EQ(16 + i, chunks.second.data[i]);
+    }
+
+    chunks = PhotonRingBuf_PeekChunks(&_buf, 2, 7);
+    EXPECT_EQ(2u, chunks.first.size);
+    EXPECT_EQ(0u, chunks.second.size);
+    EXPECT_EQ(&_data[1], chunks.first.data);
+}
+
+TEST_F(RingBufTest, consumeFreesSpace)
+{
+    init(16);
+    write(0, 16);
+    EXPECT_EQ(0u, PhotonRingBuf_WritableSize(&_buf));
+    PhotonRingBuf_AdvanceReadPtr(&_buf, 6);
+    EXPECT_EQ(6u, PhotonRingBuf_WritableSize(&_buf));
+    PhotonRingBuf_Consume(&_buf, 10);
+    EXPECT_EQ(0u, PhotonRingBuf_ReadableSize(&_buf));
+}
+
+TEST_F(RingBufTest, linearizeWrapped)
+{
+    init(16);
+    write(0, 12);
+    PhotonRingBuf_Consume(&_buf, 10);
+    write(12, 8);
+
+    PhotonRingBuf_Linearize(&_buf);
+    EXPECT_EQ(10u, PhotonRingBuf_ReadableSize(&_buf));
+    EXPECT_EQ(10u, PhotonRingBuf_LinearReadableSize(&_buf));
+    const uint8_t* data = PhotonRingBuf_CurrentReadPtr(&_buf);
+    EXPECT_EQ(_data.data(), data);
+    for (std::size_t i = 0; i < 10; i++) {
+        EXPECT_EQ(10 + i, data[i]);
+    }
+
+    write(20, 6);
+    EXPECT_EQ(0u, PhotonRingBuf_WritableSize(&_buf));
+    EXPECT_EQ(25, _data[15]);
+}
+
+TEST_F(RingBufTest, linearizeFull)
+{
+    init(16);
+    write(0, 16);
+    PhotonRingBuf_Consume(&_buf, 5);
+    write(16, 5);
+
+    PhotonRingBuf_Linearize(&_buf);
+    EXPECT_EQ(16u, PhotonRingBuf_LinearReadableSize(&_buf));
+    for (std::size_t i = 0; i < 16; i++) {
+        EXPECT_EQ(5 + i, _data[i]);
+    }
+}
@@ -0,0 +1,114 @@
+#include "photon/core/SpscRingBuf.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+class SpscRingBufTest : public ::testing::Test {
+protected:
+    void init(std::size_t size)
+    {
+        _data.assign(size, 0);
+        PhotonSpscRingBuf_Init(&_buf, _data.data(), size);
+    }
+
+    std::vector<uint8_t> _data;
+    PhotonSpscRingBuf _buf;
+};
+
+TEST_F(SpscRingBufTest, writeRead)
+{
+    init(8);
+    uint8_t src[6] = {1, 2, 3, 4, 5, 6};
+    EXPECT_EQ(6u, PhotonSpscRingBuf_Write(&_buf, src, 6));
+    EXPECT_EQ(6u, PhotonSpscRingBuf_ReadableSize(&_buf));
+    EXPECT_EQ(2u, PhotonSpscRingBuf_WritableSize(&_buf));
+
+    uint8_t dest[6];
+    EXPECT_EQ(4u, PhotonSpscRingBuf_Read(&_buf, dest, 4));
+    EXPECT_EQ(1, dest[0]);
+    EXPECT_EQ(4, dest[3]);
+    EXPECT_EQ(6u, PhotonSpscRingBuf_WritableSize(&_buf));
+}
+
+TEST_F(SpscRingBufTest, overflowDropsTail)
+{
+    init(4);
+    uint8_t src[6] = {1, 2, 3, 4, 5, 6};
+    EXPECT_EQ(4u, PhotonSpscRingBuf_Write(&_buf, src, 6));
+    EXPECT_EQ(0u, PhotonSpscRingBuf_Write(&_buf, src, 1));
+
+    uint8_t dest[4];
+    EXPECT_EQ(4u, PhotonSpscRingBuf_Read(&_buf, dest, 4));
+    EXPECT_EQ(4, dest[3]);
+}
+
+TEST_F(SpscRingBufTest, chunksAcrossEnd)
+{
+    init(8);
+    uint8_t src[6] = {1, 2, 3, 4, 5, 6};
+    PhotonSpscRingBuf_Write(&_buf, src, 6);
+    PhotonSpscRingBuf_Consume(&_buf, 6);
+    PhotonSpscRingBuf_Write(&_buf, src, 5);
+
+    PhotonMemChunks chunks = PhotonSpscRingBuf_ReadableChunks(&_buf);
+    ASSERT_EQ(2u, chunks.first.size);
+    ASSERT_EQ(3u, chunks.second.size);
+    EXPECT_EQ(1, chunks.first.data[0]);
+    EXPECT_EQ(2, chunks.first.data[1]);
+    EXPECT_EQ(3, chunks.second.data[0]);
+    EXPECT_EQ(5, chunks.second.data[2]);
+}
+
+TEST_F(SpscRingBufTest, concurrentStress)
+{
+    init(64);
+    const std::size_t total = 1000000;
+
+    std::thread producer([this, total]() {
+        std::size_t sent = 0;
+        uint8_t chunk[13];
+        while (sent < total) {
+            // odd chunk size to hit every wrap offset
+            std::size_t size = std::min<std::size_t>(sizeof(chunk), total - sent);
+            for (std::size_t i = 0; i < size; i++) {
+                chunk[i] = uint8_t((sent + i) * 7);
+            }
+            std::size_t written = 0;
+            while (written < size) {
+                std::size_t rv = PhotonSpscRingBuf_Write(&_buf, chunk + written, size - written);
+                if (rv == 0) {
+                    std::this_thread::yield();
+                }
+                written += rv;
+            }
+            sent += size;
+        }
+    });
+
+    std::size_t received = 0;
+    std::size_t errors = 0;
+    while (received < total) {
+        PhotonMemChunks chunks = PhotonSpscRingBuf_ReadableChunks(&_buf);
+        if (chunks.first.size == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        for (std::size_t i = 0; i < chunks.first.size; i++) {
+            errors += chunks.first.data[i] != uint8_t((received + i) * 7);
+        }
+        received += chunks.first.size;
+        for (std::size_t i = 0; i < chunks.second.size; i++) {
+            errors += chunks.second.data[i] != uint8_t((received + i) * 7);
+        }
+        received += chunks.second.size;
+        PhotonSpscRingBuf_Consume(&_buf, chunks.first.size + chunks.second.size);
+    }
+    producer.join();
+
+    EXPECT_EQ(total, received);
+    EXPECT_EQ(0u, errors);
+    EXPECT_EQ(0u, PhotonSpscRingBuf_ReadableSize(&_buf));
+}
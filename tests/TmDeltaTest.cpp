@@ -0,0 +1,191 @@
+#include "photongen/onboard/core/Writer.h"
+#include "photon/tm/Delta.h"
+#include "photon/model/TmDelta.h"
+#include "photon/model/CoderState.h"
+
+#include <bmcl/Bytes.h>
+#include <bmcl/MemReader.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace photon;
+
+class TmDeltaTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        PhotonTmDelta_Init(&_delta);
+        PhotonTmDelta_SetStorage(&_delta, _storage, sizeof(_storage));
+    }
+
+    // status msg with component number 1 and message number 2
+    static std::vector<uint8_t> makeImage(const std::vector<uint32_t>& values)
+    {
+        std::vector<uint8_t> image = {1, 2};
+        for (uint32_t value : values) {
+            for (int i = 0; i < 4; i++) {
+                image.push_back(uint8_t(value >> (i * 8)));
+            }
+        }
+        return image;
+    }
+
+    std::vector<uint8_t> send(const std::vector<uint8_t>& image)
+    {
+        uint8_t buf[256];
+        PhotonWriter dest;
+        PhotonWriter_Init(&dest, buf, sizeof(buf));
+        uint8_t* begin = PhotonWriter_CurrentPtr(&dest);
+        EXPECT_EQ(PhotonError_Ok, PhotonTmDelta_BeginMsg(&_delta, &dest));
+        uint8_t* imageBegin = PhotonWriter_CurrentPtr(&dest);
+        PhotonWriter_Write(&dest, image.data(), image.size());
+        PhotonTmDelta_EndMsg(&_delta, 1, 2, begin, imageBegin, &dest);
+        return std::vector<uint8_t>(buf, PhotonWriter_CurrentPtr(&dest));
+    }
+
+    static bool isBase(const std::vector<uint8_t>& packet)
+    {
+        bmcl::MemReader src(packet.data(), packet.size());
+        uint64_t marker = 0;
+        EXPECT_TRUE(src.readVarUint(&marker));
+        return marker == PHOTON_TM_DELTA_BASE_MARKER;
+    }
+
+    // returns false if delta was rejected
+    bool receive(const std::vector<uint8_t>& packet, std::vector<uint8_t>* image)
+    {
+        bmcl::MemReader src(packet.data(), packet.size());
+        uint64_t marker;
+        EXPECT_TRUE(src.readVarUint(&marker));
+        if (marker == PHOTON_TM_DELTA_BASE_MARKER) {
+            uint64_t seq;
+            EXPECT_TRUE(src.readVarUint(&seq));
+            bmcl::Bytes base(src.current(), src.sizeLeft());
+            _decoder.setBase(seq, base);
+            image->assign(base.begin(), base.end());
+            return true;
+        }
+        EXPECT_EQ(uint64_t(PHOTON_TM_DELTA_MARKER), marker);
+        uint64_t compNum;
+        uint64_t msgNum;
+        EXPECT_TRUE(src.readVarUint(&compNum));
+        EXPECT_TRUE(src.readVarUint(&msgNum));
+        EXPECT_EQ(1u, compNum);
+        EXPECT_EQ(2u, msgNum);
+        CoderState ctx(OnboardTime::now());
+        bool isOk = _decoder.apply(&ctx, &src);
+        EXPECT_EQ(0u, src.sizeLeft());
+        if (isOk) {
+            bmcl::Bytes decoded = _decoder.image();
+            image->assign(decoded.begin(), decoded.end());
+        }
+        return isOk;
+    }
+
+    uint8_t _storage[64];
+    PhotonTmDelta _delta;
+    TmDeltaDecoder _decoder;
+};
+
+TEST_F(TmDeltaTest, deltaIsSmaller)
+{
+    std::vector<uint8_t> packet = send(makeImage({1, 2, 3, 4, 5, 6, 7, 8}));
+    EXPECT_TRUE(isBase(packet));
+    packet = send(makeImage({1, 2, 3, 4, 9, 6, 7, 8}));
+    EXPECT_FALSE(isBase(packet));
+    EXPECT_LT(packet.size(), 12u);
+}
+
+TEST_F(TmDeltaTest, lostDelta)
+{
+    std::vector<std::vector<uint8_t>> images = {
+        makeImage({0, 0, 0, 0}),
+        makeImage({1, 5, 0, 0}),
+        makeImage({2, 5, 7, 0}),
+        // reverted to base values
+        makeImage({3, 0, 0, 0}),
+        makeImage({4, 0, 7, 9}),
+    };
+    std::size_t lost = 2;
+    for (std::size_t i = 0; i < images.size(); i++) {
+        std::vector<uint8_t> packet = send(images[i]);
+        EXPECT_EQ(i == 0, isBase(packet));
+        if (i == lost) {
+            continue;
+        }
+        std::vector<uint8_t> decoded;
+        ASSERT_TRUE(receive(packet, &decoded));
+        EXPECT_EQ(images[i], decoded);
+    }
+}
+
+TEST_F(TmDeltaTest, lostBase)
+{
+    std::size_t baseNum = 0;
+    std::size_t rejected = 0;
+    for (uint32_t i = 0; baseNum < 3; i++) {
+        std::vector<uint8_t> image = makeImage({i, i * 3, 11});
+        std::vector<uint8_t> packet = send(image);
+        if (isBase(packet)) {
+            baseNum++;
+            if (baseNum == 2) {
+                // following deltas reference base ground has not received
+                continue;
+            }
+        }
+        std::vector<uint8_t> decoded;
+        if (receive(packet, &decoded)) {
+            EXPECT_EQ(image, decoded);
+        } else {
+            EXPECT_EQ(2u, baseNum);
+            rejected++;
+        }
+    }
+    EXPECT_EQ(std::size_t(PHOTON_CFG_TM_DELTA_BASE_INTERVAL), rejected);
+}
+
+TEST_F(TmDeltaTest, resetSendsBase)
+{
+    send(makeImage({1, 2}));
+    EXPECT_FALSE(isBase(send(makeImage({1, 3}))));
+    PhotonTmDelta_Reset(&_delta);
+    EXPECT_TRUE(isBase(send(makeImage({1, 3}))));
+}
+
+TEST_F(TmDeltaTest, noStorage)
+{
+    PhotonTmDelta_Init(&_delta);
+    std::vector<uint8_t> image = makeImage({1, 2});
+    EXPECT_EQ(image, send(image));
+    EXPECT_EQ(image, send(image));
+}
+
+TEST_F(TmDeltaTest, skipConsumesRejectedDelta)
+{
+    send(makeImage({1, 2, 3}));
+    std::vector<uint8_t> packet = send(makeImage({1, 5, 3}));
+    ASSERT_FALSE(isBase(packet));
+    // following message in the same packet
+    packet.push_back(7);
+
+    bmcl::MemReader src(packet.data(), packet.size());
+    uint64_t num;
+    ASSERT_TRUE(src.readVarUint(&num));
+    ASSERT_TRUE(src.readVarUint(&num));
+    ASSERT_TRUE(src.readVarUint(&num));
+    CoderState ctx(OnboardTime::now());
+    // base was not received
+    bmcl::MemReader delta(src.current(), src.sizeLeft());
+    EXPECT_FALSE(_decoder.apply(&ctx, &delta));
+    EXPECT_TRUE(TmDeltaDecoder::skip(&ctx, &src));
+    EXPECT_EQ(1u, src.sizeLeft());
+    EXPECT_EQ(delta.current(), src.current());
+
+    bmcl::MemReader truncated(packet.data(), packet.size() - 3);
+    ASSERT_TRUE(truncated.readVarUint(&num));
+    ASSERT_TRUE(truncated.readVarUint(&num));
+    ASSERT_TRUE(truncated.readVarUint(&num));
+    EXPECT_FALSE(TmDeltaDecoder::skip(&ctx, &truncated));
+}
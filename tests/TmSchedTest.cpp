@@ -0,0 +1,126 @@
+#include "photon/tm/Sched.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+class TmSchedTest : public ::testing::Test {
+protected:
+    void init(std::size_t size)
+    {
+        _entries.resize(size);
+        _counts.assign(size, 0);
+        PhotonTmSched_Init(&_sched, _entries.data(), size);
+    }
+
+    void addMessage(std::size_t index, uint32_t period, int16_t priority)
+    {
+        _entries[index].isEnabled = true;
+        _entries[index].priority = priority;
+        PhotonTmSched_SetPeriod(&_sched, index, period, 0);
+    }
+
+    // emulates PhotonTm_CollectMessages with a packet that fits budget messages
+    void collect(uint64_t now, std::size_t budget)
+    {
+        PhotonTmSched_BeginCollect(&_sched);
+        while (true) {
+            std::size_t index = PhotonTmSched_NextDue(&_sched, now);
+            if (index >= _entries.size()) {
+                break;
+            }
+            if (budget == 0) {
+                PhotonTmSched_MarkSkipped(&_sched, index);
+                continue;
+            }
+            budget--;
+            _counts[index]++;
+            PhotonTmSched_MarkSent(&_sched, index, now);
+        }
+        while (budget != 0) {
+            std::size_t index = PhotonTmSched_NextBestEffort(&_sched);
+            if (index >= _entries.size()) {
+                break;
+            }
+            budget--;
+            _counts[index]++;
+            PhotonTmSched_MarkSent(&_sched, index, now);
+        }
+    }
+
+    void run(uint64_t duration, uint64_t step, std::size_t budget)
+    {
+        for (uint64_t now = 0; now < duration; now += step) {
+            collect(now, budget);
+        }
+    }
+
+    std::vector<PhotonTmSchedEntry> _entries;
+    std::vector<std::size_t> _counts;
+    PhotonTmSched _sched;
+};
+
+TEST_F(TmSchedTest, ratesHonored)
+{
+    init(3);
+    addMessage(0, 20, 10);     // attitude, 50Hz
+    addMessage(1, 10000, 0);   // housekeeping, 0.1Hz
+    addMessage(2, 0, 0);       // best effort
+
+    run(10000, 10, 4);
+
+    EXPECT_EQ(500u, _counts[0]);
+    EXPECT_EQ(1u, _counts[1]);
+    EXPECT_EQ(1000u, _counts[2]);
+}
+
+TEST_F(TmSchedTest, disabledNotSent)
+{
+    init(3);
+    addMessage(0, 20, 0);
+    addMessage(1, 0, 0);
+    addMessage(2, 20, 0);
+    _entries[2].isEnabled = false;
+
+    run(1000, 10, 4);
+
+    EXPECT_EQ(50u, _counts[0]);
+    EXPECT_EQ(100u, _counts[1]);
+    EXPECT_EQ(0u, _counts[2]);
+}
+
+TEST_F(TmSchedTest, highPriorityKeepsRateOnShortBudget)
+{
+    init(4);
+    addMessage(0, 20, 10);
+    addMessage(1, 20, 0);
+    addMessage(2, 20, 0);
+    addMessage(3, 20, 0);
+
+    // demand is 200 messages per second, budget is 100
+    run(10000, 10, 1);
+
+    EXPECT_EQ(500u, _counts[0]);
+    std::size_t rest = _counts[1] + _counts[2] + _counts[3];
+    EXPECT_EQ(500u, rest);
+    for (std::size_t i = 1; i < 4; i++) {
+        // low priority messages are slowed down evenly, not starved
+        EXPECT_GT(_counts[i], 100u);
+    }
+}
+
+TEST_F(TmSchedTest, bestEffortUsesLeftoverSpace)
+{
+    init(2);
+    addMessage(0, 10, 0);
+    addMessage(1, 0, 0);
+
+    run(1000, 10, 1);
+
+    EXPECT_EQ(100u, _counts[0]);
+    EXPECT_EQ(0u, _counts[1]);
+
+    run(1000, 10, 2);
+
+    EXPECT_EQ(100u, _counts[1]);
+}
@@ -0,0 +1,551 @@
+#include <photon/groundcontrol/BlogParser.h>
+#include <photon/groundcontrol/ProjectUpdate.h>
+#include <photon/model/TmModel.h>
+#include <photon/model/Node.h>
+#include <photon/model/ValueNode.h>
+#include <photon/model/Value.h>
+#include <photon/model/CoderState.h>
+#include <decode/core/Diagnostics.h>
+#include <decode/core/StringBuilder.h>
+#include <decode/parser/Project.h>
+
+#include <bmcl/Bytes.h>
+#include <bmcl/StringView.h>
+#include <bmcl/MemReader.h>
+#include <bmcl/FileUtils.h>
+#include <bmcl/Buffer.h>
+#include <bmcl/Logging.h>
+
+#include <tclap/CmdLine.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Exports every decoded telemetry message into <out>/<msg>.csv and <out>/<msg>.pcol.
+//
+// Blog is parsed serially (only record boundaries are located), records are then decoded in
+// batches by worker threads, each owning its own project and model copy, and written in order
+// by the main thread.
+//
+// .pcol layout (all varuints are LEB128):
+//   "pcol" u8(version) varuint(columnNum) {varuint(nameSize) name u8(kind)}*columnNum
+//   row groups until end of file: varuint(rowNum) {varuint(dataSize) data}*columnNum
+// column data by kind:
+//   0 - unsigned, varuint per row
+//   1 - signed, zigzag varuint per row
+//   2 - double, 8 byte little endian per row
+//   3 - string, varuint(size) bytes per row
+// first column is always "time" (unsigned, onboard ticks). Dynamic arrays and variants are
+// exported as a single string column.
+
+enum class ColumnKind : uint8_t {
+    Unsigned = 0,
+    Signed = 1,
+    Double = 2,
+    String = 3,
+};
+
+static constexpr uint8_t pcolVersion = 1;
+
+struct Column {
+    std::string name;
+    ColumnKind kind;
+};
+
+struct TmRecord {
+    TmRecord(uint64_t time, bmcl::Bytes data)
+        : time(time)
+        , data(data)
+    {
+    }
+
+    uint64_t time;
+    bmcl::Bytes data;
+};
+
+class TmCollector : public photon::BlogParser<TmCollector> {
+public:
+    bool handleDeviceName(std::size_t offset, bmcl::StringView name)
+    {
+        (void)offset;
+        deviceName = name.toStdString();
+        return true;
+    }
+
+    bool handleSerializedProject(std::size_t offset, bmcl::Bytes projectData)
+    {
+        (void)offset;
+        project = projectData;
+        return true;
+    }
+
+    bool handleTmMsg(const photon::BlogMsg& msg)
+    {
+        records.emplace_back(msg.time.rawValue(), msg.data);
+        return true;
+    }
+
+    std::string deviceName;
+    bmcl::Bytes project;
+    std::vector<TmRecord> records;
+};
+
+static void appendVarUint(std::vector<uint8_t>* dest, uint64_t value)
+{
+    while (value >= 0x80) {
+        dest->push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    dest->push_back(uint8_t(value));
+}
+
+static void appendVarInt(std::vector<uint8_t>* dest, int64_t value)
+{
+    appendVarUint(dest, (uint64_t(value) << 1) ^ uint64_t(value >> 63));
+}
+
+static void appendBytes(std::vector<uint8_t>* dest, const void* data, std::size_t size)
+{
+    const uint8_t* begin = (const uint8_t*)data;
+    dest->insert(dest->end(), begin, begin + size);
+}
+
+// byte order does not depend on host, ieee 754 doubles are assumed
+static void appendF64Le(std::vector<uint8_t>* dest, double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (std::size_t i = 0; i < sizeof(bits); i++) {
+        dest->push_back(uint8_t(bits >> (i * 8)));
+    }
+}
+
+static void appendCsvString(std::string* dest, bmcl::StringView str)
+{
+    bool needsQuotes = std::any_of(str.begin(), str.end(), [](char c) {
+        return c == ',' || c == '"' || c == '\n' || c == '\r';
+    });
+    if (!needsQuotes) {
+        dest->append(str.begin(), str.end());
+        return;
+    }
+    dest->push_back('"');
+    for (char c : str) {
+        if (c == '"') {
+            dest->push_back('"');
+        }
+        dest->push_back(c);
+    }
+    dest->push_back('"');
+}
+
+static ColumnKind columnKindFromValueKind(photon::ValueKind kind)
+{
+    switch (kind) {
+    case photon::ValueKind::Signed:
+        return ColumnKind::Signed;
+    case photon::ValueKind::Unsigned:
+        return ColumnKind::Unsigned;
+    case photon::ValueKind::Double:
+        return ColumnKind::Double;
+    default:
+        return ColumnKind::String;
+    }
+}
+
+// value node written as a single column
+struct Leaf {
+    photon::Node* node;
+    bool stringify;
+};
+
+static void collectLeaves(photon::Node* node, const std::string& prefix, std::vector<Leaf>* leaves, std::vector<Column>* columns)
+{
+    bool isVariant = dynamic_cast<photon::VariantValueNode*>(node) != nullptr;
+    if (node->canHaveChildren() && node->canBeResized().isNone() && !isVariant) {
+        for (std::size_t i = 0; i < node->numChildren(); i++) {
+            photon::Node* child = node->childAt(i).unwrap();
+            std::string name = child->fieldName().toStdString();
+            if (name.empty()) {
+                name = std::to_string(i);
+            }
+            collectLeaves(child, prefix.empty() ? name : prefix + '.' + name, leaves, columns);
+        }
+        return;
+    }
+    bool stringify = node->canHaveChildren();
+    leaves->push_back(Leaf{node, stringify});
+    if (columns) {
+        ColumnKind kind = stringify ? ColumnKind::String : columnKindFromValueKind(node->valueKind());
+        columns->push_back(Column{prefix, kind});
+    }
+}
+
+// decoded rows of one message type from one batch
+struct MsgChunk {
+    std::vector<Column> columns;
+    std::size_t rows = 0;
+    std::string csv;
+    std::vector<std::vector<uint8_t>> data;
+};
+
+struct Batch {
+    std::map<std::string, MsgChunk> chunks;
+    std::size_t errors = 0;
+};
+
+class Worker {
+public:
+    Worker(const TmCollector* blog)
+        : _blog(blog)
+    {
+    }
+
+    bool init()
+    {
+        // every worker decodes its own copy of the project so that no ref counted nodes are shared
+        decode::Rc<decode::Diagnostics> diag = new decode::Diagnostics;
+        auto project = decode::Project::decodeFromMemory(diag.get(), _blog->project.data(), _blog->project.size());
+        if (project.isErr()) {
+            return false;
+        }
+        auto update = photon::ProjectUpdate::fromProjectAndName(project.unwrap().get(), _blog->deviceName);
+        if (update.isErr()) {
+            BMCL_CRITICAL() << update.unwrapErr();
+            return false;
+        }
+        _update = update.unwrap();
+        _model = new photon::TmModel(_update->device(), _update->cache());
+        return true;
+    }
+
+    void decodeRange(std::size_t from, std::size_t to, Batch* dest)
+    {
+        for (std::size_t i = from; i < to; i++) {
+            if (!decodeRecord(_blog->records[i], dest)) {
+                dest->errors++;
+            }
+        }
+    }
+
+private:
+    bool decodeRecord(const TmRecord& record, Batch* dest)
+    {
+        bmcl::MemReader reader(record.data);
+        uint64_t compNum;
+        uint64_t msgNum;
+        if (!reader.readVarUint(&compNum) || !reader.readVarUint(&msgNum)) {
+            return false;
+        }
+        photon::CoderState state(photon::OnboardTime(record.time));
+        bmcl::StringView name;
+        if (!_model->decodeTmMsg(&state, compNum, msgNum, &reader, &name, &_decoded)) {
+            return false;
+        }
+
+        MsgChunk& chunk = dest->chunks[name.toStdString()];
+        bool isNew = chunk.columns.empty();
+        _leaves.clear();
+        if (isNew) {
+            chunk.columns.push_back(Column{"time", ColumnKind::Unsigned});
+        }
+        for (const decode::Rc<photon::Node>& node : _decoded) {
+            collectLeaves(node.get(), node->fieldName().toStdString(), &_leaves, isNew ? &chunk.columns : nullptr);
+        }
+        if (isNew) {
+            chunk.data.resize(chunk.columns.size());
+        }
+        if (_leaves.size() + 1 != chunk.columns.size()) {
+            return false;
+        }
+
+        chunk.rows++;
+        chunk.csv.append(std::to_string(record.time));
+        appendVarUint(&chunk.data[0], record.time);
+        for (std::size_t i = 0; i < _leaves.size(); i++) {
+            chunk.csv.push_back(',');
+            appendLeaf(_leaves[i], chunk.columns[i + 1].kind, &chunk.csv, &chunk.data[i + 1]);
+        }
+        chunk.csv.push_back('\n');
+        return true;
+    }
+
+    void appendLeaf(const Leaf& leaf, ColumnKind kind, std::string* csv, std::vector<uint8_t>* data)
+    {
+        if (leaf.stringify) {
+            decode::StringBuilder builder;
+            leaf.node->stringify(&builder);
+            appendString(builder.toStdString(), csv, data);
+            return;
+        }
+        photon::Value value = leaf.node->value();
+        switch (kind) {
+        case ColumnKind::Unsigned: {
+            uint64_t v = value.isA(photon::ValueKind::Unsigned) ? value.asUnsigned() : 0;
+            if (value.isA(photon::ValueKind::Unsigned)) {
+                csv->append(std::to_string(v));
+            }
+            appendVarUint(data, v);
+            return;
+        }
+        case ColumnKind::Signed: {
+            int64_t v = value.isA(photon::ValueKind::Signed) ? value.asSigned() : 0;
+            if (value.isA(photon::ValueKind::Signed)) {
+                csv->append(std::to_string(v));
+            }
+            appendVarInt(data, v);
+            return;
+        }
+        case ColumnKind::Double: {
+            double v = value.isA(photon::ValueKind::Double) ? value.asDouble() : 0;
+            if (value.isA(photon::ValueKind::Double)) {
+                char buf[32];
+                int size = std::snprintf(buf, sizeof(buf), "%.17g", v);
+                csv->append(buf, size);
+            }
+            appendF64Le(data, v);
+            return;
+        }
+        case ColumnKind::String:
+            if (value.isA(photon::ValueKind::String)) {
+                appendString(value.asString(), csv, data);
+            } else if (value.isA(photon::ValueKind::StringView)) {
+                appendString(value.asStringView(), csv, data);
+            } else {
+                appendString(bmcl::StringView::empty(), csv, data);
+            }
+            return;
+        }
+    }
+
+    static void appendString(bmcl::StringView str, std::string* csv, std::vector<uint8_t>* data)
+    {
+        appendCsvString(csv, str);
+        appendVarUint(data, str.size());
+        appendBytes(data, str.data(), str.size());
+    }
+
+    const TmCollector* _blog;
+    decode::Rc<const photon::ProjectUpdate> _update;
+    decode::Rc<photon::TmModel> _model;
+    std::vector<decode::Rc<photon::Node>> _decoded;
+    std::vector<Leaf> _leaves;
+};
+
+class MsgWriter {
+public:
+    MsgWriter(const std::string& path, const std::vector<Column>& columns)
+        : _columns(columns)
+    {
+        _csv = std::fopen((path + ".csv").c_str(), "wb");
+        _pcol = std::fopen((path + ".pcol").c_str(), "wb");
+        if (!isOpen()) {
+            return;
+        }
+
+        std::string header;
+        std::vector<uint8_t> pcolHeader = {'p', 'c', 'o', 'l', pcolVersion};
+        appendVarUint(&pcolHeader, columns.size());
+        for (const Column& col : columns) {
+            if (!header.empty()) {
+                header.push_back(',');
+            }
+            appendCsvString(&header, col.name);
+            appendVarUint(&pcolHeader, col.name.size());
+            appendBytes(&pcolHeader, col.name.data(), col.name.size());
+            pcolHeader.push_back(uint8_t(col.kind));
+        }
+        header.push_back('\n');
+        std::fwrite(header.data(), 1, header.size(), _csv);
+        std::fwrite(pcolHeader.data(), 1, pcolHeader.size(), _pcol);
+    }
+
+    ~MsgWriter()
+    {
+        if (_csv) {
+            std::fclose(_csv);
+        }
+        if (_pcol) {
+            std::fclose(_pcol);
+        }
+    }
+
+    bool isOpen() const
+    {
+        return _csv && _pcol;
+    }
+
+    bool write(const MsgChunk& chunk)
+    {
+        if (chunk.columns.size() != _columns.size()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < _columns.size(); i++) {
+            if (chunk.columns[i].name != _columns[i].name || chunk.columns[i].kind != _columns[i].kind) {
+                return false;
+            }
+        }
+        std::fwrite(chunk.csv.data(), 1, chunk.csv.size(), _csv);
+
+        std::vector<uint8_t> sizes;
+        appendVarUint(&sizes, chunk.rows);
+        std::fwrite(sizes.data(), 1, sizes.size(), _pcol);
+        for (const std::vector<uint8_t>& data : chunk.data) {
+            sizes.clear();
+            appendVarUint(&sizes, data.size());
+            std::fwrite(sizes.data(), 1, sizes.size(), _pcol);
+            std::fwrite(data.data(), 1, data.size(), _pcol);
+        }
+        rows += chunk.rows;
+        return true;
+    }
+
+    std::size_t rows = 0;
+
+private:
+    std::vector<Column> _columns;
+    std::FILE* _csv;
+    std::FILE* _pcol;
+};
+
+const char* usage = "photon-blog-export path/to/logfile.pblog";
+
+int main(int argc, char** argv)
+{
+    TCLAP::CmdLine cmdLine(usage);
+    TCLAP::UnlabeledValueArg<std::string> pathArg("path", "Path to file", true, "", "path");
+    TCLAP::ValueArg<std::string> outArg("o", "out", "Output directory", false, ".", "dir");
+    TCLAP::ValueArg<unsigned> threadsArg("j", "threads", "Number of decoder threads", false, 0, "num");
+    TCLAP::ValueArg<std::size_t> batchArg("b", "batch", "Number of records decoded by a thread at once", false, 16384, "num");
+
+    cmdLine.add(&pathArg);
+    cmdLine.add(&outArg);
+    cmdLine.add(&threadsArg);
+    cmdLine.add(&batchArg);
+    cmdLine.parse(argc, argv);
+
+    auto fileRv = bmcl::readFileIntoBuffer(pathArg.getValue().c_str());
+    if (fileRv.isErr()) {
+        BMCL_CRITICAL() << "failed to read file";
+        return 1;
+    }
+
+    const auto& file = fileRv.unwrap();
+    bmcl::Bytes data(file.data(), file.size());
+    std::vector<uint8_t> stream;
+    if (photon::isBlockFile(data)) {
+        photon::BlockStats stats;
+        stream = photon::decodeBlocks(data, &stats);
+        data = bmcl::Bytes(stream.data(), stream.size());
+        if (stats.brokenNum != 0) {
+            BMCL_WARNING() << "broken blocks: " << stats.brokenNum;
+        }
+    }
+
+    TmCollector blog;
+    if (!blog.parse(data) || blog.project.size() == 0) {
+        BMCL_CRITICAL() << "failed to parse blog";
+        return 1;
+    }
+
+    unsigned threadNum = threadsArg.getValue();
+    if (threadNum == 0) {
+        threadNum = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::size_t batchSize = std::max<std::size_t>(1, batchArg.getValue());
+    std::size_t batchNum = (blog.records.size() + batchSize - 1) / batchSize;
+    // limits memory used by decoded batches waiting to be written
+    std::size_t window = threadNum * 2;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (unsigned i = 0; i < threadNum; i++) {
+        workers.emplace_back(new Worker(&blog));
+        if (!workers.back()->init()) {
+            BMCL_CRITICAL() << "failed to load project from blog";
+            return 1;
+        }
+    }
+
+    std::vector<std::unique_ptr<Batch>> batches(batchNum);
+    std::atomic<std::size_t> nextBatch(0);
+    std::size_t written = 0;
+    std::mutex mutex;
+    std::condition_variable batchDone;
+    std::condition_variable batchWritten;
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < threadNum; i++) {
+        Worker* worker = workers[i].get();
+        threads.emplace_back([&, worker]() {
+            while (true) {
+                std::size_t index = nextBatch.fetch_add(1);
+                if (index >= batchNum) {
+                    return;
+                }
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    batchWritten.wait(lock, [&]() { return index < written + window; });
+                }
+                std::unique_ptr<Batch> batch(new Batch);
+                std::size_t from = index * batchSize;
+                worker->decodeRange(from, std::min(from + batchSize, blog.records.size()), batch.get());
+                std::lock_guard<std::mutex> lock(mutex);
+                batches[index] = std::move(batch);
+                batchDone.notify_all();
+            }
+        });
+    }
+
+    std::map<std::string, std::unique_ptr<MsgWriter>> writers;
+    std::size_t errors = 0;
+    bool isOk = true;
+    for (std::size_t i = 0; i < batchNum; i++) {
+        std::unique_ptr<Batch> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            batchDone.wait(lock, [&]() { return batches[i] != nullptr; });
+            batch = std::move(batches[i]);
+        }
+
+        errors += batch->errors;
+        for (const auto& it : batch->chunks) {
+            auto& writer = writers[it.first];
+            if (!writer) {
+                writer.reset(new MsgWriter(outArg.getValue() + '/' + it.first, it.second.columns));
+                if (!writer->isOpen()) {
+                    BMCL_CRITICAL() << "failed to open output files for " << it.first;
+                    isOk = false;
+                }
+            }
+            if (writer->isOpen() && !writer->write(it.second)) {
+                errors += it.second.rows;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        written = i + 1;
+        batchWritten.notify_all();
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (const auto& it : writers) {
+        std::cout << it.first << ": " << it.second->rows << std::endl;
+    }
+    std::cout << "Tm messages: " << blog.records.size() << std::endl;
+    std::cout << "Decode errors: " << errors << std::endl;
+
+    return isOk ? 0 : 1;
+}
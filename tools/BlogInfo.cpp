@@ -1,6 +1,6 @@
+#include <photon/groundcontrol/BlogParser.h>
+#include <photon/groundcontrol/LogRecord.h>
 #include <photon/groundcontrol/ProjectUpdate.h>
-#include <photongen/groundcontrol/blog/MsgKind.hpp>
-#include <decode/core/Utils.h>
 
 #include <bmcl/Bytes.h>
 #include <bmcl/StringView.h>
@@ -12,190 +12,14 @@
 
 #include <tclap/CmdLine.h>
 
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
 #include <cstdlib>
+#include <ctime>
+#include <vector>
 
-struct BlogMsg {
-    BlogMsg(std::size_t offset, photon::OnboardTime time, bmcl::Bytes data)
-        : offset(offset)
-        , time(time)
-        , data(data)
-    {
-    }
-
-    std::size_t offset;
-    photon::OnboardTime time;
-    bmcl::Bytes data;
-};
-
-template <typename B>
-class BlogParser {
-public:
-
-    B& base();
-
-    bool parse(bmcl::Bytes data);
-
-    bool handleDeviceName(std::size_t offset, bmcl::StringView name);
-    bool handleSerializedProject(std::size_t offset, bmcl::Bytes projectData);
-    bool handleBrokenPart(std::size_t offset, bmcl::Bytes data);
-    bool handlePvuCmd(const BlogMsg& msg);
-    bool handleTmMsg(const BlogMsg& msg);
-    bool handleFwtCmd(const BlogMsg& msg);
-};
-
-template <typename B>
-inline bool BlogParser<B>::parse(bmcl::Bytes data)
-{
-    static char magicPrefix[4] = {'b', 'l', 'o', 'g'};
-    bmcl::MemReader reader(data);
-    if (reader.sizeLeft() < sizeof(magicPrefix)) {
-        return false;
-    }
-    if (std::memcmp(magicPrefix, reader.current(), sizeof(magicPrefix)) != 0) {
-        return false;
-    }
-    reader.skip(sizeof(magicPrefix));
-
-    auto nameRv = decode::deserializeString(&reader);
-    if (nameRv.isErr()) {
-        return false;
-    }
-    if (!base().handleDeviceName(reader.current() - reader.start(), nameRv.unwrap())) {
-        return true;
-    }
-
-    uint64_t projectSize = 0;
-    if (!reader.readVarUint(&projectSize)) {
-        return false;
-    }
-    if (reader.sizeLeft() < projectSize) {
-        return false;
-    }
-    if (!base().handleSerializedProject(reader.current() - reader.start(), bmcl::Bytes(reader.current(), projectSize))) {
-        return true;
-    }
-    reader.skip(projectSize);
-
-    constexpr uint8_t sepFirstPart = 0x63;
-    constexpr uint8_t sepSecondPart = 0xc1;
-    const uint8_t* lastOk = reader.current();
-    while (reader.readableSize() != 0) {
-        const uint8_t* start = reader.current();
-        const uint8_t* current = start;
-        const uint8_t* end = reader.end();
-        current = std::find(current, end, sepFirstPart);
-        const uint8_t* csStart = current;
-        if (current == end) {
-            base().handleBrokenPart(reader.start() - lastOk, bmcl::Bytes(lastOk, current));
-            return true;
-        }
-        current++;
-        if (current == end) {
-            base().handleBrokenPart(reader.start() - lastOk, bmcl::Bytes(lastOk, current));
-            return true;
-        }
-        if (*current != sepSecondPart) {
-            reader.skip(current - start);
-            continue;
-        }
-        current++;
-        reader.skip(current - start);
-
-        photongen::blog::MsgKind kind;
-
-        photon::CoderState state(photon::OnboardTime::now());
-        if (!photongenDeserializeBlogMsgKind(&kind, &reader, &state)) {
-            continue;
-        }
-        uint64_t time = 0;
-        if (!reader.readVarUint(&time)) {
-            continue;
-        }
-        uint64_t size = 0;
-        if (!reader.readVarUint(&size)) {
-            continue;
-        }
-        if (reader.readableSize() < size) {
-            continue;
-        }
-        bmcl::Bytes chunk(reader.current(), size);
-        std::size_t offset = reader.current() - reader.start();
-        BlogMsg msg(offset, photon::OnboardTime(time), chunk);
-        switch (kind) {
-        case photongen::blog::MsgKind::PvuCmd:
-            base().handlePvuCmd(msg);
-            break;
-        case photongen::blog::MsgKind::TmMsg:
-            base().handleTmMsg(msg);
-            break;
-        case photongen::blog::MsgKind::FwtCmd:
-            base().handleFwtCmd(msg);
-            break;
-        }
-        reader.skip(size);
-        if (lastOk != start) {
-            base().handleBrokenPart(csStart - lastOk, bmcl::Bytes(lastOk, csStart));
-        }
-
-        lastOk = reader.current();
-    }
-
-    return true;
-}
-
-template <typename B>
-inline B& BlogParser<B>::base()
-{
-    return *static_cast<B*>(this);
-}
-
-template <typename B>
-inline bool BlogParser<B>::handleDeviceName(std::size_t offset, bmcl::StringView name)
-{
-    (void)offset;
-    (void)name;
-    return true;
-}
-
-template <typename B>
-inline bool BlogParser<B>::handleSerializedProject(std::size_t offset, bmcl::Bytes data)
-{
-    (void)offset;
-    (void)data;
-    return true;
-}
-
-template <typename B>
-inline bool BlogParser<B>::handleBrokenPart(std::size_t offset, bmcl::Bytes data)
-{
-    (void)offset;
-    (void)data;
-    return true;
-}
-
-template <typename B>
-inline bool BlogParser<B>::handlePvuCmd(const BlogMsg& msg)
-{
-    (void)msg;
-    return true;
-}
-
-template <typename B>
-inline bool BlogParser<B>::handleTmMsg(const BlogMsg& msg)
-{
-    (void)msg;
-    return true;
-}
-
-template <typename B>
-inline bool BlogParser<B>::handleFwtCmd(const BlogMsg& msg)
-{
-    (void)msg;
-    return true;
-}
-
-class BlogInfo : public BlogParser<BlogInfo> {
+class BlogInfo : public photon::BlogParser<BlogInfo> {
 public:
     struct KindInfo {
         KindInfo()
@@ -204,7 +28,7 @@ public:
         {
         }
 
-        void add(const BlogMsg& msg)
+        void add(const photon::BlogMsg& msg)
         {
             num++;
             size += msg.data.size();
@@ -215,6 +39,8 @@ public:
     };
 
     BlogInfo()
+        : logRecordNum(0)
+        , brokenLogRecordsNum(0)
     {
     }
 
@@ -237,28 +63,66 @@ public:
         return true;
     }
 
-    bool handlePvuCmd(const BlogMsg& msg)
+    bool handlePvuCmd(const photon::BlogMsg& msg)
     {
         pvuCmdInfo.add(msg);
         return true;
     }
 
-    bool handleTmMsg(const BlogMsg& msg)
+    bool handleTmMsg(const photon::BlogMsg& msg)
     {
         tmMsgInfo.add(msg);
         return true;
     }
 
-    bool handleFwtCmd(const BlogMsg& msg)
+    bool handleFwtCmd(const photon::BlogMsg& msg)
     {
         fwtCmdInfo.add(msg);
         return true;
     }
 
+    bool handleLogRecords(const photon::BlogMsg& msg)
+    {
+        logRecordsInfo.add(msg);
+        if (!photon::BlogParser<BlogInfo>::handleLogRecords(msg)) {
+            brokenLogRecordsNum++;
+        }
+        return true;
+    }
+
+    bool handleLogRecord(const photon::BlogMsg& msg, const photon::LogRecord& record)
+    {
+        logRecordNum++;
+        if (logStrings.size() == 0) {
+            return true;
+        }
+        static const char* levels[] = {"NONE", "FATAL", "CRITICAL", "WARNING", "INFO", "DEBUG"};
+        const char* level = record.level < 6 ? levels[record.level] : "?";
+        const std::string* fname = logStrings.find(record.fnameId);
+        const std::string* fmt = logStrings.find(record.fmtId);
+
+        char timeStr[20] = {0};
+        std::time_t t = record.time;
+        std::strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", std::localtime(&t));
+        std::cout << timeStr << " [" << (fname ? *fname : "?") << ":" << record.line << "] " << level << ": ";
+        if (fmt) {
+            std::cout << photon::formatLogRecord(record, *fmt) << std::endl;
+        } else {
+            char unknown[32];
+            std::snprintf(unknown, sizeof(unknown), "<unknown format %08x>", (unsigned)record.fmtId);
+            std::cout << unknown << std::endl;
+        }
+        return true;
+    }
+
     KindInfo brokenInfo;
     KindInfo pvuCmdInfo;
     KindInfo tmMsgInfo;
     KindInfo fwtCmdInfo;
+    KindInfo logRecordsInfo;
+    std::size_t logRecordNum;
+    std::size_t brokenLogRecordsNum;
+    photon::LogStringTable logStrings;
 };
 
 std::ostream& operator<<(std::ostream& os, const BlogInfo::KindInfo& info)
@@ -267,26 +131,45 @@ std::ostream& operator<<(std::ostream& os, const BlogInfo::KindInfo& info)
     return os;
 }
 
-const char* usage = "photon-blog-info path/to/logfile.pblog";
+const char* usage = "photon-blog-info [--log-strings path/to/photon-log-strings.txt] path/to/logfile.pblog";
 
 int main(int argc, char** argv)
 {
     TCLAP::CmdLine cmdLine(usage);
     TCLAP::UnlabeledValueArg<std::string> pathArg("path", "Path to file", true, "", "path");
+    TCLAP::ValueArg<std::string> logStringsArg("l", "log-strings", "Path to string table generated by photon-log-strings, log records are printed if set", false, "", "path");
 
     cmdLine.add(&pathArg);
+    cmdLine.add(&logStringsArg);
     cmdLine.parse(argc, argv);
 
+    BlogInfo info;
+    if (logStringsArg.isSet() && !info.logStrings.load(logStringsArg.getValue())) {
+        BMCL_CRITICAL() << "failed to read log string table";
+        return 1;
+    }
+
     auto fileRv = bmcl::readFileIntoBuffer(pathArg.getValue().c_str());
     if (fileRv.isErr()) {
         BMCL_CRITICAL() << "failed to read file";
         return 1;
     }
 
-    std::cout << "File size: " << fileRv.unwrap().size() << " bytes" << std::endl;
+    const auto& file = fileRv.unwrap();
+    std::cout << "File size: " << file.size() << " bytes" << std::endl;
 
-    BlogInfo info;
-    if (!info.parse(fileRv.unwrap())) {
+    bmcl::Bytes data(file.data(), file.size());
+    std::vector<uint8_t> stream;
+    if (photon::isBlockFile(data)) {
+        photon::BlockStats stats;
+        stream = photon::decodeBlocks(data, &stats);
+        data = bmcl::Bytes(stream.data(), stream.size());
+        std::cout << "Blocks: " << stats.num << " (" << stats.compressedNum << " compressed, "
+                  << stats.rawSize << " bytes -> " << stats.storedSize << " bytes)" << std::endl;
+        std::cout << "Broken blocks: " << stats.brokenNum << std::endl;
+    }
+
+    if (!info.parse(data)) {
         BMCL_CRITICAL() << "failed to parse blog";
         return 1;
     }
@@ -294,6 +177,8 @@ int main(int argc, char** argv)
     std::cout << "Pvu commands: " << info.pvuCmdInfo << std::endl;
     std::cout << "Tm messages: " << info.tmMsgInfo << std::endl;
     std::cout << "Fwt commands: " << info.fwtCmdInfo << std::endl;
+    std::cout << "Log records: " << info.logRecordsInfo << ", " << info.logRecordNum << " records, "
+              << info.brokenLogRecordsNum << " broken" << std::endl;
     std::cout << "Broken segments: " << info.brokenInfo <<  std::endl;
 
     return 0;
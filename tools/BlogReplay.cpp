@@ -0,0 +1,111 @@
+#include <photon/groundcontrol/BlogReplay.h>
+#include <photon/groundcontrol/TmState.h>
+#include <photon/groundcontrol/Atoms.h>
+
+#include <bmcl/Logging.h>
+
+#include <tclap/CmdLine.h>
+
+#include <caf/send.hpp>
+#include <caf/actor_system.hpp>
+#include <caf/actor_system_config.hpp>
+#include <caf/event_based_actor.hpp>
+#include <caf/scoped_actor.hpp>
+#include <caf/exit_reason.hpp>
+
+#include <iostream>
+#include <limits>
+#include <string>
+
+using namespace photon;
+
+// drops model updates, forwards replay events to waiting scoped actor
+class ReplayHandler : public caf::event_based_actor {
+public:
+    ReplayHandler(caf::actor_config& cfg, const caf::actor& waiter, bool isVerbose)
+        : caf::event_based_actor(cfg)
+        , _waiter(waiter)
+        , _isVerbose(isVerbose)
+    {
+        set_default_handler(caf::drop);
+    }
+
+    caf::behavior make_behavior() override
+    {
+        return caf::behavior{
+            [this](LogAtom, const std::string& msg) {
+                BMCL_INFO() << msg;
+            },
+            [this](ExchangeErrorEventAtom, const std::string& msg) {
+                if (_isVerbose) {
+                    BMCL_WARNING() << msg;
+                }
+                _errors++;
+            },
+            [this](ReplayFinishedEventAtom, uint64_t msgs, uint64_t duration) {
+                send(_waiter, ReplayFinishedEventAtom::value, msgs, duration, _errors);
+            },
+        };
+    }
+
+    void on_exit() override
+    {
+        destroy(_waiter);
+    }
+
+private:
+    caf::actor _waiter;
+    uint64_t _errors = 0;
+    bool _isVerbose;
+};
+
+const char* usage = "photon-blog-replay path/to/logfile.pblog";
+
+int main(int argc, char** argv)
+{
+    TCLAP::CmdLine cmdLine(usage);
+    TCLAP::UnlabeledValueArg<std::string> pathArg("path", "Path to file", true, "", "path");
+    TCLAP::ValueArg<double> speedArg("s", "speed", "Replay speed relative to onboard time, 0 - as fast as possible", false, 0, "speed");
+    TCLAP::ValueArg<uint64_t> fromArg("f", "from", "Start onboard time, ms", false, 0, "time");
+    TCLAP::ValueArg<uint64_t> toArg("t", "to", "End onboard time, ms", false, std::numeric_limits<uint64_t>::max(), "time");
+    TCLAP::SwitchArg verboseArg("v", "verbose", "Print decoding errors");
+
+    cmdLine.add(&pathArg);
+    cmdLine.add(&speedArg);
+    cmdLine.add(&fromArg);
+    cmdLine.add(&toArg);
+    cmdLine.add(&verboseArg);
+    cmdLine.parse(argc, argv);
+
+    caf::actor_system_config cfg;
+    caf::actor_system system(cfg);
+    caf::scoped_actor self(system);
+
+    caf::actor handler = system.spawn<ReplayHandler>(caf::actor_cast<caf::actor>(self), verboseArg.getValue());
+    caf::actor tm = system.spawn<TmState>(handler);
+    caf::actor replay = system.spawn<BlogReplay>(pathArg.getValue(), tm, handler, speedArg.getValue());
+
+    self->monitor(replay);
+    caf::anon_send(replay, SeekReplayAtom::value, fromArg.getValue(), toArg.getValue());
+    caf::anon_send(replay, StartAtom::value);
+
+    int rv = 0;
+    self->receive(
+        [&](ReplayFinishedEventAtom, uint64_t msgs, uint64_t duration, uint64_t errors) {
+            double seconds = duration / 1000000.0;
+            std::cout << "Tm messages: " << msgs << std::endl;
+            std::cout << "Decode errors: " << errors << std::endl;
+            std::cout << "Time: " << seconds << " s" << std::endl;
+            if (duration != 0) {
+                std::cout << "Throughput: " << uint64_t(msgs / seconds) << " msg/s" << std::endl;
+            }
+        },
+        [&](const caf::down_msg&) {
+            BMCL_CRITICAL() << "failed to load blog";
+            rv = 1;
+        }
+    );
+
+    caf::anon_send_exit(replay, caf::exit_reason::user_shutdown);
+    return rv;
+}
@@ -0,0 +1,62 @@
+#include <photon/groundcontrol/LogRecord.h>
+
+#include <bmcl/Logging.h>
+
+#include <tclap/CmdLine.h>
+
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// generates string table used to format deferred log records outside the image, see LogStringTable
+const char* usage = "photon-log-strings -o path/to/photon-log-strings.txt sources...";
+
+static bool isSourceFile(const std::string& path)
+{
+    auto endsWith = [&path](const char* ext) {
+        std::size_t size = std::strlen(ext);
+        return path.size() >= size && path.compare(path.size() - size, size, ext) == 0;
+    };
+    return endsWith(".c") || endsWith(".h");
+}
+
+int main(int argc, char** argv)
+{
+    TCLAP::CmdLine cmdLine(usage);
+    TCLAP::ValueArg<std::string> outArg("o", "output", "Path to generated table", true, "", "path");
+    TCLAP::UnlabeledMultiArg<std::string> sourcesArg("sources", "Onboard sources, files other than .c and .h are ignored", false, "path");
+
+    cmdLine.add(&outArg);
+    cmdLine.add(&sourcesArg);
+    cmdLine.parse(argc, argv);
+
+    std::set<std::string> strings;
+    for (const std::string& path : sourcesArg.getValue()) {
+        if (!isSourceFile(path)) {
+            continue;
+        }
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            BMCL_CRITICAL() << "failed to read " << path;
+            return 1;
+        }
+        std::stringstream source;
+        source << file.rdbuf();
+        for (std::string& str : photon::extractLogStrings(source.str())) {
+            strings.insert(std::move(str));
+        }
+    }
+
+    std::ofstream out(outArg.getValue(), std::ios::binary | std::ios::trunc);
+    for (const std::string& str : strings) {
+        out << photon::escapeLogString(str) << '\n';
+    }
+    if (!out.good()) {
+        BMCL_CRITICAL() << "failed to write " << outArg.getValue();
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+// Build time helper, packs project package generated by decode-gen into compressed package served by fwt module.
+// Compiled for host with the same device definitions as onboard sources, writes header with _packageLz4 array
+// included by fwt/Fwt.c when PHOTON_CFG_FWT_PACKAGE_LZ4 is enabled.
+//
+// package: ["pkz4"][u32le rawSize][blocks]
+// block: [u16le rawSize][u16le storedSize][stored data], data is stored uncompressed if sizes are equal
+
+#include "photon/blog/Lz4.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "photongen/onboard/Package.inc.c"
+
+// compressor positions are 16 bit
+#define BLOCK_SIZE 32768
+#define BLOCK_HEADER_SIZE 4
+
+static const char magicPrefix[4] = {'p', 'k', 'z', '4'};
+
+static uint16_t table[PHOTON_LZ4_HASH_TABLE_SIZE];
+
+static size_t compressPackage(const uint8_t* src, size_t srcSize, uint8_t* dest)
+{
+    uint8_t* current = dest;
+    memcpy(current, magicPrefix, sizeof(magicPrefix));
+    current += sizeof(magicPrefix);
+    current[0] = (uint8_t)srcSize;
+    current[1] = (uint8_t)(srcSize >> 8);
+    current[2] = (uint8_t)(srcSize >> 16);
+    current[3] = (uint8_t)(srcSize >> 24);
+    current += 4;
+
+    while (srcSize != 0) {
+        size_t rawSize = srcSize < BLOCK_SIZE ? srcSize : BLOCK_SIZE;
+        uint8_t* header = current;
+        current += BLOCK_HEADER_SIZE;
+        size_t storedSize = PhotonLz4_Compress(src, rawSize, current, rawSize - 1, table);
+        if (storedSize == 0) {
+            memcpy(current, src, rawSize);
+            storedSize = rawSize;
+        }
+        header[0] = (uint8_t)rawSize;
+        header[1] = (uint8_t)(rawSize >> 8);
+        header[2] = (uint8_t)storedSize;
+        header[3] = (uint8_t)(storedSize >> 8);
+        current += storedSize;
+        src += rawSize;
+        srcSize -= rawSize;
+    }
+    return current - dest;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s path/to/PackageLz4.h\n", argv[0]);
+        return 1;
+    }
+
+    size_t blockNum = (_PHOTON_PACKAGE_SIZE + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint8_t* packed = (uint8_t*)malloc(8 + _PHOTON_PACKAGE_SIZE + blockNum * BLOCK_HEADER_SIZE);
+    if (!packed) {
+        fprintf(stderr, "failed to allocate memory\n");
+        return 1;
+    }
+    size_t packedSize = compressPackage(_package, _PHOTON_PACKAGE_SIZE, packed);
+
+    FILE* file = fopen(argv[1], "w");
+    if (!file) {
+        fprintf(stderr, "failed to open %s\n", argv[1]);
+        free(packed);
+        return 1;
+    }
+    fprintf(file, "// generated by photon-package-compress from Package.inc.c, %u -> %u bytes\n\n",
+            (unsigned)_PHOTON_PACKAGE_SIZE, (unsigned)packedSize);
+    fprintf(file, "#define _PHOTON_PACKAGE_LZ4_SIZE %u\n\n", (unsigned)packedSize);
+    fprintf(file, "static const uint8_t _packageLz4[%u] = {", (unsigned)packedSize);
+    for (size_t i = 0; i < packedSize; i++) {
+        if ((i % 16) == 0) {
+            fprintf(file, "\n   ");
+        }
+        fprintf(file, " 0x%02x,", packed[i]);
+    }
+    fprintf(file, "\n};\n");
+    free(packed);
+
+    if (fclose(file) != 0) {
+        fprintf(stderr, "failed to write %s\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}